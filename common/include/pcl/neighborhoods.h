@@ -0,0 +1,283 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Point Cloud Library (PCL) - www.pointclouds.org
+ *  Copyright (c) 2010-2011, Willow Garage, Inc.
+ *  Copyright (c) 2012-, Open Perception, Inc.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_NEIGHBORHOODS_H_
+#define PCL_NEIGHBORHOODS_H_
+
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <pcl/common/point_tests.h>
+#include <boost/mpl/bool.hpp>
+#include <algorithm>
+#include <vector>
+
+namespace pcl {
+/** \brief The neighbors found by a batch of nearest neighbor searches, in
+ * compressed sparse row layout: the neighbors of the i-th query are
+ * indices[offsets[i]] ... indices[offsets[i + 1] - 1], with their squared
+ * distances at the same positions in sqr_distances.
+ *
+ * The batch searches only resize the arrays, so reusing the same object for
+ * consecutive batches does not reallocate memory once it has grown large
+ * enough.
+ * \ingroup common
+ */
+struct Neighborhoods {
+    /** \brief The start of the neighbors of each query, plus the total
+     * number of neighbors as last element. */
+    std::vector<size_t> offsets;
+
+    /** \brief The indices of the neighbors of all the queries. */
+    std::vector<int> indices;
+
+    /** \brief The squared distances to the neighbors of all the queries. */
+    std::vector<float> sqr_distances;
+
+    /** \brief Get the number of queries. */
+    inline size_t size() const {
+        return (offsets.empty() ? 0 : offsets.size() - 1);
+    }
+
+    /** \brief Get the number of neighbors of the i-th query. */
+    inline int getNumberOfNeighbors(size_t i) const {
+        return (static_cast<int>(offsets[i + 1] - offsets[i]));
+    }
+
+    /** \brief Get the indices of the neighbors of the i-th query. */
+    inline const int *getIndices(size_t i) const {
+        return (indices.empty() ? NULL : &indices[0] + offsets[i]);
+    }
+
+    /** \brief Get the squared distances to the neighbors of the i-th query. */
+    inline const float *getSqrDistances(size_t i) const {
+        return (sqr_distances.empty() ? NULL : &sqr_distances[0] + offsets[i]);
+    }
+
+    /** \brief Copy the neighbors of the i-th query, as returned by the single
+     * query searches.
+     */
+    inline void get(size_t i, std::vector<int> &k_indices,
+                    std::vector<float> &k_sqr_distances) const {
+        k_indices.assign(indices.begin() + offsets[i],
+                         indices.begin() + offsets[i + 1]);
+        k_sqr_distances.assign(sqr_distances.begin() + offsets[i],
+                               sqr_distances.begin() + offsets[i + 1]);
+    }
+};
+
+namespace detail {
+/** \brief Whether PointT has x, y and z coordinates (tested on z). */
+template <typename PointT> struct HasXYZ {
+    template <typename U> static char test(char (*)[sizeof(&U::z)]);
+    template <typename U> static long test(...);
+    static const bool value = sizeof(test<PointT>(0)) == 1;
+};
+
+template <typename PointT>
+inline bool isValidQuery(const PointT &point, boost::mpl::true_) {
+    return (pcl::isFinite(point));
+}
+
+template <typename PointT>
+inline bool isValidQuery(const PointT &, boost::mpl::false_) {
+    return (true);
+}
+
+/** \brief Check whether a point can be used as a search query: its
+ * coordinates, if it has any, must be finite.
+ */
+template <typename PointT> inline bool isValidQuery(const PointT &point) {
+    return (isValidQuery(point, boost::mpl::bool_<HasXYZ<PointT>::value>()));
+}
+
+/** \brief Run nr_queries independent neighbor searches in parallel and
+ * gather their results in neighborhoods.
+ * \param[in] search the functor searching the neighbors of the i-th query
+ * with int search (i, k_indices, k_sqr_distances) and returning how many it
+ * found. Every thread works on its own copy of it.
+ * \param[in] nr_queries the number of queries
+ * \param[in] k the maximum number of neighbors of a query, or 0 if unknown
+ * \param[in] nr_threads the number of threads to use (0 for automatic)
+ * \param[out] neighborhoods the neighbors of the queries
+ */
+template <typename SearchFunctor>
+void searchNeighborhoods(SearchFunctor search, int nr_queries, int k,
+                         unsigned int nr_threads,
+                         Neighborhoods &neighborhoods) {
+    std::vector<size_t> &offsets = neighborhoods.offsets;
+    std::vector<int> &indices = neighborhoods.indices;
+    std::vector<float> &sqr_distances = neighborhoods.sqr_distances;
+    offsets.resize(nr_queries + 1);
+    offsets[0] = 0;
+
+    // Buffers of the single searches, one per thread
+    std::vector<int> k_indices;
+    std::vector<float> k_sqr_distances;
+
+    if (k > 0) {
+        // Store the neighbors of the i-th query at i * k, then close the gaps
+        // left by the queries with less than k neighbors
+        indices.resize(static_cast<size_t>(nr_queries) * k);
+        sqr_distances.resize(indices.size());
+#pragma omp parallel for firstprivate(search)                                 \
+    private(k_indices, k_sqr_distances) num_threads(nr_threads)               \
+    schedule(dynamic, 64)
+        for (int i = 0; i < nr_queries; ++i) {
+            int n = std::min(search(i, k_indices, k_sqr_distances), k);
+            size_t first = static_cast<size_t>(i) * k;
+            std::copy(k_indices.begin(), k_indices.begin() + n,
+                      indices.begin() + first);
+            std::copy(k_sqr_distances.begin(), k_sqr_distances.begin() + n,
+                      sqr_distances.begin() + first);
+            offsets[i + 1] = n;
+        }
+
+        size_t total = 0;
+        for (int i = 0; i < nr_queries; ++i) {
+            size_t n = offsets[i + 1];
+            size_t first = static_cast<size_t>(i) * k;
+            if (total != first) {
+                std::copy(indices.begin() + first,
+                          indices.begin() + first + n,
+                          indices.begin() + total);
+                std::copy(sqr_distances.begin() + first,
+                          sqr_distances.begin() + first + n,
+                          sqr_distances.begin() + total);
+            }
+            total += n;
+            offsets[i + 1] = total;
+        }
+        indices.resize(total);
+        sqr_distances.resize(total);
+        return;
+    }
+
+    // The number of neighbors is not bounded: gather the results of blocks of
+    // consecutive queries separately, then concatenate them
+    const int block_size = 64;
+    const int nr_blocks = (nr_queries + block_size - 1) / block_size;
+    std::vector<std::vector<int> > block_indices(nr_blocks);
+    std::vector<std::vector<float> > block_sqr_distances(nr_blocks);
+#pragma omp parallel for firstprivate(search)                                 \
+    private(k_indices, k_sqr_distances) num_threads(nr_threads)               \
+    schedule(dynamic)
+    for (int b = 0; b < nr_blocks; ++b) {
+        const int end = std::min(nr_queries, (b + 1) * block_size);
+        for (int i = b * block_size; i < end; ++i) {
+            int n = search(i, k_indices, k_sqr_distances);
+            block_indices[b].insert(block_indices[b].end(), k_indices.begin(),
+                                    k_indices.begin() + n);
+            block_sqr_distances[b].insert(block_sqr_distances[b].end(),
+                                          k_sqr_distances.begin(),
+                                          k_sqr_distances.begin() + n);
+            offsets[i + 1] = n;
+        }
+    }
+
+    for (int i = 0; i < nr_queries; ++i)
+        offsets[i + 1] += offsets[i];
+    indices.resize(offsets[nr_queries]);
+    sqr_distances.resize(offsets[nr_queries]);
+#pragma omp parallel for num_threads(nr_threads)
+    for (int b = 0; b < nr_blocks; ++b) {
+        std::copy(block_indices[b].begin(), block_indices[b].end(),
+                  indices.begin() + offsets[b * block_size]);
+        std::copy(block_sqr_distances[b].begin(),
+                  block_sqr_distances[b].end(),
+                  sqr_distances.begin() + offsets[b * block_size]);
+    }
+}
+
+/** \brief Functor searching the k nearest neighbors of the points of a cloud
+ * through the single query interface of SearchT, for searchNeighborhoods ().
+ * Queries with non finite coordinates get no neighbors.
+ */
+template <typename SearchT, typename PointT> struct NearestKSearchFunctor {
+    NearestKSearchFunctor(const SearchT &search,
+                          const pcl::PointCloud<PointT> &cloud,
+                          const std::vector<int> &indices, int k)
+        : search_(search), cloud_(cloud), indices_(indices), k_(k) {}
+
+    inline int operator()(int i, std::vector<int> &k_indices,
+                          std::vector<float> &k_sqr_distances) const {
+        const PointT &point = cloud_.points[indices_.empty() ? i : indices_[i]];
+        if (!isValidQuery(point))
+            return (0);
+        return (search_.nearestKSearch(point, k_, k_indices, k_sqr_distances));
+    }
+
+    const SearchT &search_;
+    const pcl::PointCloud<PointT> &cloud_;
+    const std::vector<int> &indices_;
+    int k_;
+};
+
+/** \brief Functor searching the neighbors within a radius of the points of a
+ * cloud through the single query interface of SearchT, for
+ * searchNeighborhoods (). Queries with non finite coordinates get no
+ * neighbors.
+ */
+template <typename SearchT, typename PointT> struct RadiusSearchFunctor {
+    RadiusSearchFunctor(const SearchT &search,
+                        const pcl::PointCloud<PointT> &cloud,
+                        const std::vector<int> &indices, double radius,
+                        unsigned int max_nn)
+        : search_(search), cloud_(cloud), indices_(indices), radius_(radius),
+          max_nn_(max_nn) {}
+
+    inline int operator()(int i, std::vector<int> &k_indices,
+                          std::vector<float> &k_sqr_distances) const {
+        const PointT &point = cloud_.points[indices_.empty() ? i : indices_[i]];
+        if (!isValidQuery(point))
+            return (0);
+        return (search_.radiusSearch(point, radius_, k_indices,
+                                     k_sqr_distances, max_nn_));
+    }
+
+    const SearchT &search_;
+    const pcl::PointCloud<PointT> &cloud_;
+    const std::vector<int> &indices_;
+    double radius_;
+    unsigned int max_nn_;
+};
+} // namespace detail
+} // namespace pcl
+
+#endif // PCL_NEIGHBORHOODS_H_
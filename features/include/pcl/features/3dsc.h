@@ -160,6 +160,47 @@ class ShapeContext3DEstimation
     bool computePoint(size_t index, const pcl::PointCloud<PointNT> &normals,
                       float rf[9], std::vector<float> &desc);
 
+    /** \brief Estimate a descriptor for a given point, using a given random
+     * vector to select the X axis. This method does not modify the object and
+     * can be called from several threads at once.
+     * \param[in] index the index of the point to estimate a descriptor for
+     * \param[in] normals a pointer to the set of normals
+     * \param[in] random_axis three random numbers in [0, 1) used to build the
+     * X axis
+     * \param[in] rf the reference frame
+     * \param[out] desc the resultant estimated descriptor, which must be zeroed
+     * \param[out] nn_indices scratch buffer for the neighbor indices
+     * \param[out] nn_dists scratch buffer for the neighbor distances
+     * \return true if the descriptor was computed successfully, false if there
+     * was an error (e.g. the nearest neighbor didn't return any neighbors)
+     */
+    bool computePoint(size_t index, const pcl::PointCloud<PointNT> &normals,
+                      const Eigen::Vector3f &random_axis, float rf[9],
+                      std::vector<float> &desc, std::vector<int> &nn_indices,
+                      std::vector<float> &nn_dists) const;
+
+    /** \brief Find the first bin whose upper division is not smaller than
+     * value, or 0 if there is none.
+     * \param[in] value the value to bin
+     * \param[in] divisions the bin divisions, in increasing order
+     * \param[in] estimate an estimate of the bin, from which the search starts
+     */
+    static inline size_t findBin(float value,
+                                 const std::vector<float> &divisions,
+                                 float estimate) {
+        const size_t bins = divisions.size() - 1;
+        if (!(value <= divisions[bins]))
+            return (0);
+        size_t bin = estimate > 0.0f
+                         ? (std::min)(static_cast<size_t>(estimate), bins - 1)
+                         : 0;
+        while (bin > 0 && value <= divisions[bin])
+            --bin;
+        while (value > divisions[bin + 1])
+            ++bin;
+        return (bin);
+    }
+
     /** \brief Estimate the actual feature.
      * \param[out] output the resultant feature
      */
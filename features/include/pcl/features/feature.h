@@ -123,12 +123,14 @@ class Feature : public PCLBase<PointInT> {
                                 std::vector<int> &, std::vector<float> &)>
         SearchMethodSurface;
 
+    typedef boost::shared_ptr<const pcl::Neighborhoods> NeighborhoodsConstPtr;
+
   public:
     /** \brief Empty constructor. */
     Feature()
         : feature_name_(), search_method_surface_(), surface_(), tree_(),
-          search_parameter_(0), search_radius_(0), k_(0), fake_surface_(false) {
-    }
+          neighborhoods_(), search_parameter_(0), search_radius_(0), k_(0),
+          fake_surface_(false) {}
 
     /** \brief Provide a pointer to a dataset to add additional information
      * to estimate the features for every point in the input dataset.  This
@@ -154,6 +156,26 @@ class Feature : public PCLBase<PointInT> {
     /** \brief Get a pointer to the search method used. */
     inline KdTreePtr getSearchMethod() const { return (tree_); }
 
+    /** \brief Provide the neighbors of every point of the search surface,
+     * found beforehand with the search parameter of this feature (e.g. by a
+     * batch search shared by several estimators), so that they are not
+     * searched again. The i-th neighborhood holds the neighbors of the i-th
+     * point of the search surface.
+     * \note Only the estimators documenting it use these neighborhoods
+     * (PFHEstimation, FPFHEstimation and their OpenMP versions), the others
+     * still search the neighbors themselves.
+     * \param[in] neighborhoods the neighborhoods of the search surface points
+     */
+    inline void
+    setSearchNeighborhoods(const NeighborhoodsConstPtr &neighborhoods) {
+        neighborhoods_ = neighborhoods;
+    }
+
+    /** \brief Get the neighborhoods of the search surface points, if any. */
+    inline NeighborhoodsConstPtr getSearchNeighborhoods() const {
+        return (neighborhoods_);
+    }
+
     /** \brief Get the internal search parameter. */
     inline double getSearchParameter() const { return (search_parameter_); }
 
@@ -204,6 +226,9 @@ class Feature : public PCLBase<PointInT> {
     /** \brief A pointer to the spatial search object. */
     KdTreePtr tree_;
 
+    /** \brief The neighborhoods of the search surface points, if given. */
+    NeighborhoodsConstPtr neighborhoods_;
+
     /** \brief The actual search parameter (from either \a search_radius_ or \a
      * k_). */
     double search_parameter_;
@@ -268,6 +293,48 @@ class Feature : public PCLBase<PointInT> {
                                        distances));
     }
 
+    /** \brief Search for the neighbors of a batch of points at once, using
+     * the spatial locator from \a setSearchMethod with either \a k_ or \a
+     * search_radius_.
+     * \param[in] cloud the query point cloud
+     * \param[in] indices the indices of the query points in \a cloud
+     * \param[out] neighborhoods the neighbors of the queries, in the order of
+     * \a indices. Non finite queries get no neighbors.
+     * \param[in] nr_threads the number of threads to use (0 for automatic)
+     */
+    inline void searchForNeighborhoods(const PointCloudIn &cloud,
+                                       const std::vector<int> &indices,
+                                       pcl::Neighborhoods &neighborhoods,
+                                       unsigned int nr_threads) const {
+        if (search_radius_ != 0.0)
+            tree_->radiusSearch(cloud, indices, search_radius_, neighborhoods,
+                                0, nr_threads);
+        else
+            tree_->nearestKSearch(cloud, indices, k_, neighborhoods,
+                                  nr_threads);
+    }
+
+    /** \brief Get the neighbors of all the query points <setInputCloud (),
+     * setIndices ()>: from the neighborhoods given by \a
+     * setSearchNeighborhoods when the queries are points of the search
+     * surface, with a single batch search otherwise.
+     * \param[out] searched holds the neighbors found by the batch search
+     * \param[out] by_point set to true if the neighbors of the idx-th query
+     * are in the (*indices_)[idx]-th neighborhood, to false if they are in
+     * the idx-th one
+     * \param[in] nr_threads the number of threads to use (0 for automatic)
+     * \return the neighborhoods holding the neighbors of the queries
+     */
+    inline const pcl::Neighborhoods &
+    getQueryNeighborhoods(pcl::Neighborhoods &searched, bool &by_point,
+                          unsigned int nr_threads) const {
+        by_point = neighborhoods_ && surface_ == input_;
+        if (by_point)
+            return (*neighborhoods_);
+        searchForNeighborhoods(*input_, *indices_, searched, nr_threads);
+        return (searched);
+    }
+
   private:
     /** \brief Abstract feature estimation method.
      * \param[out] output the resultant features
@@ -70,9 +70,10 @@ namespace pcl {
  *     doesn't have finite 3D coordinates. Therefore, any point that contains
  *     NaN data on x, y, or z, will have its FPFH feature property set to NaN.
  *
- * \note The code is stateful as we do not expect this class to be multicore
- * parallelized. Please look at \ref FPFHEstimationOMP for examples on parallel
- * implementations of the FPFH (Fast Point Feature Histogram).
+ * \note The neighbors of the search surface points can be given beforehand
+ * with \ref setSearchNeighborhoods, and are otherwise searched at most once
+ * per point. Please look at \ref FPFHEstimationOMP for a parallel
+ * implementation of the FPFH (Fast Point Feature Histogram).
  *
  * \author Radu B. Rusu
  * \ingroup features
@@ -205,6 +206,16 @@ class FPFHEstimation : public FeatureFromNormals<PointInT, PointNT, PointOutT> {
      */
     void computeFeature(PointCloudOut &output);
 
+    /** \brief Estimate the FPFH descriptors of all the query points on
+     * nr_threads threads. The neighbors of every query and SPFH point are
+     * taken from \a setSearchNeighborhoods, or searched at most once.
+     * \param[out] output the resultant point cloud model dataset that contains
+     * the FPFH feature estimates
+     * \param[in] nr_threads the number of threads to use (0 for automatic)
+     */
+    void computeFeatureParallel(PointCloudOut &output,
+                                unsigned int nr_threads);
+
     /** \brief The number of subdivisions for each angular feature interval. */
     int nr_bins_f1_, nr_bins_f2_, nr_bins_f3_;
 
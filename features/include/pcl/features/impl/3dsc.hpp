@@ -138,14 +138,31 @@ template <typename PointInT, typename PointNT, typename PointOutT>
 bool pcl::ShapeContext3DEstimation<PointInT, PointNT, PointOutT>::computePoint(
     size_t index, const pcl::PointCloud<PointNT> &normals, float rf[9],
     std::vector<float> &desc) {
+    // Draw the X axis before searching, so that the random sequence does not
+    // depend on the neighborhoods
+    Eigen::Vector3f random_axis;
+    random_axis[0] = static_cast<float>(rnd());
+    random_axis[1] = static_cast<float>(rnd());
+    random_axis[2] = static_cast<float>(rnd());
+
+    std::vector<int> nn_indices;
+    std::vector<float> nn_dists;
+    return (computePoint(index, normals, random_axis, rf, desc, nn_indices,
+                         nn_dists));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointNT, typename PointOutT>
+bool pcl::ShapeContext3DEstimation<PointInT, PointNT, PointOutT>::computePoint(
+    size_t index, const pcl::PointCloud<PointNT> &normals,
+    const Eigen::Vector3f &random_axis, float rf[9], std::vector<float> &desc,
+    std::vector<int> &nn_indices, std::vector<float> &nn_dists) const {
     // The RF is formed as this x_axis | y_axis | normal
     Eigen::Map<Eigen::Vector3f> x_axis(rf);
     Eigen::Map<Eigen::Vector3f> y_axis(rf + 3);
     Eigen::Map<Eigen::Vector3f> normal(rf + 6);
 
     // Find every point within specified search_radius_
-    std::vector<int> nn_indices;
-    std::vector<float> nn_dists;
     const size_t neighb_cnt = searchForNeighbors(
         (*indices_)[index], search_radius_, nn_indices, nn_dists);
     if (neighb_cnt == 0) {
@@ -173,9 +190,7 @@ bool pcl::ShapeContext3DEstimation<PointInT, PointNT, PointOutT>::computePoint(
     normal = normals[minIndex].getNormalVector3fMap();
 
     // Compute and store the RF direction
-    x_axis[0] = static_cast<float>(rnd());
-    x_axis[1] = static_cast<float>(rnd());
-    x_axis[2] = static_cast<float>(rnd());
+    x_axis = random_axis;
     if (!pcl::utils::equal(normal[2], 0.0f))
         x_axis[2] =
             -(normal[0] * x_axis[0] + normal[1] * x_axis[1]) / normal[2];
@@ -196,6 +211,19 @@ bool pcl::ShapeContext3DEstimation<PointInT, PointNT, PointOutT>::computePoint(
     // Store the 3rd frame vector
     y_axis.matrix() = normal.cross(x_axis);
 
+    // The divisions are log-spaced along the radius and evenly spaced along
+    // the angles, so the bins can be looked up directly
+    const float log_min_radius = logf(radii_interval_[0]);
+    const float radius_scale =
+        static_cast<float>(radius_bins_) /
+        (logf(radii_interval_[radius_bins_]) - log_min_radius);
+    const float theta_scale = static_cast<float>(elevation_bins_) / 180.0f;
+    const float phi_scale = static_cast<float>(azimuth_bins_) / 360.0f;
+
+    // Reused by the density searches of all the neighbours
+    std::vector<int> neighbour_indices;
+    std::vector<float> neighbour_distances;
+
     // For each point within radius
     for (size_t ne = 0; ne < neighb_cnt; ne++) {
         if (pcl::utils::equal(nn_dists[ne], 0.0f))
@@ -228,37 +256,14 @@ bool pcl::ShapeContext3DEstimation<PointInT, PointNT, PointOutT>::computePoint(
         float theta = normal.dot(no);
         theta = pcl::rad2deg(acosf(std::min(1.0f, std::max(-1.0f, theta))));
 
-        // Bin (j, k, l)
-        size_t j = 0;
-        size_t k = 0;
-        size_t l = 0;
-
         // Compute the Bin(j, k, l) coordinates of current neighbour
-        for (size_t rad = 1; rad < radius_bins_ + 1; rad++) {
-            if (r <= radii_interval_[rad]) {
-                j = rad - 1;
-                break;
-            }
-        }
-
-        for (size_t ang = 1; ang < elevation_bins_ + 1; ang++) {
-            if (theta <= theta_divisions_[ang]) {
-                k = ang - 1;
-                break;
-            }
-        }
-
-        for (size_t ang = 1; ang < azimuth_bins_ + 1; ang++) {
-            if (phi <= phi_divisions_[ang]) {
-                l = ang - 1;
-                break;
-            }
-        }
+        const size_t j = findBin(r, radii_interval_,
+                                 (logf(r) - log_min_radius) * radius_scale);
+        const size_t k = findBin(theta, theta_divisions_, theta * theta_scale);
+        const size_t l = findBin(phi, phi_divisions_, phi * phi_scale);
 
         // Local point density = number of points in a sphere of radius
         // "point_density_radius_" around the current neighbour
-        std::vector<int> neighbour_indices;
-        std::vector<float> neighbour_distances;
         int point_density =
             searchForNeighbors(*surface_, nn_indices[ne], point_density_radius_,
                                neighbour_indices, neighbour_distances);
@@ -0,0 +1,99 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Point Cloud Library (PCL) - www.pointclouds.org
+ *  Copyright (c) 2010-2011, Willow Garage, Inc.
+ *  Copyright (c) 2012-, Open Perception, Inc.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_FEATURES_IMPL_3DSC_OMP_HPP_
+#define PCL_FEATURES_IMPL_3DSC_OMP_HPP_
+
+#include <pcl/features/3dsc_omp.h>
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointNT, typename PointOutT>
+void pcl::ShapeContext3DEstimationOMP<
+    PointInT, PointNT, PointOutT>::computeFeature(PointCloudOut &output) {
+    assert(descriptor_length_ == 1980);
+
+    const int data_size = static_cast<int>(indices_->size());
+
+    // Draw the X axes sequentially, as ShapeContext3DEstimation does, so that
+    // the descriptors do not depend on the order in which they are computed
+    std::vector<Eigen::Vector3f> random_axes(data_size);
+    for (int idx = 0; idx < data_size; ++idx) {
+        if (!isFinite((*input_)[(*indices_)[idx]]))
+            continue;
+        random_axes[idx][0] = static_cast<float>(this->rnd());
+        random_axes[idx][1] = static_cast<float>(this->rnd());
+        random_axes[idx][2] = static_cast<float>(this->rnd());
+    }
+
+    std::vector<int> nn_indices;
+    std::vector<float> nn_dists;
+    std::vector<float> descriptor(descriptor_length_);
+
+    output.is_dense = true;
+#ifdef _OPENMP
+#pragma omp parallel for firstprivate(descriptor)                              \
+    private(nn_indices, nn_dists) num_threads(threads_) schedule(dynamic, 16)
+#endif
+    for (int idx = 0; idx < data_size; ++idx) {
+        // If the point is not finite, set the descriptor to NaN and continue
+        if (!isFinite((*input_)[(*indices_)[idx]])) {
+            for (size_t i = 0; i < descriptor_length_; ++i)
+                output[idx].descriptor[i] =
+                    std::numeric_limits<float>::quiet_NaN();
+
+            memset(output[idx].rf, 0, sizeof(output[idx].rf[0]) * 9);
+            output.is_dense = false;
+            continue;
+        }
+
+        std::fill(descriptor.begin(), descriptor.end(), 0.0f);
+        if (!this->computePoint(idx, *normals_, random_axes[idx],
+                                output[idx].rf, descriptor, nn_indices,
+                                nn_dists))
+            output.is_dense = false;
+        for (size_t j = 0; j < descriptor_length_; ++j)
+            output[idx].descriptor[j] = descriptor[j];
+    }
+}
+
+#define PCL_INSTANTIATE_ShapeContext3DEstimationOMP(T, NT, OutT)               \
+    template class PCL_EXPORTS pcl::ShapeContext3DEstimationOMP<T, NT, OutT>;
+
+#endif // PCL_FEATURES_IMPL_3DSC_OMP_HPP_
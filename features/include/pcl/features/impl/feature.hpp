@@ -112,6 +112,18 @@ bool pcl::Feature<PointInT, PointOutT>::initCompute() {
         surface_ = input_;
     }
 
+    // Make sure the given neighborhoods are those of the search surface
+    if (neighborhoods_ && neighborhoods_->size() != surface_->points.size()) {
+        PCL_ERROR("[pcl::%s::compute] The number of search neighborhoods "
+                  "(%zu) differs from the number of points in the search "
+                  "surface (%zu)!\n",
+                  getClassName().c_str(), neighborhoods_->size(),
+                  surface_->points.size());
+        // Cleanup
+        deinitCompute();
+        return (false);
+    }
+
     // Check if a space search locator was given
     if (!tree_) {
         if (surface_->isOrganized() && input_->isOrganized())
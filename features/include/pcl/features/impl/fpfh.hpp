@@ -246,74 +246,151 @@ void pcl::FPFHEstimation<PointInT, PointNT, PointOutT>::computeSPFHSignatures(
 template <typename PointInT, typename PointNT, typename PointOutT>
 void pcl::FPFHEstimation<PointInT, PointNT, PointOutT>::computeFeature(
     PointCloudOut &output) {
-    // Allocate enough space to hold the NN search results
-    // \note This resize is irrelevant for a radiusSearch ().
-    std::vector<int> nn_indices(k_);
-    std::vector<float> nn_dists(k_);
+    computeFeatureParallel(output, 1);
+}
 
-    std::vector<int> spfh_hist_lookup;
-    computeSPFHSignatures(spfh_hist_lookup, hist_f1_, hist_f2_, hist_f3_);
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointNT, typename PointOutT>
+void pcl::FPFHEstimation<PointInT, PointNT, PointOutT>::computeFeatureParallel(
+    PointCloudOut &output, unsigned int nr_threads) {
+    // Get the neighbors of all the queries once, for both passes
+    pcl::Neighborhoods searched;
+    bool by_point;
+    const pcl::Neighborhoods &neighborhoods =
+        this->getQueryNeighborhoods(searched, by_point, nr_threads);
+    const int nr_queries = static_cast<int>(indices_->size());
 
-    output.is_dense = true;
-    // Save a few cycles by not checking every point for NaN/Inf values if the
-    // cloud is set to dense
-    if (input_->is_dense) {
-        // Iterate over the entire index vector
-        for (size_t idx = 0; idx < indices_->size(); ++idx) {
-            if (this->searchForNeighbors((*indices_)[idx], search_parameter_,
-                                         nn_indices, nn_dists) == 0) {
-                for (int d = 0; d < fpfh_histogram_.size(); ++d)
-                    output.points[idx].histogram[d] =
-                        std::numeric_limits<float>::quiet_NaN();
+    // Build a list of (unique) indices for which we will need to compute SPFH
+    // signatures (We need an SPFH signature for every point that is a neighbor
+    // of any point in input_[indices_]), and a lookup table for converting a
+    // point index to its corresponding row in the spfh_hist_* matrices
+    std::vector<int> spfh_hist_lookup(surface_->points.size(), -1);
+    for (int idx = 0; idx < nr_queries; ++idx) {
+        const size_t row = by_point ? (*indices_)[idx] : idx;
+        const int *nn = neighborhoods.getIndices(row);
+        for (int i = 0; i < neighborhoods.getNumberOfNeighbors(row); ++i)
+            spfh_hist_lookup[nn[i]] = 0;
+    }
+    std::vector<int> spfh_indices;
+    for (size_t p_idx = 0; p_idx < spfh_hist_lookup.size(); ++p_idx) {
+        if (spfh_hist_lookup[p_idx] < 0)
+            continue;
+        spfh_hist_lookup[p_idx] = static_cast<int>(spfh_indices.size());
+        spfh_indices.push_back(static_cast<int>(p_idx));
+    }
+    const int nr_spfh = static_cast<int>(spfh_indices.size());
+
+    // Find the neighborhoods of the SPFH points: they are either given, or
+    // already known for the points which are also queries, or searched at
+    // once for the others
+    std::vector<const int *> spfh_nn_indices(nr_spfh);
+    std::vector<int> spfh_nr_neighbors(nr_spfh);
+    pcl::Neighborhoods spfh_searched;
+    if (this->neighborhoods_) {
+        for (int i = 0; i < nr_spfh; ++i) {
+            spfh_nn_indices[i] =
+                this->neighborhoods_->getIndices(spfh_indices[i]);
+            spfh_nr_neighbors[i] =
+                this->neighborhoods_->getNumberOfNeighbors(spfh_indices[i]);
+        }
+    } else {
+        std::vector<int> query_lookup;
+        if (surface_ == input_) {
+            query_lookup.resize(surface_->points.size(), -1);
+            for (int idx = 0; idx < nr_queries; ++idx)
+                query_lookup[(*indices_)[idx]] = idx;
+        }
 
-                output.is_dense = false;
+        std::vector<int> missing;
+        for (int i = 0; i < nr_spfh; ++i) {
+            const int idx =
+                query_lookup.empty() ? -1 : query_lookup[spfh_indices[i]];
+            if (idx < 0) {
+                missing.push_back(i);
                 continue;
             }
+            spfh_nn_indices[i] = searched.getIndices(idx);
+            spfh_nr_neighbors[i] = searched.getNumberOfNeighbors(idx);
+        }
 
-            // ... and remap the nn_indices values so that they represent row
-            // indices in the spfh_hist_* matrices instead of indices into
-            // surface_->points
-            for (size_t i = 0; i < nn_indices.size(); ++i)
-                nn_indices[i] = spfh_hist_lookup[nn_indices[i]];
+        if (!missing.empty()) {
+            std::vector<int> missing_indices(missing.size());
+            for (size_t i = 0; i < missing.size(); ++i)
+                missing_indices[i] = spfh_indices[missing[i]];
+            this->searchForNeighborhoods(*surface_, missing_indices,
+                                         spfh_searched, nr_threads);
+            for (size_t i = 0; i < missing.size(); ++i) {
+                spfh_nn_indices[missing[i]] = spfh_searched.getIndices(i);
+                spfh_nr_neighbors[missing[i]] =
+                    spfh_searched.getNumberOfNeighbors(i);
+            }
+        }
+    }
 
-            // Compute the FPFH signature (i.e. compute a weighted combination
-            // of local SPFH signatures) ...
-            weightPointSPFHSignature(hist_f1_, hist_f2_, hist_f3_, nn_indices,
-                                     nn_dists, fpfh_histogram_);
+    // Initialize the arrays that will store the SPFH signatures
+    hist_f1_.setZero(nr_spfh, nr_bins_f1_);
+    hist_f2_.setZero(nr_spfh, nr_bins_f2_);
+    hist_f3_.setZero(nr_spfh, nr_bins_f3_);
 
-            // ...and copy it into the output cloud
-            for (int d = 0; d < fpfh_histogram_.size(); ++d)
-                output.points[idx].histogram[d] = fpfh_histogram_[d];
-        }
-    } else {
-        // Iterate over the entire index vector
-        for (size_t idx = 0; idx < indices_->size(); ++idx) {
-            if (!isFinite((*input_)[(*indices_)[idx]]) ||
-                this->searchForNeighbors((*indices_)[idx], search_parameter_,
-                                         nn_indices, nn_dists) == 0) {
-                for (int d = 0; d < fpfh_histogram_.size(); ++d)
-                    output.points[idx].histogram[d] =
-                        std::numeric_limits<float>::quiet_NaN();
+    std::vector<int> nn_indices;
+    std::vector<float> nn_dists;
 
-                output.is_dense = false;
-                continue;
-            }
+    // Compute SPFH signatures for every point that needs them
+#ifdef _OPENMP
+#pragma omp parallel for private(nn_indices) num_threads(nr_threads)          \
+    schedule(dynamic, 64)
+#endif
+    for (int i = 0; i < nr_spfh; ++i) {
+        if (spfh_nr_neighbors[i] == 0)
+            continue;
 
-            // ... and remap the nn_indices values so that they represent row
-            // indices in the spfh_hist_* matrices instead of indices into
-            // surface_->points
-            for (size_t i = 0; i < nn_indices.size(); ++i)
-                nn_indices[i] = spfh_hist_lookup[nn_indices[i]];
+        // Estimate the SPFH signature around the point
+        nn_indices.assign(spfh_nn_indices[i],
+                          spfh_nn_indices[i] + spfh_nr_neighbors[i]);
+        computePointSPFHSignature(*surface_, *normals_, spfh_indices[i], i,
+                                  nn_indices, hist_f1_, hist_f2_, hist_f3_);
+    }
 
-            // Compute the FPFH signature (i.e. compute a weighted combination
-            // of local SPFH signatures) ...
-            weightPointSPFHSignature(hist_f1_, hist_f2_, hist_f3_, nn_indices,
-                                     nn_dists, fpfh_histogram_);
+    // Intialize the array that will store the FPFH signature
+    const int nr_bins = nr_bins_f1_ + nr_bins_f2_ + nr_bins_f3_;
+    Eigen::VectorXf fpfh_histogram;
 
-            // ...and copy it into the output cloud
-            for (int d = 0; d < fpfh_histogram_.size(); ++d)
-                output.points[idx].histogram[d] = fpfh_histogram_[d];
+    output.is_dense = true;
+    // Iterate over the entire index vector
+#ifdef _OPENMP
+#pragma omp parallel for private(nn_indices, nn_dists, fpfh_histogram)        \
+    num_threads(nr_threads) schedule(dynamic, 64)
+#endif
+    for (int idx = 0; idx < nr_queries; ++idx) {
+        const size_t row = by_point ? (*indices_)[idx] : idx;
+        const int nr_neighbors = neighborhoods.getNumberOfNeighbors(row);
+        if (!isFinite((*input_)[(*indices_)[idx]]) || nr_neighbors == 0) {
+            for (int d = 0; d < nr_bins; ++d)
+                output.points[idx].histogram[d] =
+                    std::numeric_limits<float>::quiet_NaN();
+
+            output.is_dense = false;
+            continue;
         }
+
+        // Take the neighbors of the query, and remap their indices so that
+        // they represent row indices in the spfh_hist_* matrices instead of
+        // indices into surface_->points
+        const int *nn = neighborhoods.getIndices(row);
+        nn_indices.resize(nr_neighbors);
+        for (int i = 0; i < nr_neighbors; ++i)
+            nn_indices[i] = spfh_hist_lookup[nn[i]];
+        nn_dists.assign(neighborhoods.getSqrDistances(row),
+                        neighborhoods.getSqrDistances(row) + nr_neighbors);
+
+        // Compute the FPFH signature (i.e. compute a weighted combination of
+        // local SPFH signatures) ...
+        weightPointSPFHSignature(hist_f1_, hist_f2_, hist_f3_, nn_indices,
+                                 nn_dists, fpfh_histogram);
+
+        // ...and copy it into the output cloud
+        for (int d = 0; d < nr_bins; ++d)
+            output.points[idx].histogram[d] = fpfh_histogram[d];
     }
 }
 
@@ -40,6 +40,62 @@
 #define PCL_INTEGRAL_IMAGE2D_IMPL_H_
 
 #include <cstddef>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace pcl {
+namespace detail {
+/** \brief Add a row of an integral image to another one, element by element.
+ * \param[in,out] row the row to add to
+ * \param[in] previous_row the row to add
+ * \param[in] size the number of elements of both rows
+ */
+template <typename IntegralType>
+inline void addIntegralImageRow(IntegralType *row,
+                                const IntegralType *previous_row,
+                                unsigned size) {
+    for (unsigned idx = 0; idx < size; ++idx)
+        row[idx] += previous_row[idx];
+}
+
+#ifdef __SSE2__
+inline void addIntegralImageRow(double *row, const double *previous_row,
+                                unsigned size) {
+    unsigned idx = 0;
+    for (; idx + 4 <= size; idx += 4) {
+        _mm_storeu_pd(row + idx, _mm_add_pd(_mm_loadu_pd(row + idx),
+                                            _mm_loadu_pd(previous_row + idx)));
+        _mm_storeu_pd(row + idx + 2,
+                      _mm_add_pd(_mm_loadu_pd(row + idx + 2),
+                                 _mm_loadu_pd(previous_row + idx + 2)));
+    }
+    for (; idx < size; ++idx)
+        row[idx] += previous_row[idx];
+}
+#endif
+
+/** \brief Get the number of horizontal bands an integral image is split into,
+ * one per thread.
+ * \param[in] nr_threads the number of threads (0 for automatic)
+ * \param[in] height the number of rows of the image
+ */
+inline int getIntegralImageBands(unsigned nr_threads, unsigned height) {
+#ifdef _OPENMP
+    int nr_bands = nr_threads == 0 ? omp_get_max_threads()
+                                   : static_cast<int>(nr_threads);
+#else
+    (void)nr_threads;
+    int nr_bands = 1;
+#endif
+    return (std::max(1, std::min(nr_bands, static_cast<int>(height))));
+}
+} // namespace detail
+} // namespace pcl
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 template <typename DataType, unsigned Dimension>
@@ -54,14 +110,18 @@ template <typename DataType, unsigned Dimension>
 void pcl::IntegralImage2D<DataType, Dimension>::setInput(
     const DataType *data, unsigned width, unsigned height,
     unsigned element_stride, unsigned row_stride) {
-    if ((width + 1) * (height + 1) > first_order_integral_image_.size()) {
-        width_ = width;
-        height_ = height;
-        first_order_integral_image_.resize((width_ + 1) * (height_ + 1));
-        finite_values_integral_image_.resize((width_ + 1) * (height_ + 1));
-        if (compute_second_order_integral_images_)
-            second_order_integral_image_.resize((width_ + 1) * (height_ + 1));
+    width_ = width;
+    height_ = height;
+    // The buffers are only reallocated when they grow, so that consecutive
+    // inputs of the same size reuse them
+    const size_t size = (width_ + 1) * (height_ + 1);
+    if (size > first_order_integral_image_.size()) {
+        first_order_integral_image_.resize(size);
+        finite_values_integral_image_.resize(size);
     }
+    if (compute_second_order_integral_images_ &&
+        size > second_order_integral_image_.size())
+        second_order_integral_image_.resize(size);
     computeIntegralImages(data, row_stride, element_stride);
 }
 
@@ -163,87 +223,117 @@ unsigned pcl::IntegralImage2D<DataType, Dimension>::getFiniteElementsCountSE(
 template <typename DataType, unsigned Dimension>
 void pcl::IntegralImage2D<DataType, Dimension>::computeIntegralImages(
     const DataType *data, unsigned row_stride, unsigned element_stride) {
-    ElementType *previous_row = &first_order_integral_image_[0];
-    ElementType *current_row = previous_row + (width_ + 1);
-    memset(previous_row, 0, sizeof(ElementType) * (width_ + 1));
+    const unsigned stride = width_ + 1;
+    memset(&first_order_integral_image_[0], 0, sizeof(ElementType) * stride);
+    memset(&finite_values_integral_image_[0], 0, sizeof(unsigned) * stride);
+    if (compute_second_order_integral_images_)
+        memset(&second_order_integral_image_[0], 0,
+               sizeof(SecondOrderType) * stride);
+
+    // Each band of rows is integrated on its own
+    const int nr_bands = detail::getIntegralImageBands(threads_, height_);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nr_bands) schedule(static, 1)
+#endif
+    for (int band = 0; band < nr_bands; ++band) {
+        const unsigned begin = band * height_ / nr_bands;
+        const unsigned end = (band + 1) * height_ / nr_bands;
+        for (unsigned rowIdx = begin; rowIdx < end; ++rowIdx)
+            computeRowSums(data + rowIdx * row_stride, element_stride,
+                           rowIdx + 1, rowIdx > begin ? rowIdx : 0);
+    }
 
-    unsigned *count_previous_row = &finite_values_integral_image_[0];
-    unsigned *count_current_row = count_previous_row + (width_ + 1);
-    memset(count_previous_row, 0, sizeof(unsigned) * (width_ + 1));
+    // Then the last row of each band, followed by the others, get the sums
+    // of all the rows above the band
+    for (int band = 1; band < nr_bands; ++band)
+        addRow((band + 1) * height_ / nr_bands, band * height_ / nr_bands);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nr_bands) schedule(static, 1)
+#endif
+    for (int band = 1; band < nr_bands; ++band) {
+        const unsigned begin = band * height_ / nr_bands;
+        const unsigned end = (band + 1) * height_ / nr_bands;
+        for (unsigned rowIdx = begin + 1; rowIdx < end; ++rowIdx)
+            addRow(rowIdx, begin);
+    }
+}
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename DataType, unsigned Dimension>
+void pcl::IntegralImage2D<DataType, Dimension>::computeRowSums(
+    const DataType *data, unsigned element_stride, unsigned row,
+    unsigned previous_row) {
+    const unsigned stride = width_ + 1;
+    ElementType *current_row = &first_order_integral_image_[row * stride];
+    const ElementType *above_row =
+        &first_order_integral_image_[previous_row * stride];
+    unsigned *count_current_row = &finite_values_integral_image_[row * stride];
+    const unsigned *count_above_row =
+        &finite_values_integral_image_[previous_row * stride];
+
+    ElementType sum = ElementType::Zero();
+    unsigned count = 0;
+    current_row[0].setZero();
+    count_current_row[0] = 0;
     if (!compute_second_order_integral_images_) {
-        for (unsigned rowIdx = 0; rowIdx < height_; ++rowIdx,
-                      data += row_stride, previous_row = current_row,
-                      current_row += (width_ + 1),
-                      count_previous_row = count_current_row,
-                      count_current_row += (width_ + 1)) {
-            current_row[0].setZero();
-            count_current_row[0] = 0;
-            for (unsigned colIdx = 0, valIdx = 0; colIdx < width_;
-                 ++colIdx, valIdx += element_stride) {
-                current_row[colIdx + 1] = previous_row[colIdx + 1] +
-                                          current_row[colIdx] -
-                                          previous_row[colIdx];
-                count_current_row[colIdx + 1] = count_previous_row[colIdx + 1] +
-                                                count_current_row[colIdx] -
-                                                count_previous_row[colIdx];
-                const InputType *element =
-                    reinterpret_cast<const InputType *>(&data[valIdx]);
-                if (pcl_isfinite(element->sum())) {
-                    current_row[colIdx + 1] +=
-                        element->template cast<typename IntegralImageTypeTraits<
-                            DataType>::IntegralType>();
-                    ++(count_current_row[colIdx + 1]);
-                }
+        for (unsigned colIdx = 0, valIdx = 0; colIdx < width_;
+             ++colIdx, valIdx += element_stride) {
+            const InputType *element =
+                reinterpret_cast<const InputType *>(&data[valIdx]);
+            if (pcl_isfinite(element->sum())) {
+                sum += element->template cast<typename IntegralImageTypeTraits<
+                    DataType>::IntegralType>();
+                ++count;
             }
+            current_row[colIdx + 1] = above_row[colIdx + 1] + sum;
+            count_current_row[colIdx + 1] = count_above_row[colIdx + 1] + count;
         }
     } else {
-        SecondOrderType *so_previous_row = &second_order_integral_image_[0];
-        SecondOrderType *so_current_row = so_previous_row + (width_ + 1);
-        memset(so_previous_row, 0, sizeof(SecondOrderType) * (width_ + 1));
-
-        SecondOrderType so_element;
-        for (unsigned rowIdx = 0; rowIdx < height_; ++rowIdx,
-                      data += row_stride, previous_row = current_row,
-                      current_row += (width_ + 1),
-                      count_previous_row = count_current_row,
-                      count_current_row += (width_ + 1),
-                      so_previous_row = so_current_row,
-                      so_current_row += (width_ + 1)) {
-            current_row[0].setZero();
-            so_current_row[0].setZero();
-            count_current_row[0] = 0;
-            for (unsigned colIdx = 0, valIdx = 0; colIdx < width_;
-                 ++colIdx, valIdx += element_stride) {
-                current_row[colIdx + 1] = previous_row[colIdx + 1] +
-                                          current_row[colIdx] -
-                                          previous_row[colIdx];
-                so_current_row[colIdx + 1] = so_previous_row[colIdx + 1] +
-                                             so_current_row[colIdx] -
-                                             so_previous_row[colIdx];
-                count_current_row[colIdx + 1] = count_previous_row[colIdx + 1] +
-                                                count_current_row[colIdx] -
-                                                count_previous_row[colIdx];
-
-                const InputType *element =
-                    reinterpret_cast<const InputType *>(&data[valIdx]);
-                if (pcl_isfinite(element->sum())) {
-                    current_row[colIdx + 1] +=
-                        element->template cast<typename IntegralImageTypeTraits<
-                            DataType>::IntegralType>();
-                    ++(count_current_row[colIdx + 1]);
-                    for (unsigned myIdx = 0, elIdx = 0; myIdx < Dimension;
-                         ++myIdx)
-                        for (unsigned mxIdx = myIdx; mxIdx < Dimension;
-                             ++mxIdx, ++elIdx)
-                            so_current_row[colIdx + 1][elIdx] +=
-                                (*element)[myIdx] * (*element)[mxIdx];
-                }
+        SecondOrderType *so_current_row =
+            &second_order_integral_image_[row * stride];
+        const SecondOrderType *so_above_row =
+            &second_order_integral_image_[previous_row * stride];
+        SecondOrderType so_sum = SecondOrderType::Zero();
+        so_current_row[0].setZero();
+        for (unsigned colIdx = 0, valIdx = 0; colIdx < width_;
+             ++colIdx, valIdx += element_stride) {
+            const InputType *element =
+                reinterpret_cast<const InputType *>(&data[valIdx]);
+            if (pcl_isfinite(element->sum())) {
+                sum += element->template cast<typename IntegralImageTypeTraits<
+                    DataType>::IntegralType>();
+                ++count;
+                for (unsigned myIdx = 0, elIdx = 0; myIdx < Dimension; ++myIdx)
+                    for (unsigned mxIdx = myIdx; mxIdx < Dimension;
+                         ++mxIdx, ++elIdx)
+                        so_sum[elIdx] += (*element)[myIdx] * (*element)[mxIdx];
             }
+            current_row[colIdx + 1] = above_row[colIdx + 1] + sum;
+            so_current_row[colIdx + 1] = so_above_row[colIdx + 1] + so_sum;
+            count_current_row[colIdx + 1] = count_above_row[colIdx + 1] + count;
         }
     }
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename DataType, unsigned Dimension>
+void pcl::IntegralImage2D<DataType, Dimension>::addRow(unsigned row, unsigned source_row) {
+    const unsigned stride = width_ + 1;
+    detail::addIntegralImageRow(
+        first_order_integral_image_[row * stride].data(),
+        first_order_integral_image_[source_row * stride].data(),
+        stride * Dimension);
+    detail::addIntegralImageRow(&finite_values_integral_image_[row * stride],
+                                &finite_values_integral_image_[source_row *
+                                                               stride],
+                                stride);
+    if (compute_second_order_integral_images_)
+        detail::addIntegralImageRow(
+            second_order_integral_image_[row * stride].data(),
+            second_order_integral_image_[source_row * stride].data(),
+            stride * second_order_size);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 template <typename DataType>
@@ -252,14 +342,18 @@ void pcl::IntegralImage2D<DataType, 1>::setInput(const DataType *data,
                                                  unsigned height,
                                                  unsigned element_stride,
                                                  unsigned row_stride) {
-    if ((width + 1) * (height + 1) > first_order_integral_image_.size()) {
-        width_ = width;
-        height_ = height;
-        first_order_integral_image_.resize((width_ + 1) * (height_ + 1));
-        finite_values_integral_image_.resize((width_ + 1) * (height_ + 1));
-        if (compute_second_order_integral_images_)
-            second_order_integral_image_.resize((width_ + 1) * (height_ + 1));
+    width_ = width;
+    height_ = height;
+    // The buffers are only reallocated when they grow, so that consecutive
+    // inputs of the same size reuse them
+    const size_t size = (width_ + 1) * (height_ + 1);
+    if (size > first_order_integral_image_.size()) {
+        first_order_integral_image_.resize(size);
+        finite_values_integral_image_.resize(size);
     }
+    if (compute_second_order_integral_images_ &&
+        size > second_order_integral_image_.size())
+        second_order_integral_image_.resize(size);
     computeIntegralImages(data, row_stride, element_stride);
 }
 
@@ -369,69 +463,104 @@ unsigned pcl::IntegralImage2D<DataType, 1>::getFiniteElementsCountSE(
 template <typename DataType>
 void pcl::IntegralImage2D<DataType, 1>::computeIntegralImages(
     const DataType *data, unsigned row_stride, unsigned element_stride) {
-    ElementType *previous_row = &first_order_integral_image_[0];
-    ElementType *current_row = previous_row + (width_ + 1);
-    memset(previous_row, 0, sizeof(ElementType) * (width_ + 1));
+    const unsigned stride = width_ + 1;
+    memset(&first_order_integral_image_[0], 0, sizeof(ElementType) * stride);
+    memset(&finite_values_integral_image_[0], 0, sizeof(unsigned) * stride);
+    if (compute_second_order_integral_images_)
+        memset(&second_order_integral_image_[0], 0,
+               sizeof(SecondOrderType) * stride);
+
+    // Each band of rows is integrated on its own
+    const int nr_bands = detail::getIntegralImageBands(threads_, height_);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nr_bands) schedule(static, 1)
+#endif
+    for (int band = 0; band < nr_bands; ++band) {
+        const unsigned begin = band * height_ / nr_bands;
+        const unsigned end = (band + 1) * height_ / nr_bands;
+        for (unsigned rowIdx = begin; rowIdx < end; ++rowIdx)
+            computeRowSums(data + rowIdx * row_stride, element_stride,
+                           rowIdx + 1, rowIdx > begin ? rowIdx : 0);
+    }
 
-    unsigned *count_previous_row = &finite_values_integral_image_[0];
-    unsigned *count_current_row = count_previous_row + (width_ + 1);
-    memset(count_previous_row, 0, sizeof(unsigned) * (width_ + 1));
+    // Then the last row of each band, followed by the others, get the sums
+    // of all the rows above the band
+    for (int band = 1; band < nr_bands; ++band)
+        addRow((band + 1) * height_ / nr_bands, band * height_ / nr_bands);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nr_bands) schedule(static, 1)
+#endif
+    for (int band = 1; band < nr_bands; ++band) {
+        const unsigned begin = band * height_ / nr_bands;
+        const unsigned end = (band + 1) * height_ / nr_bands;
+        for (unsigned rowIdx = begin + 1; rowIdx < end; ++rowIdx)
+            addRow(rowIdx, begin);
+    }
+}
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename DataType>
+void pcl::IntegralImage2D<DataType, 1>::computeRowSums(
+    const DataType *data, unsigned element_stride, unsigned row,
+    unsigned previous_row) {
+    const unsigned stride = width_ + 1;
+    ElementType *current_row = &first_order_integral_image_[row * stride];
+    const ElementType *above_row =
+        &first_order_integral_image_[previous_row * stride];
+    unsigned *count_current_row = &finite_values_integral_image_[row * stride];
+    const unsigned *count_above_row =
+        &finite_values_integral_image_[previous_row * stride];
+
+    ElementType sum = 0;
+    unsigned count = 0;
+    current_row[0] = 0;
+    count_current_row[0] = 0;
     if (!compute_second_order_integral_images_) {
-        for (unsigned rowIdx = 0; rowIdx < height_; ++rowIdx,
-                      data += row_stride, previous_row = current_row,
-                      current_row += (width_ + 1),
-                      count_previous_row = count_current_row,
-                      count_current_row += (width_ + 1)) {
-            current_row[0] = 0.0;
-            count_current_row[0] = 0;
-            for (unsigned colIdx = 0, valIdx = 0; colIdx < width_;
-                 ++colIdx, valIdx += element_stride) {
-                current_row[colIdx + 1] = previous_row[colIdx + 1] +
-                                          current_row[colIdx] -
-                                          previous_row[colIdx];
-                count_current_row[colIdx + 1] = count_previous_row[colIdx + 1] +
-                                                count_current_row[colIdx] -
-                                                count_previous_row[colIdx];
-                if (pcl_isfinite(data[valIdx])) {
-                    current_row[colIdx + 1] += data[valIdx];
-                    ++(count_current_row[colIdx + 1]);
-                }
+        for (unsigned colIdx = 0, valIdx = 0; colIdx < width_;
+             ++colIdx, valIdx += element_stride) {
+            if (pcl_isfinite(data[valIdx])) {
+                sum += data[valIdx];
+                ++count;
             }
+            current_row[colIdx + 1] = above_row[colIdx + 1] + sum;
+            count_current_row[colIdx + 1] = count_above_row[colIdx + 1] + count;
         }
     } else {
-        SecondOrderType *so_previous_row = &second_order_integral_image_[0];
-        SecondOrderType *so_current_row = so_previous_row + (width_ + 1);
-        memset(so_previous_row, 0, sizeof(SecondOrderType) * (width_ + 1));
-
-        for (unsigned rowIdx = 0; rowIdx < height_; ++rowIdx,
-                      data += row_stride, previous_row = current_row,
-                      current_row += (width_ + 1),
-                      count_previous_row = count_current_row,
-                      count_current_row += (width_ + 1),
-                      so_previous_row = so_current_row,
-                      so_current_row += (width_ + 1)) {
-            current_row[0] = 0.0;
-            so_current_row[0] = 0.0;
-            count_current_row[0] = 0;
-            for (unsigned colIdx = 0, valIdx = 0; colIdx < width_;
-                 ++colIdx, valIdx += element_stride) {
-                current_row[colIdx + 1] = previous_row[colIdx + 1] +
-                                          current_row[colIdx] -
-                                          previous_row[colIdx];
-                so_current_row[colIdx + 1] = so_previous_row[colIdx + 1] +
-                                             so_current_row[colIdx] -
-                                             so_previous_row[colIdx];
-                count_current_row[colIdx + 1] = count_previous_row[colIdx + 1] +
-                                                count_current_row[colIdx] -
-                                                count_previous_row[colIdx];
-                if (pcl_isfinite(data[valIdx])) {
-                    current_row[colIdx + 1] += data[valIdx];
-                    so_current_row[colIdx + 1] += data[valIdx] * data[valIdx];
-                    ++(count_current_row[colIdx + 1]);
-                }
+        SecondOrderType *so_current_row =
+            &second_order_integral_image_[row * stride];
+        const SecondOrderType *so_above_row =
+            &second_order_integral_image_[previous_row * stride];
+        SecondOrderType so_sum = 0;
+        so_current_row[0] = 0;
+        for (unsigned colIdx = 0, valIdx = 0; colIdx < width_;
+             ++colIdx, valIdx += element_stride) {
+            if (pcl_isfinite(data[valIdx])) {
+                sum += data[valIdx];
+                so_sum += data[valIdx] * data[valIdx];
+                ++count;
             }
+            current_row[colIdx + 1] = above_row[colIdx + 1] + sum;
+            so_current_row[colIdx + 1] = so_above_row[colIdx + 1] + so_sum;
+            count_current_row[colIdx + 1] = count_above_row[colIdx + 1] + count;
         }
     }
 }
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename DataType>
+void pcl::IntegralImage2D<DataType, 1>::addRow(unsigned row, unsigned source_row) {
+    const unsigned stride = width_ + 1;
+    detail::addIntegralImageRow(&first_order_integral_image_[row * stride],
+                                &first_order_integral_image_[source_row *
+                                                             stride],
+                                stride);
+    detail::addIntegralImageRow(&finite_values_integral_image_[row * stride],
+                                &finite_values_integral_image_[source_row *
+                                                               stride],
+                                stride);
+    if (compute_second_order_integral_images_)
+        detail::addIntegralImageRow(
+            &second_order_integral_image_[row * stride],
+            &second_order_integral_image_[source_row * stride], stride);
+}
 #endif // PCL_INTEGRAL_IMAGE2D_IMPL_H_
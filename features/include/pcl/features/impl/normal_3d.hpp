@@ -41,11 +41,418 @@
 #define PCL_FEATURES_IMPL_NORMAL_3D_H_
 
 #include <pcl/features/normal_3d.h>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+namespace pcl {
+namespace detail {
+#ifdef __SSE__
+/** \brief Arc tangent of y / x for four pairs of y >= 0 and x, with an
+ * absolute error below 1e-5 radians.
+ */
+inline __m128 atan2ps(__m128 y, __m128 x) {
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128 zero = _mm_setzero_ps();
+    __m128 ax = _mm_andnot_ps(sign_mask, x);
+    __m128 max_yx = _mm_max_ps(ax, y);
+    // t in [0, 1], 0 for y = x = 0
+    __m128 t = _mm_div_ps(_mm_min_ps(ax, y), max_yx);
+    t = _mm_andnot_ps(_mm_cmpeq_ps(max_yx, zero), t);
+
+    // minimax polynomial of atan on [0, 1]
+    __m128 t2 = _mm_mul_ps(t, t);
+    __m128 a = _mm_set1_ps(-0.0117212f);
+    a = _mm_add_ps(_mm_mul_ps(a, t2), _mm_set1_ps(0.05265332f));
+    a = _mm_add_ps(_mm_mul_ps(a, t2), _mm_set1_ps(-0.11643287f));
+    a = _mm_add_ps(_mm_mul_ps(a, t2), _mm_set1_ps(0.19354346f));
+    a = _mm_add_ps(_mm_mul_ps(a, t2), _mm_set1_ps(-0.33262347f));
+    a = _mm_add_ps(_mm_mul_ps(a, t2), _mm_set1_ps(0.99997726f));
+    a = _mm_mul_ps(a, t);
+
+    // a = pi / 2 - a if y > |x|, a = pi - a if x < 0
+    __m128 mask = _mm_cmpgt_ps(y, ax);
+    a = _mm_or_ps(
+        _mm_and_ps(mask, _mm_sub_ps(_mm_set1_ps(1.57079633f), a)),
+        _mm_andnot_ps(mask, a));
+    mask = _mm_cmplt_ps(x, zero);
+    a = _mm_or_ps(_mm_and_ps(mask, _mm_sub_ps(_mm_set1_ps(3.14159265f), a)),
+                  _mm_andnot_ps(mask, a));
+    return (a);
+}
+
+/** \brief Determine the smallest eigenvalues and the corresponding
+ * eigenvectors of four symmetric positive semi definite 3x3 matrices, one
+ * per lane, the same way as pcl::eigen33 ().
+ */
+inline void eigen33ps(__m128 m00, __m128 m01, __m128 m02, __m128 m11,
+                      __m128 m12, __m128 m22, __m128 &eigenvalue,
+                      __m128 &vx, __m128 &vy, __m128 &vz) {
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    // Scale the matrices so their entries are in [-1,1]
+    __m128 scale = _mm_max_ps(
+        _mm_max_ps(_mm_max_ps(_mm_andnot_ps(sign_mask, m00),
+                              _mm_andnot_ps(sign_mask, m01)),
+                   _mm_max_ps(_mm_andnot_ps(sign_mask, m02),
+                              _mm_andnot_ps(sign_mask, m11))),
+        _mm_max_ps(_mm_andnot_ps(sign_mask, m12),
+                   _mm_andnot_ps(sign_mask, m22)));
+    __m128 mask =
+        _mm_cmple_ps(scale, _mm_set1_ps(std::numeric_limits<float>::min()));
+    scale = _mm_or_ps(_mm_and_ps(mask, one), _mm_andnot_ps(mask, scale));
+    __m128 inv_scale = _mm_div_ps(one, scale);
+    m00 = _mm_mul_ps(m00, inv_scale);
+    m01 = _mm_mul_ps(m01, inv_scale);
+    m02 = _mm_mul_ps(m02, inv_scale);
+    m11 = _mm_mul_ps(m11, inv_scale);
+    m12 = _mm_mul_ps(m12, inv_scale);
+    m22 = _mm_mul_ps(m22, inv_scale);
+
+    // The characteristic equation is x^3 - c2*x^2 + c1*x - c0 = 0, see
+    // pcl::computeRoots ()
+    __m128 m01_2 = _mm_mul_ps(m01, m01);
+    __m128 m02_2 = _mm_mul_ps(m02, m02);
+    __m128 m12_2 = _mm_mul_ps(m12, m12);
+    __m128 c0 = _mm_sub_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_mul_ps(m00, m11), m22),
+                   _mm_mul_ps(_mm_set1_ps(2.0f),
+                              _mm_mul_ps(_mm_mul_ps(m01, m02), m12))),
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, m12_2), _mm_mul_ps(m11, m02_2)),
+                   _mm_mul_ps(m22, m01_2)));
+    __m128 c1 = _mm_sub_ps(
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, m11), _mm_mul_ps(m00, m22)),
+                   _mm_mul_ps(m11, m22)),
+        _mm_add_ps(_mm_add_ps(m01_2, m02_2), m12_2));
+    __m128 c2 = _mm_add_ps(_mm_add_ps(m00, m11), m22);
+
+    const __m128 s_inv3 = _mm_set1_ps(1.0f / 3.0f);
+    __m128 c2_over_3 = _mm_mul_ps(c2, s_inv3);
+    __m128 a_over_3 = _mm_min_ps(
+        _mm_mul_ps(_mm_sub_ps(c1, _mm_mul_ps(c2, c2_over_3)), s_inv3), zero);
+    // half_b = (c0 + c2_over_3 * (2 * c2_over_3^2 - c1)) / 2
+    __m128 half_b = _mm_mul_ps(c2_over_3, c2_over_3);
+    half_b = _mm_sub_ps(_mm_add_ps(half_b, half_b), c1);
+    half_b = _mm_mul_ps(_mm_set1_ps(0.5f),
+                        _mm_add_ps(c0, _mm_mul_ps(c2_over_3, half_b)));
+    __m128 q = _mm_min_ps(
+        _mm_add_ps(_mm_mul_ps(half_b, half_b),
+                   _mm_mul_ps(_mm_mul_ps(a_over_3, a_over_3), a_over_3)),
+        zero);
+    __m128 rho = _mm_sqrt_ps(_mm_sub_ps(zero, a_over_3));
+    __m128 theta = _mm_mul_ps(
+        atan2ps(_mm_sqrt_ps(_mm_sub_ps(zero, q)), half_b), s_inv3);
+
+    // The smallest root is c2 / 3 - rho * (cos (theta) + sqrt (3) * sin
+    // (theta)) = c2 / 3 - 2 * rho * cos (phi), with phi = pi / 3 - theta in
+    // [0, pi / 3], where the Taylor series of the cosine converges quickly
+    __m128 phi = _mm_sub_ps(_mm_set1_ps(1.04719755f), theta);
+    __m128 phi2 = _mm_mul_ps(phi, phi);
+    __m128 cos_phi = _mm_set1_ps(-1.0f / 3628800.0f);
+    cos_phi =
+        _mm_add_ps(_mm_mul_ps(cos_phi, phi2), _mm_set1_ps(1.0f / 40320.0f));
+    cos_phi =
+        _mm_add_ps(_mm_mul_ps(cos_phi, phi2), _mm_set1_ps(-1.0f / 720.0f));
+    cos_phi = _mm_add_ps(_mm_mul_ps(cos_phi, phi2), _mm_set1_ps(1.0f / 24.0f));
+    cos_phi = _mm_add_ps(_mm_mul_ps(cos_phi, phi2), _mm_set1_ps(-0.5f));
+    cos_phi = _mm_add_ps(_mm_mul_ps(cos_phi, phi2), one);
+    __m128 root = _mm_sub_ps(
+        c2_over_3, _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(2.0f), rho), cos_phi));
+
+    // One root is 0 if c0 is 0, and eigenvalues can not be negative
+    mask = _mm_or_ps(
+        _mm_cmplt_ps(_mm_andnot_ps(sign_mask, c0),
+                     _mm_set1_ps(std::numeric_limits<float>::epsilon())),
+        _mm_cmple_ps(root, zero));
+    root = _mm_andnot_ps(mask, root);
+    eigenvalue = _mm_mul_ps(root, scale);
+
+    // The eigenvector is the largest cross product of two rows of the matrix
+    // minus root * identity
+    m00 = _mm_sub_ps(m00, root);
+    m11 = _mm_sub_ps(m11, root);
+    m22 = _mm_sub_ps(m22, root);
+
+    __m128 v1x = _mm_sub_ps(_mm_mul_ps(m01, m12), _mm_mul_ps(m02, m11));
+    __m128 v1y = _mm_sub_ps(_mm_mul_ps(m02, m01), _mm_mul_ps(m00, m12));
+    __m128 v1z = _mm_sub_ps(_mm_mul_ps(m00, m11), _mm_mul_ps(m01, m01));
+    __m128 v2x = _mm_sub_ps(_mm_mul_ps(m01, m22), _mm_mul_ps(m02, m12));
+    __m128 v2y = _mm_sub_ps(_mm_mul_ps(m02, m02), _mm_mul_ps(m00, m22));
+    __m128 v2z = _mm_sub_ps(_mm_mul_ps(m00, m12), _mm_mul_ps(m01, m02));
+    __m128 v3x = _mm_sub_ps(_mm_mul_ps(m11, m22), _mm_mul_ps(m12, m12));
+    __m128 v3y = _mm_sub_ps(_mm_mul_ps(m12, m02), _mm_mul_ps(m01, m22));
+    __m128 v3z = _mm_sub_ps(_mm_mul_ps(m01, m12), _mm_mul_ps(m11, m02));
+
+    __m128 len1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(v1x, v1x),
+                                        _mm_mul_ps(v1y, v1y)),
+                             _mm_mul_ps(v1z, v1z));
+    __m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(v2x, v2x),
+                                        _mm_mul_ps(v2y, v2y)),
+                             _mm_mul_ps(v2z, v2z));
+    __m128 len3 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(v3x, v3x),
+                                        _mm_mul_ps(v3y, v3y)),
+                             _mm_mul_ps(v3z, v3z));
+
+    // vec1 if len1 is the largest, else vec2 if len2 >= len3, else vec3
+    __m128 mask1 =
+        _mm_and_ps(_mm_cmpge_ps(len1, len2), _mm_cmpge_ps(len1, len3));
+    __m128 mask2 = _mm_andnot_ps(mask1, _mm_cmpge_ps(len2, len3));
+    __m128 mask3 = _mm_andnot_ps(_mm_or_ps(mask1, mask2),
+                                 _mm_cmpeq_ps(zero, zero));
+
+    vx = _mm_or_ps(_mm_or_ps(_mm_and_ps(mask1, v1x), _mm_and_ps(mask2, v2x)),
+                   _mm_and_ps(mask3, v3x));
+    vy = _mm_or_ps(_mm_or_ps(_mm_and_ps(mask1, v1y), _mm_and_ps(mask2, v2y)),
+                   _mm_and_ps(mask3, v3y));
+    vz = _mm_or_ps(_mm_or_ps(_mm_and_ps(mask1, v1z), _mm_and_ps(mask2, v2z)),
+                   _mm_and_ps(mask3, v3z));
+    __m128 len =
+        _mm_sqrt_ps(_mm_or_ps(_mm_or_ps(_mm_and_ps(mask1, len1),
+                                        _mm_and_ps(mask2, len2)),
+                              _mm_and_ps(mask3, len3)));
+    vx = _mm_div_ps(vx, len);
+    vy = _mm_div_ps(vy, len);
+    vz = _mm_div_ps(vz, len);
+}
+
+/** \brief Compute the normals and curvatures of count <= 4 consecutive
+ * neighborhoods, starting at first, one per lane.
+ */
+template <typename PointT, typename PointNT>
+void computePointNormals4(const pcl::PointCloud<PointT> &cloud,
+                          const pcl::Neighborhoods &neighborhoods, int first,
+                          int count, pcl::PointCloud<PointNT> &normals) {
+    static const float zero[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    const int *neighbors[4];
+    const float *reference[4];
+    int sizes[4];
+    int counts[4];
+    int max_size = 0;
+
+    // The coordinates are accumulated relative to the first finite neighbor
+    // of each neighborhood, which keeps the single pass covariance accurate
+    for (int j = 0; j < 4; ++j) {
+        neighbors[j] = NULL;
+        reference[j] = zero;
+        sizes[j] = counts[j] = 0;
+        if (j >= count)
+            continue;
+        int size = neighborhoods.getNumberOfNeighbors(first + j);
+        if (size == 0)
+            continue;
+        const int *indices = neighborhoods.getIndices(first + j);
+        int s = 0;
+        if (!cloud.is_dense)
+            while (s < size && !isFinite(cloud.points[indices[s]]))
+                ++s;
+        if (s == size)
+            continue;
+        neighbors[j] = indices + s;
+        reference[j] = &cloud.points[indices[s]].x;
+        sizes[j] = counts[j] = size - s;
+        max_size = std::max(max_size, sizes[j]);
+    }
+
+    __m128 rx = _mm_loadu_ps(reference[0]);
+    __m128 ry = _mm_loadu_ps(reference[1]);
+    __m128 rz = _mm_loadu_ps(reference[2]);
+    __m128 rw = _mm_loadu_ps(reference[3]);
+    _MM_TRANSPOSE4_PS(rx, ry, rz, rw);
+
+    __m128 sx = _mm_setzero_ps(), sy = _mm_setzero_ps(), sz = _mm_setzero_ps();
+    __m128 sxx = _mm_setzero_ps(), sxy = _mm_setzero_ps(),
+           sxz = _mm_setzero_ps();
+    __m128 syy = _mm_setzero_ps(), syz = _mm_setzero_ps(),
+           szz = _mm_setzero_ps();
+
+    const float *points[4];
+    for (int i = 0; i < max_size; ++i) {
+        // Gather one neighbor per lane, the reference point adding nothing
+        for (int j = 0; j < 4; ++j) {
+            points[j] = reference[j];
+            if (i < sizes[j]) {
+                const PointT &point = cloud.points[neighbors[j][i]];
+                if (cloud.is_dense || isFinite(point))
+                    points[j] = &point.x;
+                else
+                    --counts[j];
+            }
+        }
+
+        __m128 x = _mm_loadu_ps(points[0]);
+        __m128 y = _mm_loadu_ps(points[1]);
+        __m128 z = _mm_loadu_ps(points[2]);
+        __m128 w = _mm_loadu_ps(points[3]);
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        x = _mm_sub_ps(x, rx);
+        y = _mm_sub_ps(y, ry);
+        z = _mm_sub_ps(z, rz);
+
+        sx = _mm_add_ps(sx, x);
+        sy = _mm_add_ps(sy, y);
+        sz = _mm_add_ps(sz, z);
+        sxx = _mm_add_ps(sxx, _mm_mul_ps(x, x));
+        sxy = _mm_add_ps(sxy, _mm_mul_ps(x, y));
+        sxz = _mm_add_ps(sxz, _mm_mul_ps(x, z));
+        syy = _mm_add_ps(syy, _mm_mul_ps(y, y));
+        syz = _mm_add_ps(syz, _mm_mul_ps(y, z));
+        szz = _mm_add_ps(szz, _mm_mul_ps(z, z));
+    }
+
+    __m128 inv_n = _mm_div_ps(
+        _mm_set1_ps(1.0f),
+        _mm_setr_ps(static_cast<float>(counts[0]),
+                    static_cast<float>(counts[1]),
+                    static_cast<float>(counts[2]),
+                    static_cast<float>(counts[3])));
+    sx = _mm_mul_ps(sx, inv_n);
+    sy = _mm_mul_ps(sy, inv_n);
+    sz = _mm_mul_ps(sz, inv_n);
+    __m128 cxx = _mm_sub_ps(_mm_mul_ps(sxx, inv_n), _mm_mul_ps(sx, sx));
+    __m128 cxy = _mm_sub_ps(_mm_mul_ps(sxy, inv_n), _mm_mul_ps(sx, sy));
+    __m128 cxz = _mm_sub_ps(_mm_mul_ps(sxz, inv_n), _mm_mul_ps(sx, sz));
+    __m128 cyy = _mm_sub_ps(_mm_mul_ps(syy, inv_n), _mm_mul_ps(sy, sy));
+    __m128 cyz = _mm_sub_ps(_mm_mul_ps(syz, inv_n), _mm_mul_ps(sy, sz));
+    __m128 czz = _mm_sub_ps(_mm_mul_ps(szz, inv_n), _mm_mul_ps(sz, sz));
+
+    __m128 eigenvalue, nx, ny, nz;
+    eigen33ps(cxx, cxy, cxz, cyy, cyz, czz, eigenvalue, nx, ny, nz);
+
+    // Curvature: smallest eigenvalue / sum of the eigenvalues, 0 if the
+    // latter is 0
+    __m128 eig_sum = _mm_add_ps(_mm_add_ps(cxx, cyy), czz);
+    __m128 curvature = _mm_andnot_ps(
+        _mm_cmpeq_ps(eig_sum, _mm_setzero_ps()),
+        _mm_andnot_ps(_mm_set1_ps(-0.0f), _mm_div_ps(eigenvalue, eig_sum)));
+
+    float out[4][4];
+    _mm_storeu_ps(out[0], nx);
+    _mm_storeu_ps(out[1], ny);
+    _mm_storeu_ps(out[2], nz);
+    _mm_storeu_ps(out[3], curvature);
+    for (int j = 0; j < count; ++j) {
+        PointNT &normal = normals.points[first + j];
+        if (counts[j] == 0) {
+            normal.normal[0] = normal.normal[1] = normal.normal[2] =
+                normal.curvature = std::numeric_limits<float>::quiet_NaN();
+            continue;
+        }
+        normal.normal[0] = out[0][j];
+        normal.normal[1] = out[1][j];
+        normal.normal[2] = out[2][j];
+        normal.curvature = out[3][j];
+    }
+}
+#else
+/** \brief Compute the normal and curvature of the i-th neighborhood. */
+template <typename PointT, typename PointNT>
+void computePointNormal1(const pcl::PointCloud<PointT> &cloud,
+                         const pcl::Neighborhoods &neighborhoods, int i,
+                         pcl::PointCloud<PointNT> &normals) {
+    PointNT &normal = normals.points[i];
+    const int size = neighborhoods.getNumberOfNeighbors(i);
+    const int *indices = neighborhoods.getIndices(i);
+
+    // The coordinates are accumulated relative to the first finite neighbor,
+    // which keeps the single pass covariance accurate
+    int s = 0;
+    if (!cloud.is_dense)
+        while (s < size && !isFinite(cloud.points[indices[s]]))
+            ++s;
+    if (s >= size) {
+        normal.normal[0] = normal.normal[1] = normal.normal[2] =
+            normal.curvature = std::numeric_limits<float>::quiet_NaN();
+        return;
+    }
+
+    const PointT &reference = cloud.points[indices[s]];
+    Eigen::Matrix<float, 1, 9, Eigen::RowMajor> accu =
+        Eigen::Matrix<float, 1, 9, Eigen::RowMajor>::Zero();
+    int count = 0;
+    for (; s < size; ++s) {
+        const PointT &point = cloud.points[indices[s]];
+        if (!cloud.is_dense && !isFinite(point))
+            continue;
+        float x = point.x - reference.x;
+        float y = point.y - reference.y;
+        float z = point.z - reference.z;
+        accu[0] += x * x;
+        accu[1] += x * y;
+        accu[2] += x * z;
+        accu[3] += y * y;
+        accu[4] += y * z;
+        accu[5] += z * z;
+        accu[6] += x;
+        accu[7] += y;
+        accu[8] += z;
+        ++count;
+    }
+
+    accu /= static_cast<float>(count);
+    EIGEN_ALIGN16 Eigen::Matrix3f covariance_matrix;
+    covariance_matrix.coeffRef(0) = accu[0] - accu[6] * accu[6];
+    covariance_matrix.coeffRef(1) = accu[1] - accu[6] * accu[7];
+    covariance_matrix.coeffRef(2) = accu[2] - accu[6] * accu[8];
+    covariance_matrix.coeffRef(4) = accu[3] - accu[7] * accu[7];
+    covariance_matrix.coeffRef(5) = accu[4] - accu[7] * accu[8];
+    covariance_matrix.coeffRef(8) = accu[5] - accu[8] * accu[8];
+    covariance_matrix.coeffRef(3) = covariance_matrix.coeff(1);
+    covariance_matrix.coeffRef(6) = covariance_matrix.coeff(2);
+    covariance_matrix.coeffRef(7) = covariance_matrix.coeff(5);
+
+    solvePlaneParameters(covariance_matrix, normal.normal[0],
+                         normal.normal[1], normal.normal[2], normal.curvature);
+}
+#endif
+} // namespace detail
+} // namespace pcl
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT, typename PointNT>
+void pcl::computePointNormals(const pcl::PointCloud<PointT> &cloud,
+                              const pcl::Neighborhoods &neighborhoods,
+                              pcl::PointCloud<PointNT> &normals,
+                              unsigned int nr_threads) {
+    const int nr_queries = static_cast<int>(neighborhoods.size());
+    normals.points.resize(nr_queries);
+    normals.width = nr_queries;
+    normals.height = 1;
+
+#ifdef __SSE__
+    const int nr_tiles = (nr_queries + 3) / 4;
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nr_threads) schedule(dynamic, 256)
+#endif
+    for (int t = 0; t < nr_tiles; ++t)
+        detail::computePointNormals4(cloud, neighborhoods, 4 * t,
+                                     std::min(4, nr_queries - 4 * t), normals);
+#else
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nr_threads) schedule(dynamic, 1024)
+#endif
+    for (int i = 0; i < nr_queries; ++i)
+        detail::computePointNormal1(cloud, neighborhoods, i, normals);
+#endif
+
+    normals.is_dense = true;
+    for (int i = 0; i < nr_queries; ++i)
+        if (!pcl_isfinite(normals.points[i].normal[0])) {
+            normals.is_dense = false;
+            break;
+        }
+}
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointInT, typename PointOutT>
 void pcl::NormalEstimation<PointInT, PointOutT>::computeFeature(
     PointCloudOut &output) {
+    if (batched_) {
+        computeFeatureBatched(output, 1);
+        return;
+    }
+
     // Allocate enough space to hold the results
     // \note This resize is irrelevant for a radiusSearch ().
     std::vector<int> nn_indices(k_);
@@ -106,6 +513,48 @@ void pcl::NormalEstimation<PointInT, PointOutT>::computeFeature(
     }
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointOutT>
+void pcl::NormalEstimation<PointInT, PointOutT>::computeFeatureBatched(
+    PointCloudOut &output, unsigned int nr_threads) {
+    // Search the neighbors block by block, to bound the memory they use
+    const size_t block_size = 16384;
+    std::vector<int> block_indices;
+    pcl::Neighborhoods neighborhoods;
+    pcl::PointCloud<pcl::Normal> normals;
+
+    output.is_dense = true;
+    for (size_t first = 0; first < indices_->size(); first += block_size) {
+        const size_t last = std::min(first + block_size, indices_->size());
+        block_indices.assign(indices_->begin() + first,
+                             indices_->begin() + last);
+
+        // Non finite query points get no neighbors, hence a NaN normal
+        this->searchForNeighborhoods(*input_, block_indices, neighborhoods,
+                                     nr_threads);
+
+        computePointNormals(*surface_, neighborhoods, normals, nr_threads);
+
+        for (size_t idx = first; idx < last; ++idx) {
+            const pcl::Normal &normal = normals.points[idx - first];
+            output.points[idx].normal[0] = normal.normal[0];
+            output.points[idx].normal[1] = normal.normal[1];
+            output.points[idx].normal[2] = normal.normal[2];
+            output.points[idx].curvature = normal.curvature;
+
+            if (!pcl_isfinite(normal.normal[0])) {
+                output.is_dense = false;
+                continue;
+            }
+
+            flipNormalTowardsViewpoint(input_->points[(*indices_)[idx]], vpx_,
+                                       vpy_, vpz_, output.points[idx].normal[0],
+                                       output.points[idx].normal[1],
+                                       output.points[idx].normal[2]);
+        }
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointInT>
 void pcl::NormalEstimation<PointInT, Eigen::MatrixXf>::computeFeatureEigen(
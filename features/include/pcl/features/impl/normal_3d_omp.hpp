@@ -101,6 +101,11 @@ void pcl::NormalEstimationOMP<PointInT, Eigen::MatrixXf>::computeFeatureEigen(
 template <typename PointInT, typename PointOutT>
 void pcl::NormalEstimationOMP<PointInT, PointOutT>::computeFeature(
     PointCloudOut &output) {
+    if (this->batched_) {
+        this->computeFeatureBatched(output, threads_);
+        return;
+    }
+
     float vpx, vpy, vpz;
     getViewPoint(vpx, vpy, vpz);
 
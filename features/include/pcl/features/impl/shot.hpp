@@ -42,6 +42,9 @@
 #include <pcl/features/shot.h>
 #include <pcl/features/shot_lrf.h>
 #include <utility>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
 
 // Useful constants.
 #define PST_PI 3.1415926535897932384626433832795
@@ -55,6 +58,62 @@
 const double zeroDoubleEps15 = 1E-15;
 const float zeroFloatEps8 = 1E-8f;
 
+namespace pcl {
+namespace detail {
+#ifdef __SSE__
+/** \brief Arc tangent of y / x for four pairs of y and x, in [-pi, pi] like
+ * atan2 (), with an absolute error below 1e-5 radians. A null y is taken as
+ * positive.
+ */
+inline __m128 shotAtan2ps(__m128 y, __m128 x) {
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128 zero = _mm_setzero_ps();
+    __m128 y_sign = _mm_and_ps(sign_mask, y);
+    __m128 ax = _mm_andnot_ps(sign_mask, x);
+    __m128 ay = _mm_andnot_ps(sign_mask, y);
+    __m128 max_yx = _mm_max_ps(ax, ay);
+    // t in [0, 1], 0 for y = x = 0
+    __m128 t = _mm_div_ps(_mm_min_ps(ax, ay), max_yx);
+    t = _mm_andnot_ps(_mm_cmpeq_ps(max_yx, zero), t);
+
+    // minimax polynomial of atan on [0, 1]
+    __m128 t2 = _mm_mul_ps(t, t);
+    __m128 a = _mm_set1_ps(-0.0117212f);
+    a = _mm_add_ps(_mm_mul_ps(a, t2), _mm_set1_ps(0.05265332f));
+    a = _mm_add_ps(_mm_mul_ps(a, t2), _mm_set1_ps(-0.11643287f));
+    a = _mm_add_ps(_mm_mul_ps(a, t2), _mm_set1_ps(0.19354346f));
+    a = _mm_add_ps(_mm_mul_ps(a, t2), _mm_set1_ps(-0.33262347f));
+    a = _mm_add_ps(_mm_mul_ps(a, t2), _mm_set1_ps(0.99997726f));
+    a = _mm_mul_ps(a, t);
+
+    // a = pi / 2 - a if |y| > |x|, a = pi - a if x < 0, then the sign of y
+    __m128 mask = _mm_cmpgt_ps(ay, ax);
+    a = _mm_or_ps(
+        _mm_and_ps(mask, _mm_sub_ps(_mm_set1_ps(1.57079633f), a)),
+        _mm_andnot_ps(mask, a));
+    mask = _mm_cmplt_ps(x, zero);
+    a = _mm_or_ps(_mm_and_ps(mask, _mm_sub_ps(_mm_set1_ps(3.14159265f), a)),
+                  _mm_andnot_ps(mask, a));
+    return (_mm_or_ps(a, y_sign));
+}
+
+/** \brief Clamp four values to [-1, 1]. */
+inline __m128 shotClampps(__m128 v) {
+    return (_mm_max_ps(_mm_min_ps(v, _mm_set1_ps(1.0f)), _mm_set1_ps(-1.0f)));
+}
+
+/** \brief Set to 0 the values whose magnitude is below 1e-30, as the scalar
+ * SHOT interpolation does. */
+inline __m128 shotFlushps(__m128 v) {
+    return (_mm_and_ps(
+        _mm_cmpge_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), v),
+                     _mm_set1_ps(1e-30f)),
+        v));
+}
+#endif
+} // namespace detail
+} // namespace pcl
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 /** \brief Check if val1 and val2 are equals.
  *
@@ -878,6 +937,11 @@ void pcl::SHOTEstimation<PointInT, PointNT, PointOutT, PointRFT>::
 
     assert(descLength_ == 352);
 
+    if (fused_ && frames_never_defined_) {
+        computeFeatureFused(output, 1);
+        return;
+    }
+
     shot_.setZero(descLength_);
 
     // Allocate enough space to hold the results
@@ -928,6 +992,428 @@ void pcl::SHOTEstimation<PointInT, PointNT, PointOutT, PointRFT>::
     }
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointNT, typename PointOutT,
+          typename PointRFT>
+bool pcl::SHOTEstimation<PointInT, PointNT, PointOutT,
+                         PointRFT>::initCompute() {
+    if (!fused_ || !frames_never_defined_)
+        return (SHOTEstimationBase<PointInT, PointNT, PointOutT,
+                                   PointRFT>::initCompute());
+
+    if (!FeatureFromNormals<PointInT, PointNT, PointOutT>::initCompute()) {
+        PCL_ERROR("[pcl::%s::initCompute] Init failed.\n",
+                  getClassName().c_str());
+        return (false);
+    }
+
+    // SHOT cannot work with k-search
+    if (this->getKSearch() != 0) {
+        PCL_ERROR("[pcl::%s::initCompute] Error! Search method set to "
+                  "k-neighborhood. Call setKSearch(0) and setRadiusSearch( "
+                  "radius ) to use this class.\n",
+                  getClassName().c_str());
+        return (false);
+    }
+
+    // The frames are estimated along the descriptors, from neighborhoods
+    // sorted as SHOTLocalReferenceFrameEstimation expects them
+    this->tree_->setSortedResults(true);
+    frames_.reset();
+    return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointNT, typename PointOutT,
+          typename PointRFT>
+void pcl::SHOTEstimation<PointInT, PointNT, PointOutT,
+                         PointRFT>::FusedNeighbors::resize(size_t n) {
+    const size_t padded = (n + 3) & ~static_cast<size_t>(3);
+    x.resize(padded);
+    y.resize(padded);
+    z.resize(padded);
+    distance.resize(padded);
+    normal_x.resize(padded);
+    normal_y.resize(padded);
+    normal_z.resize(padded);
+    local_x.resize(padded);
+    local_y.resize(padded);
+    local_z.resize(padded);
+    bin_distance.resize(padded);
+    inclination.resize(padded);
+    azimuth.resize(padded);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointNT, typename PointOutT,
+          typename PointRFT>
+bool pcl::SHOTEstimation<PointInT, PointNT, PointOutT, PointRFT>::
+    computePointSHOTFused(const int index, const std::vector<int> &indices,
+                          const std::vector<float> &sqr_dists,
+                          FusedNeighbors &neighbors, Eigen::Matrix3f &rf,
+                          Eigen::VectorXf &shot) {
+    const Eigen::Vector4f &central_point =
+        (*input_)[(*indices_)[index]].getVector4fMap();
+
+    // Gather the neighbors once, relative to the central point, which is left
+    // out as in both SHOTLocalReferenceFrameEstimation and the descriptor
+    neighbors.resize(indices.size());
+    int nr_neighbors = 0;
+    for (size_t i_idx = 0; i_idx < indices.size(); ++i_idx) {
+        const Eigen::Vector4f &pt =
+            surface_->points[indices[i_idx]].getVector4fMap();
+        if (pt.head<3>() == central_point.head<3>())
+            continue;
+
+        const Eigen::Vector4f &normal =
+            normals_->points[indices[i_idx]].getNormalVector4fMap();
+        neighbors.x[nr_neighbors] = pt[0] - central_point[0];
+        neighbors.y[nr_neighbors] = pt[1] - central_point[1];
+        neighbors.z[nr_neighbors] = pt[2] - central_point[2];
+        neighbors.distance[nr_neighbors] = sqrtf(sqr_dists[i_idx]);
+        neighbors.normal_x[nr_neighbors] = normal[0];
+        neighbors.normal_y[nr_neighbors] = normal[1];
+        neighbors.normal_z[nr_neighbors] = normal[2];
+        ++nr_neighbors;
+    }
+
+    if (nr_neighbors < 5)
+        return (false);
+
+    // Pad the last group of 4 with harmless values
+    for (int i = nr_neighbors; i < static_cast<int>(neighbors.x.size()); ++i) {
+        neighbors.x[i] = neighbors.y[i] = neighbors.z[i] = 0.0f;
+        neighbors.normal_x[i] = neighbors.normal_y[i] = neighbors.normal_z[i] =
+            0.0f;
+        neighbors.distance[i] = 1.0f;
+    }
+
+    // Local reference frame, see SHOTLocalReferenceFrameEstimation::getLocalRF
+    Eigen::Matrix3d cov_m = Eigen::Matrix3d::Zero();
+    double sum = 0.0;
+    for (int i = 0; i < nr_neighbors; ++i) {
+        const Eigen::Vector3d vij(neighbors.x[i], neighbors.y[i],
+                                  neighbors.z[i]);
+        const double weight = search_radius_ - neighbors.distance[i];
+        cov_m += weight * (vij * vij.transpose());
+        sum += weight;
+    }
+    cov_m /= sum;
+
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver(cov_m);
+    if (!pcl_isfinite(solver.eigenvalues()[0]) ||
+        !pcl_isfinite(solver.eigenvalues()[1]) ||
+        !pcl_isfinite(solver.eigenvalues()[2]))
+        return (false);
+
+    // Disambiguation: most of the neighbors lie on the positive side of each
+    // axis
+    Eigen::Vector3d v1 = solver.eigenvectors().col(2);
+    Eigen::Vector3d v3 = solver.eigenvectors().col(0);
+    int plus_tangent = 0, plus_normal = 0;
+    for (int i = 0; i < nr_neighbors; ++i) {
+        const Eigen::Vector3d vij(neighbors.x[i], neighbors.y[i],
+                                  neighbors.z[i]);
+        if (vij.dot(v1) >= 0)
+            ++plus_tangent;
+        if (vij.dot(v3) >= 0)
+            ++plus_normal;
+    }
+    plus_tangent = 2 * plus_tangent - nr_neighbors;
+    plus_normal = 2 * plus_normal - nr_neighbors;
+
+    // On a tie, the 5 neighbors around the median distance decide; the search
+    // results are sorted, see initCompute ()
+    if (plus_tangent == 0 || plus_normal == 0) {
+        const int median_index = nr_neighbors / 2;
+        int votes_tangent = 0, votes_normal = 0;
+        for (int i = median_index - 2; i <= median_index + 2; ++i) {
+            const Eigen::Vector3d vij(neighbors.x[i], neighbors.y[i],
+                                      neighbors.z[i]);
+            if (vij.dot(v1) > 0)
+                ++votes_tangent;
+            if (vij.dot(v3) > 0)
+                ++votes_normal;
+        }
+        if (plus_tangent == 0 && votes_tangent < 3)
+            v1 *= -1;
+        if (plus_normal == 0 && votes_normal < 3)
+            v3 *= -1;
+    }
+    if (plus_tangent < 0)
+        v1 *= -1;
+    if (plus_normal < 0)
+        v3 *= -1;
+
+    rf.row(0).matrix() = v1.cast<float>();
+    rf.row(2).matrix() = v3.cast<float>();
+    rf.row(1).matrix() = rf.row(2).cross(rf.row(0));
+
+    // Coordinates in the frame, shape bins and angles of the neighbors
+    const float nr_bins = static_cast<float>(nr_shape_bins_);
+#ifdef __SSE__
+    const __m128 x_axis[3] = {_mm_set1_ps(rf(0, 0)), _mm_set1_ps(rf(0, 1)),
+                              _mm_set1_ps(rf(0, 2))};
+    const __m128 y_axis[3] = {_mm_set1_ps(rf(1, 0)), _mm_set1_ps(rf(1, 1)),
+                              _mm_set1_ps(rf(1, 2))};
+    const __m128 z_axis[3] = {_mm_set1_ps(rf(2, 0)), _mm_set1_ps(rf(2, 1)),
+                              _mm_set1_ps(rf(2, 2))};
+    const __m128 half_bins = _mm_set1_ps(0.5f * nr_bins);
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (int i = 0; i < nr_neighbors; i += 4) {
+        __m128 dx = _mm_loadu_ps(&neighbors.x[i]);
+        __m128 dy = _mm_loadu_ps(&neighbors.y[i]);
+        __m128 dz = _mm_loadu_ps(&neighbors.z[i]);
+        __m128 lx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, x_axis[0]),
+                                          _mm_mul_ps(dy, x_axis[1])),
+                               _mm_mul_ps(dz, x_axis[2]));
+        __m128 ly = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, y_axis[0]),
+                                          _mm_mul_ps(dy, y_axis[1])),
+                               _mm_mul_ps(dz, y_axis[2]));
+        __m128 lz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, z_axis[0]),
+                                          _mm_mul_ps(dy, z_axis[1])),
+                               _mm_mul_ps(dz, z_axis[2]));
+        lx = detail::shotFlushps(lx);
+        ly = detail::shotFlushps(ly);
+        lz = detail::shotFlushps(lz);
+        _mm_storeu_ps(&neighbors.local_x[i], lx);
+        _mm_storeu_ps(&neighbors.local_y[i], ly);
+        _mm_storeu_ps(&neighbors.local_z[i], lz);
+
+        // Cosine between the normal and the z axis
+        __m128 cosine = _mm_add_ps(
+            _mm_add_ps(
+                _mm_mul_ps(_mm_loadu_ps(&neighbors.normal_x[i]), z_axis[0]),
+                _mm_mul_ps(_mm_loadu_ps(&neighbors.normal_y[i]), z_axis[1])),
+            _mm_mul_ps(_mm_loadu_ps(&neighbors.normal_z[i]), z_axis[2]));
+        cosine = detail::shotClampps(cosine);
+        _mm_storeu_ps(&neighbors.bin_distance[i],
+                      _mm_mul_ps(_mm_add_ps(one, cosine), half_bins));
+
+        // acos (c) = atan2 (sqrt (1 - c^2), c)
+        __m128 c = detail::shotClampps(
+            _mm_div_ps(lz, _mm_loadu_ps(&neighbors.distance[i])));
+        __m128 s = _mm_sqrt_ps(
+            _mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(c, c)), _mm_setzero_ps()));
+        _mm_storeu_ps(&neighbors.inclination[i], detail::shotAtan2ps(s, c));
+        _mm_storeu_ps(&neighbors.azimuth[i], detail::shotAtan2ps(ly, lx));
+    }
+#else
+    for (int i = 0; i < nr_neighbors; ++i) {
+        const Eigen::Vector3f delta(neighbors.x[i], neighbors.y[i],
+                                    neighbors.z[i]);
+        float lx = delta.dot(rf.row(0));
+        float ly = delta.dot(rf.row(1));
+        float lz = delta.dot(rf.row(2));
+        if (fabsf(lx) < 1E-30f)
+            lx = 0;
+        if (fabsf(ly) < 1E-30f)
+            ly = 0;
+        if (fabsf(lz) < 1E-30f)
+            lz = 0;
+        neighbors.local_x[i] = lx;
+        neighbors.local_y[i] = ly;
+        neighbors.local_z[i] = lz;
+
+        const Eigen::Vector3f normal(neighbors.normal_x[i],
+                                     neighbors.normal_y[i],
+                                     neighbors.normal_z[i]);
+        float cosine = std::max(-1.0f, std::min(normal.dot(rf.row(2)), 1.0f));
+        neighbors.bin_distance[i] = (1.0f + cosine) * 0.5f * nr_bins;
+
+        float c = std::max(-1.0f, std::min(lz / neighbors.distance[i], 1.0f));
+        neighbors.inclination[i] = acosf(c);
+        neighbors.azimuth[i] = atan2f(ly, lx);
+    }
+#endif
+
+    // Quadrilinear interpolation, see interpolateSingleChannel ()
+    shot.setZero(descLength_);
+    const int nr_bins_int = nr_shape_bins_;
+    for (int i = 0; i < nr_neighbors; ++i) {
+        const float x = neighbors.local_x[i];
+        const float y = neighbors.local_y[i];
+        const float z = neighbors.local_z[i];
+        const float distance = neighbors.distance[i];
+
+        const int bit4 = ((y > 0) || ((y == 0.0f) && (x < 0))) ? 1 : 0;
+        const int bit3 =
+            ((x > 0) || ((x == 0.0f) && (y > 0))) ? !bit4 : bit4;
+        int desc_index = ((bit4 << 3) + (bit3 << 2)) << 1;
+
+        if ((static_cast<double>(x) * y > 0) || (x == 0.0f))
+            desc_index += (fabsf(x) >= fabsf(y)) ? 0 : 4;
+        else
+            desc_index += (fabsf(x) > fabsf(y)) ? 4 : 0;
+
+        desc_index += z > 0 ? 1 : 0;
+
+        // 2 RADII
+        desc_index += (distance > radius1_2_) ? 2 : 0;
+
+        float bin_distance = neighbors.bin_distance[i];
+        const int step_index = static_cast<int>(floorf(bin_distance + 0.5f));
+        const int volume_index = desc_index * (nr_bins_int + 1);
+
+        // Interpolation on the cosine (adjacent bins in the histogram)
+        bin_distance -= static_cast<float>(step_index);
+        float weight = 1.0f - fabsf(bin_distance);
+
+        if (bin_distance > 0)
+            shot[volume_index + ((step_index + 1) % nr_bins_int)] +=
+                bin_distance;
+        else
+            shot[volume_index + ((step_index - 1 + nr_bins_int) %
+                                 nr_bins_int)] -= bin_distance;
+
+        // Interpolation on the distance (adjacent husks)
+        if (distance > radius1_2_) {
+            const float radius_distance =
+                static_cast<float>((distance - radius3_4_) / radius1_2_);
+            if (distance > radius3_4_)
+                weight += 1 - radius_distance;
+            else {
+                weight += 1 + radius_distance;
+                shot[(desc_index - 2) * (nr_bins_int + 1) + step_index] -=
+                    radius_distance;
+            }
+        } else {
+            const float radius_distance =
+                static_cast<float>((distance - radius1_4_) / radius1_2_);
+            if (distance < radius1_4_)
+                weight += 1 + radius_distance;
+            else {
+                weight += 1 - radius_distance;
+                shot[(desc_index + 2) * (nr_bins_int + 1) + step_index] +=
+                    radius_distance;
+            }
+        }
+
+        // Interpolation on the inclination (adjacent vertical volumes)
+        const float inclination = neighbors.inclination[i];
+        if (z <= 0) {
+            const float inclination_distance =
+                (inclination - static_cast<float>(PST_RAD_135)) /
+                static_cast<float>(PST_RAD_90);
+            if (inclination > PST_RAD_135)
+                weight += 1 - inclination_distance;
+            else {
+                weight += 1 + inclination_distance;
+                shot[(desc_index + 1) * (nr_bins_int + 1) + step_index] -=
+                    inclination_distance;
+            }
+        } else {
+            const float inclination_distance =
+                (inclination - static_cast<float>(PST_RAD_45)) /
+                static_cast<float>(PST_RAD_90);
+            if (inclination < PST_RAD_45)
+                weight += 1 + inclination_distance;
+            else {
+                weight += 1 - inclination_distance;
+                shot[(desc_index - 1) * (nr_bins_int + 1) + step_index] +=
+                    inclination_distance;
+            }
+        }
+
+        // Interpolation on the azimuth (adjacent horizontal volumes)
+        if (y != 0.0f || x != 0.0f) {
+            const int sel = desc_index >> 2;
+            float azimuth_distance =
+                (neighbors.azimuth[i] -
+                 static_cast<float>(-PST_RAD_PI_7_8 + PST_RAD_45 * sel)) /
+                static_cast<float>(PST_RAD_45);
+            azimuth_distance =
+                std::max(-0.5f, std::min(azimuth_distance, 0.5f));
+
+            if (azimuth_distance > 0) {
+                weight += 1 - azimuth_distance;
+                const int interp_index =
+                    (desc_index + 4) % maxAngularSectors_;
+                shot[interp_index * (nr_bins_int + 1) + step_index] +=
+                    azimuth_distance;
+            } else {
+                weight += 1 + azimuth_distance;
+                const int interp_index =
+                    (desc_index - 4 + maxAngularSectors_) % maxAngularSectors_;
+                shot[interp_index * (nr_bins_int + 1) + step_index] -=
+                    azimuth_distance;
+            }
+        }
+
+        shot[volume_index + step_index] += weight;
+    }
+
+    // Normalize the final histogram
+    this->normalizeHistogram(shot, descLength_);
+    return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointNT, typename PointOutT,
+          typename PointRFT>
+void pcl::SHOTEstimation<PointInT, PointNT, PointOutT, PointRFT>::
+    computeFeatureFused(pcl::PointCloud<PointOutT> &output,
+                        unsigned int nr_threads) {
+    typename PointCloudLRF::Ptr frames(new PointCloudLRF);
+    frames->points.resize(indices_->size());
+    frames->width = static_cast<uint32_t>(indices_->size());
+    frames->height = 1;
+    frames->is_dense = true;
+
+    // Buffers reused by all the points of a thread
+    std::vector<int> nn_indices;
+    std::vector<float> nn_dists;
+    FusedNeighbors neighbors;
+    Eigen::VectorXf shot(descLength_);
+    Eigen::Matrix3f rf;
+
+    output.is_dense = true;
+    // Iterating over the entire index vector
+#ifdef _OPENMP
+#pragma omp parallel for private(nn_indices, nn_dists, neighbors, rf)        \
+    firstprivate(shot) num_threads(nr_threads) schedule(dynamic, 64)
+#endif
+    for (int idx = 0; idx < static_cast<int>(indices_->size()); ++idx) {
+        PointRFT &frame = frames->points[idx];
+        if (!isFinite((*input_)[(*indices_)[idx]]) ||
+            this->searchForNeighbors((*indices_)[idx], search_parameter_,
+                                     nn_indices, nn_dists) == 0 ||
+            !computePointSHOTFused(idx, nn_indices, nn_dists, neighbors, rf,
+                                   shot)) {
+            PCL_WARN("[pcl::%s::computeFeature] The local reference frame is "
+                     "not valid! Aborting description of point with index %d\n",
+                     getClassName().c_str(), (*indices_)[idx]);
+
+            // Copy into the resultant cloud
+            for (int d = 0; d < descLength_; ++d)
+                output.points[idx].descriptor[d] =
+                    std::numeric_limits<float>::quiet_NaN();
+            for (int d = 0; d < 9; ++d)
+                output.points[idx].rf[d] =
+                    std::numeric_limits<float>::quiet_NaN();
+            for (int d = 0; d < 3; ++d)
+                frame.x_axis[d] = frame.y_axis[d] = frame.z_axis[d] =
+                    std::numeric_limits<float>::quiet_NaN();
+
+            output.is_dense = false;
+            frames->is_dense = false;
+            continue;
+        }
+
+        // Copy into the resultant cloud
+        for (int d = 0; d < descLength_; ++d)
+            output.points[idx].descriptor[d] = shot[d];
+        for (int d = 0; d < 3; ++d) {
+            frame.x_axis[d] = output.points[idx].rf[d + 0] = rf(0, d);
+            frame.y_axis[d] = output.points[idx].rf[d + 3] = rf(1, d);
+            frame.z_axis[d] = output.points[idx].rf[d + 6] = rf(2, d);
+        }
+    }
+
+    // Keep the frames, as the default estimation does
+    frames_ = frames;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////
@@ -45,6 +45,11 @@ template <typename PointInT, typename PointNT, typename PointOutT,
           typename PointRFT>
 bool pcl::SHOTEstimationOMP<PointInT, PointNT, PointOutT,
                             PointRFT>::initCompute() {
+    // The frames are estimated along the descriptors
+    if (fused_ && frames_never_defined_)
+        return (SHOTEstimation<PointInT, PointNT, PointOutT,
+                               PointRFT>::initCompute());
+
     if (!FeatureFromNormals<PointInT, PointNT, PointOutT>::initCompute()) {
         PCL_ERROR("[pcl::%s::initCompute] Init failed.\n",
                   getClassName().c_str());
@@ -142,6 +147,11 @@ void pcl::SHOTEstimationOMP<PointInT, PointNT, PointOutT,
 
     assert(descLength_ == 352);
 
+    if (fused_ && frames_never_defined_) {
+        this->computeFeatureFused(output, threads_);
+        return;
+    }
+
     int data_size = static_cast<int>(indices_->size());
 
     output.is_dense = true;
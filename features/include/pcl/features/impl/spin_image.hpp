@@ -68,6 +68,18 @@ template <typename PointInT, typename PointNT, typename PointOutT>
 Eigen::ArrayXXd
 pcl::SpinImageEstimation<PointInT, PointNT, PointOutT>::computeSiForPoint(
     int index) const {
+    Eigen::ArrayXXd m_matrix, m_averAngles;
+    std::vector<int> nn_indices;
+    std::vector<float> nn_sqr_dists;
+    computeSiForPoint(index, m_matrix, m_averAngles, nn_indices, nn_sqr_dists);
+    return m_matrix;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointNT, typename PointOutT>
+void pcl::SpinImageEstimation<PointInT, PointNT, PointOutT>::computeSiForPoint(
+    int index, Eigen::ArrayXXd &m_matrix, Eigen::ArrayXXd &m_averAngles,
+    std::vector<int> &nn_indices, std::vector<float> &nn_sqr_dists) const {
     assert(image_width_ > 0);
     assert(support_angle_cos_ <= 1.0 &&
            support_angle_cos_ >= 0.0); // may be permit negative cosine?
@@ -87,10 +99,9 @@ pcl::SpinImageEstimation<PointInT, PointNT, PointOutT>::computeSiForPoint(
                   ? rotation_axes_cloud_->points[index].getNormalVector3fMap()
                   : origin_normal;
 
-    Eigen::ArrayXXd m_matrix(
-        Eigen::ArrayXXd::Zero(image_width_ + 1, 2 * image_width_ + 1));
-    Eigen::ArrayXXd m_averAngles(
-        Eigen::ArrayXXd::Zero(image_width_ + 1, 2 * image_width_ + 1));
+    m_matrix.setZero(image_width_ + 1, 2 * image_width_ + 1);
+    if (is_angular_)
+        m_averAngles.setZero(image_width_ + 1, 2 * image_width_ + 1);
 
     // OK, we are interested in the points of the cylinder of height 2*r and
     // base radius r, where r = m_dBinSize * in_iImageWidth
@@ -103,8 +114,6 @@ pcl::SpinImageEstimation<PointInT, PointNT, PointOutT>::computeSiForPoint(
     else
         bin_size = search_radius_ / image_width_ / sqrt(2.0);
 
-    std::vector<int> nn_indices;
-    std::vector<float> nn_sqr_dists;
     const int neighb_cnt = this->searchForNeighbors(index, search_radius_,
                                                     nn_indices, nn_sqr_dists);
     if (neighb_cnt < static_cast<int>(min_pts_neighb_)) {
@@ -236,14 +245,11 @@ pcl::SpinImageEstimation<PointInT, PointNT, PointOutT>::computeSiForPoint(
         m_matrix(alpha_bin + 1, beta_bin + 1) += a * b;
 
         if (is_angular_) {
-            m_averAngles(alpha_bin, beta_bin) +=
-                (1 - a) * (1 - b) * acos(cos_between_normals);
-            m_averAngles(alpha_bin + 1, beta_bin) +=
-                a * (1 - b) * acos(cos_between_normals);
-            m_averAngles(alpha_bin, beta_bin + 1) +=
-                (1 - a) * b * acos(cos_between_normals);
-            m_averAngles(alpha_bin + 1, beta_bin + 1) +=
-                a * b * acos(cos_between_normals);
+            const double angle = acos(cos_between_normals);
+            m_averAngles(alpha_bin, beta_bin) += (1 - a) * (1 - b) * angle;
+            m_averAngles(alpha_bin + 1, beta_bin) += a * (1 - b) * angle;
+            m_averAngles(alpha_bin, beta_bin + 1) += (1 - a) * b * angle;
+            m_averAngles(alpha_bin + 1, beta_bin + 1) += a * b * angle;
         }
     }
 
@@ -259,8 +265,6 @@ pcl::SpinImageEstimation<PointInT, PointNT, PointOutT>::computeSiForPoint(
         // normalization
         m_matrix /= m_matrix.sum();
     }
-
-    return m_matrix;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
@@ -80,6 +80,14 @@ bool pcl::UniqueShapeContext<PointInT, PointOutT, PointRFT>::initCompute() {
         return (false);
     }
 
+    computeBinTables();
+    return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointOutT, typename PointRFT>
+void pcl::UniqueShapeContext<PointInT, PointOutT,
+                             PointRFT>::computeBinTables() {
     // Update descriptor length
     descriptor_length_ = elevation_bins_ * azimuth_bins_ * radius_bins_;
 
@@ -146,7 +154,6 @@ bool pcl::UniqueShapeContext<PointInT, PointOutT, PointRFT>::initCompute() {
                             k * radius_bins_ + j] = 1.0f / powf(V, e);
         }
     }
-    return (true);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
@@ -154,6 +161,17 @@ template <typename PointInT, typename PointOutT, typename PointRFT>
 void pcl::UniqueShapeContext<PointInT, PointOutT, PointRFT>::
     computePointDescriptor(size_t index,
                            /*float rf[9],*/ std::vector<float> &desc) {
+    std::vector<int> nn_indices;
+    std::vector<float> nn_dists;
+    computePointDescriptor(index, desc, nn_indices, nn_dists);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointInT, typename PointOutT, typename PointRFT>
+void pcl::UniqueShapeContext<PointInT, PointOutT, PointRFT>::
+    computePointDescriptor(size_t index, std::vector<float> &desc,
+                           std::vector<int> &nn_indices,
+                           std::vector<float> &nn_dists) const {
     pcl::Vector3fMapConst origin =
         input_->points[(*indices_)[index]].getVector3fMap();
 
@@ -167,10 +185,22 @@ void pcl::UniqueShapeContext<PointInT, PointOutT, PointRFT>::
                                  frames_->points[index].z_axis[2]);
 
     // Find every point within specified search_radius_
-    std::vector<int> nn_indices;
-    std::vector<float> nn_dists;
     const size_t neighb_cnt = searchForNeighbors(
         (*indices_)[index], search_radius_, nn_indices, nn_dists);
+
+    // The divisions are log-spaced along the radius and evenly spaced along
+    // the angles, so the bins can be looked up directly
+    const float log_min_radius = logf(radii_interval_[0]);
+    const float radius_scale =
+        static_cast<float>(radius_bins_) /
+        (logf(radii_interval_[radius_bins_]) - log_min_radius);
+    const float theta_scale = static_cast<float>(elevation_bins_) / 180.0f;
+    const float phi_scale = static_cast<float>(azimuth_bins_) / 360.0f;
+
+    // Reused by the density searches of all the neighbours
+    std::vector<int> neighbour_indices;
+    std::vector<float> neighbour_didtances;
+
     // For each point within radius
     for (size_t ne = 0; ne < neighb_cnt; ne++) {
         if (pcl::utils::equal(nn_dists[ne], 0.0f))
@@ -204,37 +234,14 @@ void pcl::UniqueShapeContext<PointInT, PointOutT, PointRFT>::
         float theta = normal.dot(no);
         theta = pcl::rad2deg(acosf(std::min(1.0f, std::max(-1.0f, theta))));
 
-        /// Bin (j, k, l)
-        size_t j = 0;
-        size_t k = 0;
-        size_t l = 0;
-
         /// Compute the Bin(j, k, l) coordinates of current neighbour
-        for (size_t rad = 1; rad < radius_bins_ + 1; rad++) {
-            if (r <= radii_interval_[rad]) {
-                j = rad - 1;
-                break;
-            }
-        }
-
-        for (size_t ang = 1; ang < elevation_bins_ + 1; ang++) {
-            if (theta <= theta_divisions_[ang]) {
-                k = ang - 1;
-                break;
-            }
-        }
-
-        for (size_t ang = 1; ang < azimuth_bins_ + 1; ang++) {
-            if (phi <= phi_divisions_[ang]) {
-                l = ang - 1;
-                break;
-            }
-        }
+        const size_t j = findBin(r, radii_interval_,
+                                 (logf(r) - log_min_radius) * radius_scale);
+        const size_t k = findBin(theta, theta_divisions_, theta * theta_scale);
+        const size_t l = findBin(phi, phi_divisions_, phi * phi_scale);
 
         /// Local point density = number of points in a sphere of radius
         /// "point_density_radius_" around the current neighbour
-        std::vector<int> neighbour_indices;
-        std::vector<float> neighbour_didtances;
         float point_density = static_cast<float>(
             searchForNeighbors(*surface_, nn_indices[ne], point_density_radius_,
                                neighbour_indices, neighbour_didtances));
@@ -105,7 +105,8 @@ template <class DataType, unsigned Dimension> class IntegralImage2D {
         : first_order_integral_image_(), second_order_integral_image_(),
           finite_values_integral_image_(), width_(1), height_(1),
           compute_second_order_integral_images_(
-              compute_second_order_integral_images) {}
+              compute_second_order_integral_images),
+          threads_(1) {}
 
     /** \brief Destructor */
     virtual ~IntegralImage2D() {}
@@ -115,6 +116,15 @@ template <class DataType, unsigned Dimension> class IntegralImage2D {
      */
     void setSecondOrderComputation(bool compute_second_order_integral_images);
 
+    /** \brief Set the number of threads used to compute the integral images.
+     * The image is split in horizontal bands which are summed in parallel.
+     * \param[in] nr_threads the number of threads (0 sets the value back to
+     * automatic)
+     */
+    inline void setNumberOfThreads(unsigned nr_threads = 0) {
+        threads_ = nr_threads;
+    }
+
     /** \brief Set the input data to compute the integral image for
      * \param[in] data the input data
      * \param[in] width the width of the data
@@ -196,6 +206,24 @@ template <class DataType, unsigned Dimension> class IntegralImage2D {
     void computeIntegralImages(const DataType *data, unsigned row_stride,
                                unsigned element_stride);
 
+    /** \brief Compute a row of the integral images from the prefix sums of a
+     * row of the input data and another row of the integral images
+     * \param[in] data the input data of the row
+     * \param[in] element_stride the element stride of the data
+     * \param[in] row the row of the integral images, one more than the row of
+     * the data
+     * \param[in] previous_row the row of the integral images to add, 0 for
+     * none
+     */
+    void computeRowSums(const DataType *data, unsigned element_stride,
+                        unsigned row, unsigned previous_row);
+
+    /** \brief Add a row of the integral images to another one
+     * \param[in] row the row to add to
+     * \param[in] source_row the row to add
+     */
+    void addRow(unsigned row, unsigned source_row);
+
     std::vector<ElementType, Eigen::aligned_allocator<ElementType>>
         first_order_integral_image_;
     std::vector<SecondOrderType, Eigen::aligned_allocator<SecondOrderType>>
@@ -209,6 +237,9 @@ template <class DataType, unsigned Dimension> class IntegralImage2D {
 
     /** \brief Indicates whether second order integral images are available **/
     bool compute_second_order_integral_images_;
+
+    /** \brief The number of threads used to compute the integral images. */
+    unsigned threads_;
 };
 
 /**
@@ -231,11 +262,21 @@ template <class DataType> class IntegralImage2D<DataType, 1> {
         : first_order_integral_image_(), second_order_integral_image_(),
           finite_values_integral_image_(), width_(1), height_(1),
           compute_second_order_integral_images_(
-              compute_second_order_integral_images) {}
+              compute_second_order_integral_images),
+          threads_(1) {}
 
     /** \brief Destructor */
     virtual ~IntegralImage2D() {}
 
+    /** \brief Set the number of threads used to compute the integral images.
+     * The image is split in horizontal bands which are summed in parallel.
+     * \param[in] nr_threads the number of threads (0 sets the value back to
+     * automatic)
+     */
+    inline void setNumberOfThreads(unsigned nr_threads = 0) {
+        threads_ = nr_threads;
+    }
+
     /** \brief Set the input data to compute the integral image for
      * \param[in] data the input data
      * \param[in] width the width of the data
@@ -315,6 +356,24 @@ template <class DataType> class IntegralImage2D<DataType, 1> {
     void computeIntegralImages(const DataType *data, unsigned row_stride,
                                unsigned element_stride);
 
+    /** \brief Compute a row of the integral images from the prefix sums of a
+     * row of the input data and another row of the integral images
+     * \param[in] data the input data of the row
+     * \param[in] element_stride the element stride of the data
+     * \param[in] row the row of the integral images, one more than the row of
+     * the data
+     * \param[in] previous_row the row of the integral images to add, 0 for
+     * none
+     */
+    void computeRowSums(const DataType *data, unsigned element_stride,
+                        unsigned row, unsigned previous_row);
+
+    /** \brief Add a row of the integral images to another one
+     * \param[in] row the row to add to
+     * \param[in] source_row the row to add
+     */
+    void addRow(unsigned row, unsigned source_row);
+
     std::vector<ElementType, Eigen::aligned_allocator<ElementType>>
         first_order_integral_image_;
     std::vector<SecondOrderType, Eigen::aligned_allocator<SecondOrderType>>
@@ -328,6 +387,9 @@ template <class DataType> class IntegralImage2D<DataType, 1> {
 
     /** \brief Indicates whether second order integral images are available **/
     bool compute_second_order_integral_images_;
+
+    /** \brief The number of threads used to compute the integral images. */
+    unsigned threads_;
 };
 } // namespace pcl
 
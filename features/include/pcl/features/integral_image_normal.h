@@ -92,13 +92,13 @@ class IntegralImageNormalEstimation : public Feature<PointInT, PointOutT> {
           rect_height_2_(0), rect_height_4_(0), distance_threshold_(0),
           integral_image_DX_(false), integral_image_DY_(false),
           integral_image_depth_(false), integral_image_XYZ_(true),
-          diff_x_(NULL), diff_y_(NULL), depth_data_(NULL), distance_map_(NULL),
+          diff_x_(), diff_y_(), distance_map_(), depth_change_map_(),
           use_depth_dependent_smoothing_(false),
           max_depth_change_factor_(20.0f * 0.001f),
           normal_smoothing_size_(10.0f), init_covariance_matrix_(false),
           init_average_3d_gradient_(false), init_simple_3d_gradient_(false),
           init_depth_change_(false), vpx_(0.0f), vpy_(0.0f), vpz_(0.0f),
-          use_sensor_origin_(true) {
+          use_sensor_origin_(true), threads_(1) {
         feature_name_ = "IntegralImagesNormalEstimation";
         tree_.reset();
         k_ = 1;
@@ -113,6 +113,14 @@ class IntegralImageNormalEstimation : public Feature<PointInT, PointOutT> {
      */
     void setRectSize(const int width, const int height);
 
+    /** \brief Set the number of threads used to build the integral images
+     * and to estimate the normals. Set it before setInputCloud (), which
+     * builds the integral images.
+     * \param[in] nr_threads the number of threads (0 sets the value back to
+     * automatic)
+     */
+    void setNumberOfThreads(unsigned int nr_threads = 0);
+
     /** \brief Sets the policy for handling borders.
      * \param[in] border_policy the border policy.
      */
@@ -218,7 +226,9 @@ class IntegralImageNormalEstimation : public Feature<PointInT, PointOutT> {
     /** \brief Returns a pointer to the distance map which was computed
      * internally
      */
-    inline float *getDistanceMap() { return (distance_map_); }
+    inline float *getDistanceMap() {
+        return (distance_map_.empty() ? NULL : &distance_map_[0]);
+    }
 
     /** \brief Set the viewpoint.
      * \param vpx the X coordinate of the viewpoint
@@ -311,15 +321,15 @@ class IntegralImageNormalEstimation : public Feature<PointInT, PointOutT> {
     IntegralImage2D<float, 3> integral_image_XYZ_;
 
     /** derivatives in x-direction */
-    float *diff_x_;
+    std::vector<float> diff_x_;
     /** derivatives in y-direction */
-    float *diff_y_;
-
-    /** depth data */
-    float *depth_data_;
+    std::vector<float> diff_y_;
 
     /** distance map */
-    float *distance_map_;
+    std::vector<float> distance_map_;
+
+    /** depth change map, 0 on depth discontinuities */
+    std::vector<unsigned char> depth_change_map_;
 
     /** \brief Smooth data based on depth (true/false). */
     bool use_depth_dependent_smoothing_;
@@ -356,6 +366,9 @@ class IntegralImageNormalEstimation : public Feature<PointInT, PointOutT> {
      * should be used.*/
     bool use_sensor_origin_;
 
+    /** \brief The number of threads used by the estimation. */
+    unsigned int threads_;
+
     /** \brief This method should get called before starting the actual
      * computation. */
     bool initCompute();
@@ -376,6 +389,52 @@ class IntegralImageNormalEstimation : public Feature<PointInT, PointOutT> {
      */
     void initSimple3DGradientMethod();
 
+    /** \brief Initialize the data of the normal estimation method chosen, if
+     * not done yet for the current input. */
+    void initMethodData();
+
+    /** \brief Computes the normal at the specified position, in a rectangle of
+     * the given size. The data of the method must be initialized.
+     * \param[in] pos_x x position (pixel)
+     * \param[in] pos_y y position (pixel)
+     * \param[in] point_index the position index of the point
+     * \param[in] rect_width the width of the rectangle
+     * \param[in] rect_height the height of the rectangle
+     * \param[out] normal the output estimated normal
+     */
+    void computePointNormal(const int pos_x, const int pos_y,
+                            const unsigned point_index, const int rect_width,
+                            const int rect_height, PointOutT &normal) const;
+
+    /** \brief Computes the normal at the specified position, in a rectangle of
+     * the given size, with mirroring for border handling. The data of the
+     * method must be initialized.
+     * \param[in] pos_x x position (pixel)
+     * \param[in] pos_y y position (pixel)
+     * \param[in] point_index the position index of the point
+     * \param[in] rect_width the width of the rectangle
+     * \param[in] rect_height the height of the rectangle
+     * \param[out] normal the output estimated normal
+     */
+    void computePointNormalMirror(const int pos_x, const int pos_y,
+                                  const unsigned point_index,
+                                  const int rect_width, const int rect_height,
+                                  PointOutT &normal) const;
+
+    /** \brief Check whether the depth changes too much between two points.
+     * \param[in] index the index of the first point, giving the threshold
+     * \param[in] neighbor_index the index of the second point
+     */
+    bool isDepthChange(const int index, const int neighbor_index) const;
+
+    /** \brief Get the size of the smoothing rectangle of a point from the
+     * distance map.
+     * \param[in] index the index of the point
+     * \param[out] rect_size the width and height of the rectangle
+     * \return false if the normal of the point cannot be estimated
+     */
+    bool getSmoothingRectSize(const int index, int &rect_size) const;
+
   private:
     /** \brief Make the computeFeature (&Eigen::MatrixXf); inaccessible from
      * outside the class \param[out] output the output point cloud
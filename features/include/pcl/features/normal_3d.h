@@ -101,6 +101,23 @@ inline void computePointNormal(const pcl::PointCloud<PointT> &cloud,
                          curvature);
 }
 
+/** \brief Compute the Least-Squares plane fits of many neighborhoods at once,
+ * and return the estimated normals together with the surface curvatures.
+ * With SSE, the covariance matrices and their eigen decompositions are
+ * computed four neighborhoods at a time.
+ * \param[in] cloud the point cloud the neighbor indices refer to
+ * \param[in] neighborhoods the neighbors of each query
+ * \param[out] normals the normal and curvature of each query, NaN for the
+ * queries without finite neighbors. The normals are not flipped.
+ * \param[in] nr_threads the number of threads to use (0 for automatic)
+ * \ingroup features
+ */
+template <typename PointT, typename PointNT>
+void computePointNormals(const pcl::PointCloud<PointT> &cloud,
+                         const pcl::Neighborhoods &neighborhoods,
+                         pcl::PointCloud<PointNT> &normals,
+                         unsigned int nr_threads = 1);
+
 /** \brief Flip (in place) the estimated normal of a point towards a given
  * viewpoint \param point a given point \param vp_x the X coordinate of the
  * viewpoint \param vp_y the X coordinate of the viewpoint \param vp_z the X
@@ -199,7 +216,7 @@ class NormalEstimation : public Feature<PointInT, PointOutT> {
     /** \brief Empty constructor. */
     NormalEstimation()
         : vpx_(0), vpy_(0), vpz_(0), covariance_matrix_(), xyz_centroid_(),
-          use_sensor_origin_(true) {
+          use_sensor_origin_(true), batched_(false) {
         feature_name_ = "NormalEstimation";
     };
 
@@ -309,6 +326,18 @@ class NormalEstimation : public Feature<PointInT, PointOutT> {
         }
     }
 
+    /** \brief Set whether the normals are computed in batches: the
+     * neighbors of a block of points are searched at once, then their plane
+     * fits are computed together by computePointNormals (). This is faster
+     * on large clouds, at the cost of keeping the neighbors of a block in
+     * memory.
+     * \param[in] batched true to compute the normals in batches
+     */
+    inline void setBatchedComputation(bool batched) { batched_ = batched; }
+
+    /** \brief Get whether the normals are computed in batches. */
+    inline bool getBatchedComputation() const { return (batched_); }
+
   protected:
     /** \brief Estimate normals for all points given in <setInputCloud (),
      * setIndices ()> using the surface in setSearchSurface () and the spatial
@@ -319,6 +348,14 @@ class NormalEstimation : public Feature<PointInT, PointOutT> {
      */
     void computeFeature(PointCloudOut &output);
 
+    /** \brief Estimate normals for all points given in <setInputCloud (),
+     * setIndices ()> in batches, see setBatchedComputation ().
+     * \param[out] output the resultant point cloud model dataset that
+     * contains surface normals and curvatures
+     * \param[in] nr_threads the number of threads to use (0 for automatic)
+     */
+    void computeFeatureBatched(PointCloudOut &output, unsigned int nr_threads);
+
     /** \brief Values describing the viewpoint ("pinhole" camera model assumed).
      * For per point viewpoints, inherit
      * from NormalEstimation and provide your own computeFeature (). By default,
@@ -337,6 +374,9 @@ class NormalEstimation : public Feature<PointInT, PointOutT> {
      * should be used.*/
     bool use_sensor_origin_;
 
+    /** \brief Whether the normals are computed in batches. */
+    bool batched_;
+
   private:
     /** \brief Make the computeFeature (&Eigen::MatrixXf); inaccessible from
      * outside the class \param[out] output the output point cloud
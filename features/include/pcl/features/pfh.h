@@ -42,7 +42,6 @@
 
 #include <pcl/point_types.h>
 #include <pcl/features/feature.h>
-#include <map>
 
 namespace pcl {
 /** \brief Compute the 4-tuple representation containing the three angles and
@@ -65,6 +64,73 @@ PCL_EXPORTS bool computePairFeatures(const Eigen::Vector4f &p1,
                                      const Eigen::Vector4f &n2, float &f1,
                                      float &f2, float &f3, float &f4);
 
+/** \brief A bounded hash table of the pair features of ordered pairs of
+ * points, which can be shared by the threads computing PFH signatures.
+ *
+ * The table uses open addressing over groups of 8 slots: a pair is only
+ * looked for in the group its key hashes to, and overwrites one of the
+ * entries of this group when it is full. Both the memory and the probe
+ * length are thus bounded, at the price of forgetting some pairs. Inside
+ * active OpenMP parallel regions, the accesses to a group are serialized by
+ * one of a fixed set of locks.
+ * \ingroup features
+ */
+class PCL_EXPORTS PairFeatureCache {
+  public:
+    /** \brief Empty constructor: the cache holds nothing until \a reset. */
+    PairFeatureCache();
+
+    /** \brief Copy constructor: the copy starts empty. */
+    PairFeatureCache(const PairFeatureCache &);
+
+    /** \brief Assignment operator: the cache is emptied. */
+    PairFeatureCache &operator=(const PairFeatureCache &);
+
+    /** \brief Destructor. */
+    ~PairFeatureCache();
+
+    /** \brief Empty the cache and make room for at most max_size pairs.
+     * \param[in] max_size the maximum number of pairs, rounded down to a
+     * power of 2 (0 frees the memory and disables the cache)
+     */
+    void reset(size_t max_size);
+
+    /** \brief Get the number of pairs the cache can hold. */
+    inline size_t capacity() const { return (keys_.size()); }
+
+    /** \brief Look for the features of a pair of points.
+     * \param[in] p_idx the index of the first point (source)
+     * \param[in] q_idx the index of the second point (target)
+     * \param[out] features the f1, f2, f3 and f4 features of the pair, if
+     * found
+     * \return true if the pair is in the cache
+     */
+    bool find(int p_idx, int q_idx, Eigen::Vector4f &features) const;
+
+    /** \brief Store the features of a pair of points.
+     * \param[in] p_idx the index of the first point (source)
+     * \param[in] q_idx the index of the second point (target)
+     * \param[in] features the f1, f2, f3 and f4 features of the pair
+     */
+    void insert(int p_idx, int q_idx, const Eigen::Vector4f &features);
+
+  private:
+    /** \brief The locks serializing the accesses to the groups. */
+    struct Locks;
+
+    /** \brief The keys of the pairs, or the empty key. */
+    std::vector<uint64_t> keys_;
+
+    /** \brief The features of the pairs, 4 per slot. */
+    std::vector<float> features_;
+
+    /** \brief The number of groups minus one. */
+    size_t group_mask_;
+
+    /** \brief The locks, allocated along the table. */
+    Locks *locks_;
+};
+
 /** \brief PFHEstimation estimates the Point Feature Histogram (PFH) descriptor
  * for a given point cloud dataset containing points and normals.
  *
@@ -90,9 +156,9 @@ PCL_EXPORTS bool computePairFeatures(const Eigen::Vector4f &p1,
  *     doesn't have finite 3D coordinates. Therefore, any point that contains
  *     NaN data on x, y, or z, will have its PFH feature property set to NaN.
  *
- * \note The code is stateful as we do not expect this class to be multicore
- * parallelized. Please look at \ref FPFHEstimationOMP for examples on parallel
- * implementations of the FPFH (Fast Point Feature Histogram).
+ * \note The neighbors of the search surface points can be given beforehand
+ * with \ref setSearchNeighborhoods, and are otherwise searched all at once.
+ * Please look at \ref PFHEstimationOMP for a parallel implementation.
  *
  * \author Radu B. Rusu
  * \ingroup features
@@ -118,20 +184,19 @@ class PFHEstimation : public FeatureFromNormals<PointInT, PointNT, PointOutT> {
      * cache size to 1GB.
      */
     PFHEstimation()
-        : nr_subdiv_(5), pfh_histogram_(), pfh_tuple_(),
-          d_pi_(1.0f / (2.0f * static_cast<float>(M_PI))), feature_map_(),
-          key_list_(),
+        : nr_subdiv_(5), pfh_histogram_(),
+          d_pi_(1.0f / (2.0f * static_cast<float>(M_PI))), feature_cache_(),
           // Default 1GB memory size. Need to set it to something more
           // conservative.
-          max_cache_size_(
-              (1ul * 1024ul * 1024ul * 1024ul) /
-              sizeof(std::pair<std::pair<int, int>, Eigen::Vector4f>)),
+          max_cache_size_((1ul * 1024ul * 1024ul * 1024ul) /
+                          (sizeof(uint64_t) + sizeof(Eigen::Vector4f))),
           use_cache_(false) {
         feature_name_ = "PFHEstimation";
     };
 
-    /** \brief Set the maximum internal cache size. Defaults to 2GB worth of
-     * entries. \param[in] cache_size maximum cache size
+    /** \brief Set the maximum internal cache size, in pairs. Defaults to 1GB
+     * worth of entries; the cache never holds more pairs than the
+     * neighborhoods have though. \param[in] cache_size maximum cache size
      */
     inline void setMaximumCacheSize(unsigned int cache_size) {
         max_cache_size_ = cache_size;
@@ -146,7 +211,8 @@ class PFHEstimation : public FeatureFromNormals<PointInT, PointNT, PointOutT> {
      * \note Depending on how the point cloud is ordered and how the nearest
      * neighbors are estimated, using a cache could have a positive or a
      * negative influence. Please test with and without a cache on your
-     * data, and choose whatever works best!
+     * data, and choose whatever works best! The cache is shared by the
+     * threads of \ref PFHEstimationOMP.
      *
      * See \ref setMaximumCacheSize for setting the maximum cache size
      *
@@ -189,6 +255,7 @@ class PFHEstimation : public FeatureFromNormals<PointInT, PointNT, PointOutT> {
      * the dataset \param[in] nr_split the number of subdivisions for each
      * angular feature interval \param[out] pfh_histogram the resultant
      * (combinatorial) PFH histogram representing the feature at the query point
+     * \note Safe to call from concurrent threads with different histograms.
      */
     void computePointPFHSignature(const pcl::PointCloud<PointInT> &cloud,
                                   const pcl::PointCloud<PointNT> &normals,
@@ -204,30 +271,37 @@ class PFHEstimation : public FeatureFromNormals<PointInT, PointNT, PointOutT> {
      */
     void computeFeature(PointCloudOut &output);
 
+    /** \brief Estimate the PFH descriptors of all the query points on
+     * nr_threads threads, using the neighborhoods given by \a
+     * setSearchNeighborhoods or searching them all at once.
+     * \param[out] output the resultant point cloud model dataset that contains
+     * the PFH feature estimates
+     * \param[in] nr_threads the number of threads to use (0 for automatic)
+     */
+    void computeFeatureParallel(PointCloudOut &output,
+                                unsigned int nr_threads);
+
+    /** \brief Empty the internal cache and size it for the pairs of the
+     * neighborhoods of the queries, if it is used.
+     * \param[in] neighborhoods the neighborhoods of the queries, as returned
+     * by \a getQueryNeighborhoods
+     * \param[in] by_point true if the neighbors of the idx-th query are in the
+     * (*indices_)[idx]-th neighborhood, false if they are in the idx-th one
+     */
+    void resetCache(const pcl::Neighborhoods &neighborhoods, bool by_point);
+
     /** \brief The number of subdivisions for each angular feature interval. */
     int nr_subdiv_;
 
     /** \brief Placeholder for a point's PFH signature. */
     Eigen::VectorXf pfh_histogram_;
 
-    /** \brief Placeholder for a PFH 4-tuple. */
-    Eigen::Vector4f pfh_tuple_;
-
-    /** \brief Placeholder for a histogram index. */
-    int f_index_[3];
-
     /** \brief Float constant = 1.0 / (2.0 * M_PI) */
     float d_pi_;
 
-    /** \brief Internal hashmap, used to optimize efficiency of redundant
-     * computations. */
-    std::map<std::pair<int, int>, Eigen::Vector4f,
-             std::less<std::pair<int, int>>,
-             Eigen::aligned_allocator<Eigen::Vector4f>>
-        feature_map_;
-
-    /** \brief Queue of pairs saved, used to constrain memory usage. */
-    std::queue<std::pair<int, int>> key_list_;
+    /** \brief Internal cache of pair features, used to optimize efficiency of
+     * redundant computations. */
+    PairFeatureCache feature_cache_;
 
     /** \brief Maximum size of internal cache memory. */
     unsigned int max_cache_size_;
@@ -290,8 +364,6 @@ class PFHEstimation<PointInT, PointNT, Eigen::MatrixXf>
     using PFHEstimation<PointInT, PointNT,
                         pcl::PFHSignature125>::computePointPFHSignature;
     using PFHEstimation<PointInT, PointNT, pcl::PFHSignature125>::compute;
-    using PFHEstimation<PointInT, PointNT, pcl::PFHSignature125>::feature_map_;
-    using PFHEstimation<PointInT, PointNT, pcl::PFHSignature125>::key_list_;
 
   private:
     /** \brief Estimate the Point Feature Histograms (PFH) descriptors at a set
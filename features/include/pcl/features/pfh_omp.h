@@ -0,0 +1,115 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Point Cloud Library (PCL) - www.pointclouds.org
+ *  Copyright (c) 2010-2011, Willow Garage, Inc.
+ *  Copyright (c) 2012-, Open Perception, Inc.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_PFH_OMP_H_
+#define PCL_PFH_OMP_H_
+
+#include <pcl/features/feature.h>
+#include <pcl/features/pfh.h>
+
+namespace pcl {
+/** \brief PFHEstimationOMP estimates the Point Feature Histogram (PFH)
+ * descriptor for a given point cloud dataset containing points and normals,
+ * in parallel, using the OpenMP standard.
+ *
+ * When enabled with \ref setUseInternalCache, the cache of pair features is
+ * shared by all the threads.
+ *
+ * \note If you use this code in any academic work, please cite:
+ *
+ *   - R.B. Rusu, N. Blodow, Z.C. Marton, M. Beetz.
+ *     Aligning Point Cloud Views using Persistent Feature Histograms.
+ *     In Proceedings of the 21st IEEE/RSJ International Conference on
+ * Intelligent Robots and Systems (IROS), Nice, France, September 22-26 2008.
+ *
+ * \attention
+ * The convention for PFH features is:
+ *   - if a query point's nearest neighbors cannot be estimated, the PFH feature
+ * will be set to NaN (not a number)
+ *   - it is impossible to estimate a PFH descriptor for a point that
+ *     doesn't have finite 3D coordinates. Therefore, any point that contains
+ *     NaN data on x, y, or z, will have its PFH feature property set to NaN.
+ *
+ * \ingroup features
+ */
+template <typename PointInT, typename PointNT,
+          typename PointOutT = pcl::PFHSignature125>
+class PFHEstimationOMP : public PFHEstimation<PointInT, PointNT, PointOutT> {
+  public:
+    using Feature<PointInT, PointOutT>::feature_name_;
+
+    typedef typename Feature<PointInT, PointOutT>::PointCloudOut PointCloudOut;
+
+    /** \brief Initialize the scheduler and set the number of threads to use.
+     * \param[in] nr_threads the number of hardware threads to use (0 sets the
+     * value back to automatic)
+     */
+    PFHEstimationOMP(unsigned int nr_threads = 0) : threads_(nr_threads) {
+        feature_name_ = "PFHEstimationOMP";
+    }
+
+    /** \brief Initialize the scheduler and set the number of threads to use.
+     * \param[in] nr_threads the number of hardware threads to use (0 sets the
+     * value back to automatic)
+     */
+    inline void setNumberOfThreads(unsigned int nr_threads = 0) {
+        threads_ = nr_threads;
+    }
+
+  private:
+    /** \brief Estimate the Point Feature Histograms (PFH) descriptors at a set
+     * of points given by <setInputCloud (), setIndices ()> using the surface in
+     * setSearchSurface () and the spatial locator in setSearchMethod ()
+     * \param[out] output the resultant point cloud model dataset that contains
+     * the PFH feature estimates
+     */
+    void computeFeature(PointCloudOut &output);
+
+    /** \brief The number of threads the scheduler should use. */
+    unsigned int threads_;
+
+    /** \brief Make the computeFeature (&Eigen::MatrixXf); inaccessible from
+     * outside the class \param[out] output the output point cloud
+     */
+    void computeFeatureEigen(pcl::PointCloud<Eigen::MatrixXf> &) {}
+};
+} // namespace pcl
+
+#endif //#ifndef PCL_PFH_OMP_H_
@@ -237,12 +237,33 @@ class SHOTEstimation
 
     typedef typename Feature<PointInT, PointOutT>::PointCloudIn PointCloudIn;
 
+    using FeatureWithLocalReferenceFrames<PointInT,
+                                          PointRFT>::frames_never_defined_;
+
+    typedef typename FeatureWithLocalReferenceFrames<
+        PointInT, PointRFT>::PointCloudLRF PointCloudLRF;
+
     /** \brief Empty constructor. */
     SHOTEstimation()
-        : SHOTEstimationBase<PointInT, PointNT, PointOutT, PointRFT>(10) {
+        : SHOTEstimationBase<PointInT, PointNT, PointOutT, PointRFT>(10),
+          fused_(false) {
         feature_name_ = "SHOTEstimation";
     };
 
+    /** \brief Set whether the local reference frames are estimated along the
+     * descriptors. The neighbors of each point are then searched and gathered
+     * once for both, and the angles and bins of the descriptor are computed
+     * four neighbors at a time with SSE. The frames are the same as those of
+     * SHOTLocalReferenceFrameEstimation, up to floating point precision.
+     * \note Frames given with setInputReferenceFrames () are used as is.
+     * \param[in] fused true to estimate the frames along the descriptors
+     */
+    inline void setFusedComputation(bool fused) { fused_ = fused; }
+
+    /** \brief Get whether the local reference frames are estimated along the
+     * descriptors. */
+    inline bool getFusedComputation() const { return (fused_); }
+
     /** \brief Estimate the SHOT descriptor for a given point based on its
      * spatial neighborhood of 3D points with normals \param[in] index the index
      * of the point in indices_ \param[in] indices the k-neighborhood point
@@ -264,6 +285,54 @@ class SHOTEstimation
      * SHOT feature estimates
      */
     void computeFeature(pcl::PointCloud<PointOutT> &output);
+
+    /** \brief This method should get called before starting the actual
+     * computation. The local reference frames are not estimated here when
+     * they are fused with the descriptors. */
+    virtual bool initCompute();
+
+    /** \brief The neighbors of a point relative to it, in structure of arrays
+     * layout, reused from one point to the next. */
+    struct FusedNeighbors {
+        /** \brief Resize the arrays to hold n neighbors, plus padding up to
+         * a multiple of 4. */
+        void resize(size_t n);
+
+        std::vector<float> x, y, z, distance;
+        std::vector<float> normal_x, normal_y, normal_z;
+        std::vector<float> local_x, local_y, local_z;
+        std::vector<float> bin_distance, inclination, azimuth;
+    };
+
+    /** \brief Estimate the local reference frame and the SHOT descriptor of
+     * a point in a single pass over its neighbors.
+     * \param[in] index the index of the point in indices_
+     * \param[in] indices the neighborhood point indices in surface_
+     * \param[in] sqr_dists the neighborhood point distances in surface_
+     * \param[in,out] neighbors the scratch buffers
+     * \param[out] rf the local reference frame, one axis per row
+     * \param[out] shot the resultant SHOT descriptor
+     * \return false if the frame could not be estimated (less than 5
+     * neighbors or a degenerate covariance)
+     */
+    bool computePointSHOTFused(const int index,
+                               const std::vector<int> &indices,
+                               const std::vector<float> &sqr_dists,
+                               FusedNeighbors &neighbors, Eigen::Matrix3f &rf,
+                               Eigen::VectorXf &shot);
+
+    /** \brief Estimate the local reference frames and the SHOT descriptors
+     * of all the points together, see setFusedComputation ().
+     * \param output the resultant point cloud model dataset that contains the
+     * SHOT feature estimates
+     * \param[in] nr_threads the number of threads to use (0 for automatic)
+     */
+    void computeFeatureFused(pcl::PointCloud<PointOutT> &output,
+                             unsigned int nr_threads);
+
+    /** \brief Whether the local reference frames are estimated along the
+     * descriptors. */
+    bool fused_;
 };
 
 /** \brief SHOTEstimation estimates the Signature of Histograms of OrienTations
@@ -362,6 +431,10 @@ class SHOTEstimation<PointInT, PointNT, Eigen::MatrixXf, PointRFT>
      * class \param[out] output the output point cloud
      */
     void compute(pcl::PointCloud<pcl::SHOT352> &) { assert(0); }
+
+    /** \brief Make the setFusedComputation (); inaccessible from outside the
+     * class, the frames are always estimated separately here */
+    void setFusedComputation(bool) {}
 };
 
 /** \brief SHOTColorEstimation estimates the Signature of Histograms of
@@ -80,7 +80,10 @@ class SHOTEstimationOMP
     using Feature<PointInT, PointOutT>::fake_surface_;
     using FeatureFromNormals<PointInT, PointNT, PointOutT>::normals_;
     using FeatureWithLocalReferenceFrames<PointInT, PointRFT>::frames_;
+    using FeatureWithLocalReferenceFrames<PointInT,
+                                          PointRFT>::frames_never_defined_;
     using SHOTEstimation<PointInT, PointNT, PointOutT, PointRFT>::descLength_;
+    using SHOTEstimation<PointInT, PointNT, PointOutT, PointRFT>::fused_;
     using SHOTEstimation<PointInT, PointNT, PointOutT,
                          PointRFT>::nr_grid_sector_;
     using SHOTEstimation<PointInT, PointNT, PointOutT,
@@ -249,6 +249,20 @@ class SpinImageEstimation : public Feature<PointInT, PointOutT> {
      */
     Eigen::ArrayXXd computeSiForPoint(int index) const;
 
+    /** \brief Computes a spin-image for the point of the scan, using buffers
+     * given by the caller. This method can be called from several threads at
+     * once.
+     * \param[in] index the index of the reference point in the input cloud
+     * \param[out] m_matrix estimated spin-image (or its variant) as a matrix
+     * \param[out] m_averAngles scratch buffer for the average angles
+     * \param[out] nn_indices scratch buffer for the neighbor indices
+     * \param[out] nn_sqr_dists scratch buffer for the neighbor distances
+     */
+    void computeSiForPoint(int index, Eigen::ArrayXXd &m_matrix,
+                           Eigen::ArrayXXd &m_averAngles,
+                           std::vector<int> &nn_indices,
+                           std::vector<float> &nn_sqr_dists) const;
+
   private:
     PointCloudNConstPtr input_normals_;
     PointCloudNConstPtr rotation_axes_cloud_;
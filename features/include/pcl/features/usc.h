@@ -150,10 +150,47 @@ class UniqueShapeContext
      */
     void computePointDescriptor(size_t index, std::vector<float> &desc);
 
+    /** Compute 3D shape context feature descriptor. This method does not
+     * modify the object and can be called from several threads at once.
+     * \param[in] index point index in input_
+     * \param[out] desc descriptor to compute
+     * \param[out] nn_indices scratch buffer for the neighbor indices
+     * \param[out] nn_dists scratch buffer for the neighbor distances
+     */
+    void computePointDescriptor(size_t index, std::vector<float> &desc,
+                                std::vector<int> &nn_indices,
+                                std::vector<float> &nn_dists) const;
+
     /** \brief Initialize computation by allocating all the intervals and the
      * volume lookup table. */
     virtual bool initCompute();
 
+    /** \brief Fill the radius, elevation and azimuth divisions and the volume
+     * lookup table from the current parameters. */
+    void computeBinTables();
+
+    /** \brief Find the first bin whose upper division is not smaller than
+     * value, or 0 if there is none.
+     * \param[in] value the value to bin
+     * \param[in] divisions the bin divisions, in increasing order
+     * \param[in] estimate an estimate of the bin, from which the search starts
+     */
+    static inline size_t findBin(float value,
+                                 const std::vector<float> &divisions,
+                                 float estimate) {
+        const size_t bins = divisions.size() - 1;
+        if (!(value <= divisions[bins]))
+            return (0);
+        size_t bin = estimate > 0.0f
+                         ? (std::min)(static_cast<size_t>(estimate), bins - 1)
+                         : 0;
+        while (bin > 0 && value <= divisions[bin])
+            --bin;
+        while (value > divisions[bin + 1])
+            ++bin;
+        return (bin);
+    }
+
     /** \brief The actual feature computation.
      * \param[out] output the resultant features
      */
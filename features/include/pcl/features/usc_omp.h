@@ -0,0 +1,122 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Point Cloud Library (PCL) - www.pointclouds.org
+ *  Copyright (c) 2010-2011, Willow Garage, Inc.
+ *  Copyright (c) 2012-, Open Perception, Inc.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_FEATURES_USC_OMP_H_
+#define PCL_FEATURES_USC_OMP_H_
+
+#include <pcl/features/usc.h>
+
+namespace pcl {
+/** \brief UniqueShapeContextOMP estimates the Unique Shape Context descriptor
+ * in parallel, using the OpenMP standard. The default local reference frames
+ * are estimated in parallel as well.
+ *
+ * \note If you use this code in any academic work, please cite:
+ *   - F. Tombari, S. Salti, L. Di Stefano,
+ *     "Unique Shape Context for 3D data description",
+ *     International Workshop on 3D Object Retrieval (3DOR 10) -
+ *     in conjuction with ACM Multimedia 2010
+ *
+ * \ingroup features
+ */
+template <typename PointInT, typename PointOutT = pcl::ShapeContext1980,
+          typename PointRFT = pcl::ReferenceFrame>
+class UniqueShapeContextOMP
+    : public UniqueShapeContext<PointInT, PointOutT, PointRFT> {
+  public:
+    using Feature<PointInT, PointOutT>::feature_name_;
+    using Feature<PointInT, PointOutT>::getClassName;
+    using Feature<PointInT, PointOutT>::indices_;
+    using Feature<PointInT, PointOutT>::search_radius_;
+    using Feature<PointInT, PointOutT>::surface_;
+    using Feature<PointInT, PointOutT>::fake_surface_;
+    using Feature<PointInT, PointOutT>::input_;
+    using FeatureWithLocalReferenceFrames<PointInT, PointRFT>::frames_;
+    using UniqueShapeContext<PointInT, PointOutT, PointRFT>::min_radius_;
+    using UniqueShapeContext<PointInT, PointOutT, PointRFT>::local_radius_;
+    using UniqueShapeContext<PointInT, PointOutT,
+                             PointRFT>::descriptor_length_;
+
+    typedef typename Feature<PointInT, PointOutT>::PointCloudOut PointCloudOut;
+    typedef typename boost::shared_ptr<
+        UniqueShapeContextOMP<PointInT, PointOutT, PointRFT>>
+        Ptr;
+    typedef typename boost::shared_ptr<
+        const UniqueShapeContextOMP<PointInT, PointOutT, PointRFT>>
+        ConstPtr;
+
+    /** \brief Initialize the scheduler and set the number of threads to use.
+     * \param[in] nr_threads the number of hardware threads to use (0 sets the
+     * value back to automatic)
+     */
+    UniqueShapeContextOMP(unsigned int nr_threads = 0) : threads_(nr_threads) {
+        feature_name_ = "UniqueShapeContextOMP";
+    }
+
+    /** \brief Initialize the scheduler and set the number of threads to use.
+     * \param[in] nr_threads the number of hardware threads to use (0 sets the
+     * value back to automatic)
+     */
+    inline void setNumberOfThreads(unsigned int nr_threads = 0) {
+        threads_ = nr_threads;
+    }
+
+  protected:
+    /** \brief Initialize computation by estimating the default local
+     * reference frames in parallel and allocating the bin tables. */
+    bool initCompute();
+
+    /** \brief The actual feature computation.
+     * \param[out] output the resultant features
+     */
+    void computeFeature(PointCloudOut &output);
+
+    /** \brief The number of threads the scheduler should use. */
+    unsigned int threads_;
+
+  private:
+    /** \brief Make the computeFeature (&Eigen::MatrixXf); inaccessible from
+     * outside the class \param[out] output the output point cloud
+     */
+    void computeFeatureEigen(pcl::PointCloud<Eigen::MatrixXf> &) {}
+};
+} // namespace pcl
+
+#endif //#ifndef PCL_FEATURES_USC_OMP_H_
@@ -41,6 +41,9 @@
 #include <pcl/impl/instantiate.hpp>
 #include <pcl/features/pfh.h>
 #include <pcl/features/impl/pfh.hpp>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 bool pcl::computePairFeatures(const Eigen::Vector4f &p1,
@@ -101,6 +104,171 @@ bool pcl::computePairFeatures(const Eigen::Vector4f &p1,
     return (true);
 }
 
+namespace {
+/** \brief The number of slots of a group. */
+const size_t group_size = 8;
+
+/** \brief The number of locks shared by the groups. */
+const size_t nr_locks = 256;
+
+/** \brief The key of the empty slots. */
+const pcl::uint64_t empty_key = ~static_cast<pcl::uint64_t>(0);
+
+/** \brief Get the key of an ordered pair of points. */
+inline pcl::uint64_t getKey(int p_idx, int q_idx) {
+    return ((static_cast<pcl::uint64_t>(static_cast<pcl::uint32_t>(p_idx))
+             << 32) |
+            static_cast<pcl::uint32_t>(q_idx));
+}
+
+/** \brief Hash a key (Fibonacci hashing): the high bits of the result
+ * depend on all the bits of the key. */
+inline pcl::uint64_t getHash(pcl::uint64_t key) {
+    return (key * static_cast<pcl::uint64_t>(0x9E3779B97F4A7C15ull));
+}
+} // namespace
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+struct pcl::PairFeatureCache::Locks {
+#ifdef _OPENMP
+    Locks() {
+        for (size_t i = 0; i < nr_locks; ++i)
+            omp_init_lock(&locks[i]);
+    }
+
+    ~Locks() {
+        for (size_t i = 0; i < nr_locks; ++i)
+            omp_destroy_lock(&locks[i]);
+    }
+
+    omp_lock_t locks[nr_locks];
+#endif
+
+    /** \brief Lock a group if other threads may access it.
+     * \return true if the group has to be unlocked
+     */
+    inline bool lock(size_t group) {
+#ifdef _OPENMP
+        if (omp_in_parallel()) {
+            omp_set_lock(&locks[group % nr_locks]);
+            return (true);
+        }
+#else
+        (void)group;
+#endif
+        return (false);
+    }
+
+    /** \brief Unlock a group locked by \a lock. */
+    inline void unlock(size_t group) {
+#ifdef _OPENMP
+        omp_unset_lock(&locks[group % nr_locks]);
+#else
+        (void)group;
+#endif
+    }
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+pcl::PairFeatureCache::PairFeatureCache()
+    : keys_(), features_(), group_mask_(0), locks_(NULL) {}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+pcl::PairFeatureCache::PairFeatureCache(const PairFeatureCache &)
+    : keys_(), features_(), group_mask_(0), locks_(NULL) {}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+pcl::PairFeatureCache &
+pcl::PairFeatureCache::operator=(const PairFeatureCache &other) {
+    if (this != &other)
+        reset(0);
+    return (*this);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+pcl::PairFeatureCache::~PairFeatureCache() { delete locks_; }
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+void pcl::PairFeatureCache::reset(size_t max_size) {
+    // The number of groups is the largest power of 2 that fits in max_size
+    size_t nr_groups = 0;
+    if (max_size >= group_size) {
+        nr_groups = 1;
+        while (nr_groups * 2 <= max_size / group_size)
+            nr_groups *= 2;
+    }
+
+    if (nr_groups == 0) {
+        std::vector<uint64_t>().swap(keys_);
+        std::vector<float>().swap(features_);
+        group_mask_ = 0;
+        return;
+    }
+
+    keys_.assign(nr_groups * group_size, empty_key);
+    features_.resize(keys_.size() * 4);
+    group_mask_ = nr_groups - 1;
+    if (!locks_)
+        locks_ = new Locks;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+bool pcl::PairFeatureCache::find(int p_idx, int q_idx,
+                                 Eigen::Vector4f &features) const {
+    if (keys_.empty())
+        return (false);
+
+    const uint64_t key = getKey(p_idx, q_idx);
+    const size_t group =
+        static_cast<size_t>(getHash(key) >> 32) & group_mask_;
+    const bool locked = locks_->lock(group);
+
+    // The slots of a group are filled in order, so the first empty one ends
+    // the search
+    bool found = false;
+    for (size_t i = group * group_size; i < (group + 1) * group_size; ++i) {
+        if (keys_[i] == key) {
+            features = Eigen::Vector4f::Map(&features_[4 * i]);
+            found = true;
+            break;
+        }
+        if (keys_[i] == empty_key)
+            break;
+    }
+
+    if (locked)
+        locks_->unlock(group);
+    return (found);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+void pcl::PairFeatureCache::insert(int p_idx, int q_idx,
+                                   const Eigen::Vector4f &features) {
+    if (keys_.empty())
+        return;
+
+    const uint64_t key = getKey(p_idx, q_idx);
+    const uint64_t hash = getHash(key);
+    const size_t group = static_cast<size_t>(hash >> 32) & group_mask_;
+    const bool locked = locks_->lock(group);
+
+    // Use the slot of the pair or the first empty one, and overwrite a slot
+    // picked by other bits of the hash when the group is full
+    size_t slot =
+        group * group_size + static_cast<size_t>(hash >> 29) % group_size;
+    for (size_t i = group * group_size; i < (group + 1) * group_size; ++i) {
+        if (keys_[i] == key || keys_[i] == empty_key) {
+            slot = i;
+            break;
+        }
+    }
+    keys_[slot] = key;
+    Eigen::Vector4f::Map(&features_[4 * slot]) = features;
+
+    if (locked)
+        locks_->unlock(group);
+}
+
 // Instantiations of specific point types
 #ifdef PCL_ONLY_CORE_POINT_TYPES
 PCL_INSTANTIATE_PRODUCT(
@@ -63,6 +63,12 @@ template <typename PointT> class PointDataAtOffset {
      */
     int compare(const PointT &p, const double &val);
 
+    /** \brief Get the type of data. */
+    inline uint8_t getDatatype() const { return (datatype_); }
+
+    /** \brief Get the data offset. */
+    inline uint32_t getOffset() const { return (offset_); }
+
   protected:
     /** \brief The type of data. */
     uint8_t datatype_;
@@ -93,6 +99,16 @@ template <typename PointT> class ComparisonBase {
     /** \brief Evaluate function. */
     virtual bool evaluate(const PointT &point) const = 0;
 
+    /** \brief Evaluate the comparison on several points at once. The default
+     * implementation calls evaluate () for each point.
+     * \param[in] cloud the point cloud holding the points
+     * \param[in] indices the indices of the points to evaluate
+     * \param[out] result 1 for the points passing the comparison, 0 otherwise
+     */
+    virtual void evaluateBatch(const PointCloud<PointT> &cloud,
+                               const std::vector<int> &indices,
+                               std::vector<uint8_t> &result) const;
+
   protected:
     /** \brief True if capable. */
     bool capable_;
@@ -152,6 +168,16 @@ class FieldComparison : public ComparisonBase<PointT> {
      */
     virtual bool evaluate(const PointT &point) const;
 
+    /** \brief Determine the result of this comparison for several points.
+     * Float fields are compared four points at a time.
+     * \param[in] cloud the point cloud holding the points
+     * \param[in] indices the indices of the points to evaluate
+     * \param[out] result 1 for the points passing the comparison, 0 otherwise
+     */
+    virtual void evaluateBatch(const PointCloud<PointT> &cloud,
+                               const std::vector<int> &indices,
+                               std::vector<uint8_t> &result) const;
+
   protected:
     /** \brief All types (that we care about) can be represented as a double. */
     double compare_val_;
@@ -435,6 +461,16 @@ template <typename PointT> class ConditionBase {
      */
     virtual bool evaluate(const PointT &point) const = 0;
 
+    /** \brief Determine which points of a set meet this condition. The
+     * default implementation calls evaluate () for each point.
+     * \param[in] cloud the point cloud holding the points
+     * \param[in] indices the indices of the points to evaluate
+     * \param[out] result 1 for the points meeting the condition, 0 otherwise
+     */
+    virtual void evaluateBatch(const PointCloud<PointT> &cloud,
+                               const std::vector<int> &indices,
+                               std::vector<uint8_t> &result) const;
+
   protected:
     /** \brief True if capable. */
     bool capable_;
@@ -466,6 +502,15 @@ template <typename PointT> class ConditionAnd : public ConditionBase<PointT> {
      * comparisons and nested conditions evaluate to true
      */
     virtual bool evaluate(const PointT &point) const;
+    /** \brief Determine which points of a set meet this condition, one
+     * comparison or nested condition at a time.
+     * \param[in] cloud the point cloud holding the points
+     * \param[in] indices the indices of the points to evaluate
+     * \param[out] result 1 for the points meeting the condition, 0 otherwise
+     */
+    virtual void evaluateBatch(const PointCloud<PointT> &cloud,
+                               const std::vector<int> &indices,
+                               std::vector<uint8_t> &result) const;
 };
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -488,6 +533,15 @@ template <typename PointT> class ConditionOr : public ConditionBase<PointT> {
      * comparisons or nested conditions evaluate to true
      */
     virtual bool evaluate(const PointT &point) const;
+    /** \brief Determine which points of a set meet this condition, one
+     * comparison or nested condition at a time.
+     * \param[in] cloud the point cloud holding the points
+     * \param[in] indices the indices of the points to evaluate
+     * \param[out] result 1 for the points meeting the condition, 0 otherwise
+     */
+    virtual void evaluateBatch(const PointCloud<PointT> &cloud,
+                               const std::vector<int> &indices,
+                               std::vector<uint8_t> &result) const;
 };
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -40,6 +40,7 @@
 
 #include <pcl/common/io.h>
 #include <pcl/filters/boost.h>
+#include <pcl/filters/point_block.h>
 #include <vector>
 #include <Eigen/Geometry>
 
@@ -124,6 +125,89 @@ bool pcl::FieldComparison<PointT>::evaluate(const PointT &point) const {
     }
 }
 
+//////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::ComparisonBase<PointT>::evaluateBatch(
+    const PointCloud<PointT> &cloud, const std::vector<int> &indices,
+    std::vector<uint8_t> &result) const {
+    result.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i)
+        result[i] = evaluate(cloud.points[indices[i]]);
+}
+
+//////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::FieldComparison<PointT>::evaluateBatch(
+    const PointCloud<PointT> &cloud, const std::vector<int> &indices,
+    std::vector<uint8_t> &result) const {
+    if (!this->capable_ ||
+        point_data_->getDatatype() != sensor_msgs::PointField::FLOAT32) {
+        ComparisonBase<PointT>::evaluateBatch(cloud, indices, result);
+        return;
+    }
+    result.resize(indices.size());
+
+    const uint32_t offset = point_data_->getOffset();
+    const float val = static_cast<float>(compare_val_);
+#ifdef __SSE__
+    const __m128 val4 = _mm_set1_ps(val);
+#endif
+
+    const int nr_indices = static_cast<int>(indices.size());
+    for (int block = 0; block < nr_indices; block += 4) {
+        const int block_size = std::min(4, nr_indices - block);
+
+        // Get the field's values
+        float pt_val[4];
+        for (int j = 0; j < block_size; ++j)
+            memcpy(&pt_val[j],
+                   reinterpret_cast<const uint8_t *>(
+                       &cloud.points[indices[block + j]]) +
+                       offset,
+                   sizeof(float));
+
+        // Masks of the values greater and smaller than the compared value
+        int greater = 0, less = 0;
+#ifdef __SSE__
+        if (block_size == 4) {
+            __m128 v = _mm_loadu_ps(pt_val);
+            greater = _mm_movemask_ps(_mm_cmpgt_ps(v, val4));
+            less = _mm_movemask_ps(_mm_cmplt_ps(v, val4));
+        } else
+#endif
+            for (int j = 0; j < block_size; ++j) {
+                greater |= (pt_val[j] > val) << j;
+                less |= (pt_val[j] < val) << j;
+            }
+
+        int passed;
+        switch (this->op_) {
+        case pcl::ComparisonOps::GT:
+            passed = greater;
+            break;
+        case pcl::ComparisonOps::GE:
+            passed = ~less;
+            break;
+        case pcl::ComparisonOps::LT:
+            passed = less;
+            break;
+        case pcl::ComparisonOps::LE:
+            passed = ~greater;
+            break;
+        case pcl::ComparisonOps::EQ:
+            passed = ~(greater | less);
+            break;
+        default:
+            PCL_WARN("[pcl::FieldComparison::evaluateBatch] unrecognized "
+                     "op_!\n");
+            passed = 0;
+        }
+
+        for (int j = 0; j < block_size; ++j)
+            result[block + j] = (passed >> j) & 1;
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
@@ -588,6 +672,16 @@ void pcl::ConditionBase<PointT>::addCondition(Ptr condition) {
     conditions_.push_back(condition);
 }
 
+//////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::ConditionBase<PointT>::evaluateBatch(
+    const PointCloud<PointT> &cloud, const std::vector<int> &indices,
+    std::vector<uint8_t> &result) const {
+    result.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i)
+        result[i] = evaluate(cloud.points[indices[i]]);
+}
+
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
@@ -604,6 +698,26 @@ bool pcl::ConditionAnd<PointT>::evaluate(const PointT &point) const {
     return (true);
 }
 
+//////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::ConditionAnd<PointT>::evaluateBatch(
+    const PointCloud<PointT> &cloud, const std::vector<int> &indices,
+    std::vector<uint8_t> &result) const {
+    result.assign(indices.size(), 1);
+    std::vector<uint8_t> partial;
+    for (size_t i = 0; i < comparisons_.size(); ++i) {
+        comparisons_[i]->evaluateBatch(cloud, indices, partial);
+        for (size_t j = 0; j < result.size(); ++j)
+            result[j] &= partial[j];
+    }
+
+    for (size_t i = 0; i < conditions_.size(); ++i) {
+        conditions_[i]->evaluateBatch(cloud, indices, partial);
+        for (size_t j = 0; j < result.size(); ++j)
+            result[j] &= partial[j];
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
@@ -622,6 +736,30 @@ bool pcl::ConditionOr<PointT>::evaluate(const PointT &point) const {
     return (false);
 }
 
+//////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::ConditionOr<PointT>::evaluateBatch(
+    const PointCloud<PointT> &cloud, const std::vector<int> &indices,
+    std::vector<uint8_t> &result) const {
+    if (comparisons_.empty() && conditions_.empty()) {
+        result.assign(indices.size(), 1);
+        return;
+    }
+    result.assign(indices.size(), 0);
+    std::vector<uint8_t> partial;
+    for (size_t i = 0; i < comparisons_.size(); ++i) {
+        comparisons_[i]->evaluateBatch(cloud, indices, partial);
+        for (size_t j = 0; j < result.size(); ++j)
+            result[j] |= partial[j];
+    }
+
+    for (size_t i = 0; i < conditions_.size(); ++i) {
+        conditions_[i]->evaluateBatch(cloud, indices, partial);
+        for (size_t j = 0; j < result.size(); ++j)
+            result[j] |= partial[j];
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
@@ -670,33 +808,38 @@ void pcl::ConditionalRemoval<PointT>::applyFilter(PointCloud &output) {
     int nr_removed_p = 0;
 
     if (!keep_organized_) {
-        for (size_t cp = 0; cp < Filter<PointT>::indices_->size(); ++cp) {
-            // Check if the point is invalid
-            if (!pcl_isfinite(
-                    input_->points[(*Filter<PointT>::indices_)[cp]].x) ||
-                !pcl_isfinite(
-                    input_->points[(*Filter<PointT>::indices_)[cp]].y) ||
-                !pcl_isfinite(
-                    input_->points[(*Filter<PointT>::indices_)[cp]].z)) {
-                if (extract_removed_indices_) {
-                    (*removed_indices_)[nr_removed_p] =
-                        (*Filter<PointT>::indices_)[cp];
-                    nr_removed_p++;
-                }
-                continue;
+        const std::vector<int> &indices = *Filter<PointT>::indices_;
+
+        // Evaluate the condition on blocks of finite points at once
+        const size_t block_size = 256;
+        std::vector<uint8_t> valid(block_size);
+        std::vector<int> valid_indices;
+        valid_indices.reserve(block_size);
+        std::vector<uint8_t> passed;
+        for (size_t block = 0; block < indices.size(); block += block_size) {
+            const size_t block_end =
+                std::min(indices.size(), block + block_size);
+
+            valid_indices.clear();
+            for (size_t cp = block; cp < block_end; ++cp) {
+                // Check if the point is invalid
+                const PointT &pt = input_->points[indices[cp]];
+                valid[cp - block] = pcl_isfinite(pt.x) &&
+                                    pcl_isfinite(pt.y) && pcl_isfinite(pt.z);
+                if (valid[cp - block])
+                    valid_indices.push_back(indices[cp]);
             }
-
-            if (condition_->evaluate(
-                    input_->points[(*Filter<PointT>::indices_)[cp]])) {
-                pcl::for_each_type<FieldList>(
-                    pcl::NdConcatenateFunctor<PointT, PointT>(
-                        input_->points[(*Filter<PointT>::indices_)[cp]],
-                        output.points[nr_p]));
-                nr_p++;
-            } else {
-                if (extract_removed_indices_) {
-                    (*removed_indices_)[nr_removed_p] =
-                        (*Filter<PointT>::indices_)[cp];
+            condition_->evaluateBatch(*input_, valid_indices, passed);
+
+            size_t vi = 0; // vi = valid indices iterator
+            for (size_t cp = block; cp < block_end; ++cp) {
+                if (valid[cp - block] && passed[vi++]) {
+                    pcl::for_each_type<FieldList>(
+                        pcl::NdConcatenateFunctor<PointT, PointT>(
+                            input_->points[indices[cp]], output.points[nr_p]));
+                    nr_p++;
+                } else if (extract_removed_indices_) {
+                    (*removed_indices_)[nr_removed_p] = indices[cp];
                     nr_removed_p++;
                 }
             }
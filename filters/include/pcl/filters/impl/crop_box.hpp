@@ -41,140 +41,140 @@
 #define PCL_FILTERS_IMPL_CROP_BOX_H_
 
 #include <pcl/filters/crop_box.h>
+#include <pcl/filters/point_block.h>
 
 ///////////////////////////////////////////////////////////////////////////////
 template <typename PointT>
 void pcl::CropBox<PointT>::applyFilter(PointCloud &output) {
-    output.resize(input_->points.size());
-    removed_indices_->resize(input_->points.size());
-    int indices_count = 0;
-    int removed_indices_count = 0;
+    std::vector<int> indices;
+    applyFilter(indices);
 
+    output.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i)
+        output.points[i] = input_->points[indices[i]];
+    output.width = static_cast<uint32_t>(indices.size());
+    output.height = 1;
     // We filter out invalid points
     output.is_dense = true;
-
-    Eigen::Affine3f transform = Eigen::Affine3f::Identity();
-    Eigen::Affine3f inverse_transform = Eigen::Affine3f::Identity();
-
-    if (rotation_ != Eigen::Vector3f::Zero()) {
-        pcl::getTransformation(0, 0, 0, rotation_(0), rotation_(1),
-                               rotation_(2), transform);
-        inverse_transform = transform.inverse();
-    }
-
-    for (size_t index = 0; index < indices_->size(); ++index) {
-        if (!input_->is_dense)
-            // Check if the point is invalid
-            if (!isFinite(input_->points[index]))
-                continue;
-
-        // Get local point
-        PointT local_pt = input_->points[(*indices_)[index]];
-
-        // Transform point to world space
-        if (!(transform_.matrix().isIdentity()))
-            local_pt = pcl::transformPoint<PointT>(local_pt, transform_);
-
-        if (translation_ != Eigen::Vector3f::Zero()) {
-            local_pt.x -= translation_(0);
-            local_pt.y -= translation_(1);
-            local_pt.z -= translation_(2);
-        }
-
-        // Transform point to local space of crop box
-        if (!(inverse_transform.matrix().isIdentity()))
-            local_pt = pcl::transformPoint<PointT>(local_pt, inverse_transform);
-
-        // If outside the cropbox
-        if ((local_pt.x < min_pt_[0] || local_pt.y < min_pt_[1] ||
-             local_pt.z < min_pt_[2]) ||
-            (local_pt.x > max_pt_[0] || local_pt.y > max_pt_[1] ||
-             local_pt.z > max_pt_[2])) {
-            if (negative_) {
-                output.points[indices_count++] =
-                    input_->points[(*indices_)[index]];
-            } else if (extract_removed_indices_) {
-                (*removed_indices_)[removed_indices_count++] =
-                    static_cast<int>(index);
-            }
-        }
-        // If inside the cropbox
-        else {
-            if (negative_ && extract_removed_indices_) {
-                (*removed_indices_)[removed_indices_count++] =
-                    static_cast<int>(index);
-            } else if (!negative_) {
-                output.points[indices_count++] =
-                    input_->points[(*indices_)[index]];
-            }
-        }
-    }
-    output.width = indices_count;
-    output.height = 1;
-    output.resize(output.width * output.height);
-    removed_indices_->resize(removed_indices_count);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 template <typename PointT>
 void pcl::CropBox<PointT>::applyFilter(std::vector<int> &indices) {
-    indices.resize(input_->points.size());
-    removed_indices_->resize(input_->points.size());
+    indices.resize(indices_->size());
+    removed_indices_->resize(indices_->size());
     int indices_count = 0;
     int removed_indices_count = 0;
 
-    Eigen::Affine3f transform = Eigen::Affine3f::Identity();
     Eigen::Affine3f inverse_transform = Eigen::Affine3f::Identity();
-
     if (rotation_ != Eigen::Vector3f::Zero()) {
+        Eigen::Affine3f transform;
         pcl::getTransformation(0, 0, 0, rotation_(0), rotation_(1),
                                rotation_(2), transform);
         inverse_transform = transform.inverse();
     }
 
-    for (size_t index = 0; index < indices_->size(); ++index) {
-        if (!input_->is_dense)
-            // Check if the point is invalid
-            if (!isFinite(input_->points[index]))
-                continue;
-
-        // Get local point
-        PointT local_pt = input_->points[(*indices_)[index]];
+    // Transform to world space, subtract the translation of the box and
+    // transform to the local space of the box, all at once
+    const Eigen::Matrix4f box_transform =
+        (inverse_transform * Eigen::Translation3f(-translation_) * transform_)
+            .matrix();
+    const bool transform_points = box_transform != Eigen::Matrix4f::Identity();
+
+#ifdef __SSE__
+    __m128 m[12];
+    for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 4; ++c)
+            m[r * 4 + c] = _mm_set1_ps(box_transform(r, c));
+    const __m128 min_x = _mm_set1_ps(min_pt_[0]);
+    const __m128 min_y = _mm_set1_ps(min_pt_[1]);
+    const __m128 min_z = _mm_set1_ps(min_pt_[2]);
+    const __m128 max_x = _mm_set1_ps(max_pt_[0]);
+    const __m128 max_y = _mm_set1_ps(max_pt_[1]);
+    const __m128 max_z = _mm_set1_ps(max_pt_[2]);
+#endif
+
+    // Classify the points four at a time, see detail::HasPackedXYZ
+    const int nr_indices = static_cast<int>(indices_->size());
+    for (int block = 0; block < nr_indices; block += 4) {
+        const int block_size = std::min(4, nr_indices - block);
+        const int *idx = &(*indices_)[block];
+
+        // Masks of the valid points and of the points outside of the box
+        int valid = (1 << block_size) - 1;
+        int outside = 0;
+#ifdef __SSE__
+        if (detail::HasPackedXYZ<PointT>::value && block_size == 4) {
+            __m128 x, y, z;
+            detail::loadXYZ(input_->points[idx[0]], input_->points[idx[1]],
+                            input_->points[idx[2]], input_->points[idx[3]],
+                            x, y, z);
+            if (!input_->is_dense)
+                valid = detail::finiteMask(x, y, z);
+
+            if (transform_points) {
+                __m128 lx = _mm_add_ps(
+                    _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0], x),
+                                          _mm_mul_ps(m[1], y)),
+                               _mm_mul_ps(m[2], z)),
+                    m[3]);
+                __m128 ly = _mm_add_ps(
+                    _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[4], x),
+                                          _mm_mul_ps(m[5], y)),
+                               _mm_mul_ps(m[6], z)),
+                    m[7]);
+                z = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m[8], x),
+                                                     _mm_mul_ps(m[9], y)),
+                                          _mm_mul_ps(m[10], z)),
+                               m[11]);
+                x = lx;
+                y = ly;
+            }
 
-        // Transform point to world space
-        if (!(transform_.matrix().isIdentity()))
-            local_pt = pcl::transformPoint<PointT>(local_pt, transform_);
+            outside = _mm_movemask_ps(
+                _mm_or_ps(_mm_or_ps(detail::isOutside(x, min_x, max_x),
+                                    detail::isOutside(y, min_y, max_y)),
+                          detail::isOutside(z, min_z, max_z)));
+        } else
+#endif
+            for (int j = 0; j < block_size; ++j) {
+                const PointT &pt = input_->points[idx[j]];
+                // Check if the point is invalid
+                if (!input_->is_dense && !isFinite(pt)) {
+                    valid &= ~(1 << j);
+                    continue;
+                }
+
+                // Get local point
+                float x = pt.x, y = pt.y, z = pt.z;
+                if (transform_points) {
+                    float lx = box_transform(0, 0) * x +
+                               box_transform(0, 1) * y +
+                               box_transform(0, 2) * z + box_transform(0, 3);
+                    float ly = box_transform(1, 0) * x +
+                               box_transform(1, 1) * y +
+                               box_transform(1, 2) * z + box_transform(1, 3);
+                    z = box_transform(2, 0) * x + box_transform(2, 1) * y +
+                        box_transform(2, 2) * z + box_transform(2, 3);
+                    x = lx;
+                    y = ly;
+                }
+
+                if (x < min_pt_[0] || y < min_pt_[1] || z < min_pt_[2] ||
+                    x > max_pt_[0] || y > max_pt_[1] || z > max_pt_[2])
+                    outside |= 1 << j;
+            }
 
-        if (translation_ != Eigen::Vector3f::Zero()) {
-            local_pt.x -= translation_(0);
-            local_pt.y -= translation_(1);
-            local_pt.z -= translation_(2);
-        }
+        for (int j = 0; j < block_size; ++j) {
+            if (!(valid & (1 << j)))
+                continue;
 
-        // Transform point to local space of crop box
-        if (!(inverse_transform.matrix().isIdentity()))
-            local_pt = pcl::transformPoint<PointT>(local_pt, inverse_transform);
-
-        // If outside the cropbox
-        if ((local_pt.x < min_pt_[0] || local_pt.y < min_pt_[1] ||
-             local_pt.z < min_pt_[2]) ||
-            (local_pt.x > max_pt_[0] || local_pt.y > max_pt_[1] ||
-             local_pt.z > max_pt_[2])) {
-            if (negative_) {
-                indices[indices_count++] = (*indices_)[index];
-            } else if (extract_removed_indices_) {
-                (*removed_indices_)[removed_indices_count++] =
-                    static_cast<int>(index);
-            }
-        }
-        // If inside the cropbox
-        else {
-            if (negative_ && extract_removed_indices_) {
-                (*removed_indices_)[removed_indices_count++] =
-                    static_cast<int>(index);
-            } else if (!negative_) {
-                indices[indices_count++] = (*indices_)[index];
-            }
+            // The points outside of the cropbox are kept if negative_ is set,
+            // the ones inside of it otherwise
+            if (((outside & (1 << j)) != 0) == negative_)
+                indices[indices_count++] = idx[j];
+            else if (extract_removed_indices_)
+                (*removed_indices_)[removed_indices_count++] = idx[j];
         }
     }
     indices.resize(indices_count);
@@ -42,6 +42,7 @@
 
 #include <pcl/filters/passthrough.h>
 #include <pcl/common/io.h>
+#include <pcl/filters/point_block.h>
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointT>
@@ -79,22 +80,8 @@ void pcl::PassThrough<PointT>::applyFilterIndices(std::vector<int> &indices) {
             0; // oii = output indices iterator, rii = removed indices iterator
 
     // Has a field name been specified?
-    if (filter_field_name_.empty()) {
-        // Only filter for non-finite entries then
-        for (int iii = 0; iii < static_cast<int>(indices_->size());
-             ++iii) // iii = input indices iterator
-        {
-            // Non-finite entries are always passed to removed indices
-            if (!pcl_isfinite(input_->points[(*indices_)[iii]].x) ||
-                !pcl_isfinite(input_->points[(*indices_)[iii]].y) ||
-                !pcl_isfinite(input_->points[(*indices_)[iii]].z)) {
-                if (extract_removed_indices_)
-                    (*removed_indices_)[rii++] = (*indices_)[iii];
-                continue;
-            }
-            indices[oii++] = (*indices_)[iii];
-        }
-    } else {
+    int field_offset = -1;
+    if (!filter_field_name_.empty()) {
         // Attempt to get the field name's index
         std::vector<sensor_msgs::PointField> fields;
         int distance_idx =
@@ -107,54 +94,88 @@ void pcl::PassThrough<PointT>::applyFilterIndices(std::vector<int> &indices) {
             removed_indices_->clear();
             return;
         }
+        field_offset = fields[distance_idx].offset;
+    }
 
-        // Filter for non-finite entries and the specified field limits
-        for (int iii = 0; iii < static_cast<int>(indices_->size());
-             ++iii) // iii = input indices iterator
-        {
-            // Non-finite entries are always passed to removed indices
-            if (!pcl_isfinite(input_->points[(*indices_)[iii]].x) ||
-                !pcl_isfinite(input_->points[(*indices_)[iii]].y) ||
-                !pcl_isfinite(input_->points[(*indices_)[iii]].z)) {
-                if (extract_removed_indices_)
-                    (*removed_indices_)[rii++] = (*indices_)[iii];
-                continue;
-            }
+#ifdef __SSE__
+    const __m128 min = _mm_set1_ps(filter_limit_min_);
+    const __m128 max = _mm_set1_ps(filter_limit_max_);
+#endif
 
-            // Get the field's value
-            const uint8_t *pt_data = reinterpret_cast<const uint8_t *>(
-                &input_->points[(*indices_)[iii]]);
-            float field_value = 0;
-            memcpy(&field_value, pt_data + fields[distance_idx].offset,
-                   sizeof(float));
-
-            // Remove NAN/INF/-INF values. We expect passthrough to output clean
-            // valid data.
-            if (!pcl_isfinite(field_value)) {
-                if (extract_removed_indices_)
-                    (*removed_indices_)[rii++] = (*indices_)[iii];
-                continue;
-            }
+    // Classify the points four at a time, see detail::HasPackedXYZ. A point is
+    // removed when:
+    //  - one of its coordinates is not finite (NAN/INF/-INF): we expect
+    //    passthrough to output clean valid data;
+    //  - a field is given and its value is not finite, either;
+    //  - a field is given and its value is outside of the field limits or,
+    //    when negative_ is set, strictly inside of them.
+    const int nr_indices = static_cast<int>(indices_->size());
+    for (int block = 0; block < nr_indices; block += 4) {
+        const int block_size = std::min(4, nr_indices - block);
+        const int *idx = &(*indices_)[block];
 
-            // Outside of the field limits are passed to removed indices
-            if (!negative_ && (field_value < filter_limit_min_ ||
-                               field_value > filter_limit_max_)) {
-                if (extract_removed_indices_)
-                    (*removed_indices_)[rii++] = (*indices_)[iii];
-                continue;
+        // Mask of the points to keep
+        int keep = 0;
+#ifdef __SSE__
+        if (detail::HasPackedXYZ<PointT>::value && block_size == 4) {
+            __m128 x, y, z;
+            detail::loadXYZ(input_->points[idx[0]], input_->points[idx[1]],
+                            input_->points[idx[2]], input_->points[idx[3]],
+                            x, y, z);
+            keep = detail::finiteMask(x, y, z);
+            if (field_offset >= 0 && keep != 0) {
+                // Get the field's values
+                float v[4];
+                for (int j = 0; j < 4; ++j)
+                    memcpy(&v[j],
+                           reinterpret_cast<const uint8_t *>(
+                               &input_->points[idx[j]]) +
+                               field_offset,
+                           sizeof(float));
+                __m128 value = _mm_loadu_ps(v);
+
+                __m128 removed;
+                if (negative_)
+                    removed = _mm_and_ps(_mm_cmpgt_ps(value, min),
+                                         _mm_cmplt_ps(value, max));
+                else
+                    removed = detail::isOutside(value, min, max);
+                keep &= _mm_movemask_ps(
+                    _mm_andnot_ps(removed, detail::isFinite(value)));
             }
+        } else
+#endif
+            for (int j = 0; j < block_size; ++j) {
+                const PointT &pt = input_->points[idx[j]];
+                if (!pcl_isfinite(pt.x) || !pcl_isfinite(pt.y) ||
+                    !pcl_isfinite(pt.z))
+                    continue;
+
+                if (field_offset >= 0) {
+                    // Get the field's value
+                    float field_value = 0;
+                    memcpy(&field_value,
+                           reinterpret_cast<const uint8_t *>(&pt) +
+                               field_offset,
+                           sizeof(float));
 
-            // Inside of the field limits are passed to removed indices if
-            // negative was set
-            if (negative_ && field_value > filter_limit_min_ &&
-                field_value < filter_limit_max_) {
-                if (extract_removed_indices_)
-                    (*removed_indices_)[rii++] = (*indices_)[iii];
-                continue;
+                    if (!pcl_isfinite(field_value))
+                        continue;
+                    if (!negative_ && (field_value < filter_limit_min_ ||
+                                       field_value > filter_limit_max_))
+                        continue;
+                    if (negative_ && field_value > filter_limit_min_ &&
+                        field_value < filter_limit_max_)
+                        continue;
+                }
+                keep |= 1 << j;
             }
 
-            // Otherwise it was a normal point for output (inlier)
-            indices[oii++] = (*indices_)[iii];
+        for (int j = 0; j < block_size; ++j) {
+            if (keep & (1 << j))
+                indices[oii++] = idx[j];
+            else if (extract_removed_indices_)
+                (*removed_indices_)[rii++] = idx[j];
         }
     }
 
@@ -90,21 +90,33 @@ void pcl::RadiusOutlierRemoval<PointT>::applyFilterIndices(
     searcher_->setInputCloud(input_);
 
     // The arrays to be used
-    std::vector<int> nn_indices(indices_->size());
-    std::vector<float> nn_dists(indices_->size());
+    std::vector<int> nn_indices;
+    std::vector<float> nn_dists;
+    std::vector<int> nn_counts(indices_->size());
     indices.resize(indices_->size());
     removed_indices_->resize(indices_->size());
     int oii = 0,
         rii =
             0; // oii = output indices iterator, rii = removed indices iterator
 
+    // First pass: count the neighbors of every point. The searches are
+    // independent, each thread using its own neighbor buffers
+#pragma omp parallel for shared(nn_counts) private(nn_indices, nn_dists)      \
+    num_threads(threads_)
     for (int iii = 0; iii < static_cast<int>(indices_->size());
          ++iii) // iii = input indices iterator
     {
         // Perform the radius search
         // Note: k includes the query point, so is always at least 1
-        int k = searcher_->radiusSearch((*indices_)[iii], search_radius_,
-                                        nn_indices, nn_dists);
+        nn_counts[iii] = searcher_->radiusSearch(
+            (*indices_)[iii], search_radius_, nn_indices, nn_dists);
+    }
+
+    // Second pass: classify the points in input order
+    for (int iii = 0; iii < static_cast<int>(indices_->size());
+         ++iii) // iii = input indices iterator
+    {
+        int k = nn_counts[iii];
 
         // Points having too few neighbors are outliers and are passed to
         // removed indices Unless negative was set, then it's the opposite
@@ -92,8 +92,12 @@ void pcl::StatisticalOutlierRemoval<PointT>::applyFilterIndices(
             0; // oii = output indices iterator, rii = removed indices iterator
 
     // First pass: Compute the mean distances for all points with respect to
-    // their k nearest neighbors
+    // their k nearest neighbors. Each thread works on its own copy of the
+    // neighbor buffers and only writes its own entries of distances, so the
+    // result does not depend on the number of threads
     int valid_distances = 0;
+#pragma omp parallel for shared(distances) firstprivate(nn_indices, nn_dists) \
+    reduction(+ : valid_distances) num_threads(threads_)
     for (int iii = 0; iii < static_cast<int>(indices_->size());
          ++iii) // iii = input indices iterator
     {
@@ -123,6 +127,7 @@ void pcl::StatisticalOutlierRemoval<PointT>::applyFilterIndices(
     }
 
     // Estimate the mean and the standard deviation of the distance vector
+    // (serially, to keep the summation order and thus the threshold fixed)
     double sum = 0, sq_sum = 0;
     for (size_t i = 0; i < distances.size(); ++i) {
         sum += distances[i];
@@ -121,17 +121,6 @@ void pcl::getMinMax3D(const typename pcl::PointCloud<PointT>::ConstPtr &cloud,
     max_pt = max_p;
 }
 
-struct cloud_point_index_idx {
-    unsigned int idx;
-    unsigned int cloud_point_index;
-
-    cloud_point_index_idx(unsigned int idx_, unsigned int cloud_point_index_)
-        : idx(idx_), cloud_point_index(cloud_point_index_) {}
-    bool operator<(const cloud_point_index_idx &p) const {
-        return (idx < p.idx);
-    }
-};
-
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointT>
 void pcl::VoxelGrid<PointT>::applyFilter(PointCloud &output) {
@@ -175,6 +164,22 @@ void pcl::VoxelGrid<PointT>::applyFilter(PointCloud &output) {
     // Set up the division multiplier
     divb_mul_ = Eigen::Vector4i(1, div_b_[0], div_b_[0] * div_b_[1], 0);
 
+    // Voxel indices are 64-bit, the division multipliers above only serve
+    // the (32-bit) leaf layout
+    uint64_t nr_voxels;
+    if (!detail::getNumberOfVoxels(div_b_, nr_voxels)) {
+        PCL_WARN("[pcl::%s::applyFilter] Leaf size is too small for the input "
+                 "dataset. Integer indices would overflow.\n",
+                 getClassName().c_str());
+        output = *input_;
+        return;
+    }
+    const uint64_t mul_y = static_cast<uint64_t>(div_b_[0]);
+    const uint64_t mul_z = mul_y * static_cast<uint64_t>(div_b_[1]);
+    // Discarded points get an index past the last voxel, so that sorting
+    // moves them to the end
+    const uint64_t invalid_idx = nr_voxels;
+
     int centroid_size = 4;
     if (downsample_all_data_)
         centroid_size = boost::mpl::size<FieldList>::value;
@@ -190,11 +195,9 @@ void pcl::VoxelGrid<PointT>::applyFilter(PointCloud &output) {
         centroid_size += 3;
     }
 
-    std::vector<cloud_point_index_idx> index_vector;
-    index_vector.reserve(input_->points.size());
-
     // If we don't want to process the entire cloud, but rather filter points
     // far away from the viewpoint first...
+    int distance_offset = -1;
     if (!filter_field_name_.empty()) {
         // Get the distance field index
         std::vector<sensor_msgs::PointField> fields;
@@ -204,24 +207,32 @@ void pcl::VoxelGrid<PointT>::applyFilter(PointCloud &output) {
             PCL_WARN("[pcl::%s::applyFilter] Invalid filter field name. Index "
                      "is %d.\n",
                      getClassName().c_str(), distance_idx);
+        else
+            distance_offset = fields[distance_idx].offset;
+    }
 
-        // First pass: go over all points and insert them into the index_vector
-        // vector with calculated idx. Points with the same idx value will
-        // contribute to the same point of resulting CloudPoint
-        for (unsigned int cp = 0;
-             cp < static_cast<unsigned int>(input_->points.size()); ++cp) {
-            if (!input_->is_dense)
-                // Check if the point is invalid
-                if (!pcl_isfinite(input_->points[cp].x) ||
-                    !pcl_isfinite(input_->points[cp].y) ||
-                    !pcl_isfinite(input_->points[cp].z))
-                    continue;
+    // First pass: go over all points and compute the index of the voxel they
+    // fall into. Points with the same idx value will contribute to the same
+    // point of resulting CloudPoint
+    const int nr_points = static_cast<int>(input_->points.size());
+    std::vector<detail::VoxelIndex> index_vector(nr_points);
+#pragma omp parallel for shared(index_vector) num_threads(threads_)
+    for (int cp = 0; cp < nr_points; ++cp) {
+        const PointT &point = input_->points[cp];
+        index_vector[cp] =
+            detail::VoxelIndex(invalid_idx, static_cast<unsigned int>(cp));
+
+        if (!input_->is_dense)
+            // Check if the point is invalid
+            if (!pcl_isfinite(point.x) || !pcl_isfinite(point.y) ||
+                !pcl_isfinite(point.z))
+                continue;
 
+        if (distance_offset >= 0) {
             // Get the distance value
-            const uint8_t *pt_data =
-                reinterpret_cast<const uint8_t *>(&input_->points[cp]);
             float distance_value = 0;
-            memcpy(&distance_value, pt_data + fields[distance_idx].offset,
+            memcpy(&distance_value,
+                   reinterpret_cast<const uint8_t *>(&point) + distance_offset,
                    sizeof(float));
 
             if (filter_limit_negative_) {
@@ -237,91 +248,46 @@ void pcl::VoxelGrid<PointT>::applyFilter(PointCloud &output) {
                     (distance_value < filter_limit_min_))
                     continue;
             }
-
-            int ijk0 = static_cast<int>(
-                floor(input_->points[cp].x * inverse_leaf_size_[0]) -
-                min_b_[0]);
-            int ijk1 = static_cast<int>(
-                floor(input_->points[cp].y * inverse_leaf_size_[1]) -
-                min_b_[1]);
-            int ijk2 = static_cast<int>(
-                floor(input_->points[cp].z * inverse_leaf_size_[2]) -
-                min_b_[2]);
-
-            // Compute the centroid leaf index
-            int idx =
-                ijk0 * divb_mul_[0] + ijk1 * divb_mul_[1] + ijk2 * divb_mul_[2];
-            index_vector.push_back(
-                cloud_point_index_idx(static_cast<unsigned int>(idx), cp));
         }
-    }
-    // No distance filtering, process all data
-    else {
-        // First pass: go over all points and insert them into the index_vector
-        // vector with calculated idx. Points with the same idx value will
-        // contribute to the same point of resulting CloudPoint
-        for (unsigned int cp = 0;
-             cp < static_cast<unsigned int>(input_->points.size()); ++cp) {
-            if (!input_->is_dense)
-                // Check if the point is invalid
-                if (!pcl_isfinite(input_->points[cp].x) ||
-                    !pcl_isfinite(input_->points[cp].y) ||
-                    !pcl_isfinite(input_->points[cp].z))
-                    continue;
 
-            int ijk0 = static_cast<int>(
-                floor(input_->points[cp].x * inverse_leaf_size_[0]) -
-                min_b_[0]);
-            int ijk1 = static_cast<int>(
-                floor(input_->points[cp].y * inverse_leaf_size_[1]) -
-                min_b_[1]);
-            int ijk2 = static_cast<int>(
-                floor(input_->points[cp].z * inverse_leaf_size_[2]) -
-                min_b_[2]);
-
-            // Compute the centroid leaf index
-            int idx =
-                ijk0 * divb_mul_[0] + ijk1 * divb_mul_[1] + ijk2 * divb_mul_[2];
-            index_vector.push_back(
-                cloud_point_index_idx(static_cast<unsigned int>(idx), cp));
-        }
+        int ijk0 = static_cast<int>(floor(point.x * inverse_leaf_size_[0]) -
+                                    min_b_[0]);
+        int ijk1 = static_cast<int>(floor(point.y * inverse_leaf_size_[1]) -
+                                    min_b_[1]);
+        int ijk2 = static_cast<int>(floor(point.z * inverse_leaf_size_[2]) -
+                                    min_b_[2]);
+
+        // Compute the centroid leaf index
+        index_vector[cp].idx = static_cast<uint64_t>(ijk0) +
+                               static_cast<uint64_t>(ijk1) * mul_y +
+                               static_cast<uint64_t>(ijk2) * mul_z;
     }
 
     // Second pass: sort the index_vector vector using value representing target
     // cell as index in effect all points belonging to the same output cell will
-    // be next to each other
-    std::sort(index_vector.begin(), index_vector.end(),
-              std::less<cloud_point_index_idx>());
-
-    // Third pass: count output cells
-    // we need to skip all the same, adjacenent idx values
-    unsigned int total = 0;
-    unsigned int index = 0;
-    while (index < index_vector.size()) {
-        unsigned int i = index + 1;
-        while (i < index_vector.size() &&
-               index_vector[i].idx == index_vector[index].idx)
-            ++i;
-        ++total;
-        index = i;
-    }
+    // be next to each other. The sort is stable, and drops the discarded
+    // points at the end
+    detail::sortVoxelIndices(index_vector, invalid_idx, threads_);
+    while (!index_vector.empty() && index_vector.back().idx == invalid_idx)
+        index_vector.pop_back();
+
+    // Third pass: find where each output cell starts
+    std::vector<unsigned int> first;
+    detail::findVoxelBoundaries(index_vector, first);
+    const int total = static_cast<int>(first.size()) - 1;
 
     // Fourth pass: compute centroids, insert them into their final position
     output.points.resize(total);
     if (save_leaf_layout_) {
+        // leaf_layout_ is addressed with (32-bit) division multipliers
+        if (nr_voxels > static_cast<uint64_t>(std::numeric_limits<int>::max()))
+            throw PCLException("VoxelGrid bin size is too low; impossible to "
+                               "allocate memory for layout",
+                               "voxel_grid.hpp", "applyFilter");
         try {
-            // Resizing won't reset old elements to -1.  If leaf_layout_ has
-            // been used previously, it needs to be re-initialized to -1
-            uint32_t new_layout_size = div_b_[0] * div_b_[1] * div_b_[2];
-            // This is the number of elements that need to be re-initialized to
-            // -1
-            uint32_t reinit_size =
-                std::min(static_cast<unsigned int>(new_layout_size),
-                         static_cast<unsigned int>(leaf_layout_.size()));
-            for (uint32_t i = 0; i < reinit_size; i++) {
-                leaf_layout_[i] = -1;
-            }
-            leaf_layout_.resize(new_layout_size, -1);
+            // Resizing won't reset old elements to -1, so reset the whole
+            // layout in case it has been used previously
+            leaf_layout_.assign(static_cast<size_t>(nr_voxels), -1);
         } catch (std::bad_alloc &) {
             throw PCLException("VoxelGrid bin size is too low; impossible to "
                                "allocate memory for layout",
@@ -333,75 +299,71 @@ void pcl::VoxelGrid<PointT>::applyFilter(PointCloud &output) {
         }
     }
 
-    index = 0;
     Eigen::VectorXf centroid = Eigen::VectorXf::Zero(centroid_size);
     Eigen::VectorXf temporary = Eigen::VectorXf::Zero(centroid_size);
 
-    for (unsigned int cp = 0; cp < index_vector.size();) {
+    // Every output cell is averaged independently, from its points in input
+    // order
+#pragma omp parallel for shared(output, index_vector, first)                  \
+    firstprivate(centroid, temporary) num_threads(threads_)
+    for (int index = 0; index < total; ++index) {
+        const unsigned int cp = first[index];
+        const unsigned int last = first[index + 1];
+
         // calculate centroid - sum values from all input points, that have the
         // same idx value in index_vector array
+        const PointT &point =
+            input_->points[index_vector[cp].cloud_point_index];
         if (!downsample_all_data_) {
-            centroid[0] = input_->points[index_vector[cp].cloud_point_index].x;
-            centroid[1] = input_->points[index_vector[cp].cloud_point_index].y;
-            centroid[2] = input_->points[index_vector[cp].cloud_point_index].z;
+            centroid[0] = point.x;
+            centroid[1] = point.y;
+            centroid[2] = point.z;
         } else {
             // ---[ RGB special case
             if (rgba_index >= 0) {
                 // Fill r/g/b data, assuming that the order is BGRA
                 pcl::RGB rgb;
-                memcpy(
-                    &rgb,
-                    reinterpret_cast<const char *>(
-                        &input_->points[index_vector[cp].cloud_point_index]) +
-                        rgba_index,
-                    sizeof(RGB));
+                memcpy(&rgb,
+                       reinterpret_cast<const char *>(&point) + rgba_index,
+                       sizeof(RGB));
                 centroid[centroid_size - 3] = rgb.r;
                 centroid[centroid_size - 2] = rgb.g;
                 centroid[centroid_size - 1] = rgb.b;
             }
-            pcl::for_each_type<FieldList>(NdCopyPointEigenFunctor<PointT>(
-                input_->points[index_vector[cp].cloud_point_index], centroid));
+            pcl::for_each_type<FieldList>(
+                NdCopyPointEigenFunctor<PointT>(point, centroid));
         }
 
-        unsigned int i = cp + 1;
-        while (i < index_vector.size() &&
-               index_vector[i].idx == index_vector[cp].idx) {
+        for (unsigned int i = cp + 1; i < last; ++i) {
+            const PointT &pt =
+                input_->points[index_vector[i].cloud_point_index];
             if (!downsample_all_data_) {
-                centroid[0] +=
-                    input_->points[index_vector[i].cloud_point_index].x;
-                centroid[1] +=
-                    input_->points[index_vector[i].cloud_point_index].y;
-                centroid[2] +=
-                    input_->points[index_vector[i].cloud_point_index].z;
+                centroid[0] += pt.x;
+                centroid[1] += pt.y;
+                centroid[2] += pt.z;
             } else {
                 // ---[ RGB special case
                 if (rgba_index >= 0) {
                     // Fill r/g/b data, assuming that the order is BGRA
                     pcl::RGB rgb;
-                    memcpy(
-                        &rgb,
-                        reinterpret_cast<const char *>(
-                            &input_
-                                 ->points[index_vector[i].cloud_point_index]) +
-                            rgba_index,
-                        sizeof(RGB));
+                    memcpy(&rgb,
+                           reinterpret_cast<const char *>(&pt) + rgba_index,
+                           sizeof(RGB));
                     temporary[centroid_size - 3] = rgb.r;
                     temporary[centroid_size - 2] = rgb.g;
                     temporary[centroid_size - 1] = rgb.b;
                 }
-                pcl::for_each_type<FieldList>(NdCopyPointEigenFunctor<PointT>(
-                    input_->points[index_vector[i].cloud_point_index],
-                    temporary));
+                pcl::for_each_type<FieldList>(
+                    NdCopyPointEigenFunctor<PointT>(pt, temporary));
                 centroid += temporary;
             }
-            ++i;
         }
 
         // index is centroid final position in resulting PointCloud
         if (save_leaf_layout_)
-            leaf_layout_[index_vector[cp].idx] = index;
+            leaf_layout_[static_cast<size_t>(index_vector[cp].idx)] = index;
 
-        centroid /= static_cast<float>(i - cp);
+        centroid /= static_cast<float>(last - cp);
 
         // store centroid
         // Do we need to process all the fields?
@@ -425,8 +387,6 @@ void pcl::VoxelGrid<PointT>::applyFilter(PointCloud &output) {
                        &rgb, sizeof(float));
             }
         }
-        cp = i;
-        ++index;
     }
     output.width = static_cast<uint32_t>(output.points.size());
 }
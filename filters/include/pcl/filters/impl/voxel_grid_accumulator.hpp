@@ -0,0 +1,363 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Point Cloud Library (PCL) - www.pointclouds.org
+ *  Copyright (c) 2010-2011, Willow Garage, Inc.
+ *  Copyright (c) 2012-, Open Perception, Inc.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_FILTERS_IMPL_VOXEL_GRID_ACCUMULATOR_H_
+#define PCL_FILTERS_IMPL_VOXEL_GRID_ACCUMULATOR_H_
+
+#include <pcl/common/io.h>
+#include <pcl/filters/voxel_grid_accumulator.h>
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::VoxelGridAccumulator<PointT>::setLeafSize(float lx, float ly,
+                                                     float lz) {
+    leaf_size_ = Eigen::Vector4f(lx, ly, lz, 1.0f);
+    // Use multiplications instead of divisions
+    inverse_leaf_size_ = Eigen::Array4f::Ones() / leaf_size_.array();
+    // The dense layout depends on the leaf size
+    if (dense_ && !setDenseStorage(dense_min_, dense_max_))
+        setHashStorage();
+    clear();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::VoxelGridAccumulator<PointT>::setDownsampleAllData(bool downsample) {
+    downsample_all_data_ = downsample;
+    initCentroidLayout();
+    clear();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::VoxelGridAccumulator<PointT>::setHashStorage() {
+    dense_ = false;
+    std::vector<int>().swap(leaf_layout_);
+    clear();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+bool pcl::VoxelGridAccumulator<PointT>::setDenseStorage(
+    const Eigen::Vector4f &min_pt, const Eigen::Vector4f &max_pt) {
+    if (leaf_size_[0] <= 0 || leaf_size_[1] <= 0 || leaf_size_[2] <= 0) {
+        PCL_ERROR("[pcl::VoxelGridAccumulator::setDenseStorage] The leaf size "
+                  "has to be set first!\n");
+        return (false);
+    }
+
+    Eigen::Vector3i min_ijk =
+        getGridCoordinates(min_pt[0], min_pt[1], min_pt[2]);
+    Eigen::Vector3i max_ijk =
+        getGridCoordinates(max_pt[0], max_pt[1], max_pt[2]);
+    Eigen::Vector4i min_b(min_ijk[0], min_ijk[1], min_ijk[2], 0);
+    Eigen::Vector4i div_b(max_ijk[0] - min_ijk[0] + 1,
+                          max_ijk[1] - min_ijk[1] + 1,
+                          max_ijk[2] - min_ijk[2] + 1, 0);
+
+    // The layout is addressed with (32-bit) division multipliers
+    uint64_t nr_voxels = 0;
+    if (div_b[0] <= 0 || div_b[1] <= 0 || div_b[2] <= 0 ||
+        !detail::getNumberOfVoxels(div_b, nr_voxels) ||
+        nr_voxels > static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+        PCL_ERROR("[pcl::VoxelGridAccumulator::setDenseStorage] Invalid or too "
+                  "large box for a dense layout!\n");
+        return (false);
+    }
+    try {
+        leaf_layout_.assign(static_cast<size_t>(nr_voxels), -1);
+    } catch (std::bad_alloc &) {
+        PCL_ERROR("[pcl::VoxelGridAccumulator::setDenseStorage] Impossible to "
+                  "allocate memory for the layout!\n");
+        return (false);
+    }
+
+    dense_ = true;
+    dense_min_ = min_pt;
+    dense_max_ = max_pt;
+    min_b_ = min_b;
+    div_b_ = div_b;
+    divb_mul_ = Eigen::Vector4i(1, div_b_[0], div_b_[0] * div_b_[1], 0);
+    leaf_map_.clear();
+    leaves_.clear();
+    free_leaves_.clear();
+    return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> void pcl::VoxelGridAccumulator<PointT>::clear() {
+    leaves_.clear();
+    free_leaves_.clear();
+    leaf_map_.clear();
+    std::fill(leaf_layout_.begin(), leaf_layout_.end(), -1);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+size_t pcl::VoxelGridAccumulator<PointT>::addPoints(const PointCloud &cloud) {
+    Eigen::VectorXf temporary = Eigen::VectorXf::Zero(centroid_size_);
+    size_t nr_added = 0;
+    for (size_t cp = 0; cp < cloud.points.size(); ++cp)
+        if (addPoint(cloud.points[cp], temporary))
+            ++nr_added;
+    return (nr_added);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+size_t
+pcl::VoxelGridAccumulator<PointT>::addPoints(const PointCloud &cloud,
+                                             const std::vector<int> &indices) {
+    Eigen::VectorXf temporary = Eigen::VectorXf::Zero(centroid_size_);
+    size_t nr_added = 0;
+    for (size_t i = 0; i < indices.size(); ++i)
+        if (addPoint(cloud.points[indices[i]], temporary))
+            ++nr_added;
+    return (nr_added);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+size_t
+pcl::VoxelGridAccumulator<PointT>::removeRegion(const Eigen::Vector4f &min_pt,
+                                                const Eigen::Vector4f &max_pt) {
+    Eigen::Vector3i min_ijk =
+        getGridCoordinates(min_pt[0], min_pt[1], min_pt[2]);
+    Eigen::Vector3i max_ijk =
+        getGridCoordinates(max_pt[0], max_pt[1], max_pt[2]);
+    if ((max_ijk.array() < min_ijk.array()).any())
+        return (0);
+
+    size_t nr_removed = 0;
+    double nr_voxels =
+        (max_ijk - min_ijk + Eigen::Vector3i::Ones()).cast<double>().prod();
+    if (nr_voxels <= static_cast<double>(getNumberOfLeaves())) {
+        // Visit the voxels of the box
+        Eigen::Vector3i ijk;
+        for (ijk[2] = min_ijk[2]; ijk[2] <= max_ijk[2]; ++ijk[2])
+            for (ijk[1] = min_ijk[1]; ijk[1] <= max_ijk[1]; ++ijk[1])
+                for (ijk[0] = min_ijk[0]; ijk[0] <= max_ijk[0]; ++ijk[0]) {
+                    int slot = findLeaf(ijk);
+                    if (slot >= 0) {
+                        removeLeaf(slot);
+                        ++nr_removed;
+                    }
+                }
+    } else {
+        // Visit the occupied voxels
+        for (size_t slot = 0; slot < leaves_.size(); ++slot) {
+            const Leaf &leaf = leaves_[slot];
+            if (leaf.nr_points > 0 &&
+                (leaf.ijk.array() >= min_ijk.array()).all() &&
+                (leaf.ijk.array() <= max_ijk.array()).all()) {
+                removeLeaf(static_cast<int>(slot));
+                ++nr_removed;
+            }
+        }
+    }
+    return (nr_removed);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::VoxelGridAccumulator<PointT>::getCentroids(PointCloud &output) const {
+    output.points.clear();
+    output.points.reserve(getNumberOfLeaves());
+    Eigen::VectorXf centroid(centroid_size_);
+    for (size_t slot = 0; slot < leaves_.size(); ++slot) {
+        const Leaf &leaf = leaves_[slot];
+        if (leaf.nr_points == 0 || leaf.nr_points < min_points_per_voxel_)
+            continue;
+
+        centroid =
+            (leaf.centroid / static_cast<double>(leaf.nr_points))
+                .template cast<float>();
+        output.points.push_back(PointT());
+        PointT &point = output.points.back();
+        // Do we need to process all the fields?
+        if (!downsample_all_data_) {
+            point.x = centroid[0];
+            point.y = centroid[1];
+            point.z = centroid[2];
+        } else {
+            pcl::for_each_type<FieldList>(
+                pcl::NdCopyEigenPointFunctor<PointT>(centroid, point));
+            // ---[ RGB special case
+            if (rgba_index_ >= 0) {
+                // pack r/g/b into rgb
+                float r = centroid[centroid_size_ - 3],
+                      g = centroid[centroid_size_ - 2],
+                      b = centroid[centroid_size_ - 1];
+                int rgb = (static_cast<int>(r) << 16) |
+                          (static_cast<int>(g) << 8) | static_cast<int>(b);
+                memcpy(reinterpret_cast<char *>(&point) + rgba_index_, &rgb,
+                       sizeof(float));
+            }
+        }
+    }
+    output.width = static_cast<uint32_t>(output.points.size());
+    output.height = 1;
+    output.is_dense = true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::VoxelGridAccumulator<PointT>::initCentroidLayout() {
+    centroid_size_ = 4;
+    if (downsample_all_data_)
+        centroid_size_ = boost::mpl::size<FieldList>::value;
+
+    // ---[ RGB special case
+    std::vector<sensor_msgs::PointField> fields;
+    PointCloud empty;
+    rgba_index_ = pcl::getFieldIndex(empty, "rgb", fields);
+    if (rgba_index_ == -1)
+        rgba_index_ = pcl::getFieldIndex(empty, "rgba", fields);
+    if (rgba_index_ >= 0) {
+        rgba_index_ = fields[rgba_index_].offset;
+        centroid_size_ += 3;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+int pcl::VoxelGridAccumulator<PointT>::findLeaf(
+    const Eigen::Vector3i &ijk) const {
+    if (dense_) {
+        int idx = getLayoutIndex(ijk);
+        return (idx >= 0 ? leaf_layout_[idx] : -1);
+    }
+    typename boost::unordered_map<Eigen::Vector3i, int,
+                                  CoordinatesHash>::const_iterator it =
+        leaf_map_.find(ijk);
+    return (it != leaf_map_.end() ? it->second : -1);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+int pcl::VoxelGridAccumulator<PointT>::getOrCreateLeaf(
+    const Eigen::Vector3i &ijk) {
+    int *slot;
+    if (dense_) {
+        int idx = getLayoutIndex(ijk);
+        if (idx < 0)
+            return (-1);
+        slot = &leaf_layout_[idx];
+    } else
+        slot = &leaf_map_.insert(std::make_pair(ijk, -1)).first->second;
+
+    if (*slot < 0) {
+        // Reuse the slot of a removed voxel if possible
+        if (!free_leaves_.empty()) {
+            *slot = free_leaves_.back();
+            free_leaves_.pop_back();
+        } else {
+            *slot = static_cast<int>(leaves_.size());
+            leaves_.push_back(Leaf());
+        }
+        Leaf &leaf = leaves_[*slot];
+        leaf.ijk = ijk;
+        leaf.centroid.setZero(centroid_size_);
+        leaf.pt_sum.setZero();
+        leaf.pt_sq_sum.setZero();
+    }
+    return (*slot);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::VoxelGridAccumulator<PointT>::removeLeaf(int slot) {
+    Leaf &leaf = leaves_[slot];
+    if (dense_)
+        leaf_layout_[getLayoutIndex(leaf.ijk)] = -1;
+    else
+        leaf_map_.erase(leaf.ijk);
+    leaf.nr_points = 0;
+    free_leaves_.push_back(slot);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+bool pcl::VoxelGridAccumulator<PointT>::addPoint(const PointT &point,
+                                                  Eigen::VectorXf &temporary) {
+    // Check if the point is invalid
+    if (!pcl_isfinite(point.x) || !pcl_isfinite(point.y) ||
+        !pcl_isfinite(point.z))
+        return (false);
+
+    int slot = getOrCreateLeaf(getGridCoordinates(point.x, point.y, point.z));
+    if (slot < 0)
+        return (false);
+    Leaf &leaf = leaves_[slot];
+
+    Eigen::Vector3d pt3d(point.x, point.y, point.z);
+    // Accumulate point sum for centroid calculation
+    leaf.pt_sum += pt3d;
+    // Accumulate x*xT for single pass covariance calculation
+    leaf.pt_sq_sum += pt3d * pt3d.transpose();
+
+    // Do we need to process all the fields?
+    if (!downsample_all_data_) {
+        leaf.centroid[0] += point.x;
+        leaf.centroid[1] += point.y;
+        leaf.centroid[2] += point.z;
+    } else {
+        // ---[ RGB special case
+        if (rgba_index_ >= 0) {
+            // Fill r/g/b data, assuming that the order is BGRA
+            pcl::RGB rgb;
+            memcpy(&rgb, reinterpret_cast<const char *>(&point) + rgba_index_,
+                   sizeof(RGB));
+            temporary[centroid_size_ - 3] = rgb.r;
+            temporary[centroid_size_ - 2] = rgb.g;
+            temporary[centroid_size_ - 1] = rgb.b;
+        }
+        pcl::for_each_type<FieldList>(
+            NdCopyPointEigenFunctor<PointT>(point, temporary));
+        leaf.centroid += temporary.cast<double>();
+    }
+    ++leaf.nr_points;
+    return (true);
+}
+
+#define PCL_INSTANTIATE_VoxelGridAccumulator(T)                                \
+    template class PCL_EXPORTS pcl::VoxelGridAccumulator<T>;
+
+#endif // PCL_FILTERS_IMPL_VOXEL_GRID_ACCUMULATOR_H_
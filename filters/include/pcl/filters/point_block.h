@@ -0,0 +1,115 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Point Cloud Library (PCL) - www.pointclouds.org
+ *  Copyright (c) 2010-2011, Willow Garage, Inc.
+ *  Copyright (c) 2012-, Open Perception, Inc.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_FILTERS_POINT_BLOCK_H_
+#define PCL_FILTERS_POINT_BLOCK_H_
+
+#include <pcl/point_traits.h>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+namespace pcl {
+namespace detail {
+/** \brief Helpers used by the filters to classify the points of a cloud four
+ * at a time.
+ *
+ * The coordinates of four points are gathered into one SSE register per
+ * coordinate, the filter compares the registers against its limits and
+ * reduces the comparisons to a 4 bit mask (bit j set for the j-th point),
+ * which it then walks in order to emit the kept and removed indices. The
+ * points left over at the end of the cloud go through the equivalent scalar
+ * code.
+ */
+
+/** \brief Whether x, y and z are stored as the first three floats of a 16
+ * bytes block inside PointT (true for all the types declared with
+ * PCL_ADD_POINT4D), so that one unaligned load fetches all of them.
+ */
+template <typename PointT> struct HasPackedXYZ {
+    static const size_t x = pcl::traits::offset<PointT, pcl::fields::x>::value;
+    static const bool value =
+        pcl::traits::offset<PointT, pcl::fields::y>::value == x + 4 &&
+        pcl::traits::offset<PointT, pcl::fields::z>::value == x + 8 &&
+        x + 16 <= sizeof(PointT);
+};
+
+#ifdef __SSE__
+/** \brief Load the coordinates of four points, one register per coordinate.
+ * \note Only valid when HasPackedXYZ<PointT>::value is true.
+ */
+template <typename PointT>
+inline void loadXYZ(const PointT &p0, const PointT &p1, const PointT &p2,
+                    const PointT &p3, __m128 &x, __m128 &y, __m128 &z) {
+    __m128 r0 = _mm_loadu_ps(&p0.x);
+    __m128 r1 = _mm_loadu_ps(&p1.x);
+    __m128 r2 = _mm_loadu_ps(&p2.x);
+    __m128 r3 = _mm_loadu_ps(&p3.x);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    x = r0;
+    y = r1;
+    z = r2;
+}
+
+/** \brief Select (all bits set) the lanes of v holding a finite value. */
+inline __m128 isFinite(const __m128 &v) {
+    // v - v is 0 for finite values and NaN for +/-inf and NaN
+    return (_mm_cmpeq_ps(_mm_sub_ps(v, v), _mm_setzero_ps()));
+}
+
+/** \brief Get the 4 bit mask of the points whose coordinates are all finite.
+ */
+inline int finiteMask(const __m128 &x, const __m128 &y, const __m128 &z) {
+    return (_mm_movemask_ps(
+        _mm_and_ps(_mm_and_ps(isFinite(x), isFinite(y)), isFinite(z))));
+}
+
+/** \brief Select the lanes where v < min or v > max. As with the scalar
+ * comparisons, NaN values are never outside.
+ */
+inline __m128 isOutside(const __m128 &v, const __m128 &min,
+                        const __m128 &max) {
+    return (_mm_or_ps(_mm_cmplt_ps(v, min), _mm_cmpgt_ps(v, max)));
+}
+#endif
+} // namespace detail
+} // namespace pcl
+
+#endif // PCL_FILTERS_POINT_BLOCK_H_
@@ -81,7 +81,8 @@ class RadiusOutlierRemoval : public FilterIndices<PointT> {
      */
     RadiusOutlierRemoval(bool extract_removed_indices = false)
         : FilterIndices<PointT>::FilterIndices(extract_removed_indices),
-          searcher_(), search_radius_(0.0), min_pts_radius_(1) {
+          searcher_(), search_radius_(0.0), min_pts_radius_(1),
+          threads_(1) {
         filter_name_ = "RadiusOutlierRemoval";
     }
 
@@ -123,6 +124,18 @@ class RadiusOutlierRemoval : public FilterIndices<PointT> {
      */
     inline int getMinNeighborsInRadius() { return (min_pts_radius_); }
 
+    /** \brief Set the number of threads used for the radius searches. The
+     * kept and removed indices do not depend on it.
+     * \param[in] nr_threads the number of hardware threads to use (0 sets the
+     * value back to automatic, 1 runs serially)
+     */
+    inline void setNumberOfThreads(unsigned int nr_threads = 0) {
+        threads_ = nr_threads;
+    }
+
+    /** \brief Get the number of threads used for the radius searches. */
+    inline unsigned int getNumberOfThreads() { return (threads_); }
+
   protected:
     using PCLBase<PointT>::input_;
     using PCLBase<PointT>::indices_;
@@ -159,6 +172,9 @@ class RadiusOutlierRemoval : public FilterIndices<PointT> {
     /** \brief The minimum number of neighbors that a point needs to have in the
      * given search radius to be considered an inlier. */
     int min_pts_radius_;
+
+    /** \brief The number of threads the scheduler should use. */
+    unsigned int threads_;
 };
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -94,7 +94,7 @@ class StatisticalOutlierRemoval : public FilterIndices<PointT> {
      */
     StatisticalOutlierRemoval(bool extract_removed_indices = false)
         : FilterIndices<PointT>::FilterIndices(extract_removed_indices),
-          searcher_(), mean_k_(1), std_mul_(0.0) {
+          searcher_(), mean_k_(1), std_mul_(0.0), threads_(1) {
         filter_name_ = "StatisticalOutlierRemoval";
     }
 
@@ -128,6 +128,19 @@ class StatisticalOutlierRemoval : public FilterIndices<PointT> {
      */
     inline double getStddevMulThresh() { return (std_mul_); }
 
+    /** \brief Set the number of threads used for the nearest neighbor
+     * searches. The kept and removed indices do not depend on it.
+     * \param[in] nr_threads the number of hardware threads to use (0 sets the
+     * value back to automatic, 1 runs serially)
+     */
+    inline void setNumberOfThreads(unsigned int nr_threads = 0) {
+        threads_ = nr_threads;
+    }
+
+    /** \brief Get the number of threads used for the nearest neighbor
+     * searches. */
+    inline unsigned int getNumberOfThreads() { return (threads_); }
+
   protected:
     using PCLBase<PointT>::input_;
     using PCLBase<PointT>::indices_;
@@ -164,6 +177,9 @@ class StatisticalOutlierRemoval : public FilterIndices<PointT> {
     /** \brief Standard deviations threshold (i.e., points outside of
      * \f$ \mu \pm \sigma \cdot std\_mul \f$ will be marked as outliers). */
     double std_mul_;
+
+    /** \brief The number of threads the scheduler should use. */
+    unsigned int threads_;
 };
 
 /** \brief @b StatisticalOutlierRemoval uses point neighborhood statistics to
@@ -139,6 +139,54 @@ void getMinMax3D(const typename pcl::PointCloud<PointT>::ConstPtr &cloud,
                  float max_distance, Eigen::Vector4f &min_pt,
                  Eigen::Vector4f &max_pt, bool limit_negative = false);
 
+namespace detail {
+/** \brief A point index tagged with the index of the voxel it falls into. */
+struct VoxelIndex {
+    VoxelIndex() : idx(0), cloud_point_index(0) {}
+    VoxelIndex(uint64_t idx_, unsigned int cloud_point_index_)
+        : idx(idx_), cloud_point_index(cloud_point_index_) {}
+    bool operator<(const VoxelIndex &p) const { return (idx < p.idx); }
+
+    uint64_t idx;
+    unsigned int cloud_point_index;
+};
+
+/** \brief Get the number of voxels of a grid, unless 64-bit voxel indices
+ * would overflow.
+ * \param[in] div_b the number of divisions along each axis
+ * \param[out] nr_voxels the number of voxels
+ * \return false if the grid has 2^64 - 1 voxels or more, which leaves no
+ * room for the index marking discarded points
+ */
+inline bool getNumberOfVoxels(const Eigen::Vector4i &div_b,
+                              uint64_t &nr_voxels) {
+    uint64_t nr_xy =
+        static_cast<uint64_t>(div_b[0]) * static_cast<uint64_t>(div_b[1]);
+    if (static_cast<uint64_t>(div_b[2]) > (~uint64_t(0) - 1) / nr_xy)
+        return (false);
+    nr_voxels = nr_xy * static_cast<uint64_t>(div_b[2]);
+    return (true);
+}
+
+/** \brief Sort voxel indices by voxel with a parallel LSD radix sort. The
+ * sort is stable: the points of a voxel stay in the order they were given,
+ * so the centroids do not depend on the number of threads.
+ * \param[in,out] indices the indices to sort
+ * \param[in] max_idx the largest voxel index found in \a indices
+ * \param[in] nr_threads the number of threads to use (0: automatic)
+ */
+PCL_EXPORTS void sortVoxelIndices(std::vector<VoxelIndex> &indices,
+                                  uint64_t max_idx, unsigned int nr_threads);
+
+/** \brief Find where each voxel starts in sorted voxel indices.
+ * \param[in] indices the indices, sorted by voxel
+ * \param[out] first the position of the first point of each voxel, followed
+ * by indices.size ()
+ */
+PCL_EXPORTS void findVoxelBoundaries(const std::vector<VoxelIndex> &indices,
+                                     std::vector<unsigned int> &first);
+} // namespace detail
+
 /** \brief VoxelGrid assembles a local 3D grid over a given PointCloud, and
  * downsamples + filters the data.
  *
@@ -172,7 +220,8 @@ template <typename PointT> class VoxelGrid : public Filter<PointT> {
           min_b_(Eigen::Vector4i::Zero()), max_b_(Eigen::Vector4i::Zero()),
           div_b_(Eigen::Vector4i::Zero()), divb_mul_(Eigen::Vector4i::Zero()),
           filter_field_name_(""), filter_limit_min_(-FLT_MAX),
-          filter_limit_max_(FLT_MAX), filter_limit_negative_(false) {
+          filter_limit_max_(FLT_MAX), filter_limit_negative_(false),
+          threads_(1) {
         filter_name_ = "VoxelGrid";
     }
 
@@ -411,6 +460,16 @@ template <typename PointT> class VoxelGrid : public Filter<PointT> {
      */
     inline bool getFilterLimitsNegative() { return (filter_limit_negative_); }
 
+    /** \brief Set the number of threads used to compute the voxel indices,
+     * sort them and average the voxels (1 by default). The output does not
+     * depend on it.
+     * \param[in] nr_threads the number of hardware threads to use (0 sets the
+     * value to automatic)
+     */
+    inline void setNumberOfThreads(unsigned int nr_threads = 0) {
+        threads_ = nr_threads;
+    }
+
   protected:
     /** \brief The size of a leaf. */
     Eigen::Vector4f leaf_size_;
@@ -450,6 +509,9 @@ template <typename PointT> class VoxelGrid : public Filter<PointT> {
      * filter_limit_min_;\a filter_limit_max_). Default: false. */
     bool filter_limit_negative_;
 
+    /** \brief The number of threads the scheduler should use. */
+    unsigned int threads_;
+
     typedef typename pcl::traits::fieldList<PointT>::type FieldList;
 
     /** \brief Downsample a Point Cloud using a voxelized grid approach
@@ -490,7 +552,8 @@ class PCL_EXPORTS VoxelGrid<sensor_msgs::PointCloud2>
           min_b_(Eigen::Vector4i::Zero()), max_b_(Eigen::Vector4i::Zero()),
           div_b_(Eigen::Vector4i::Zero()), divb_mul_(Eigen::Vector4i::Zero()),
           filter_field_name_(""), filter_limit_min_(-FLT_MAX),
-          filter_limit_max_(FLT_MAX), filter_limit_negative_(false) {
+          filter_limit_max_(FLT_MAX), filter_limit_negative_(false),
+          threads_(1) {
         filter_name_ = "VoxelGrid";
     }
 
@@ -761,6 +824,16 @@ class PCL_EXPORTS VoxelGrid<sensor_msgs::PointCloud2>
      */
     inline bool getFilterLimitsNegative() { return (filter_limit_negative_); }
 
+    /** \brief Set the number of threads used to compute the voxel indices,
+     * sort them and average the voxels (1 by default). The output does not
+     * depend on it.
+     * \param[in] nr_threads the number of hardware threads to use (0 sets the
+     * value to automatic)
+     */
+    inline void setNumberOfThreads(unsigned int nr_threads = 0) {
+        threads_ = nr_threads;
+    }
+
   protected:
     /** \brief The size of a leaf. */
     Eigen::Vector4f leaf_size_;
@@ -803,6 +876,9 @@ class PCL_EXPORTS VoxelGrid<sensor_msgs::PointCloud2>
      * filter_limit_min_;\a filter_limit_max_). Default: false. */
     bool filter_limit_negative_;
 
+    /** \brief The number of threads the scheduler should use. */
+    unsigned int threads_;
+
     /** \brief Downsample a Point Cloud using a voxelized grid approach
      * \param[out] output the resultant point cloud
      */
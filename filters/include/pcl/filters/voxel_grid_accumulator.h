@@ -0,0 +1,330 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Point Cloud Library (PCL) - www.pointclouds.org
+ *  Copyright (c) 2010-2011, Willow Garage, Inc.
+ *  Copyright (c) 2012-, Open Perception, Inc.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_FILTERS_VOXEL_GRID_ACCUMULATOR_H_
+#define PCL_FILTERS_VOXEL_GRID_ACCUMULATOR_H_
+
+#include <pcl/filters/boost.h>
+#include <pcl/filters/voxel_grid.h>
+
+namespace pcl {
+/** \brief Incremental voxel grid, for downsampling streams of point clouds
+ * (e.g. a sliding map that receives a new frame at every step).
+ *
+ * Instead of recomputing every centroid at each call like \ref VoxelGrid,
+ * VoxelGridAccumulator keeps the running sums of every voxel: addPoints ()
+ * and removeRegion () cost O(batch), and getCentroids () returns the
+ * centroids of all the points added so far.
+ *
+ * The centroids follow the conventions of \ref VoxelGrid (all fields are
+ * averaged unless setDownsampleAllData (false), r/g/b are averaged
+ * separately), and every voxel also provides the mean and covariance of its
+ * points like \ref VoxelGridCovariance. The sums are kept in double
+ * precision, since a voxel may accumulate points for a long time.
+ *
+ * Two storages are available:
+ *  - a hash map of the occupied voxels (default): unbounded, memory
+ *    proportional to the number of occupied voxels;
+ *  - a dense layout covering a fixed box, like the leaf layout of \ref
+ *    VoxelGrid: cheaper lookups, memory proportional to the volume of the
+ *    box. Points outside of the box are ignored.
+ *
+ * \code
+ * pcl::VoxelGridAccumulator<pcl::PointXYZ> map;
+ * map.setLeafSize (0.05f, 0.05f, 0.05f);
+ * // For every frame
+ * map.addPoints (*frame);
+ * map.removeRegion (old_min, old_max);
+ * map.getCentroids (downsampled_map);
+ * \endcode
+ * \ingroup filters
+ */
+template <typename PointT> class VoxelGridAccumulator {
+  public:
+    typedef pcl::PointCloud<PointT> PointCloud;
+    typedef boost::shared_ptr<VoxelGridAccumulator<PointT> > Ptr;
+    typedef boost::shared_ptr<const VoxelGridAccumulator<PointT> > ConstPtr;
+
+    /** \brief Running sums of the points that fell into a voxel. */
+    struct Leaf {
+        Leaf()
+            : nr_points(0), ijk(Eigen::Vector3i::Zero()), centroid(),
+              pt_sum(Eigen::Vector3d::Zero()),
+              pt_sq_sum(Eigen::Matrix3d::Zero()) {}
+
+        /** \brief Get the number of points contained by this voxel. */
+        int getPointCount() const { return (nr_points); }
+
+        /** \brief Get the mean of the XYZ coordinates of the points. */
+        Eigen::Vector3d getMean() const {
+            return (pt_sum / static_cast<double>(nr_points));
+        }
+
+        /** \brief Get the covariance of the XYZ coordinates of the points,
+         * normalized like \ref VoxelGridCovariance does (before inflating
+         * small eigen values).
+         */
+        Eigen::Matrix3d getCov() const {
+            const double n = static_cast<double>(nr_points);
+            Eigen::Vector3d mean = getMean();
+            Eigen::Matrix3d cov = pt_sq_sum / n - mean * mean.transpose();
+            return (cov * ((n - 1.0) / n));
+        }
+
+        /** \brief Number of points contained by the voxel (0 for unused
+         * leaves). */
+        int nr_points;
+
+        /** \brief Grid coordinates of the voxel. */
+        Eigen::Vector3i ijk;
+
+        /** \brief Sum of the N-d point data, laid out like the centroids of
+         * \ref VoxelGrid. */
+        Eigen::VectorXd centroid;
+
+        /** \brief Sum of the XYZ coordinates. */
+        Eigen::Vector3d pt_sum;
+
+        /** \brief Sum of the XYZ coordinates times their transpose. */
+        Eigen::Matrix3d pt_sq_sum;
+
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    };
+
+    /** \brief Empty constructor. Uses hash map storage. */
+    VoxelGridAccumulator()
+        : leaf_size_(Eigen::Vector4f::Zero()),
+          inverse_leaf_size_(Eigen::Array4f::Zero()),
+          downsample_all_data_(true), min_points_per_voxel_(1),
+          centroid_size_(0), rgba_index_(-1), dense_(false),
+          dense_min_(Eigen::Vector4f::Zero()),
+          dense_max_(Eigen::Vector4f::Zero()),
+          min_b_(Eigen::Vector4i::Zero()), div_b_(Eigen::Vector4i::Zero()),
+          divb_mul_(Eigen::Vector4i::Zero()), leaf_layout_(), leaf_map_(),
+          leaves_(), free_leaves_() {
+        initCentroidLayout();
+    }
+
+    /** \brief Set the voxel grid leaf size. Clears the grid.
+     * \param[in] lx the leaf size for X
+     * \param[in] ly the leaf size for Y
+     * \param[in] lz the leaf size for Z
+     */
+    void setLeafSize(float lx, float ly, float lz);
+
+    /** \brief Get the voxel grid leaf size. */
+    inline Eigen::Vector3f getLeafSize() const {
+        return (leaf_size_.head<3>());
+    }
+
+    /** \brief Set to true if all fields need to be downsampled, or false if
+     * just XYZ. Clears the grid.
+     * \param[in] downsample the new value (true/false)
+     */
+    void setDownsampleAllData(bool downsample);
+
+    /** \brief Get the state of the internal downsampling parameter. */
+    inline bool getDownsampleAllData() const { return (downsample_all_data_); }
+
+    /** \brief Set the minimum number of points a voxel needs to be returned
+     * by getCentroids () (default: 1).
+     */
+    inline void setMinPointsPerVoxel(int min_points_per_voxel) {
+        min_points_per_voxel_ = min_points_per_voxel;
+    }
+
+    /** \brief Get the minimum number of points a voxel needs to be returned
+     * by getCentroids (). */
+    inline int getMinPointsPerVoxel() const { return (min_points_per_voxel_); }
+
+    /** \brief Store the voxels in a hash map (the default). Clears the grid.
+     */
+    void setHashStorage();
+
+    /** \brief Store the voxels in a dense layout covering the given box,
+     * ignoring points outside of it. The leaf size has to be set first.
+     * Clears the grid.
+     * \param[in] min_pt the minimum corner of the box
+     * \param[in] max_pt the maximum corner of the box
+     * \return false (and keep the current storage) if the layout would be
+     * too large
+     */
+    bool setDenseStorage(const Eigen::Vector4f &min_pt,
+                         const Eigen::Vector4f &max_pt);
+
+    /** \brief Check whether the voxels are stored in a dense layout. */
+    inline bool isDense() const { return (dense_); }
+
+    /** \brief Remove all the voxels. */
+    void clear();
+
+    /** \brief Add a batch of points to the grid. Invalid points are skipped.
+     * \param[in] cloud the points to add
+     * \return the number of points added
+     */
+    size_t addPoints(const PointCloud &cloud);
+
+    /** \brief Add a batch of points to the grid. Invalid points are skipped.
+     * \param[in] cloud the point cloud
+     * \param[in] indices the indices of the points to add
+     * \return the number of points added
+     */
+    size_t addPoints(const PointCloud &cloud, const std::vector<int> &indices);
+
+    /** \brief Remove the voxels that intersect an axis aligned box. The cost
+     * is proportional to the smaller of the number of voxels in the box and
+     * the number of occupied voxels.
+     * \param[in] min_pt the minimum corner of the box
+     * \param[in] max_pt the maximum corner of the box
+     * \return the number of voxels removed
+     */
+    size_t removeRegion(const Eigen::Vector4f &min_pt,
+                        const Eigen::Vector4f &max_pt);
+
+    /** \brief Get the centroids of the voxels that contain at least
+     * getMinPointsPerVoxel () points, in no particular order.
+     * \param[out] output the resultant centroids
+     */
+    void getCentroids(PointCloud &output) const;
+
+    /** \brief Get the number of occupied voxels. */
+    inline size_t getNumberOfLeaves() const {
+        return (leaves_.size() - free_leaves_.size());
+    }
+
+    /** \brief Get the voxel containing a given point.
+     * \return NULL if the voxel is empty
+     */
+    inline const Leaf *getLeaf(const PointT &p) const {
+        int slot = findLeaf(getGridCoordinates(p.x, p.y, p.z));
+        return (slot >= 0 ? &leaves_[slot] : NULL);
+    }
+
+    /** \brief Get the grid coordinates of a point, as \ref VoxelGrid does. */
+    inline Eigen::Vector3i getGridCoordinates(float x, float y, float z) const {
+        return (Eigen::Vector3i(
+            static_cast<int>(floor(x * inverse_leaf_size_[0])),
+            static_cast<int>(floor(y * inverse_leaf_size_[1])),
+            static_cast<int>(floor(z * inverse_leaf_size_[2]))));
+    }
+
+  protected:
+    typedef typename pcl::traits::fieldList<PointT>::type FieldList;
+
+    /** \brief Hash of grid coordinates, for the hash map storage. */
+    struct CoordinatesHash {
+        size_t operator()(const Eigen::Vector3i &ijk) const {
+            size_t seed = 0;
+            boost::hash_combine(seed, ijk[0]);
+            boost::hash_combine(seed, ijk[1]);
+            boost::hash_combine(seed, ijk[2]);
+            return (seed);
+        }
+    };
+
+    /** \brief Compute the size of the centroids and the RGB offset. */
+    void initCentroidLayout();
+
+    /** \brief Get the slot of the voxel at the given grid coordinates, or -1
+     * if it is empty. */
+    int findLeaf(const Eigen::Vector3i &ijk) const;
+
+    /** \brief Get the slot of the voxel at the given grid coordinates,
+     * creating it if needed, or -1 if outside of the dense layout. */
+    int getOrCreateLeaf(const Eigen::Vector3i &ijk);
+
+    /** \brief Release the voxel stored in the given slot. */
+    void removeLeaf(int slot);
+
+    /** \brief Accumulate one point. */
+    bool addPoint(const PointT &point, Eigen::VectorXf &temporary);
+
+    /** \brief Get the index of grid coordinates in the dense layout, or -1
+     * if outside. */
+    inline int getLayoutIndex(const Eigen::Vector3i &ijk) const {
+        Eigen::Vector4i d = (Eigen::Vector4i() << ijk, 0).finished() - min_b_;
+        if (d[0] < 0 || d[1] < 0 || d[2] < 0 || d[0] >= div_b_[0] ||
+            d[1] >= div_b_[1] || d[2] >= div_b_[2])
+            return (-1);
+        return (d.dot(divb_mul_));
+    }
+
+    /** \brief The size of a leaf. */
+    Eigen::Vector4f leaf_size_;
+
+    /** \brief Internal leaf sizes stored as 1/leaf_size_ for efficiency
+     * reasons. */
+    Eigen::Array4f inverse_leaf_size_;
+
+    /** \brief Set to true if all fields need to be downsampled, or false if
+     * just XYZ. */
+    bool downsample_all_data_;
+
+    /** \brief Minimum number of points of the voxels returned by
+     * getCentroids (). */
+    int min_points_per_voxel_;
+
+    /** \brief Size of the centroids, and offset of the RGB field in PointT
+     * (-1 if none). */
+    int centroid_size_;
+    int rgba_index_;
+
+    /** \brief Dense storage: box covered, minimum bin coordinates, number of
+     * divisions and division multiplier, as in \ref VoxelGrid. */
+    bool dense_;
+    Eigen::Vector4f dense_min_, dense_max_;
+    Eigen::Vector4i min_b_, div_b_, divb_mul_;
+
+    /** \brief Slot of every voxel of the dense layout (-1 when empty). */
+    std::vector<int> leaf_layout_;
+
+    /** \brief Slot of every occupied voxel, for the hash map storage. */
+    boost::unordered_map<Eigen::Vector3i, int, CoordinatesHash> leaf_map_;
+
+    /** \brief The voxels, and the unused slots. */
+    std::vector<Leaf, Eigen::aligned_allocator<Leaf> > leaves_;
+    std::vector<int> free_leaves_;
+
+  public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+} // namespace pcl
+
+#endif //#ifndef PCL_FILTERS_VOXEL_GRID_ACCUMULATOR_H_
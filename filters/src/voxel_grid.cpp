@@ -164,6 +164,77 @@ void pcl::getMinMax3D(const sensor_msgs::PointCloud2ConstPtr &cloud, int x_idx,
     max_pt = max_p;
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+void pcl::detail::sortVoxelIndices(std::vector<VoxelIndex> &indices,
+                                   uint64_t max_idx, unsigned int nr_threads) {
+    const int n = static_cast<int>(indices.size());
+    // Not worth the histograms
+    if (n < 4096) {
+        std::stable_sort(indices.begin(), indices.end());
+        return;
+    }
+
+    // Every block of (at least 64k) points is counted and scattered by one
+    // thread. The blocks do not depend on the number of threads, and neither
+    // does the result
+    const int nr_blocks = std::min(64, (n + 65535) / 65536);
+    const int block_size = (n + nr_blocks - 1) / nr_blocks;
+    std::vector<VoxelIndex> buffer(n);
+    std::vector<size_t> offsets(nr_blocks * 256);
+    VoxelIndex *src = &indices[0], *dst = &buffer[0];
+
+    // One pass per byte of the largest index, least significant first
+    for (int shift = 0; shift < 64 && (max_idx >> shift) != 0; shift += 8) {
+        std::fill(offsets.begin(), offsets.end(), 0);
+#pragma omp parallel for shared(offsets) num_threads(nr_threads)
+        for (int b = 0; b < nr_blocks; ++b) {
+            size_t *count = &offsets[b * 256];
+            const int end = std::min(n, (b + 1) * block_size);
+            for (int i = b * block_size; i < end; ++i)
+                ++count[(src[i].idx >> shift) & 0xff];
+        }
+
+        // Turn the counts into output positions, digit major and block minor
+        // so that the order of equal digits is preserved
+        size_t position = 0;
+        bool single_digit = false;
+        for (int d = 0; d < 256; ++d) {
+            const size_t start = position;
+            for (int b = 0; b < nr_blocks; ++b) {
+                const size_t count = offsets[b * 256 + d];
+                offsets[b * 256 + d] = position;
+                position += count;
+            }
+            single_digit |= (position - start == static_cast<size_t>(n));
+        }
+        // All the indices share this byte, nothing to reorder
+        if (single_digit)
+            continue;
+
+#pragma omp parallel for shared(offsets) num_threads(nr_threads)
+        for (int b = 0; b < nr_blocks; ++b) {
+            size_t *position = &offsets[b * 256];
+            const int end = std::min(n, (b + 1) * block_size);
+            for (int i = b * block_size; i < end; ++i)
+                dst[position[(src[i].idx >> shift) & 0xff]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+
+    if (src != &indices[0])
+        indices.swap(buffer);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+void pcl::detail::findVoxelBoundaries(const std::vector<VoxelIndex> &indices,
+                                      std::vector<unsigned int> &first) {
+    first.clear();
+    for (size_t i = 0; i < indices.size(); ++i)
+        if (i == 0 || indices[i].idx != indices[i - 1].idx)
+            first.push_back(static_cast<unsigned int>(i));
+    first.push_back(static_cast<unsigned int>(indices.size()));
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 void pcl::VoxelGrid<sensor_msgs::PointCloud2>::applyFilter(
     PointCloud2 &output) {
@@ -225,15 +296,24 @@ void pcl::VoxelGrid<sensor_msgs::PointCloud2>::applyFilter(
     div_b_ = max_b_ - min_b_ + Eigen::Vector4i::Ones();
     div_b_[3] = 0;
 
-    std::vector<cloud_point_index_idx> index_vector;
-    index_vector.reserve(nr_points);
-
-    // Create the first xyz_offset, and set up the division multiplier
-    Eigen::Array4i xyz_offset(input_->fields[x_idx_].offset,
-                              input_->fields[y_idx_].offset,
-                              input_->fields[z_idx_].offset, 0);
+    // Set up the division multiplier
     divb_mul_ = Eigen::Vector4i(1, div_b_[0], div_b_[0] * div_b_[1], 0);
-    Eigen::Vector4f pt = Eigen::Vector4f::Zero();
+
+    // Voxel indices are 64-bit, the division multipliers above only serve
+    // the (32-bit) leaf layout
+    uint64_t nr_voxels;
+    if (!detail::getNumberOfVoxels(div_b_, nr_voxels)) {
+        PCL_WARN("[pcl::%s::applyFilter] Leaf size is too small for the input "
+                 "dataset. Integer indices would overflow.\n",
+                 getClassName().c_str());
+        output = *input_;
+        return;
+    }
+    const uint64_t mul_y = static_cast<uint64_t>(div_b_[0]);
+    const uint64_t mul_z = mul_y * static_cast<uint64_t>(div_b_[1]);
+    // Discarded points get an index past the last voxel, so that sorting
+    // moves them to the end
+    const uint64_t invalid_idx = nr_voxels;
 
     int centroid_size = 4;
     if (downsample_all_data_)
@@ -255,6 +335,7 @@ void pcl::VoxelGrid<sensor_msgs::PointCloud2>::applyFilter(
 
     // If we don't want to process the entire cloud, but rather filter points
     // far away from the viewpoint first...
+    int distance_offset = -1;
     if (!filter_field_name_.empty()) {
         // Get the distance field index
         int distance_idx = pcl::getFieldIndex(*input_, filter_field_name_);
@@ -270,111 +351,77 @@ void pcl::VoxelGrid<sensor_msgs::PointCloud2>::applyFilter(
             output.data.clear();
             return;
         }
+        distance_offset = input_->fields[distance_idx].offset;
+    }
+
+    // First pass: go over all points and compute the index of the voxel they
+    // fall into. Points with the same idx value will contribute to the same
+    // point of resulting CloudPoint
+    const Eigen::Array4i xyz_offset(input_->fields[x_idx_].offset,
+                                    input_->fields[y_idx_].offset,
+                                    input_->fields[z_idx_].offset, 0);
+    std::vector<detail::VoxelIndex> index_vector(nr_points);
+#pragma omp parallel for shared(index_vector) num_threads(threads_)
+    for (int cp = 0; cp < nr_points; ++cp) {
+        const uint8_t *point = &input_->data[cp * input_->point_step];
+        index_vector[cp] =
+            detail::VoxelIndex(invalid_idx, static_cast<unsigned int>(cp));
 
-        // First pass: go over all points and insert them into the index_vector
-        // vector with calculated idx. Points with the same idx value will
-        // contribute to the same point of resulting CloudPoint
-        float distance_value = 0;
-        for (int cp = 0; cp < nr_points; ++cp) {
-            int point_offset = cp * input_->point_step;
+        if (distance_offset >= 0) {
             // Get the distance value
-            memcpy(&distance_value,
-                   &input_->data[point_offset +
-                                 input_->fields[distance_idx].offset],
-                   sizeof(float));
+            float distance_value = 0;
+            memcpy(&distance_value, point + distance_offset, sizeof(float));
 
             if (filter_limit_negative_) {
                 // Use a threshold for cutting out points which inside the
                 // interval
                 if (distance_value < filter_limit_max_ &&
-                    distance_value > filter_limit_min_) {
-                    xyz_offset += input_->point_step;
+                    distance_value > filter_limit_min_)
                     continue;
-                }
             } else {
                 // Use a threshold for cutting out points which are too
                 // close/far away
                 if (distance_value > filter_limit_max_ ||
-                    distance_value < filter_limit_min_) {
-                    xyz_offset += input_->point_step;
+                    distance_value < filter_limit_min_)
                     continue;
-                }
             }
+        }
 
-            // Unoptimized memcpys: assume fields x, y, z are in random order
-            memcpy(&pt[0], &input_->data[xyz_offset[0]], sizeof(float));
-            memcpy(&pt[1], &input_->data[xyz_offset[1]], sizeof(float));
-            memcpy(&pt[2], &input_->data[xyz_offset[2]], sizeof(float));
-
-            // Check if the point is invalid
-            if (!pcl_isfinite(pt[0]) || !pcl_isfinite(pt[1]) ||
-                !pcl_isfinite(pt[2])) {
-                xyz_offset += input_->point_step;
-                continue;
-            }
+        // Unoptimized memcpys: assume fields x, y, z are in random order
+        float pt[3];
+        memcpy(&pt[0], point + xyz_offset[0], sizeof(float));
+        memcpy(&pt[1], point + xyz_offset[1], sizeof(float));
+        memcpy(&pt[2], point + xyz_offset[2], sizeof(float));
 
-            int ijk0 = static_cast<int>(floor(pt[0] * inverse_leaf_size_[0]) -
-                                        min_b_[0]);
-            int ijk1 = static_cast<int>(floor(pt[1] * inverse_leaf_size_[1]) -
-                                        min_b_[1]);
-            int ijk2 = static_cast<int>(floor(pt[2] * inverse_leaf_size_[2]) -
-                                        min_b_[2]);
-            // Compute the centroid leaf index
-            int idx =
-                ijk0 * divb_mul_[0] + ijk1 * divb_mul_[1] + ijk2 * divb_mul_[2];
-            index_vector.push_back(cloud_point_index_idx(idx, cp));
-
-            xyz_offset += input_->point_step;
-        }
-    }
-    // No distance filtering, process all data
-    else {
-        // First pass: go over all points and insert them into the right leaf
-        for (int cp = 0; cp < nr_points; ++cp) {
-            // Unoptimized memcpys: assume fields x, y, z are in random order
-            memcpy(&pt[0], &input_->data[xyz_offset[0]], sizeof(float));
-            memcpy(&pt[1], &input_->data[xyz_offset[1]], sizeof(float));
-            memcpy(&pt[2], &input_->data[xyz_offset[2]], sizeof(float));
-
-            // Check if the point is invalid
-            if (!pcl_isfinite(pt[0]) || !pcl_isfinite(pt[1]) ||
-                !pcl_isfinite(pt[2])) {
-                xyz_offset += input_->point_step;
-                continue;
-            }
+        // Check if the point is invalid
+        if (!pcl_isfinite(pt[0]) || !pcl_isfinite(pt[1]) ||
+            !pcl_isfinite(pt[2]))
+            continue;
 
-            int ijk0 = static_cast<int>(floor(pt[0] * inverse_leaf_size_[0]) -
-                                        min_b_[0]);
-            int ijk1 = static_cast<int>(floor(pt[1] * inverse_leaf_size_[1]) -
-                                        min_b_[1]);
-            int ijk2 = static_cast<int>(floor(pt[2] * inverse_leaf_size_[2]) -
-                                        min_b_[2]);
-            // Compute the centroid leaf index
-            int idx =
-                ijk0 * divb_mul_[0] + ijk1 * divb_mul_[1] + ijk2 * divb_mul_[2];
-            index_vector.push_back(cloud_point_index_idx(idx, cp));
-            xyz_offset += input_->point_step;
-        }
+        int ijk0 = static_cast<int>(floor(pt[0] * inverse_leaf_size_[0]) -
+                                    min_b_[0]);
+        int ijk1 = static_cast<int>(floor(pt[1] * inverse_leaf_size_[1]) -
+                                    min_b_[1]);
+        int ijk2 = static_cast<int>(floor(pt[2] * inverse_leaf_size_[2]) -
+                                    min_b_[2]);
+        // Compute the centroid leaf index
+        index_vector[cp].idx = static_cast<uint64_t>(ijk0) +
+                               static_cast<uint64_t>(ijk1) * mul_y +
+                               static_cast<uint64_t>(ijk2) * mul_z;
     }
 
     // Second pass: sort the index_vector vector using value representing target
     // cell as index in effect all points belonging to the same output cell will
-    // be next to each other
-    std::sort(index_vector.begin(), index_vector.end(),
-              std::less<cloud_point_index_idx>());
-
-    // Third pass: count output cells
-    // we need to skip all the same, adjacenent idx values
-    unsigned int total = 0;
-    unsigned int index = 0;
-    while (index < index_vector.size()) {
-        unsigned int i = index + 1;
-        while (i < index_vector.size() &&
-               index_vector[i].idx == index_vector[index].idx)
-            ++i;
-        ++total;
-        index = i;
-    }
+    // be next to each other. The sort is stable, and drops the discarded
+    // points at the end
+    detail::sortVoxelIndices(index_vector, invalid_idx, threads_);
+    while (!index_vector.empty() && index_vector.back().idx == invalid_idx)
+        index_vector.pop_back();
+
+    // Third pass: find where each output cell starts
+    std::vector<unsigned int> first;
+    detail::findVoxelBoundaries(index_vector, first);
+    const int total = static_cast<int>(first.size()) - 1;
 
     // Fourth pass: compute centroids, insert them into their final position
     output.width = total;
@@ -382,19 +429,15 @@ void pcl::VoxelGrid<sensor_msgs::PointCloud2>::applyFilter(
     output.data.resize(output.width * output.point_step);
 
     if (save_leaf_layout_) {
+        // leaf_layout_ is addressed with (32-bit) division multipliers
+        if (nr_voxels > static_cast<uint64_t>(std::numeric_limits<int>::max()))
+            throw PCLException("VoxelGrid bin size is too low; impossible to "
+                               "allocate memory for layout",
+                               "voxel_grid.cpp", "applyFilter");
         try {
-            // Resizing won't reset old elements to -1.  If leaf_layout_ has
-            // been used previously, it needs to be re-initialized to -1
-            uint32_t new_layout_size = div_b_[0] * div_b_[1] * div_b_[2];
-            // This is the number of elements that need to be re-initialized to
-            // -1
-            uint32_t reinit_size =
-                std::min(static_cast<unsigned int>(new_layout_size),
-                         static_cast<unsigned int>(leaf_layout_.size()));
-            for (uint32_t i = 0; i < reinit_size; i++) {
-                leaf_layout_[i] = -1;
-            }
-            leaf_layout_.resize(new_layout_size, -1);
+            // Resizing won't reset old elements to -1, so reset the whole
+            // layout in case it has been used previously
+            leaf_layout_.assign(static_cast<size_t>(nr_voxels), -1);
         } catch (std::bad_alloc &) {
             throw PCLException("VoxelGrid bin size is too low; impossible to "
                                "allocate memory for layout",
@@ -408,118 +451,88 @@ void pcl::VoxelGrid<sensor_msgs::PointCloud2>::applyFilter(
 
     // If we downsample each field, the {x,y,z}_idx_ offsets should correspond
     // in input_ and output
+    Eigen::Array4i out_xyz_offset;
     if (downsample_all_data_)
-        xyz_offset = Eigen::Array4i(output.fields[x_idx_].offset,
-                                    output.fields[y_idx_].offset,
-                                    output.fields[z_idx_].offset, 0);
+        out_xyz_offset = Eigen::Array4i(output.fields[x_idx_].offset,
+                                        output.fields[y_idx_].offset,
+                                        output.fields[z_idx_].offset, 0);
     else
         // If not, we must have created a new xyzw cloud
-        xyz_offset = Eigen::Array4i(0, 4, 8, 12);
+        out_xyz_offset = Eigen::Array4i(0, 4, 8, 12);
 
-    index = 0;
     Eigen::VectorXf centroid = Eigen::VectorXf::Zero(centroid_size);
     Eigen::VectorXf temporary = Eigen::VectorXf::Zero(centroid_size);
 
-    for (unsigned int cp = 0; cp < index_vector.size();) {
-        int point_offset =
-            index_vector[cp].cloud_point_index * input_->point_step;
-        // Do we need to process all the fields?
-        if (!downsample_all_data_) {
-            memcpy(&pt[0],
-                   &input_->data[point_offset + input_->fields[x_idx_].offset],
-                   sizeof(float));
-            memcpy(&pt[1],
-                   &input_->data[point_offset + input_->fields[y_idx_].offset],
-                   sizeof(float));
-            memcpy(&pt[2],
-                   &input_->data[point_offset + input_->fields[z_idx_].offset],
-                   sizeof(float));
-            centroid[0] = pt[0];
-            centroid[1] = pt[1];
-            centroid[2] = pt[2];
-            centroid[3] = 0;
-        } else {
+    // Every output cell is averaged independently, from its points in input
+    // order
+#pragma omp parallel for shared(output, index_vector, first)                  \
+    firstprivate(centroid, temporary) num_threads(threads_)
+    for (int index = 0; index < total; ++index) {
+        const unsigned int cp = first[index];
+        const unsigned int last = first[index + 1];
+
+        for (unsigned int i = cp; i < last; ++i) {
+            const uint8_t *point =
+                &input_->data[index_vector[i].cloud_point_index *
+                              input_->point_step];
+            // The first point initializes the centroid
+            Eigen::VectorXf &sum = (i == cp) ? centroid : temporary;
+            // Do we need to process all the fields?
+            if (!downsample_all_data_) {
+                float pt[3];
+                memcpy(&pt[0], point + xyz_offset[0], sizeof(float));
+                memcpy(&pt[1], point + xyz_offset[1], sizeof(float));
+                memcpy(&pt[2], point + xyz_offset[2], sizeof(float));
+                if (i == cp) {
+                    centroid[0] = pt[0];
+                    centroid[1] = pt[1];
+                    centroid[2] = pt[2];
+                    centroid[3] = 0;
+                } else {
+                    centroid[0] += pt[0];
+                    centroid[1] += pt[1];
+                    centroid[2] += pt[2];
+                }
+                continue;
+            }
+
             // ---[ RGB special case
             // fill extra r/g/b centroid field
             if (rgba_index >= 0) {
                 pcl::RGB rgb;
-                memcpy(&rgb,
-                       &input_->data[point_offset +
-                                     input_->fields[rgba_index].offset],
+                memcpy(&rgb, point + input_->fields[rgba_index].offset,
                        sizeof(RGB));
-                centroid[centroid_size - 3] = rgb.r;
-                centroid[centroid_size - 2] = rgb.g;
-                centroid[centroid_size - 1] = rgb.b;
+                sum[centroid_size - 3] = rgb.r;
+                sum[centroid_size - 2] = rgb.g;
+                sum[centroid_size - 1] = rgb.b;
             }
             // Copy all the fields
             for (unsigned int d = 0; d < input_->fields.size(); ++d)
-                memcpy(&centroid[d],
-                       &input_->data[point_offset + input_->fields[d].offset],
+                memcpy(&sum[d], point + input_->fields[d].offset,
                        field_sizes_[d]);
-        }
-
-        unsigned int i = cp + 1;
-        while (i < index_vector.size() &&
-               index_vector[i].idx == index_vector[cp].idx) {
-            int point_offset =
-                index_vector[i].cloud_point_index * input_->point_step;
-            if (!downsample_all_data_) {
-                memcpy(
-                    &pt[0],
-                    &input_->data[point_offset + input_->fields[x_idx_].offset],
-                    sizeof(float));
-                memcpy(
-                    &pt[1],
-                    &input_->data[point_offset + input_->fields[y_idx_].offset],
-                    sizeof(float));
-                memcpy(
-                    &pt[2],
-                    &input_->data[point_offset + input_->fields[z_idx_].offset],
-                    sizeof(float));
-                centroid[0] += pt[0];
-                centroid[1] += pt[1];
-                centroid[2] += pt[2];
-            } else {
-                // ---[ RGB special case
-                // fill extra r/g/b centroid field
-                if (rgba_index >= 0) {
-                    pcl::RGB rgb;
-                    memcpy(&rgb,
-                           &input_->data[point_offset +
-                                         input_->fields[rgba_index].offset],
-                           sizeof(RGB));
-                    temporary[centroid_size - 3] = rgb.r;
-                    temporary[centroid_size - 2] = rgb.g;
-                    temporary[centroid_size - 1] = rgb.b;
-                }
-                // Copy all the fields
-                for (unsigned int d = 0; d < input_->fields.size(); ++d)
-                    memcpy(
-                        &temporary[d],
-                        &input_->data[point_offset + input_->fields[d].offset],
-                        field_sizes_[d]);
+            if (i != cp)
                 centroid += temporary;
-            }
-            ++i;
         }
 
         // Save leaf layout information for fast access to cells relative to
         // current position
         if (save_leaf_layout_)
-            leaf_layout_[index_vector[cp].idx] = index;
+            leaf_layout_[static_cast<size_t>(index_vector[cp].idx)] = index;
 
         // Normalize the centroid
-        centroid /= static_cast<float>(i - cp);
+        centroid /= static_cast<float>(last - cp);
 
+        int point_offset = index * output.point_step;
         // Do we need to process all the fields?
         if (!downsample_all_data_) {
             // Copy the data
-            memcpy(&output.data[xyz_offset[0]], &centroid[0], sizeof(float));
-            memcpy(&output.data[xyz_offset[1]], &centroid[1], sizeof(float));
-            memcpy(&output.data[xyz_offset[2]], &centroid[2], sizeof(float));
-            xyz_offset += output.point_step;
+            memcpy(&output.data[point_offset + out_xyz_offset[0]], &centroid[0],
+                   sizeof(float));
+            memcpy(&output.data[point_offset + out_xyz_offset[1]], &centroid[1],
+                   sizeof(float));
+            memcpy(&output.data[point_offset + out_xyz_offset[2]], &centroid[2],
+                   sizeof(float));
         } else {
-            int point_offset = index * output.point_step;
             // Copy all the fields
             for (size_t d = 0; d < output.fields.size(); ++d)
                 memcpy(&output.data[point_offset + output.fields[d].offset],
@@ -538,8 +551,6 @@ void pcl::VoxelGrid<sensor_msgs::PointCloud2>::applyFilter(
                        &rgb, sizeof(float));
             }
         }
-        cp = i;
-        ++index;
     }
 }
 
@@ -0,0 +1,248 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Point Cloud Library (PCL) - www.pointclouds.org
+ *  Copyright (c) 2010-2011, Willow Garage, Inc.
+ *  Copyright (c) 2012-, Open Perception, Inc.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_IO_ASYNC_PCD_WRITER_H_
+#define PCL_IO_ASYNC_PCD_WRITER_H_
+
+#include <deque>
+#include <pcl/point_cloud.h>
+#include <pcl/ros/conversions.h>
+#include <pcl/io/pcd_io.h>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace pcl {
+/** \brief Background PCD writer for recording streams of point clouds.
+ *
+ * write () only copies the cloud into a recycled buffer and queues it; a
+ * pool of writer threads serializes the queued clouds to disk with
+ * PCDWriter. The queue is bounded: when it is full, write () either drops
+ * the frame (DROP_FRAME, the default, which never stalls an acquisition
+ * callback) or waits for a slot (BLOCK). Both cases are accounted for in
+ * the statistics, which tell whether the disk keeps up with the stream.
+ *
+ * Frames are written in the order they were queued, except that a frame is
+ * never written while another frame for the same file name is being
+ * written: it waits for that frame instead, so that two writer threads never
+ * write to the same file at the same time. Frames for different file names
+ * are written in parallel.
+ *
+ * Buffers travel from a free list to the queue and back, so once the
+ * writer has warmed up no memory is allocated per frame (as long as the
+ * clouds do not grow).
+ *
+ * \code
+ * pcl::AsyncPCDWriter writer (64, 2);
+ * // In the grabber callback
+ * writer.write (file_name, *cloud);
+ * // Before exiting
+ * writer.flush ();
+ * \endcode
+ * \ingroup io
+ */
+class PCL_EXPORTS AsyncPCDWriter : boost::noncopyable {
+  public:
+    typedef boost::shared_ptr<AsyncPCDWriter> Ptr;
+    typedef boost::shared_ptr<const AsyncPCDWriter> ConstPtr;
+
+    /** \brief Data format of the written files. */
+    enum Format { ASCII, BINARY, BINARY_COMPRESSED, BINARY_COMPRESSED_CHUNKED };
+
+    /** \brief What write () does when the queue is full. */
+    enum OverflowPolicy { DROP_FRAME, BLOCK };
+
+    /** \brief Counters describing how the writer kept up so far. */
+    struct Statistics {
+        Statistics()
+            : submitted(0), written(0), dropped(0), failed(0), blocked(0),
+              blocked_time(0.0), max_queue_size(0) {}
+        /** \brief Number of calls to write (). */
+        size_t submitted;
+        /** \brief Number of files written successfully. */
+        size_t written;
+        /** \brief Number of frames dropped because the queue was full. */
+        size_t dropped;
+        /** \brief Number of frames that PCDWriter failed to write. */
+        size_t failed;
+        /** \brief Number of calls to write () that had to wait for a slot. */
+        size_t blocked;
+        /** \brief Total time (in seconds) spent waiting for a slot. */
+        double blocked_time;
+        /** \brief Largest number of frames waiting in the queue. */
+        size_t max_queue_size;
+    };
+
+    /** \brief Constructor. Starts the writer threads.
+     * \param[in] queue_size the maximum number of frames waiting to be
+     * written (at least 1)
+     * \param[in] nr_threads the number of writer threads (at least 1)
+     * \param[in] format the format of the written files
+     */
+    AsyncPCDWriter(size_t queue_size = 32, unsigned int nr_threads = 1,
+                   Format format = BINARY_COMPRESSED);
+
+    /** \brief Destructor. Writes all the queued frames and joins the
+     * threads.
+     */
+    ~AsyncPCDWriter();
+
+    /** \brief Set the format of the files written from now on. */
+    void setFormat(Format format);
+
+    /** \brief Get the format of the written files. */
+    Format getFormat() const;
+
+    /** \brief Set what write () does when the queue is full. */
+    void setOverflowPolicy(OverflowPolicy policy);
+
+    /** \brief Get what write () does when the queue is full. */
+    OverflowPolicy getOverflowPolicy() const;
+
+    /** \brief Queue a cloud for writing.
+     * \param[in] file_name the name of the file to write
+     * \param[in] cloud the cloud, copied before returning
+     * \param[in] origin the sensor acquisition origin
+     * \param[in] orientation the sensor acquisition orientation
+     * \return false if the frame was dropped
+     */
+    bool write(const std::string &file_name,
+               const sensor_msgs::PointCloud2 &cloud,
+               const Eigen::Vector4f &origin = Eigen::Vector4f::Zero(),
+               const Eigen::Quaternionf &orientation =
+                   Eigen::Quaternionf::Identity());
+
+    /** \brief Queue a cloud for writing.
+     * \param[in] file_name the name of the file to write
+     * \param[in] cloud the cloud, copied before returning
+     * \return false if the frame was dropped
+     */
+    template <typename PointT>
+    bool write(const std::string &file_name,
+               const pcl::PointCloud<PointT> &cloud) {
+        Job *job = acquire();
+        if (!job)
+            return (false);
+        pcl::toROSMsg(cloud, job->cloud);
+        job->file_name = file_name;
+        job->origin = cloud.sensor_origin_;
+        job->orientation = cloud.sensor_orientation_;
+        enqueue(job);
+        return (true);
+    }
+
+    /** \brief Wait until all the frames accepted by write () have been
+     * written. */
+    void flush();
+
+    /** \brief Get the number of frames waiting in the queue. */
+    size_t getQueueSize() const;
+
+    /** \brief Get a snapshot of the statistics. */
+    Statistics getStatistics() const;
+
+    /** \brief Reset the statistics. */
+    void resetStatistics();
+
+  private:
+    /** \brief One frame to write, recycled between writes. */
+    struct Job {
+        std::string file_name;
+        sensor_msgs::PointCloud2 cloud;
+        Eigen::Vector4f origin;
+        Eigen::Quaternionf orientation;
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    };
+
+    /** \brief Get a free buffer, waiting for a slot in the queue or dropping
+     * the frame depending on the overflow policy.
+     * \return NULL if the frame has to be dropped
+     */
+    Job *acquire();
+
+    /** \brief Queue a filled buffer for the writer threads. */
+    void enqueue(Job *job);
+
+    /** \brief Body of the writer threads. */
+    void run();
+
+    /** \brief Format and overflow policy. */
+    Format format_;
+    OverflowPolicy policy_;
+
+    /** \brief All the buffers, and the ones currently unused. */
+    std::vector<boost::shared_ptr<Job> > jobs_;
+    std::vector<Job *> free_;
+
+    /** \brief Frames waiting to be written. */
+    std::deque<Job *> queue_;
+
+    /** \brief Maximum number of queued frames. */
+    size_t queue_size_;
+
+    /** \brief Number of frames acquired or queued, but not being written yet.
+     */
+    size_t pending_;
+
+    /** \brief Number of frames being written. */
+    size_t in_progress_;
+
+    /** \brief The file names of the frames being written. */
+    std::vector<std::string> files_in_progress_;
+
+    bool stop_;
+    Statistics statistics_;
+
+    mutable boost::mutex mutex_;
+    /** \brief Signaled when a frame is queued or written, or the writer
+     * stops. */
+    boost::condition_variable queue_not_empty_;
+    /** \brief Signaled when a writer thread takes a frame off the queue. */
+    boost::condition_variable slot_available_;
+    /** \brief Signaled when no frame is pending or in progress. */
+    boost::condition_variable idle_;
+
+    boost::thread_group threads_;
+};
+} // namespace pcl
+
+#endif //#ifndef PCL_IO_ASYNC_PCD_WRITER_H_
@@ -40,6 +40,7 @@
 #ifndef PCL_IO_PCD_IO_IMPL_H_
 #define PCL_IO_PCD_IO_IMPL_H_
 
+#include <algorithm>
 #include <fstream>
 #include <fcntl.h>
 #include <string>
@@ -119,6 +120,31 @@ std::string pcl::PCDWriter::generateHeader(const pcl::PointCloud<PointT> &cloud,
     return (oss.str());
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+std::string
+pcl::PCDWriter::generateHeaderZeroCopy(const pcl::PointCloud<PointT> &cloud,
+                                       const int nr_points) {
+    // Describe the memory layout of PointT, and let the binary header fill
+    // the gaps in with padding fields
+    sensor_msgs::PointCloud2 layout;
+    pcl::getFields(cloud, layout.fields);
+    std::sort(layout.fields.begin(), layout.fields.end(),
+              FieldOffsetComparator());
+    layout.point_step = static_cast<uint32_t>(sizeof(PointT));
+    if (nr_points != std::numeric_limits<int>::max()) {
+        layout.width = nr_points;
+        layout.height = 1;
+    } else {
+        layout.width = cloud.width;
+        layout.height = cloud.height;
+    }
+
+    std::string header = generateHeaderBinary(layout, cloud.sensor_origin_,
+                                              cloud.sensor_orientation_);
+    return (header + generateHeaderPadding(header.size() + 12));
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointT>
 int pcl::PCDWriter::writeBinary(const std::string &file_name,
@@ -130,7 +156,11 @@ int pcl::PCDWriter::writeBinary(const std::string &file_name,
     }
     int data_idx = 0;
     std::ostringstream oss;
-    oss << generateHeader<PointT>(cloud) << "DATA binary\n";
+    if (zero_copy_layout_)
+        oss << generateHeaderZeroCopy<PointT>(cloud);
+    else
+        oss << generateHeader<PointT>(cloud);
+    oss << "DATA binary\n";
     oss.flush();
     data_idx = static_cast<int>(oss.tellp());
 
@@ -174,6 +204,9 @@ int pcl::PCDWriter::writeBinary(const std::string &file_name,
     }
     fields.resize(nri);
 
+    // The zero copy layout keeps the padding of PointT
+    if (zero_copy_layout_)
+        fsize = sizeof(PointT);
     data_size = cloud.points.size() * fsize;
 
     // Prepare the map
@@ -222,14 +255,18 @@ int pcl::PCDWriter::writeBinary(const std::string &file_name,
 
     // Copy the data
     char *out = &map[0] + data_idx;
-    for (size_t i = 0; i < cloud.points.size(); ++i) {
-        int nrj = 0;
-        for (size_t j = 0; j < fields.size(); ++j) {
-            memcpy(out,
-                   reinterpret_cast<const char *>(&cloud.points[i]) +
-                       fields[j].offset,
-                   fields_sizes[nrj]);
-            out += fields_sizes[nrj++];
+    if (zero_copy_layout_)
+        memcpy(out, &cloud.points[0], data_size);
+    else {
+        for (size_t i = 0; i < cloud.points.size(); ++i) {
+            int nrj = 0;
+            for (size_t j = 0; j < fields.size(); ++j) {
+                memcpy(out,
+                       reinterpret_cast<const char *>(&cloud.points[i]) +
+                           fields[j].offset,
+                       fields_sizes[nrj]);
+                out += fields_sizes[nrj++];
+            }
         }
     }
 
@@ -649,8 +686,12 @@ int pcl::PCDWriter::writeBinary(const std::string &file_name,
     }
     int data_idx = 0;
     std::ostringstream oss;
-    oss << generateHeader<PointT>(cloud, static_cast<int>(indices.size()))
-        << "DATA binary\n";
+    if (zero_copy_layout_)
+        oss << generateHeaderZeroCopy<PointT>(
+            cloud, static_cast<int>(indices.size()));
+    else
+        oss << generateHeader<PointT>(cloud, static_cast<int>(indices.size()));
+    oss << "DATA binary\n";
     oss.flush();
     data_idx = static_cast<int>(oss.tellp());
 
@@ -694,6 +735,9 @@ int pcl::PCDWriter::writeBinary(const std::string &file_name,
     }
     fields.resize(nri);
 
+    // The zero copy layout keeps the padding of PointT
+    if (zero_copy_layout_)
+        fsize = sizeof(PointT);
     data_size = indices.size() * fsize;
 
     // Prepare the map
@@ -742,14 +786,20 @@ int pcl::PCDWriter::writeBinary(const std::string &file_name,
 
     char *out = &map[0] + data_idx;
     // Copy the data
-    for (size_t i = 0; i < indices.size(); ++i) {
-        int nrj = 0;
-        for (size_t j = 0; j < fields.size(); ++j) {
-            memcpy(out,
-                   reinterpret_cast<const char *>(&cloud.points[indices[i]]) +
-                       fields[j].offset,
-                   fields_sizes[nrj]);
-            out += fields_sizes[nrj++];
+    if (zero_copy_layout_) {
+        for (size_t i = 0; i < indices.size(); ++i, out += sizeof(PointT))
+            memcpy(out, &cloud.points[indices[i]], sizeof(PointT));
+    } else {
+        for (size_t i = 0; i < indices.size(); ++i) {
+            int nrj = 0;
+            for (size_t j = 0; j < fields.size(); ++j) {
+                memcpy(out,
+                       reinterpret_cast<const char *>(
+                           &cloud.points[indices[i]]) +
+                           fields[j].offset,
+                       fields_sizes[nrj]);
+                out += fields_sizes[nrj++];
+            }
         }
     }
 
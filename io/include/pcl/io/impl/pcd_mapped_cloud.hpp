@@ -0,0 +1,235 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Point Cloud Library (PCL) - www.pointclouds.org
+ *  Copyright (c) 2010-2011, Willow Garage, Inc.
+ *  Copyright (c) 2012-, Open Perception, Inc.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_IO_IMPL_PCD_MAPPED_CLOUD_HPP_
+#define PCL_IO_IMPL_PCD_MAPPED_CLOUD_HPP_
+
+#include <pcl/io/pcd_mapped_cloud.h>
+#include <boost/mpl/size.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+
+namespace pcl {
+namespace detail {
+/** \brief Count the fields of PointT that have a matching serialized field. */
+template <typename PointT> struct MatchingFieldCounter {
+    MatchingFieldCounter(const std::vector<sensor_msgs::PointField> &fields,
+                         size_t &count)
+        : fields_(fields), count_(count) {}
+
+    template <typename Tag> void operator()() {
+        for (size_t i = 0; i < fields_.size(); ++i) {
+            if (FieldMatches<PointT, Tag>()(fields_[i])) {
+                ++count_;
+                return;
+            }
+        }
+    }
+
+    const std::vector<sensor_msgs::PointField> &fields_;
+    size_t &count_;
+};
+} // namespace detail
+} // namespace pcl
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+int pcl::PCDMappedCloud<PointT>::open(const std::string &file_name,
+                                      const int offset) {
+    close();
+
+    sensor_msgs::PointCloud2 header;
+    int pcd_version, data_type;
+    unsigned int data_idx;
+    pcl::PCDReader reader;
+    if (reader.parseHeader(file_name, header, sensor_origin_,
+                           sensor_orientation_, pcd_version, data_type,
+                           data_idx, offset) < 0)
+        return (-1);
+
+    if (data_type != 1) {
+        PCL_ERROR("[pcl::PCDMappedCloud::open] Only binary PCD files can be "
+                  "mapped (%s)!\n",
+                  file_name.c_str());
+        return (-1);
+    }
+
+    size_t file_size =
+        static_cast<size_t>(boost::filesystem::file_size(file_name));
+    size_t data_size =
+        static_cast<size_t>(header.width) * header.height * header.point_step;
+    if (data_idx + data_size > file_size) {
+        PCL_ERROR("[pcl::PCDMappedCloud::open] File %s is smaller than "
+                  "advertised by its header!\n",
+                  file_name.c_str());
+        return (-1);
+    }
+
+    // pcl_open/pcl_close would resolve to the open ()/close () members here
+#ifdef _WIN32
+    int fd = ::_open(file_name.c_str(), O_RDONLY);
+#else
+    int fd = ::open(file_name.c_str(), O_RDONLY);
+#endif
+    if (fd == -1) {
+        PCL_ERROR("[pcl::PCDMappedCloud::open] Failure to open file %s\n",
+                  file_name.c_str());
+        return (-1);
+    }
+#ifdef _WIN32
+    file_mapping_ = CreateFileMapping((HANDLE)_get_osfhandle(fd), NULL,
+                                      PAGE_READONLY, 0, 0, NULL);
+    char *map = static_cast<char *>(
+        MapViewOfFile(file_mapping_, FILE_MAP_READ, 0, 0, 0));
+    ::_close(fd);
+    if (map == NULL) {
+        CloseHandle(file_mapping_);
+        file_mapping_ = NULL;
+        PCL_ERROR("[pcl::PCDMappedCloud::open] Error mapping view of file, "
+                  "%s\n",
+                  file_name.c_str());
+        return (-1);
+    }
+#else
+    char *map =
+        static_cast<char *>(mmap(0, file_size, PROT_READ, MAP_SHARED, fd, 0));
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if (map == reinterpret_cast<char *>(-1)) // MAP_FAILED
+    {
+        PCL_ERROR("[pcl::PCDMappedCloud::open] Error preparing mmap for binary "
+                  "PCD file %s.\n",
+                  file_name.c_str());
+        return (-1);
+    }
+#endif
+
+    map_ = map;
+    map_size_ = file_size;
+    data_ = reinterpret_cast<const uint8_t *>(map_ + data_idx);
+    width_ = header.width;
+    height_ = header.height;
+    point_step_ = header.point_step;
+    fields_ = header.fields;
+
+    // The mapped points can be used in place if every field of PointT is
+    // stored at its in-memory offset, with no gaps in between, and if the data
+    // section honours the alignment of PointT
+    field_map_.clear();
+    createMapping<PointT>(fields_, field_map_);
+    size_t nr_matching = 0;
+    detail::MatchingFieldCounter<PointT> counter(fields_, nr_matching);
+    for_each_type<typename traits::fieldList<PointT>::type>(counter);
+
+    zero_copy_ =
+        nr_matching == static_cast<size_t>(boost::mpl::size<
+                           typename traits::fieldList<PointT>::type>::value) &&
+        field_map_.size() == 1 && field_map_[0].serialized_offset == 0 &&
+        field_map_[0].struct_offset == 0 && point_step_ == sizeof(PointT) &&
+        reinterpret_cast<size_t>(data_) % boost::alignment_of<PointT>::value ==
+            0;
+    return (0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> void pcl::PCDMappedCloud<PointT>::close() {
+    if (map_ == NULL)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(map_);
+    CloseHandle(file_mapping_);
+    file_mapping_ = NULL;
+#else
+    munmap(map_, map_size_);
+#endif
+    map_ = NULL;
+    map_size_ = 0;
+    data_ = NULL;
+    width_ = height_ = point_step_ = 0;
+    zero_copy_ = false;
+    fields_.clear();
+    field_map_.clear();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::PCDMappedCloud<PointT>::copyTo(pcl::PointCloud<PointT> &cloud) const {
+    cloud.width = width_;
+    cloud.height = height_;
+    cloud.sensor_origin_ = sensor_origin_;
+    cloud.sensor_orientation_ = sensor_orientation_;
+    cloud.points.resize(size());
+    if (zero_copy_) {
+        if (!empty())
+            memcpy(&cloud.points[0], data_, size() * sizeof(PointT));
+    } else {
+        for (size_t i = 0; i < size(); ++i)
+            at(i, cloud.points[i]);
+    }
+
+    // Check the floating point fields for NaN/Inf values
+    cloud.is_dense = true;
+    for (size_t d = 0; d < fields_.size() && cloud.is_dense; ++d) {
+        const sensor_msgs::PointField &field = fields_[d];
+        if (field.datatype != sensor_msgs::PointField::FLOAT32 &&
+            field.datatype != sensor_msgs::PointField::FLOAT64)
+            continue;
+        for (size_t i = 0; i < size() && cloud.is_dense; ++i) {
+            const uint8_t *src = getPointData(i) + field.offset;
+            for (uint32_t c = 0; c < field.count; ++c) {
+                bool finite;
+                if (field.datatype == sensor_msgs::PointField::FLOAT32) {
+                    float value;
+                    memcpy(&value, src + c * sizeof(float), sizeof(float));
+                    finite = pcl_isfinite(value);
+                } else {
+                    double value;
+                    memcpy(&value, src + c * sizeof(double), sizeof(double));
+                    finite = pcl_isfinite(value);
+                }
+                if (!finite) {
+                    cloud.is_dense = false;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+#endif //#ifndef PCL_IO_IMPL_PCD_MAPPED_CLOUD_HPP_
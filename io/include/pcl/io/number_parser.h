@@ -0,0 +1,366 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Point Cloud Library (PCL) - www.pointclouds.org
+ *  Copyright (c) 2010-2011, Willow Garage, Inc.
+ *  Copyright (c) 2012-, Open Perception, Inc.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_IO_NUMBER_PARSER_H_
+#define PCL_IO_NUMBER_PARSER_H_
+
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <pcl/pcl_macros.h>
+#include <pcl/common/io.h>
+#include <sensor_msgs/PointCloud2.h>
+
+namespace pcl {
+namespace io {
+/** \brief Check whether c separates two values of an ascii file. */
+inline bool isBlank(char c) { return (c == ' ' || c == '\t' || c == '\r'); }
+
+/** \brief Advance p over blanks (spaces, tabs, carriage returns), without
+ * going past end.
+ */
+inline void skipBlanks(const char *&p, const char *end) {
+    while (p < end && isBlank(*p))
+        ++p;
+}
+
+/** \brief Advance p to the first blank or newline, without going past end. */
+inline void skipToken(const char *&p, const char *end) {
+    while (p < end && !isBlank(*p) && *p != '\n')
+        ++p;
+}
+
+namespace detail {
+/** \brief Exact powers of ten as doubles (10^22 is the largest one). */
+inline const double *getPowersOfTen() {
+    static const double powers[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    return (powers);
+}
+
+/** \brief Case insensitive comparison of [p, end) against the lower case
+ * keyword word.
+ */
+inline bool matchKeyword(const char *p, const char *end, const char *word) {
+    for (; *word; ++p, ++word)
+        if (p == end || (*p | 0x20) != *word)
+            return (false);
+    return (true);
+}
+
+/** \brief Slow path: convert [begin, end) with a classic locale stream. */
+template <typename T>
+inline bool parseWithStream(const char *begin, const char *end, T &value) {
+    std::istringstream is(std::string(begin, end));
+    is.imbue(std::locale::classic());
+    is >> value;
+    return (!is.fail());
+}
+
+/** \brief Parse a floating point number in the C locale, advancing p past
+ * it.
+ *
+ * Numbers whose decimal significand fits in 53 bits and whose exponent is
+ * within [-22, 22] (the vast majority of what ascii writers produce) are
+ * correctly rounded by a single multiplication or division of exact
+ * operands. Anything else falls back to a stream based conversion.
+ *
+ * Floats are computed in single precision when both operands are exact
+ * floats. Otherwise the correctly rounded double is narrowed to a float,
+ * which can only round differently from a direct conversion when that
+ * double lies exactly halfway between two floats: these values, and the
+ * ones out of the range of normal floats, go through the stream (strtof).
+ */
+template <typename T> inline bool parseReal(const char *&p, const char *end,
+                                            T &value) {
+    const char *begin = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = (*p++ == '-');
+
+    if (p < end && ((*p | 0x20) == 'n' || (*p | 0x20) == 'i')) {
+        if (matchKeyword(p, end, "nan")) {
+            value = std::numeric_limits<T>::quiet_NaN();
+            p += 3;
+        } else if (matchKeyword(p, end, "inf")) {
+            value = std::numeric_limits<T>::infinity();
+            p += matchKeyword(p, end, "infinity") ? 8 : 3;
+        } else
+            return (false);
+        if (negative)
+            value = -value;
+        return (true);
+    }
+
+    pcl::uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool any = false, truncated = false;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+        any = true;
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        } else {
+            ++exponent;
+            truncated |= *p != '0';
+        }
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && *p >= '0' && *p <= '9'; ++p) {
+            any = true;
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                --exponent;
+            } else
+                truncated |= *p != '0';
+        }
+    }
+    if (!any)
+        return (false);
+
+    if (p < end && (*p | 0x20) == 'e') {
+        const char *e = p + 1;
+        bool negative_exponent = false;
+        if (e < end && (*e == '-' || *e == '+'))
+            negative_exponent = (*e++ == '-');
+        if (e == end || *e < '0' || *e > '9')
+            return (false);
+        int exp = 0;
+        for (; e < end && *e >= '0' && *e <= '9'; ++e)
+            if (exp < 100000)
+                exp = exp * 10 + (*e - '0');
+        exponent += negative_exponent ? -exp : exp;
+        p = e;
+    }
+
+    if (truncated || mantissa > (static_cast<pcl::uint64_t>(1) << 53) ||
+        exponent < -22 || exponent > 22)
+        return (parseWithStream(begin, p, value));
+
+    // Same for single precision, when both operands are exact floats
+    if (sizeof(T) == sizeof(float) &&
+        mantissa <= (static_cast<pcl::uint64_t>(1) << 24) && exponent >= -10 &&
+        exponent <= 10) {
+        float result = static_cast<float>(mantissa);
+        float power = static_cast<float>(getPowersOfTen()[std::abs(exponent)]);
+        result = exponent < 0 ? result / power : result * power;
+        value = static_cast<T>(negative ? -result : result);
+        return (true);
+    }
+
+    double result = static_cast<double>(mantissa);
+    if (exponent < 0)
+        result /= getPowersOfTen()[-exponent];
+    else
+        result *= getPowersOfTen()[exponent];
+
+    if (sizeof(T) == sizeof(float) && result != 0.0) {
+        // The 29 low significand bits of a double halfway between two
+        // normal floats are 1 followed by zeros
+        pcl::uint64_t bits;
+        memcpy(&bits, &result, sizeof(bits));
+        const pcl::uint64_t half = static_cast<pcl::uint64_t>(1) << 28;
+        if ((bits & (2 * half - 1)) == half ||
+            result < std::numeric_limits<float>::min() ||
+            result > std::numeric_limits<float>::max())
+            return (parseWithStream(begin, p, value));
+    }
+    value = static_cast<T>(negative ? -result : result);
+    return (true);
+}
+
+/** \brief Parse a (possibly signed) decimal integer, advancing p past it.
+ * Values which do not fit in T are rejected, like a stream extraction would.
+ */
+template <typename T> inline bool parseInteger(const char *&p, const char *end,
+                                               T &value) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = (*p++ == '-');
+    if (p == end || *p < '0' || *p > '9')
+        return (false);
+    // The magnitude of the smallest value is max () + 1 for signed types
+    const pcl::uint64_t limit =
+        !negative ? static_cast<pcl::uint64_t>(std::numeric_limits<T>::max())
+        : std::numeric_limits<T>::is_signed
+            ? static_cast<pcl::uint64_t>(std::numeric_limits<T>::max()) + 1
+            : 0;
+    pcl::uint64_t result = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+        const pcl::uint64_t digit = *p - '0';
+        if (digit > limit || result > (limit - digit) / 10)
+            return (false);
+        result = result * 10 + digit;
+    }
+    value = static_cast<T>(negative ? (0 - result) : result);
+    return (true);
+}
+
+/** \brief Check whether a parsed value is NaN; integers never are. */
+template <typename T> inline bool isNaN(T) { return (false); }
+
+template <> inline bool isNaN<float>(float value) {
+    return (pcl_isnan(value));
+}
+
+template <> inline bool isNaN<double>(double value) {
+    return (pcl_isnan(value));
+}
+} // namespace detail
+
+/** \brief Locale independent, allocation free conversion of the number
+ * starting at p.
+ *
+ * On success p is advanced to the first character following the number.
+ * The character at p is not checked: the caller decides whether the number
+ * has to be followed by a blank. 8 bit types are read as numbers, not as
+ * characters.
+ *
+ * \param[in,out] p the position of the number; moved past it on success
+ * \param[in] end the end of the buffer
+ * \param[out] value the converted value
+ * \return false if no number could be read at p
+ */
+template <typename T>
+inline bool parseNumber(const char *&p, const char *end, T &value) {
+    return (detail::parseInteger(p, end, value));
+}
+
+template <>
+inline bool parseNumber<float>(const char *&p, const char *end, float &value) {
+    return (detail::parseReal(p, end, value));
+}
+
+template <>
+inline bool parseNumber<double>(const char *&p, const char *end,
+                                double &value) {
+    return (detail::parseReal(p, end, value));
+}
+
+/** \brief Convert the ascii value at p to T and store it at out. "nan"
+ * tokens are accepted for every type, and clear is_dense.
+ */
+template <typename T>
+inline bool parseASCIIValue(const char *&p, const char *end, pcl::uint8_t *out,
+                            bool &is_dense) {
+    T value;
+    if (detail::matchKeyword(p, end, "nan")) {
+        value = std::numeric_limits<T>::quiet_NaN();
+        is_dense = false;
+    } else if (!parseNumber(p, end, value))
+        return (false);
+    else if (detail::isNaN(value))
+        is_dense = false;
+    // Ignore trailing garbage, like a stream extraction would
+    skipToken(p, end);
+    memcpy(out, &value, sizeof(T));
+    return (true);
+}
+
+/** \brief Parse one ascii point (the line [p, end)) into point, following
+ * the fields of cloud.
+ * \return false if a value is missing or invalid
+ */
+inline bool parseASCIIPoint(const char *p, const char *end,
+                            const sensor_msgs::PointCloud2 &cloud,
+                            pcl::uint8_t *point, bool &is_dense) {
+    for (size_t d = 0; d < cloud.fields.size(); ++d) {
+        const sensor_msgs::PointField &field = cloud.fields[d];
+        int size = pcl::getFieldSize(field.datatype);
+        for (unsigned int c = 0; c < field.count; ++c) {
+            skipBlanks(p, end);
+            if (p == end)
+                return (false);
+            // Ignore invalid padded dimensions that are inherited from
+            // binary data
+            if (field.name == "_") {
+                skipToken(p, end);
+                continue;
+            }
+            pcl::uint8_t *out = point + field.offset + c * size;
+            bool ok = false;
+            switch (field.datatype) {
+            case sensor_msgs::PointField::INT8:
+                ok = parseASCIIValue<pcl::int8_t>(p, end, out, is_dense);
+                break;
+            case sensor_msgs::PointField::UINT8:
+                ok = parseASCIIValue<pcl::uint8_t>(p, end, out, is_dense);
+                break;
+            case sensor_msgs::PointField::INT16:
+                ok = parseASCIIValue<pcl::int16_t>(p, end, out, is_dense);
+                break;
+            case sensor_msgs::PointField::UINT16:
+                ok = parseASCIIValue<pcl::uint16_t>(p, end, out, is_dense);
+                break;
+            case sensor_msgs::PointField::INT32:
+                ok = parseASCIIValue<pcl::int32_t>(p, end, out, is_dense);
+                break;
+            case sensor_msgs::PointField::UINT32:
+                ok = parseASCIIValue<pcl::uint32_t>(p, end, out, is_dense);
+                break;
+            case sensor_msgs::PointField::FLOAT32:
+                ok = parseASCIIValue<float>(p, end, out, is_dense);
+                break;
+            case sensor_msgs::PointField::FLOAT64:
+                ok = parseASCIIValue<double>(p, end, out, is_dense);
+                break;
+            default:
+                PCL_WARN("[pcl::io::parseASCIIPoint] Incorrect field data "
+                         "type specified (%d)!\n",
+                         field.datatype);
+                skipToken(p, end);
+                ok = true;
+                break;
+            }
+            if (!ok)
+                return (false);
+        }
+    }
+    return (true);
+}
+} // namespace io
+} // namespace pcl
+
+#endif //#ifndef PCL_IO_NUMBER_PARSER_H_
@@ -44,6 +44,9 @@
 #include <pcl/io/file_io.h>
 
 namespace pcl {
+template <typename PointT> class PCDMappedCloud;
+class PCDStreamReader;
+
 /** \brief Point Cloud Data (PCD) file format reader.
  * \author Radu Bogdan Rusu
  * \ingroup io
@@ -51,7 +54,7 @@ namespace pcl {
 class PCL_EXPORTS PCDReader : public FileReader {
   public:
     /** Empty constructor */
-    PCDReader() : FileReader() {}
+    PCDReader() : FileReader(), threads_(1) {}
     /** Empty destructor */
     ~PCDReader() {}
     /** \brief Various PCD file versions.
@@ -66,11 +69,21 @@ class PCL_EXPORTS PCDReader : public FileReader {
      *   - WIDTH ...
      *   - HEIGHT ...
      *   - POINTS ...
-     *   - DATA ascii/binary
+     *   - DATA ascii/binary/binary_compressed/binary_compressed_chunked
      *
      * Everything that follows \b DATA is intepreted as data points and
      * will be read accordingly.
      *
+     * binary_compressed_chunked stores every field column split into blocks
+     * of a fixed number of points, each block being LZF compressed on its
+     * own. The data section starts with a small block table:
+     *   - uint32 points per chunk, uint32 number of chunks, uint32 number of
+     *     fields
+     *   - for every field and every chunk (field major): uint64 offset of
+     *     the block relative to the end of the table, uint32 stored size,
+     *     uint32 uncompressed size. A block whose stored size equals its
+     *     uncompressed size was not compressible and is stored verbatim.
+     *
      * PCD_V7 represents PCD files with version 0.7 and has an important
      * addon: it adds sensor origin/orientation (aka viewpoint) information
      * to a dataset through the use of a new header field:
@@ -78,6 +91,16 @@ class PCL_EXPORTS PCDReader : public FileReader {
      */
     enum { PCD_V6 = 0, PCD_V7 = 1 };
 
+    /** \brief Set the number of threads used to parse ascii data and to
+     * decompress binary_compressed_chunked data. Files are read on a single
+     * thread by default.
+     * \param[in] nr_threads the number of hardware threads to use (0 sets the
+     * value to automatic)
+     */
+    inline void setNumberOfThreads(unsigned int nr_threads = 0) {
+        threads_ = nr_threads;
+    }
+
     /** \brief Read a point cloud data header from a PCD file.
      *
      * Load only the meta information (number of points, their types, etc),
@@ -95,9 +118,10 @@ class PCL_EXPORTS PCDReader : public FileReader {
      * acquisition orientation (only for > PCD_V7 - identity if not present)
      * \param[out] pcd_version the PCD version of the file (i.e., PCD_V6,
      * PCD_V7) \param[out] data_type the type of data (0 = ASCII, 1 = Binary, 2
-     * = Binary compressed) \param[out] data_idx the offset of cloud data within
-     * the file \param[in] offset the offset of where to expect the PCD Header
-     * in the file (optional parameter). One usage example for setting the
+     * = Binary compressed, 3 = Binary compressed chunked) \param[out]
+     * data_idx the offset of cloud data within the file \param[in] offset
+     * the offset of where to expect the PCD Header in the file (optional
+     * parameter). One usage example for setting the
      * offset parameter is for reading data from a TAR "archive containing
      * multiple PCD files: TAR files always add a 512 byte header in front of
      * the actual file, so set the offset to the next byte after the header
@@ -267,7 +291,63 @@ class PCL_EXPORTS PCDReader : public FileReader {
                   pcl::PointCloud<Eigen::MatrixXf> &cloud,
                   const int offset = 0);
 
+    /** \brief Read a subset of the fields and of the points of a PCD file
+     * and store it into a sensor_msgs/PointCloud2.
+     *
+     * For binary_compressed_chunked files only the blocks that overlap the
+     * requested fields and point range are decompressed. All other formats
+     * are read completely and the requested subset is copied afterwards.
+     *
+     * \param[in] file_name the name of the file containing the actual
+     * PointCloud data
+     * \param[out] cloud the resultant unorganized PointCloud message, holding
+     * only the requested fields (packed, in file order)
+     * \param[in] field_names the names of the fields to read (empty means all)
+     * \param[in] first_point the index of the first point to read
+     * \param[in] nr_points the number of points to read (clamped to the
+     * number of points available in the file)
+     * \param[in] offset the offset of where to expect the PCD Header in the
+     * file (optional parameter)
+     *
+     * \return
+     *  * < 0 (-1) on error
+     *  * == 0 on success
+     */
+    int readSubset(const std::string &file_name,
+                   sensor_msgs::PointCloud2 &cloud,
+                   const std::vector<std::string> &field_names,
+                   unsigned int first_point, unsigned int nr_points,
+                   const int offset = 0);
+
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  protected:
+    /** \brief Parse the header of a PCD file, same as readHeader (), but
+     * without allocating cloud.data for the points that follow it.
+     * \param[in] file_name the name of the file to load
+     * \param[out] cloud the resultant point cloud dataset (only the header
+     * will be filled, cloud.data is left empty)
+     * \param[out] origin the sensor acquisition origin
+     * \param[out] orientation the sensor acquisition orientation
+     * \param[out] pcd_version the PCD version of the file
+     * \param[out] data_type the type of data (0 = ASCII, 1 = Binary, 2 =
+     * Binary compressed, 3 = Binary compressed chunked)
+     * \param[out] data_idx the offset of cloud data within the file
+     * \param[in] offset the offset of where to expect the PCD Header in the
+     * file
+     */
+    int parseHeader(const std::string &file_name,
+                    sensor_msgs::PointCloud2 &cloud, Eigen::Vector4f &origin,
+                    Eigen::Quaternionf &orientation, int &pcd_version,
+                    int &data_type, unsigned int &data_idx,
+                    const int offset = 0);
+
+    template <typename PointT> friend class PCDMappedCloud;
+    friend class PCDStreamReader;
+
+  private:
+    /** \brief The number of threads used for parsing and decompression. */
+    unsigned int threads_;
 };
 
 /** \brief Point Cloud Data (PCD) file format writer.
@@ -276,7 +356,9 @@ class PCL_EXPORTS PCDReader : public FileReader {
  */
 class PCL_EXPORTS PCDWriter : public FileWriter {
   public:
-    PCDWriter() : FileWriter(), map_synchronization_(false) {}
+    PCDWriter()
+        : FileWriter(), map_synchronization_(false), zero_copy_layout_(false),
+          chunk_size_(1 << 20), threads_(0) {}
     ~PCDWriter() {}
 
     /** \brief Set whether mmap() synchornization via msync() is desired before
@@ -290,6 +372,53 @@ class PCL_EXPORTS PCDWriter : public FileWriter {
      */
     void setMapSynchronization(bool sync) { map_synchronization_ = sync; }
 
+    /** \brief Set whether the binary writers should lay the data out for
+     * PCDMappedCloud. The header is then padded with a comment line so that
+     * the data section starts at a multiple of 16 bytes, and
+     * writeBinary<PointT> stores the points with the memory layout of PointT
+     * (padding included) instead of packing their fields. Such files can be
+     * used in place, without copying a point. Default: false
+     * \param[in] zero_copy set to true to write zero copy mappable files
+     */
+    void setZeroCopyLayout(bool zero_copy) { zero_copy_layout_ = zero_copy; }
+
+    /** \brief Get whether the binary writers lay the data out for
+     * PCDMappedCloud. */
+    bool getZeroCopyLayout() const { return (zero_copy_layout_); }
+
+    /** \brief Set the number of points stored in each independently
+     * compressed block of a binary_compressed_chunked PCD file. Smaller
+     * chunks give finer random access and more parallelism, at the cost of a
+     * slightly worse compression ratio. Default: 1048576 (2^20)
+     * \param[in] chunk_size the number of points per block
+     */
+    void setChunkSize(unsigned int chunk_size) {
+        chunk_size_ = chunk_size > 0 ? chunk_size : 1;
+    }
+
+    /** \brief Get the number of points stored in each block of a
+     * binary_compressed_chunked PCD file. */
+    unsigned int getChunkSize() const { return (chunk_size_); }
+
+    /** \brief Set the number of threads used to compress
+     * binary_compressed_chunked data.
+     * \param[in] nr_threads the number of hardware threads to use (0 sets the
+     * value back to automatic)
+     */
+    void setNumberOfThreads(unsigned int nr_threads = 0) {
+        threads_ = nr_threads;
+    }
+
+    /** \brief Generate a comment line to be inserted right before the DATA
+     * line of a binary PCD header, so that the binary data following the
+     * header starts at a multiple of 16 bytes. This allows PCDMappedCloud to
+     * use the mapped points in place for SSE aligned point types. Only used
+     * when the zero copy layout is enabled (see setZeroCopyLayout).
+     * \param[in] header_size the size of the header in bytes, including the
+     * DATA line
+     */
+    static std::string generateHeaderPadding(size_t header_size);
+
     /** \brief Generate the header of a PCD file format
      * \param[in] cloud the point cloud data message
      * \param[in] origin the sensor acquisition origin
@@ -329,6 +458,19 @@ class PCL_EXPORTS PCDWriter : public FileWriter {
     generateHeader(const pcl::PointCloud<PointT> &cloud,
                    const int nr_points = std::numeric_limits<int>::max());
 
+    /** \brief Generate the header of a binary PCD file storing the points
+     * with the memory layout of PointT: the gaps between the fields are
+     * described by "_" padding fields, and the header ends with the padding
+     * line that aligns the data section (see generateHeaderPadding).
+     * \param[in] cloud the point cloud data message
+     * \param[in] nr_points if given, use this to fill in WIDTH, HEIGHT (=1),
+     * and POINTS in the header
+     */
+    template <typename PointT>
+    std::string generateHeaderZeroCopy(
+        const pcl::PointCloud<PointT> &cloud,
+        const int nr_points = std::numeric_limits<int>::max());
+
     /** \brief Generate the header of a PCD file format
      * \note This version is specialized for PointCloud<Eigen::MatrixXf> data
      * types. \attention The PCD data is \b always stored in ROW major format!
@@ -388,6 +530,19 @@ class PCL_EXPORTS PCDWriter : public FileWriter {
         const Eigen::Vector4f &origin = Eigen::Vector4f::Zero(),
         const Eigen::Quaternionf &orientation = Eigen::Quaternionf::Identity());
 
+    /** \brief Save point cloud data to a PCD file containing n-D points, in
+     * BINARY_COMPRESSED_CHUNKED format. Every field is split into blocks of
+     * getChunkSize () points which are compressed in parallel.
+     * \param[in] file_name the output file name
+     * \param[in] cloud the point cloud data message
+     * \param[in] origin the sensor acquisition origin
+     * \param[in] orientation the sensor acquisition orientation
+     */
+    int writeBinaryCompressedChunked(
+        const std::string &file_name, const sensor_msgs::PointCloud2 &cloud,
+        const Eigen::Vector4f &origin = Eigen::Vector4f::Zero(),
+        const Eigen::Quaternionf &orientation = Eigen::Quaternionf::Identity());
+
     /** \brief Save point cloud data to a PCD file containing n-D points
      * \param[in] file_name the output file name
      * \param[in] cloud the point cloud data message
@@ -482,6 +637,21 @@ class PCL_EXPORTS PCDWriter : public FileWriter {
     writeBinaryCompressedEigen(const std::string &file_name,
                                const pcl::PointCloud<Eigen::MatrixXf> &cloud);
 
+    /** \brief Save point cloud data to a binary compressed chunked PCD file
+     * \param[in] file_name the output file name
+     * \param[in] cloud the point cloud data
+     */
+    template <typename PointT>
+    inline int
+    writeBinaryCompressedChunked(const std::string &file_name,
+                                 const pcl::PointCloud<PointT> &cloud) {
+        sensor_msgs::PointCloud2 blob;
+        pcl::toROSMsg(cloud, blob);
+        return (writeBinaryCompressedChunked(file_name, blob,
+                                             cloud.sensor_origin_,
+                                             cloud.sensor_orientation_));
+    }
+
     /** \brief Save point cloud data to a PCD file containing n-D points, in
      * BINARY format \param[in] file_name the output file name \param[in] cloud
      * the point cloud data message \param[in] indices the set of point indices
@@ -595,6 +765,17 @@ class PCL_EXPORTS PCDWriter : public FileWriter {
      * data loss on NFS systems. */
     bool map_synchronization_;
 
+    /** \brief Set to true if the binary files should be mappable in place by
+     * PCDMappedCloud. */
+    bool zero_copy_layout_;
+
+    /** \brief Number of points per block in binary_compressed_chunked files.
+     */
+    unsigned int chunk_size_;
+
+    /** \brief The number of threads used for compression. */
+    unsigned int threads_;
+
     typedef std::pair<std::string, pcl::ChannelProperties>
         pair_channel_properties;
     /** \brief Internal structure used to sort the ChannelProperties in the
@@ -606,6 +787,16 @@ class PCL_EXPORTS PCDWriter : public FileWriter {
             return (lhs.second.offset < rhs.second.offset);
         }
     };
+
+    /** \brief Internal structure used to sort the fields of a point type
+     * based on their offset.
+     */
+    struct FieldOffsetComparator {
+        bool operator()(const sensor_msgs::PointField &lhs,
+                        const sensor_msgs::PointField &rhs) {
+            return (lhs.offset < rhs.offset);
+        }
+    };
 };
 
 namespace io {
@@ -0,0 +1,241 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Point Cloud Library (PCL) - www.pointclouds.org
+ *  Copyright (c) 2010-2011, Willow Garage, Inc.
+ *  Copyright (c) 2012-, Open Perception, Inc.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_IO_PCD_MAPPED_CLOUD_H_
+#define PCL_IO_PCD_MAPPED_CLOUD_H_
+
+#include <pcl/point_cloud.h>
+#include <pcl/io/pcd_io.h>
+#include <boost/noncopyable.hpp>
+
+namespace pcl {
+/** \brief Read-only view of a binary PCD file, backed by a memory map.
+ *
+ * Opening a file only parses its header and maps it: no point is copied and
+ * the pages are loaded (and shared between processes through the page cache)
+ * on first access.
+ *
+ * When the on-disk point layout is identical to the memory layout of PointT
+ * (same fields at the same offsets, same point size and a suitably aligned
+ * data section), the mapped region is exposed directly as a range of points
+ * via begin () / end (). Otherwise isZeroCopy () returns false and points are
+ * assembled lazily, field by field, through at ().
+ *
+ * \note Only uncompressed binary PCD files can be mapped. Files written by
+ * a PCDWriter with setZeroCopyLayout (true) have a 16 bytes aligned data
+ * section and, for writeBinary<PointT>, the memory layout of PointT: they are
+ * always zero copy for that point type.
+ * \ingroup io
+ */
+template <typename PointT> class PCDMappedCloud : boost::noncopyable {
+  public:
+    typedef boost::shared_ptr<PCDMappedCloud<PointT> > Ptr;
+    typedef boost::shared_ptr<const PCDMappedCloud<PointT> > ConstPtr;
+    typedef const PointT *const_iterator;
+
+    /** \brief Empty constructor. */
+    PCDMappedCloud()
+        : map_(NULL), map_size_(0), data_(NULL), width_(0), height_(0),
+          point_step_(0), zero_copy_(false), fields_(), field_map_(),
+          sensor_origin_(Eigen::Vector4f::Zero()),
+          sensor_orientation_(Eigen::Quaternionf::Identity())
+#ifdef _WIN32
+          ,
+          file_mapping_(NULL)
+#endif
+    {
+    }
+
+    /** \brief Destructor. Unmaps the file. */
+    virtual ~PCDMappedCloud() { close(); }
+
+    /** \brief Map a binary PCD file.
+     * \param[in] file_name the name of the file to map
+     * \param[in] offset the offset of where to expect the PCD Header in the
+     * file (optional parameter)
+     * \return
+     *  * < 0 (-1) on error
+     *  * == 0 on success
+     */
+    int open(const std::string &file_name, const int offset = 0);
+
+    /** \brief Unmap the file. All iterators and pointers obtained from this
+     * view become invalid. */
+    void close();
+
+    /** \brief Return true if a file is currently mapped. */
+    inline bool isOpen() const { return (map_ != NULL); }
+
+    /** \brief Return true if the mapped data can be used in place as an
+     * array of PointT, i.e., if begin () / end () are valid. */
+    inline bool isZeroCopy() const { return (zero_copy_); }
+
+    /** \brief Return the number of points in the mapped cloud. */
+    inline size_t size() const {
+        return (static_cast<size_t>(width_) * height_);
+    }
+
+    /** \brief Return true if no points are mapped. */
+    inline bool empty() const { return (size() == 0); }
+
+    /** \brief Return the width of the mapped cloud. */
+    inline uint32_t getWidth() const { return (width_); }
+
+    /** \brief Return the height of the mapped cloud. */
+    inline uint32_t getHeight() const { return (height_); }
+
+    /** \brief Return the fields stored in the file. */
+    inline const std::vector<sensor_msgs::PointField> &getFields() const {
+        return (fields_);
+    }
+
+    /** \brief Return the sensor acquisition origin stored in the file. */
+    inline const Eigen::Vector4f &getSensorOrigin() const {
+        return (sensor_origin_);
+    }
+
+    /** \brief Return the sensor acquisition orientation stored in the file. */
+    inline const Eigen::Quaternionf &getSensorOrientation() const {
+        return (sensor_orientation_);
+    }
+
+    /** \brief Return an iterator to the first mapped point, or NULL if the
+     * view is not zero copy. */
+    inline const_iterator begin() const {
+        return (zero_copy_ ? reinterpret_cast<const PointT *>(data_) : NULL);
+    }
+
+    /** \brief Return an iterator past the last mapped point, or NULL if the
+     * view is not zero copy. */
+    inline const_iterator end() const {
+        return (zero_copy_ ? reinterpret_cast<const PointT *>(data_) + size()
+                           : NULL);
+    }
+
+    /** \brief Access a mapped point in place.
+     * \note Only valid if isZeroCopy () returns true.
+     * \param[in] n the index of the point
+     */
+    inline const PointT &operator[](size_t n) const {
+        assert(zero_copy_ && n < size());
+        return (reinterpret_cast<const PointT *>(data_)[n]);
+    }
+
+    /** \brief Return the raw, serialized data of a point.
+     * \param[in] n the index of the point
+     */
+    inline const uint8_t *getPointData(size_t n) const {
+        return (data_ + n * point_step_);
+    }
+
+    /** \brief Get a point by value. For views that are not zero copy, only
+     * the fields present in the file are copied from the mapped data, all
+     * others keep their default values.
+     * \param[in] n the index of the point
+     * \param[out] point the resultant point
+     */
+    inline void at(size_t n, PointT &point) const {
+        if (zero_copy_) {
+            point = reinterpret_cast<const PointT *>(data_)[n];
+            return;
+        }
+        const uint8_t *src = getPointData(n);
+        uint8_t *dst = reinterpret_cast<uint8_t *>(&point);
+        for (size_t i = 0; i < field_map_.size(); ++i)
+            memcpy(dst + field_map_[i].struct_offset,
+                   src + field_map_[i].serialized_offset, field_map_[i].size);
+    }
+
+    /** \brief Get a point by value.
+     * \param[in] n the index of the point
+     */
+    inline PointT at(size_t n) const {
+        PointT point;
+        at(n, point);
+        return (point);
+    }
+
+    /** \brief Copy the mapped points into a regular point cloud.
+     * \param[out] cloud the resultant point cloud
+     */
+    void copyTo(pcl::PointCloud<PointT> &cloud) const;
+
+  private:
+    /** \brief Start of the memory map. */
+    char *map_;
+
+    /** \brief Size of the memory map in bytes. */
+    size_t map_size_;
+
+    /** \brief Start of the point data inside the memory map. */
+    const uint8_t *data_;
+
+    /** \brief The width and height of the mapped cloud. */
+    uint32_t width_, height_;
+
+    /** \brief The size of one serialized point. */
+    uint32_t point_step_;
+
+    /** \brief True if the serialized layout is identical to PointT. */
+    bool zero_copy_;
+
+    /** \brief The fields stored in the file. */
+    std::vector<sensor_msgs::PointField> fields_;
+
+    /** \brief Mapping between serialized fields and PointT fields. */
+    MsgFieldMap field_map_;
+
+    /** \brief Sensor acquisition pose stored in the file. */
+    Eigen::Vector4f sensor_origin_;
+    Eigen::Quaternionf sensor_orientation_;
+
+#ifdef _WIN32
+    /** \brief Handle of the file mapping object. */
+    HANDLE file_mapping_;
+#endif
+
+  public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+} // namespace pcl
+
+#include <pcl/io/impl/pcd_mapped_cloud.hpp>
+
+#endif //#ifndef PCL_IO_PCD_MAPPED_CLOUD_H_
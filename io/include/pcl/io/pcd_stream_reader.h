@@ -0,0 +1,221 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Point Cloud Library (PCL) - www.pointclouds.org
+ *  Copyright (c) 2010-2011, Willow Garage, Inc.
+ *  Copyright (c) 2012-, Open Perception, Inc.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_IO_PCD_STREAM_READER_H_
+#define PCL_IO_PCD_STREAM_READER_H_
+
+#include <fstream>
+#include <pcl/point_cloud.h>
+#include <pcl/ros/conversions.h>
+#include <pcl/io/pcd_io.h>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace pcl {
+namespace detail {
+class PCDFieldStream;
+}
+
+/** \brief Sequential, chunk by chunk reader for PCD files that do not fit in
+ * memory.
+ *
+ * After open () has parsed the header, every call to readChunk () returns
+ * the next (at most) getChunkSize () points of the file, until hasNext ()
+ * becomes false. The reader never holds more than one chunk of points (plus
+ * a few small I/O buffers), whatever the size of the file:
+ *  - ascii and binary data are read sequentially from the file;
+ *  - binary_compressed data is decompressed on the fly by one LZF decoder per
+ *    field. LZF back references reach at most 8 KB back, so each decoder only
+ *    keeps that sliding window, and can start anywhere in the stream from a
+ *    copy of the window. The fields are stored one after the other: open ()
+ *    decodes the stream once, and starts every decoder from the state of
+ *    that scan at the beginning of its field;
+ *  - binary_compressed_chunked data is read one compressed block at a time.
+ *
+ * Typical usage:
+ * \code
+ * pcl::PCDStreamReader reader (1000000);
+ * if (reader.open ("huge.pcd") < 0)
+ *   return (-1);
+ * pcl::PointCloud<pcl::PointXYZ> chunk;
+ * while (reader.hasNext ())
+ * {
+ *   if (reader.readChunk (chunk) < 0)
+ *     return (-1);
+ *   // filter, accumulate, ...
+ * }
+ * \endcode
+ *
+ * \note Organized clouds are returned as unorganized chunks (height = 1).
+ * \ingroup io
+ */
+class PCL_EXPORTS PCDStreamReader : boost::noncopyable {
+  public:
+    typedef boost::shared_ptr<PCDStreamReader> Ptr;
+    typedef boost::shared_ptr<const PCDStreamReader> ConstPtr;
+
+    /** \brief Constructor.
+     * \param[in] chunk_size the maximum number of points returned by each
+     * call to readChunk ()
+     */
+    PCDStreamReader(unsigned int chunk_size = 1 << 20);
+
+    /** \brief Destructor. Closes the file if still open. */
+    ~PCDStreamReader();
+
+    /** \brief Parse the header of a PCD file and prepare reading its points.
+     * \param[in] file_name the name of the file to read
+     * \param[in] offset the offset of where to expect the PCD header in the
+     * file
+     * \return 0 on success, a negative value on error
+     */
+    int open(const std::string &file_name, const int offset = 0);
+
+    /** \brief Release the file and all the buffers. */
+    void close();
+
+    /** \brief Check whether a file is currently open. */
+    inline bool isOpen() const { return (data_type_ >= 0); }
+
+    /** \brief Check whether there are points left to read. */
+    inline bool hasNext() const {
+        return (isOpen() && points_read_ < nr_points_);
+    }
+
+    /** \brief Set the maximum number of points returned by readChunk ().
+     * \param[in] chunk_size the number of points per chunk (at least 1)
+     */
+    inline void setChunkSize(unsigned int chunk_size) {
+        chunk_size_ = chunk_size > 0 ? chunk_size : 1;
+    }
+
+    /** \brief Get the maximum number of points returned by readChunk (). */
+    inline unsigned int getChunkSize() const { return (chunk_size_); }
+
+    /** \brief Get the total number of points in the file. */
+    inline size_t getNumberOfPoints() const { return (nr_points_); }
+
+    /** \brief Get the number of points returned so far. */
+    inline size_t getNumberOfPointsRead() const { return (points_read_); }
+
+    /** \brief Get the header of the file: fields, width, height and
+     * point_step, with an empty data array.
+     */
+    inline const sensor_msgs::PointCloud2 &getHeader() const {
+        return (header_);
+    }
+
+    /** \brief Get the sensor acquisition origin stored in the header. */
+    inline const Eigen::Vector4f &getSensorOrigin() const { return (origin_); }
+
+    /** \brief Get the sensor acquisition orientation stored in the header. */
+    inline const Eigen::Quaternionf &getSensorOrientation() const {
+        return (orientation_);
+    }
+
+    /** \brief Read the next chunk of points.
+     * \param[out] chunk the resultant chunk (height = 1, the fields of the
+     * file)
+     * \return the number of points read (0 when the end of the file has been
+     * reached), or a negative value on error
+     */
+    int readChunk(sensor_msgs::PointCloud2 &chunk);
+
+    /** \brief Read the next chunk of points and convert it to PointT.
+     * \param[out] chunk the resultant chunk
+     * \return the number of points read (0 when the end of the file has been
+     * reached), or a negative value on error
+     */
+    template <typename PointT> int readChunk(pcl::PointCloud<PointT> &chunk) {
+        int res = readChunk(blob_);
+        if (res < 0)
+            return (res);
+        pcl::fromROSMsg(blob_, chunk);
+        chunk.sensor_origin_ = origin_;
+        chunk.sensor_orientation_ = orientation_;
+        return (res);
+    }
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  private:
+    /** \brief Read n ascii points into chunk. */
+    int readASCII(sensor_msgs::PointCloud2 &chunk, unsigned int n);
+
+    /** \brief Read n points from the per field streams into chunk. */
+    int readColumns(sensor_msgs::PointCloud2 &chunk, unsigned int n);
+
+    /** \brief The name of the file being read. */
+    std::string file_name_;
+
+    /** \brief The header of the file (no data). */
+    sensor_msgs::PointCloud2 header_;
+
+    /** \brief Sensor origin and orientation stored in the header. */
+    Eigen::Vector4f origin_;
+    Eigen::Quaternionf orientation_;
+
+    /** \brief The type of data in the file (-1 when no file is open). */
+    int data_type_;
+
+    /** \brief The total number of points and the number of points read. */
+    size_t nr_points_, points_read_;
+
+    /** \brief The maximum number of points per chunk. */
+    unsigned int chunk_size_;
+
+    /** \brief Sequential stream over the ascii or binary data section. */
+    std::ifstream fs_;
+
+    /** \brief Indices of the non padding fields, and one decoder each, for
+     * compressed data.
+     */
+    std::vector<int> field_ids_;
+    std::vector<boost::shared_ptr<detail::PCDFieldStream> > field_streams_;
+
+    /** \brief Scratch buffer holding one field column of a chunk. */
+    std::vector<char> column_;
+
+    /** \brief Scratch cloud used by the templated readChunk (). */
+    sensor_msgs::PointCloud2 blob_;
+};
+} // namespace pcl
+
+#endif //#ifndef PCL_IO_PCD_STREAM_READER_H_
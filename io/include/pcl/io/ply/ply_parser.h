@@ -65,6 +65,7 @@
 
 #include <pcl/io/ply/ply.h>
 #include <pcl/io/ply/io_operators.h>
+#include <pcl/io/number_parser.h>
 #include <pcl/pcl_macros.h>
 
 namespace pcl {
@@ -92,6 +93,28 @@ class PCL_EXPORTS ply_parser {
     typedef boost::function<void(const std::string &)> obj_info_callback_type;
     typedef boost::function<bool()> end_header_callback_type;
 
+    /** \brief Description of one property of a fixed size element: its
+     * name, its size in bytes and whether a callback was registered for it.
+     */
+    struct property_layout {
+        std::string name;
+        std::size_t size;
+        bool handled;
+    };
+    /** \brief The properties of a fixed size element, in file order. */
+    typedef std::vector<property_layout> element_layout_type;
+    /** \brief Called before the records of an element that has no list
+     * property are parsed from a binary file, with the element name, the
+     * number of records, the layout of a record, whether the data needs to
+     * be byte swapped and the stream positioned on the first record. If it
+     * returns true, the callee has consumed all the records from the stream
+     * and the per property callbacks are skipped for this element.
+     */
+    typedef boost::function<bool(const std::string &, std::size_t,
+                                 const element_layout_type &, bool,
+                                 std::istream &)>
+        fixed_size_element_callback_type;
+
     typedef boost::function<void()> begin_element_callback_type;
     typedef boost::function<void()> end_element_callback_type;
     typedef boost::tuple<begin_element_callback_type, end_element_callback_type>
@@ -319,12 +342,16 @@ class PCL_EXPORTS ply_parser {
     inline void
     end_header_callback(const end_header_callback_type &end_header_callback);
 
+    inline void fixed_size_element_callback(
+        const fixed_size_element_callback_type &fixed_size_element_callback);
+
     typedef int flags_type;
     enum flags {};
 
     ply_parser(flags_type flags = 0)
         : flags_(flags), comment_callback_(), obj_info_callback_(),
-          end_header_callback_(), line_number_(0), current_element_() {}
+          end_header_callback_(), fixed_size_element_callback_(),
+          line_number_(0), current_element_() {}
 
     bool parse(const std::string &filename);
     // inline bool parse (const std::string& filename);
@@ -335,6 +362,17 @@ class PCL_EXPORTS ply_parser {
         virtual ~property() {}
         virtual bool parse(class ply_parser &ply_parser, format_type format,
                            std::istream &istream) = 0;
+        /** \brief Parse an ascii value from the line [p, end), moving p
+         * past it and the blanks that follow.
+         */
+        virtual bool parse(class ply_parser &ply_parser, const char *&p,
+                           const char *end) = 0;
+        /** \brief The size of the property in a binary file, 0 if it is not
+         * fixed (list properties).
+         */
+        virtual std::size_t binary_size() const { return (0); }
+        /** \brief Whether a callback is registered for this property. */
+        virtual bool handled() const { return (true); }
         std::string name;
     };
 
@@ -349,6 +387,13 @@ class PCL_EXPORTS ply_parser {
             return ply_parser.parse_scalar_property<scalar_type>(
                 format, istream, callback);
         }
+        bool parse(class ply_parser &ply_parser, const char *&p,
+                   const char *end) {
+            return ply_parser.parse_scalar_property<scalar_type>(p, end,
+                                                                 callback);
+        }
+        std::size_t binary_size() const { return (sizeof(scalar_type)); }
+        bool handled() const { return (!callback.empty()); }
         callback_type callback;
     };
 
@@ -374,6 +419,11 @@ class PCL_EXPORTS ply_parser {
                 format, istream, begin_callback, element_callback,
                 end_callback);
         }
+        bool parse(class ply_parser &ply_parser, const char *&p,
+                   const char *end) {
+            return ply_parser.parse_list_property<size_type, scalar_type>(
+                p, end, begin_callback, element_callback, end_callback);
+        }
         begin_callback_type begin_callback;
         element_callback_type element_callback;
         end_callback_type end_callback;
@@ -408,6 +458,7 @@ class PCL_EXPORTS ply_parser {
     comment_callback_type comment_callback_;
     obj_info_callback_type obj_info_callback_;
     end_header_callback_type end_header_callback_;
+    fixed_size_element_callback_type fixed_size_element_callback_;
 
     template <typename ScalarType>
     inline void
@@ -433,6 +484,29 @@ class PCL_EXPORTS ply_parser {
         const typename list_property_end_callback_type<
             SizeType, ScalarType>::type &list_property_end_callback);
 
+    template <typename ScalarType>
+    inline bool parse_scalar_property(
+        const char *&p, const char *end,
+        const typename scalar_property_callback_type<ScalarType>::type
+            &scalar_property_callback);
+
+    template <typename SizeType, typename ScalarType>
+    inline bool parse_list_property(
+        const char *&p, const char *end,
+        const typename list_property_begin_callback_type<
+            SizeType, ScalarType>::type &list_property_begin_callback,
+        const typename list_property_element_callback_type<
+            SizeType, ScalarType>::type &list_property_element_callback,
+        const typename list_property_end_callback_type<
+            SizeType, ScalarType>::type &list_property_end_callback);
+
+    /** \brief Read one ascii value from [p, end): it has to be followed by
+     * white space or by the end of the line, which is skipped as well.
+     */
+    template <typename ScalarType>
+    inline bool parse_ascii_value(const char *&p, const char *end,
+                                  ScalarType &value);
+
     std::size_t line_number_;
     element *current_element_;
 };
@@ -504,6 +578,11 @@ inline void pcl::io::ply::ply_parser::end_header_callback(
     end_header_callback_ = end_header_callback;
 }
 
+inline void pcl::io::ply::ply_parser::fixed_size_element_callback(
+    const fixed_size_element_callback_type &fixed_size_element_callback) {
+    fixed_size_element_callback_ = fixed_size_element_callback;
+}
+
 template <typename ScalarType>
 inline void pcl::io::ply::ply_parser::parse_scalar_property_definition(
     const std::string &property_name) {
@@ -708,6 +787,60 @@ inline bool pcl::io::ply::ply_parser::parse_list_property(
     }
 }
 
+template <typename ScalarType>
+inline bool pcl::io::ply::ply_parser::parse_ascii_value(const char *&p,
+                                                        const char *end,
+                                                        ScalarType &value) {
+    if (!pcl::io::parseNumber(p, end, value) ||
+        (p != end && !isspace(static_cast<unsigned char>(*p)))) {
+        if (error_callback_)
+            error_callback_(line_number_, "parse error");
+        return (false);
+    }
+    while (p != end && isspace(static_cast<unsigned char>(*p)))
+        ++p;
+    return (true);
+}
+
+template <typename ScalarType>
+inline bool pcl::io::ply::ply_parser::parse_scalar_property(
+    const char *&p, const char *end,
+    const typename scalar_property_callback_type<ScalarType>::type
+        &scalar_property_callback) {
+    ScalarType value = std::numeric_limits<ScalarType>::quiet_NaN();
+    if (!parse_ascii_value(p, end, value))
+        return (false);
+    if (scalar_property_callback)
+        scalar_property_callback(value);
+    return (true);
+}
+
+template <typename SizeType, typename ScalarType>
+inline bool pcl::io::ply::ply_parser::parse_list_property(
+    const char *&p, const char *end,
+    const typename list_property_begin_callback_type<SizeType, ScalarType>::type
+        &list_property_begin_callback,
+    const typename list_property_element_callback_type<
+        SizeType, ScalarType>::type &list_property_element_callback,
+    const typename list_property_end_callback_type<SizeType, ScalarType>::type
+        &list_property_end_callback) {
+    SizeType size = 0;
+    if (!parse_ascii_value(p, end, size))
+        return (false);
+    if (list_property_begin_callback)
+        list_property_begin_callback(size);
+    for (std::size_t index = 0; index < size; ++index) {
+        ScalarType value = std::numeric_limits<ScalarType>::quiet_NaN();
+        if (!parse_ascii_value(p, end, value))
+            return (false);
+        if (list_property_element_callback)
+            list_property_element_callback(value);
+    }
+    if (list_property_end_callback)
+        list_property_end_callback();
+    return (true);
+}
+
 #ifdef BUILD_Maintainer
 #if defined __GNUC__
 #if __GNUC__ == 4 && __GNUC_MINOR__ > 3
@@ -406,6 +406,22 @@ class PCL_EXPORTS PLYReader : public FileReader {
     void appendUnsignedIntProperty(const std::string &name,
                                    const size_t &count = 1);
 
+    /** Read all the records of a binary vertex element at once, when it has
+     * no list property. Properties that map one to one to the cloud fields
+     * are copied in bulk (straight into the cloud data when the layouts are
+     * identical); colors and intensities are converted on the fly.
+     * param[in] element_name the name of the element
+     * param[in] count the number of records
+     * param[in] layout the properties of a record
+     * param[in] swap_bytes whether the data needs to be byte swapped
+     * param[in] istream the stream, positioned on the first record
+     * \return false if the element can not be read in bulk
+     */
+    bool fixedSizeElementCallback(
+        const std::string &element_name, std::size_t count,
+        const pcl::io::ply::ply_parser::element_layout_type &layout,
+        bool swap_bytes, std::istream &istream);
+
     /** Callback function for the begin of vertex line */
     void vertexBeginCallback();
 
@@ -0,0 +1,259 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Point Cloud Library (PCL) - www.pointclouds.org
+ *  Copyright (c) 2010-2011, Willow Garage, Inc.
+ *  Copyright (c) 2012-, Open Perception, Inc.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#include <algorithm>
+#include <pcl/io/async_pcd_writer.h>
+#include <pcl/common/time.h>
+#include <boost/bind.hpp>
+#include <pcl/console/print.h>
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+pcl::AsyncPCDWriter::AsyncPCDWriter(size_t queue_size, unsigned int nr_threads,
+                                    Format format)
+    : format_(format), policy_(DROP_FRAME), jobs_(), free_(), queue_(),
+      queue_size_(queue_size > 0 ? queue_size : 1), pending_(0),
+      in_progress_(0), files_in_progress_(), stop_(false), statistics_() {
+    if (nr_threads == 0)
+        nr_threads = 1;
+    // Enough buffers to fill the queue while every thread writes a frame
+    jobs_.resize(queue_size_ + nr_threads);
+    free_.reserve(jobs_.size());
+    for (size_t i = 0; i < jobs_.size(); ++i) {
+        jobs_[i].reset(new Job);
+        free_.push_back(jobs_[i].get());
+    }
+    for (unsigned int i = 0; i < nr_threads; ++i)
+        threads_.create_thread(boost::bind(&AsyncPCDWriter::run, this));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+pcl::AsyncPCDWriter::~AsyncPCDWriter() {
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        stop_ = true;
+    }
+    queue_not_empty_.notify_all();
+    // The threads only exit once the queue is empty
+    threads_.join_all();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+void pcl::AsyncPCDWriter::setFormat(Format format) {
+    boost::mutex::scoped_lock lock(mutex_);
+    format_ = format;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+pcl::AsyncPCDWriter::Format pcl::AsyncPCDWriter::getFormat() const {
+    boost::mutex::scoped_lock lock(mutex_);
+    return (format_);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+void pcl::AsyncPCDWriter::setOverflowPolicy(OverflowPolicy policy) {
+    boost::mutex::scoped_lock lock(mutex_);
+    policy_ = policy;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+pcl::AsyncPCDWriter::OverflowPolicy
+pcl::AsyncPCDWriter::getOverflowPolicy() const {
+    boost::mutex::scoped_lock lock(mutex_);
+    return (policy_);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+bool pcl::AsyncPCDWriter::write(const std::string &file_name,
+                                const sensor_msgs::PointCloud2 &cloud,
+                                const Eigen::Vector4f &origin,
+                                const Eigen::Quaternionf &orientation) {
+    Job *job = acquire();
+    if (!job)
+        return (false);
+    job->file_name = file_name;
+    // Reuses the buffer of the previous frame written with this job
+    job->cloud.header = cloud.header;
+    job->cloud.height = cloud.height;
+    job->cloud.width = cloud.width;
+    job->cloud.fields = cloud.fields;
+    job->cloud.is_bigendian = cloud.is_bigendian;
+    job->cloud.point_step = cloud.point_step;
+    job->cloud.row_step = cloud.row_step;
+    job->cloud.data.assign(cloud.data.begin(), cloud.data.end());
+    job->cloud.is_dense = cloud.is_dense;
+    job->origin = origin;
+    job->orientation = orientation;
+    enqueue(job);
+    return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+void pcl::AsyncPCDWriter::flush() {
+    boost::mutex::scoped_lock lock(mutex_);
+    // Frames acquired by write () but not queued yet are pending as well
+    while (pending_ > 0 || in_progress_ > 0)
+        idle_.wait(lock);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+size_t pcl::AsyncPCDWriter::getQueueSize() const {
+    boost::mutex::scoped_lock lock(mutex_);
+    return (queue_.size());
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+pcl::AsyncPCDWriter::Statistics pcl::AsyncPCDWriter::getStatistics() const {
+    boost::mutex::scoped_lock lock(mutex_);
+    return (statistics_);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+void pcl::AsyncPCDWriter::resetStatistics() {
+    boost::mutex::scoped_lock lock(mutex_);
+    statistics_ = Statistics();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+pcl::AsyncPCDWriter::Job *pcl::AsyncPCDWriter::acquire() {
+    boost::mutex::scoped_lock lock(mutex_);
+    ++statistics_.submitted;
+    if (pending_ >= queue_size_) {
+        if (policy_ == DROP_FRAME) {
+            ++statistics_.dropped;
+            return (NULL);
+        }
+        ++statistics_.blocked;
+        pcl::StopWatch watch;
+        while (pending_ >= queue_size_)
+            slot_available_.wait(lock);
+        statistics_.blocked_time += watch.getTimeSeconds();
+    }
+    // There is always a free buffer left for a pending frame, as the
+    // remaining ones are at most being written by every thread
+    ++pending_;
+    Job *job = free_.back();
+    free_.pop_back();
+    return (job);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+void pcl::AsyncPCDWriter::enqueue(Job *job) {
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        queue_.push_back(job);
+        statistics_.max_queue_size =
+            std::max(statistics_.max_queue_size, queue_.size());
+    }
+    queue_not_empty_.notify_one();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+void pcl::AsyncPCDWriter::run() {
+    pcl::PCDWriter writer;
+    // The frames are already written in parallel
+    writer.setNumberOfThreads(1);
+
+    boost::mutex::scoped_lock lock(mutex_);
+    while (true) {
+        // Take the oldest frame whose file is not being written by another
+        // thread: PCDWriter truncates the file before locking it, which
+        // would pull the pages from under the mmap of the other writer
+        std::deque<Job *>::iterator it = queue_.end();
+        while (true) {
+            for (it = queue_.begin(); it != queue_.end(); ++it)
+                if (std::find(files_in_progress_.begin(),
+                              files_in_progress_.end(),
+                              (*it)->file_name) == files_in_progress_.end())
+                    break;
+            if (it != queue_.end() || (queue_.empty() && stop_))
+                break;
+            queue_not_empty_.wait(lock);
+        }
+        if (it == queue_.end())
+            return;
+        Job *job = *it;
+        queue_.erase(it);
+        --pending_;
+        ++in_progress_;
+        files_in_progress_.push_back(job->file_name);
+        slot_available_.notify_one();
+        Format format = format_;
+        lock.unlock();
+
+        int res;
+        switch (format) {
+        case ASCII:
+            res = writer.writeASCII(job->file_name, job->cloud, job->origin,
+                                    job->orientation, 8);
+            break;
+        case BINARY:
+            res = writer.writeBinary(job->file_name, job->cloud, job->origin,
+                                     job->orientation);
+            break;
+        case BINARY_COMPRESSED_CHUNKED:
+            res = writer.writeBinaryCompressedChunked(
+                job->file_name, job->cloud, job->origin, job->orientation);
+            break;
+        case BINARY_COMPRESSED:
+        default:
+            res = writer.writeBinaryCompressed(job->file_name, job->cloud,
+                                               job->origin, job->orientation);
+            break;
+        }
+
+        lock.lock();
+        --in_progress_;
+        files_in_progress_.erase(std::find(files_in_progress_.begin(),
+                                           files_in_progress_.end(),
+                                           job->file_name));
+        // Frames for this file may be waiting for it
+        if (!queue_.empty())
+            queue_not_empty_.notify_all();
+        if (res < 0) {
+            ++statistics_.failed;
+            PCL_ERROR("[pcl::AsyncPCDWriter] Error writing %s!\n",
+                      job->file_name.c_str());
+        } else
+            ++statistics_.written;
+        free_.push_back(job);
+        if (pending_ == 0 && in_progress_ == 0)
+            idle_.notify_all();
+    }
+}
@@ -37,6 +37,7 @@
  *
  */
 
+#include <algorithm>
 #include <fstream>
 #include <fcntl.h>
 #include <string>
@@ -45,6 +46,7 @@
 #include <pcl/common/io.h>
 #include <pcl/io/pcd_io.h>
 #include <pcl/io/lzf.h>
+#include <pcl/io/number_parser.h>
 
 #include <cstring>
 #include <cerrno>
@@ -63,6 +65,303 @@
 #endif
 #include <boost/version.hpp>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+/** \brief Size (in bytes) of the fixed part of a binary_compressed_chunked
+ * block table: points per chunk, number of chunks, number of fields. */
+const size_t PCD_CHUNK_TABLE_HEADER_SIZE = 12;
+/** \brief Size (in bytes) of one block table entry: offset, stored size,
+ * uncompressed size. */
+const size_t PCD_CHUNK_TABLE_ENTRY_SIZE = 16;
+
+/** \brief One block of a binary_compressed_chunked PCD file. */
+struct PCDChunkEntry {
+    pcl::uint64_t offset;
+    unsigned int stored_size;
+    unsigned int size;
+};
+
+/** \brief Return the number of threads an OpenMP loop should use, given the
+ * user setting (0 = automatic). */
+inline int getNumberOfThreads(unsigned int threads) {
+#ifdef _OPENMP
+    return (threads == 0 ? omp_get_num_procs() : static_cast<int>(threads));
+#else
+    (void)threads;
+    return (1);
+#endif
+}
+
+/** \brief Parse the block table of a binary_compressed_chunked data section.
+ * \param[in] data pointer to the start of the data section
+ * \param[in] data_len number of valid bytes starting at data
+ * \param[in] nr_fields the number of (non padding) fields in the header
+ * \param[in] nr_points the number of points in the header
+ * \param[out] chunk_size the number of points per block
+ * \param[out] nr_chunks the number of blocks per field
+ * \param[out] table the block table, field major
+ * \param[out] payload_idx the offset of the first block relative to data
+ * \return true if the table is consistent with the header and the file size
+ */
+bool parseChunkTable(const char *data, size_t data_len, unsigned int nr_fields,
+                     unsigned int nr_points, unsigned int &chunk_size,
+                     unsigned int &nr_chunks,
+                     std::vector<PCDChunkEntry> &table, size_t &payload_idx) {
+    if (data_len < PCD_CHUNK_TABLE_HEADER_SIZE)
+        return (false);
+    unsigned int table_fields;
+    memcpy(&chunk_size, &data[0], sizeof(unsigned int));
+    memcpy(&nr_chunks, &data[4], sizeof(unsigned int));
+    memcpy(&table_fields, &data[8], sizeof(unsigned int));
+    if (chunk_size == 0 || table_fields != nr_fields ||
+        nr_chunks != (nr_points + chunk_size - 1) / chunk_size)
+        return (false);
+
+    size_t nr_entries = static_cast<size_t>(nr_chunks) * nr_fields;
+    payload_idx =
+        PCD_CHUNK_TABLE_HEADER_SIZE + nr_entries * PCD_CHUNK_TABLE_ENTRY_SIZE;
+    if (data_len < payload_idx)
+        return (false);
+
+    table.resize(nr_entries);
+    const char *entry = &data[PCD_CHUNK_TABLE_HEADER_SIZE];
+    for (size_t i = 0; i < nr_entries;
+         ++i, entry += PCD_CHUNK_TABLE_ENTRY_SIZE) {
+        memcpy(&table[i].offset, &entry[0], sizeof(pcl::uint64_t));
+        memcpy(&table[i].stored_size, &entry[8], sizeof(unsigned int));
+        memcpy(&table[i].size, &entry[12], sizeof(unsigned int));
+        if (payload_idx + table[i].offset + table[i].stored_size > data_len)
+            return (false);
+    }
+    return (true);
+}
+
+/** \brief Decode the blocks of a binary_compressed_chunked data section that
+ * overlap a given set of fields and a given range of points, and scatter them
+ * into an interleaved (AoS) buffer. Blocks are decompressed in parallel.
+ * \param[in] data pointer to the start of the data section
+ * \param[in] data_len number of valid bytes starting at data
+ * \param[in] header the cloud header as returned by the header parser
+ * \param[in] field_ids the indices (in header.fields) of the fields to decode
+ * \param[in] out_offsets the byte offset of each decoded field in out
+ * \param[in] first_point the index of the first point to decode
+ * \param[in] nr_points the number of points to decode
+ * \param[in] out_point_step the size of one point in out
+ * \param[out] out the output buffer (nr_points * out_point_step bytes)
+ * \param[in] threads the number of threads to use (0 = automatic)
+ * \return 0 on success, -1 on error
+ */
+int decodeChunkedData(const char *data, size_t data_len,
+                      const sensor_msgs::PointCloud2 &header,
+                      const std::vector<int> &field_ids,
+                      const std::vector<unsigned int> &out_offsets,
+                      unsigned int first_point, unsigned int nr_points,
+                      unsigned int out_point_step, pcl::uint8_t *out,
+                      unsigned int threads) {
+    // Blocks are stored for the non padding fields only, in header order
+    std::vector<int> block_field(header.fields.size(), -1);
+    unsigned int nr_fields = 0;
+    for (size_t i = 0; i < header.fields.size(); ++i)
+        if (header.fields[i].name != "_")
+            block_field[i] = nr_fields++;
+
+    unsigned int chunk_size, nr_chunks;
+    size_t payload_idx;
+    std::vector<PCDChunkEntry> table;
+    if (!parseChunkTable(data, data_len, nr_fields,
+                         header.width * header.height, chunk_size, nr_chunks,
+                         table, payload_idx)) {
+        PCL_ERROR("[pcl::PCDReader::read] Corrupted binary_compressed_chunked "
+                  "block table!\n");
+        return (-1);
+    }
+    if (nr_points == 0)
+        return (0);
+
+    // Collect the (field, chunk) pairs that we actually need
+    unsigned int first_chunk = first_point / chunk_size;
+    unsigned int last_chunk = (first_point + nr_points - 1) / chunk_size;
+    std::vector<std::pair<int, unsigned int> > tasks;
+    for (size_t f = 0; f < field_ids.size(); ++f)
+        for (unsigned int c = first_chunk; c <= last_chunk; ++c)
+            tasks.push_back(std::make_pair(static_cast<int>(f), c));
+
+    bool failed = false;
+#ifdef _OPENMP
+#pragma omp parallel for shared(failed)                                        \
+    num_threads(getNumberOfThreads(threads)) schedule(dynamic, 1)
+#endif
+    for (int t = 0; t < static_cast<int>(tasks.size()); ++t) {
+        const sensor_msgs::PointField &field =
+            header.fields[field_ids[tasks[t].first]];
+        size_t field_size = field.count * pcl::getFieldSize(field.datatype);
+        unsigned int chunk = tasks[t].second;
+        const PCDChunkEntry &entry =
+            table[static_cast<size_t>(block_field[field_ids[tasks[t].first]]) *
+                      nr_chunks +
+                  chunk];
+
+        unsigned int chunk_begin = chunk * chunk_size;
+        unsigned int chunk_points =
+            std::min(chunk_size, header.width * header.height - chunk_begin);
+        if (entry.size != chunk_points * field_size) {
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+            failed = true;
+            continue;
+        }
+
+        const char *block = &data[payload_idx + entry.offset];
+        std::vector<char> buf;
+        if (entry.stored_size != entry.size) {
+            buf.resize(entry.size);
+            if (pcl::lzfDecompress(block, entry.stored_size, &buf[0],
+                                   entry.size) != entry.size) {
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+                failed = true;
+                continue;
+            }
+            block = &buf[0];
+        }
+
+        // Scatter the overlapping range into the interleaved output
+        unsigned int begin = std::max(chunk_begin, first_point);
+        unsigned int end =
+            std::min(chunk_begin + chunk_points, first_point + nr_points);
+        const char *src = &block[(begin - chunk_begin) * field_size];
+        pcl::uint8_t *dst =
+            &out[static_cast<size_t>(begin - first_point) * out_point_step +
+                 out_offsets[tasks[t].first]];
+        for (unsigned int i = begin; i < end; ++i) {
+            memcpy(dst, src, field_size);
+            src += field_size;
+            dst += out_point_step;
+        }
+    }
+
+    if (failed) {
+        PCL_ERROR("[pcl::PCDReader::read] Size of decompressed lzf data does "
+                  "not match value stored in the block table\n");
+        return (-1);
+    }
+    return (0);
+}
+/** \brief Find the end of the line starting at p (the newline, or end). */
+inline const char *findLineEnd(const char *p, const char *end) {
+    const char *eol = static_cast<const char *>(
+        memchr(p, '\n', static_cast<size_t>(end - p)));
+    return (eol ? eol : end);
+}
+
+/** \brief Check whether [p, end) contains anything but blanks. */
+inline bool isEmptyLine(const char *p, const char *end) {
+    pcl::io::skipBlanks(p, end);
+    return (p == end);
+}
+
+/** \brief Count the points (non empty lines) in [begin, end). */
+size_t countASCIIPoints(const char *begin, const char *end) {
+    size_t count = 0;
+    for (const char *p = begin; p < end;) {
+        const char *eol = findLineEnd(p, end);
+        if (!isEmptyLine(p, eol))
+            ++count;
+        p = eol + 1;
+    }
+    return (count);
+}
+
+/** \brief Parse the ascii points in [begin, end) into cloud, starting at
+ * point index idx and stopping when the cloud is full.
+ * \return the number of points parsed, or -1 on a malformed line
+ */
+long parseASCIIPoints(const char *begin, const char *end, size_t idx,
+                      sensor_msgs::PointCloud2 &cloud, bool &is_dense) {
+    size_t nr_points = static_cast<size_t>(cloud.width) * cloud.height;
+    size_t first = idx;
+    for (const char *p = begin; p < end && idx < nr_points;) {
+        const char *eol = findLineEnd(p, end);
+        if (!isEmptyLine(p, eol)) {
+            if (!pcl::io::parseASCIIPoint(p, eol, cloud,
+                                          &cloud.data[idx * cloud.point_step],
+                                          is_dense)) {
+                PCL_ERROR("[pcl::PCDReader::read] Could not parse point %u: "
+                          "missing or invalid values!\n",
+                          static_cast<unsigned int>(idx));
+                return (-1);
+            }
+            ++idx;
+        }
+        p = eol + 1;
+    }
+    return (static_cast<long>(idx - first));
+}
+
+/** \brief Parse the ascii data section [begin, end) into cloud (whose data
+ * must be allocated). With several threads the section is split at newline
+ * boundaries; the points of each piece are counted first, so that every
+ * thread knows where its points go.
+ * \param[out] nr_read the number of points read
+ * \return 0 on success, -1 on a malformed line
+ */
+int parseASCIIData(const char *begin, const char *end,
+                   sensor_msgs::PointCloud2 &cloud, unsigned int threads,
+                   unsigned int &nr_read) {
+    size_t size = static_cast<size_t>(end - begin);
+    // Do not bother splitting less than 1MB per thread
+    int nr_threads = static_cast<int>(
+        std::min(static_cast<size_t>(getNumberOfThreads(threads)),
+                 size / (1 << 20) + 1));
+
+    std::vector<const char *> bounds(nr_threads + 1, end);
+    bounds[0] = begin;
+    for (int t = 1; t < nr_threads; ++t) {
+        const char *p = std::max(begin + size / nr_threads * t, bounds[t - 1]);
+        bounds[t] = std::min(findLineEnd(p, end) + 1, end);
+    }
+
+    std::vector<size_t> first(nr_threads, 0);
+    if (nr_threads > 1) {
+        std::vector<size_t> counts(nr_threads);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nr_threads)
+#endif
+        for (int t = 0; t < nr_threads; ++t)
+            counts[t] = countASCIIPoints(bounds[t], bounds[t + 1]);
+        for (int t = 1; t < nr_threads; ++t)
+            first[t] = first[t - 1] + counts[t - 1];
+    }
+
+    std::vector<long> parsed(nr_threads, 0);
+    std::vector<char> dense(nr_threads, 1);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nr_threads)
+#endif
+    for (int t = 0; t < nr_threads; ++t) {
+        bool is_dense = true;
+        parsed[t] = parseASCIIPoints(bounds[t], bounds[t + 1], first[t],
+                                     cloud, is_dense);
+        dense[t] = is_dense;
+    }
+
+    nr_read = 0;
+    for (int t = 0; t < nr_threads; ++t) {
+        if (parsed[t] < 0)
+            return (-1);
+        nr_read += static_cast<unsigned int>(parsed[t]);
+        if (!dense[t])
+            cloud.is_dense = false;
+    }
+    return (0);
+}
+} // namespace
+
 ///////////////////////////////////////////////////////////////////////////////////////////
 void pcl::PCDWriter::setLockingPermissions(
     const std::string &file_name, boost::interprocess::file_lock &lock) {
@@ -108,12 +407,12 @@ void pcl::PCDWriter::resetLockingPermissions(
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////
-int pcl::PCDReader::readHeader(const std::string &file_name,
-                               sensor_msgs::PointCloud2 &cloud,
-                               Eigen::Vector4f &origin,
-                               Eigen::Quaternionf &orientation,
-                               int &pcd_version, int &data_type,
-                               unsigned int &data_idx, const int offset) {
+int pcl::PCDReader::parseHeader(const std::string &file_name,
+                                sensor_msgs::PointCloud2 &cloud,
+                                Eigen::Vector4f &origin,
+                                Eigen::Quaternionf &orientation,
+                                int &pcd_version, int &data_type,
+                                unsigned int &data_idx, const int offset) {
     // Default values
     data_idx = 0;
     data_type = 0;
@@ -329,15 +628,15 @@ int pcl::PCDReader::readHeader(const std::string &file_name,
             // Get the number of points
             if (line_type.substr(0, 6) == "POINTS") {
                 sstream >> nr_points;
-                // Need to allocate: N * point_step
-                cloud.data.resize(nr_points * cloud.point_step);
                 continue;
             }
 
             // Read the header + comments line by line until we get to <DATA>
             if (line_type.substr(0, 4) == "DATA") {
                 data_idx = static_cast<int>(fs.tellg());
-                if (st.at(1).substr(0, 17) == "binary_compressed")
+                if (st.at(1).substr(0, 25) == "binary_compressed_chunked")
+                    data_type = 3;
+                else if (st.at(1).substr(0, 17) == "binary_compressed")
                     data_type = 2;
                 else if (st.at(1).substr(0, 6) == "binary")
                     data_type = 1;
@@ -401,6 +700,23 @@ int pcl::PCDReader::readHeader(const std::string &file_name,
     return (0);
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////
+int pcl::PCDReader::readHeader(const std::string &file_name,
+                               sensor_msgs::PointCloud2 &cloud,
+                               Eigen::Vector4f &origin,
+                               Eigen::Quaternionf &orientation,
+                               int &pcd_version, int &data_type,
+                               unsigned int &data_idx, const int offset) {
+    int res = parseHeader(file_name, cloud, origin, orientation, pcd_version,
+                          data_type, data_idx, offset);
+    if (res < 0)
+        return (res);
+
+    // Need to allocate: N * point_step
+    cloud.data.resize(cloud.width * cloud.height * cloud.point_step);
+    return (0);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////
 int pcl::PCDReader::readHeader(const std::string &file_name,
                                sensor_msgs::PointCloud2 &cloud,
@@ -884,7 +1200,9 @@ int pcl::PCDReader::readHeaderEigen(const std::string &file_name,
             // Read the header + comments line by line until we get to <DATA>
             if (line_type.substr(0, 4) == "DATA") {
                 data_idx = static_cast<int>(fs.tellg());
-                if (st.at(1).substr(0, 17) == "binary_compressed")
+                if (st.at(1).substr(0, 25) == "binary_compressed_chunked")
+                    data_type = 3;
+                else if (st.at(1).substr(0, 17) == "binary_compressed")
                     data_type = 2;
                 else if (st.at(1).substr(0, 6) == "binary")
                     data_type = 1;
@@ -968,123 +1286,53 @@ int pcl::PCDReader::read(const std::string &file_name,
 
     // if ascii
     if (data_type == 0) {
-        // Re-open the file (readHeader closes it)
-        std::ifstream fs;
-        fs.open(file_name.c_str());
-        if (!fs.is_open() || fs.fail()) {
-            PCL_ERROR("[pcl::PCDReader::read] Could not open file %s.\n",
-                      file_name.c_str());
-            return (-1);
-        }
-
-        fs.seekg(data_idx);
-
-        std::string line;
-        std::vector<std::string> st;
-
-        // Read the rest of the file
-        try {
-            while (idx < nr_points && !fs.eof()) {
-                getline(fs, line);
-                // Ignore empty lines
-                if (line == "")
-                    continue;
-
-                // Tokenize the line
-                boost::trim(line);
-                boost::split(st, line, boost::is_any_of("\t\r "),
-                             boost::token_compress_on);
-
-                if (idx >= nr_points) {
-                    PCL_WARN("[pcl::PCDReader::read] input file %s has more "
-                             "points (%d) than advertised (%d)!\n",
-                             file_name.c_str(), idx, nr_points);
-                    break;
-                }
-
-                size_t total = 0;
-                // Copy data
-                for (unsigned int d = 0;
-                     d < static_cast<unsigned int>(cloud.fields.size()); ++d) {
-                    // Ignore invalid padded dimensions that are inherited from
-                    // binary data
-                    if (cloud.fields[d].name == "_") {
-                        total += cloud.fields[d]
-                                     .count; // jump over this many elements in
-                                             // the string token
-                        continue;
-                    }
-                    for (unsigned int c = 0; c < cloud.fields[d].count; ++c) {
-                        switch (cloud.fields[d].datatype) {
-                        case sensor_msgs::PointField::INT8: {
-                            copyStringValue<pcl::traits::asType<
-                                sensor_msgs::PointField::INT8>::type>(
-                                st.at(total + c), cloud, idx, d, c);
-                            break;
-                        }
-                        case sensor_msgs::PointField::UINT8: {
-                            copyStringValue<pcl::traits::asType<
-                                sensor_msgs::PointField::UINT8>::type>(
-                                st.at(total + c), cloud, idx, d, c);
-                            break;
-                        }
-                        case sensor_msgs::PointField::INT16: {
-                            copyStringValue<pcl::traits::asType<
-                                sensor_msgs::PointField::INT16>::type>(
-                                st.at(total + c), cloud, idx, d, c);
-                            break;
-                        }
-                        case sensor_msgs::PointField::UINT16: {
-                            copyStringValue<pcl::traits::asType<
-                                sensor_msgs::PointField::UINT16>::type>(
-                                st.at(total + c), cloud, idx, d, c);
-                            break;
-                        }
-                        case sensor_msgs::PointField::INT32: {
-                            copyStringValue<pcl::traits::asType<
-                                sensor_msgs::PointField::INT32>::type>(
-                                st.at(total + c), cloud, idx, d, c);
-                            break;
-                        }
-                        case sensor_msgs::PointField::UINT32: {
-                            copyStringValue<pcl::traits::asType<
-                                sensor_msgs::PointField::UINT32>::type>(
-                                st.at(total + c), cloud, idx, d, c);
-                            break;
-                        }
-                        case sensor_msgs::PointField::FLOAT32: {
-                            copyStringValue<pcl::traits::asType<
-                                sensor_msgs::PointField::FLOAT32>::type>(
-                                st.at(total + c), cloud, idx, d, c);
-                            break;
-                        }
-                        case sensor_msgs::PointField::FLOAT64: {
-                            copyStringValue<pcl::traits::asType<
-                                sensor_msgs::PointField::FLOAT64>::type>(
-                                st.at(total + c), cloud, idx, d, c);
-                            break;
-                        }
-                        default:
-                            PCL_WARN("[pcl::PCDReader::read] Incorrect field "
-                                     "data type specified (%d)!\n",
-                                     cloud.fields[d].datatype);
-                            break;
-                        }
-                    }
-                    total +=
-                        cloud.fields[d].count; // jump over this many elements
-                                               // in the string token
-                }
-                idx++;
+        size_t file_size =
+            static_cast<size_t>(boost::filesystem::file_size(file_name));
+        // Map the file instead of streaming it line by line: values are
+        // parsed in place, possibly by several threads
+        if (data_idx < file_size) {
+            int fd = pcl_open(file_name.c_str(), O_RDONLY);
+            if (fd == -1) {
+                PCL_ERROR("[pcl::PCDReader::read] Could not open file %s.\n",
+                          file_name.c_str());
+                return (-1);
             }
-        } catch (const char *exception) {
-            PCL_ERROR("[pcl::PCDReader::read] %s\n", exception);
-            fs.close();
-            return (-1);
+#ifdef _WIN32
+            HANDLE fm = CreateFileMapping((HANDLE)_get_osfhandle(fd), NULL,
+                                          PAGE_READONLY, 0, 0, NULL);
+            char *map =
+                static_cast<char *>(MapViewOfFile(fm, FILE_MAP_READ, 0, 0, 0));
+            if (map == NULL) {
+                CloseHandle(fm);
+                pcl_close(fd);
+                PCL_ERROR("[pcl::PCDReader::read] Error mapping view of file, "
+                          "%s\n",
+                          file_name.c_str());
+                return (-1);
+            }
+#else
+            char *map = static_cast<char *>(
+                mmap(0, file_size, PROT_READ, MAP_SHARED, fd, 0));
+            if (map == reinterpret_cast<char *>(-1)) // MAP_FAILED
+            {
+                pcl_close(fd);
+                PCL_ERROR("[pcl::PCDReader::read] Error preparing mmap for "
+                          "ascii PCD file.\n");
+                return (-1);
+            }
+#endif
+            res = parseASCIIData(map + data_idx, map + file_size, cloud,
+                                 threads_, idx);
+#ifdef _WIN32
+            UnmapViewOfFile(map);
+            CloseHandle(fm);
+#else
+            munmap(map, file_size);
+#endif
+            pcl_close(fd);
+            if (res < 0)
+                return (-1);
         }
-
-        // Close file
-        fs.close();
     } else
     /// ---[ Binary mode only
     /// We must re-open the file and read with mmap () for binary
@@ -1106,6 +1354,11 @@ int pcl::PCDReader::read(const std::string &file_name,
         }
 
         size_t data_size = data_idx + cloud.data.size();
+        // The chunked layout carries a block table and compressed blocks of
+        // varying size: map everything up to the end of the file
+        if (data_type == 3)
+            data_size =
+                static_cast<size_t>(boost::filesystem::file_size(file_name));
         // Prepare the map
 #ifdef _WIN32
         // map te whole file
@@ -1220,6 +1473,30 @@ int pcl::PCDReader::read(const std::string &file_name,
             // memcpy (&cloud.data[0], &buf[0], uncompressed_size);
 
             free(buf);
+        }
+        /// ---[ Binary compressed chunked mode only
+        else if (data_type == 3) {
+            std::vector<int> field_ids;
+            std::vector<unsigned int> out_offsets;
+            for (size_t i = 0; i < cloud.fields.size(); ++i) {
+                if (cloud.fields[i].name == "_")
+                    continue;
+                field_ids.push_back(static_cast<int>(i));
+                out_offsets.push_back(cloud.fields[i].offset);
+            }
+            if (decodeChunkedData(&map[data_idx], data_size - data_idx, cloud,
+                                  field_ids, out_offsets, 0, nr_points,
+                                  cloud.point_step, &cloud.data[0],
+                                  threads_) < 0) {
+#if _WIN32
+                UnmapViewOfFile(map);
+                CloseHandle(fm);
+#else
+                munmap(map, data_size);
+#endif
+                pcl_close(fd);
+                return (-1);
+            }
         } else
             // Copy the data
             memcpy(&cloud.data[0], &map[0] + data_idx, cloud.data.size());
@@ -1454,7 +1731,7 @@ int pcl::PCDReader::readEigen(const std::string &file_name,
 #endif
 
         /// ---[ Binary compressed mode only
-        if (data_type == 2)
+        if (data_type >= 2)
             throw pcl::IOException(
                 "[pcl::PCDReader::readEigen] PCD binary_compressed mode not "
                 "implemented for Eigen::MatrixXf!");
@@ -1533,6 +1810,170 @@ int pcl::PCDReader::read(const std::string &file_name,
     return (0);
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int pcl::PCDReader::readSubset(const std::string &file_name,
+                               sensor_msgs::PointCloud2 &cloud,
+                               const std::vector<std::string> &field_names,
+                               unsigned int first_point,
+                               unsigned int nr_points, const int offset) {
+    sensor_msgs::PointCloud2 header;
+    Eigen::Vector4f origin;
+    Eigen::Quaternionf orientation;
+    int pcd_version, data_type;
+    unsigned int data_idx;
+    int res = parseHeader(file_name, header, origin, orientation, pcd_version,
+                          data_type, data_idx, offset);
+    if (res < 0)
+        return (res);
+
+    unsigned int total_points = header.width * header.height;
+    if (first_point >= total_points) {
+        PCL_ERROR("[pcl::PCDReader::readSubset] First point (%u) is out of "
+                  "range (%u points in %s)!\n",
+                  first_point, total_points, file_name.c_str());
+        return (-1);
+    }
+    nr_points = std::min(nr_points, total_points - first_point);
+
+    // Select the requested fields, keeping the order in which they are stored
+    for (size_t n = 0; n < field_names.size(); ++n) {
+        if (pcl::getFieldIndex(header, field_names[n]) == -1) {
+            PCL_ERROR("[pcl::PCDReader::readSubset] Field %s not found in "
+                      "%s!\n",
+                      field_names[n].c_str(), file_name.c_str());
+            return (-1);
+        }
+    }
+    std::vector<int> field_ids;
+    std::vector<unsigned int> out_offsets;
+    cloud.fields.clear();
+    unsigned int point_step = 0;
+    for (size_t i = 0; i < header.fields.size(); ++i) {
+        if (header.fields[i].name == "_")
+            continue;
+        if (!field_names.empty() &&
+            std::find(field_names.begin(), field_names.end(),
+                      header.fields[i].name) == field_names.end())
+            continue;
+        field_ids.push_back(static_cast<int>(i));
+        out_offsets.push_back(point_step);
+        cloud.fields.push_back(header.fields[i]);
+        cloud.fields.back().offset = point_step;
+        point_step += header.fields[i].count *
+                      pcl::getFieldSize(header.fields[i].datatype);
+    }
+
+    cloud.width = nr_points;
+    cloud.height = 1;
+    cloud.point_step = point_step;
+    cloud.row_step = point_step * nr_points;
+    cloud.is_bigendian = false;
+    cloud.is_dense = true;
+    cloud.data.resize(static_cast<size_t>(point_step) * nr_points);
+
+    if (data_type != 3) {
+        // No random access possible: read everything, then copy the subset
+        sensor_msgs::PointCloud2 full;
+        res = read(file_name, full, origin, orientation, pcd_version, offset);
+        if (res < 0)
+            return (res);
+        for (unsigned int i = 0; i < nr_points; ++i) {
+            for (size_t f = 0; f < field_ids.size(); ++f) {
+                const sensor_msgs::PointField &field =
+                    full.fields[field_ids[f]];
+                memcpy(&cloud.data[static_cast<size_t>(i) * point_step +
+                                   out_offsets[f]],
+                       &full.data[static_cast<size_t>(first_point + i) *
+                                      full.point_step +
+                                  field.offset],
+                       field.count * pcl::getFieldSize(field.datatype));
+            }
+        }
+        cloud.is_dense = full.is_dense;
+        return (0);
+    }
+
+    // Map the file: only the pages holding the needed blocks get touched
+    int fd = pcl_open(file_name.c_str(), O_RDONLY);
+    if (fd == -1) {
+        PCL_ERROR("[pcl::PCDReader::readSubset] Failure to open file %s\n",
+                  file_name.c_str());
+        return (-1);
+    }
+    size_t data_size =
+        static_cast<size_t>(boost::filesystem::file_size(file_name));
+#ifdef _WIN32
+    HANDLE fm = CreateFileMapping((HANDLE)_get_osfhandle(fd), NULL,
+                                  PAGE_READONLY, 0, 0, NULL);
+    char *map = static_cast<char *>(MapViewOfFile(fm, FILE_MAP_READ, 0, 0, 0));
+    if (map == NULL) {
+        CloseHandle(fm);
+        pcl_close(fd);
+        PCL_ERROR("[pcl::PCDReader::readSubset] Error mapping view of file, "
+                  "%s\n",
+                  file_name.c_str());
+        return (-1);
+    }
+#else
+    char *map =
+        static_cast<char *>(mmap(0, data_size, PROT_READ, MAP_SHARED, fd, 0));
+    if (map == reinterpret_cast<char *>(-1)) // MAP_FAILED
+    {
+        pcl_close(fd);
+        PCL_ERROR("[pcl::PCDReader::readSubset] Error preparing mmap for "
+                  "binary PCD file.\n");
+        return (-1);
+    }
+#endif
+
+    res = decodeChunkedData(&map[data_idx], data_size - data_idx, header,
+                            field_ids, out_offsets, first_point, nr_points,
+                            point_step, &cloud.data[0], threads_);
+
+#if _WIN32
+    UnmapViewOfFile(map);
+    CloseHandle(fm);
+#else
+    munmap(map, data_size);
+#endif
+    pcl_close(fd);
+    if (res < 0)
+        return (res);
+
+    // Check the floating point fields for NaN/Inf values
+    for (size_t f = 0; f < cloud.fields.size() && cloud.is_dense; ++f) {
+        for (unsigned int i = 0; i < nr_points && cloud.is_dense; ++i) {
+            for (unsigned int c = 0; c < cloud.fields[f].count; ++c) {
+                bool finite = true;
+                if (cloud.fields[f].datatype ==
+                    sensor_msgs::PointField::FLOAT32)
+                    finite = isValueFinite<float>(
+                        cloud, i, point_step, static_cast<unsigned int>(f), c);
+                else if (cloud.fields[f].datatype ==
+                         sensor_msgs::PointField::FLOAT64)
+                    finite = isValueFinite<double>(
+                        cloud, i, point_step, static_cast<unsigned int>(f), c);
+                if (!finite) {
+                    cloud.is_dense = false;
+                    break;
+                }
+            }
+        }
+    }
+    return (0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::string pcl::PCDWriter::generateHeaderPadding(size_t header_size) {
+    // The shortest possible comment line is "#\n"
+    size_t padding = (16 - header_size % 16) % 16;
+    if (padding == 0)
+        return ("");
+    if (padding == 1)
+        padding += 16;
+    return ("#" + std::string(padding - 2, ' ') + "\n");
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 std::string
 pcl::PCDWriter::generateHeaderASCII(const sensor_msgs::PointCloud2 &cloud,
@@ -1678,7 +2119,7 @@ pcl::PCDWriter::generateHeaderBinary(const sensor_msgs::PointCloud2 &cloud,
                     (cloud.fields[i].offset -
                      (cloud.fields[i - 1].offset +
                       cloud.fields[i - 1].count *
-                          getFieldSize(cloud.fields[i].datatype)));
+                          getFieldSize(cloud.fields[i - 1].datatype)));
 
             toffset += fake_offset;
 
@@ -1911,7 +2352,11 @@ int pcl::PCDWriter::writeBinary(const std::string &file_name,
     std::ostringstream oss;
     oss.imbue(std::locale::classic());
 
-    oss << generateHeaderBinary(cloud, origin, orientation) << "DATA binary\n";
+    std::string header = generateHeaderBinary(cloud, origin, orientation);
+    oss << header;
+    if (zero_copy_layout_)
+        oss << generateHeaderPadding(header.size() + 12);
+    oss << "DATA binary\n";
     oss.flush();
     data_idx = static_cast<unsigned int>(oss.tellp());
 
@@ -2215,6 +2660,203 @@ int pcl::PCDWriter::writeBinaryCompressed(
     return (0);
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+int pcl::PCDWriter::writeBinaryCompressedChunked(
+    const std::string &file_name, const sensor_msgs::PointCloud2 &cloud,
+    const Eigen::Vector4f &origin, const Eigen::Quaternionf &orientation) {
+    if (cloud.data.empty()) {
+        PCL_ERROR("[pcl::PCDWriter::writeBinaryCompressedChunked] Input point "
+                  "cloud has no data!\n");
+        return (-1);
+    }
+    std::ostringstream oss;
+    oss.imbue(std::locale::classic());
+
+    oss << generateHeaderBinaryCompressed(cloud, origin, orientation)
+        << "DATA binary_compressed_chunked\n";
+    oss.flush();
+    size_t data_idx = static_cast<size_t>(oss.tellp());
+
+    // Only the valid (non padding) fields get stored
+    std::vector<sensor_msgs::PointField> fields;
+    std::vector<size_t> fields_sizes;
+    for (size_t i = 0; i < cloud.fields.size(); ++i) {
+        if (cloud.fields[i].name == "_")
+            continue;
+        fields.push_back(cloud.fields[i]);
+        fields_sizes.push_back(cloud.fields[i].count *
+                               pcl::getFieldSize(cloud.fields[i].datatype));
+    }
+
+    unsigned int nr_points = cloud.width * cloud.height;
+    unsigned int chunk_size = std::min(chunk_size_, nr_points);
+    unsigned int nr_chunks = (nr_points + chunk_size - 1) / chunk_size;
+    unsigned int nr_fields = static_cast<unsigned int>(fields.size());
+    int nr_blocks = static_cast<int>(nr_chunks * nr_fields);
+
+    // Gather and compress every (field, chunk) block independently. A block
+    // that does not shrink is stored verbatim.
+    std::vector<std::vector<char> > blocks(nr_blocks);
+    std::vector<unsigned int> blocks_sizes(nr_blocks);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(getNumberOfThreads(threads_))            \
+    schedule(dynamic, 1)
+#endif
+    for (int b = 0; b < nr_blocks; ++b) {
+        unsigned int f = b / nr_chunks;
+        unsigned int chunk_begin = (b % nr_chunks) * chunk_size;
+        unsigned int chunk_points =
+            std::min(chunk_size, nr_points - chunk_begin);
+        size_t size = chunk_points * fields_sizes[f];
+
+        std::vector<char> column(size);
+        const pcl::uint8_t *src =
+            &cloud.data[static_cast<size_t>(chunk_begin) * cloud.point_step +
+                        fields[f].offset];
+        for (unsigned int i = 0; i < chunk_points; ++i) {
+            memcpy(&column[i * fields_sizes[f]], src, fields_sizes[f]);
+            src += cloud.point_step;
+        }
+
+        // LZF expands incompressible data by at most 1 byte every 32 bytes
+        blocks_sizes[b] = static_cast<unsigned int>(size);
+        blocks[b].resize(size + size / 32 + 16);
+        unsigned int compressed_size = pcl::lzfCompress(
+            &column[0], static_cast<unsigned int>(size), &blocks[b][0],
+            static_cast<unsigned int>(blocks[b].size()));
+        if (compressed_size == 0 || compressed_size >= size)
+            blocks[b].swap(column);
+        else
+            blocks[b].resize(compressed_size);
+    }
+
+    // Assemble the block table
+    size_t table_size = PCD_CHUNK_TABLE_HEADER_SIZE +
+                        static_cast<size_t>(nr_blocks) *
+                            PCD_CHUNK_TABLE_ENTRY_SIZE;
+    std::vector<char> table(table_size);
+    memcpy(&table[0], &chunk_size, sizeof(unsigned int));
+    memcpy(&table[4], &nr_chunks, sizeof(unsigned int));
+    memcpy(&table[8], &nr_fields, sizeof(unsigned int));
+    std::vector<size_t> blocks_offsets(nr_blocks);
+    pcl::uint64_t payload_size = 0;
+    for (int b = 0; b < nr_blocks; ++b) {
+        char *entry = &table[PCD_CHUNK_TABLE_HEADER_SIZE +
+                             b * PCD_CHUNK_TABLE_ENTRY_SIZE];
+        unsigned int stored_size = static_cast<unsigned int>(blocks[b].size());
+        memcpy(&entry[0], &payload_size, sizeof(pcl::uint64_t));
+        memcpy(&entry[8], &stored_size, sizeof(unsigned int));
+        memcpy(&entry[12], &blocks_sizes[b], sizeof(unsigned int));
+        blocks_offsets[b] =
+            data_idx + table_size + static_cast<size_t>(payload_size);
+        payload_size += stored_size;
+    }
+    size_t file_size =
+        data_idx + table_size + static_cast<size_t>(payload_size);
+
+#if _WIN32
+    HANDLE h_native_file =
+        CreateFile(file_name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL,
+                   CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h_native_file == INVALID_HANDLE_VALUE) {
+        PCL_ERROR("[pcl::PCDWriter::writeBinaryCompressedChunked] Error during "
+                  "CreateFile (%s)!\n",
+                  file_name.c_str());
+        return (-1);
+    }
+#else
+    int fd = pcl_open(file_name.c_str(), O_RDWR | O_CREAT | O_TRUNC,
+                      static_cast<mode_t>(0600));
+    if (fd < 0) {
+        PCL_ERROR("[pcl::PCDWriter::writeBinaryCompressedChunked] Error during "
+                  "open (%s)!\n",
+                  file_name.c_str());
+        return (-1);
+    }
+#endif
+    // Mandatory lock file
+    boost::interprocess::file_lock file_lock;
+    setLockingPermissions(file_name, file_lock);
+
+#if !_WIN32
+    // Stretch the file size to the size of the data
+    int result = static_cast<int>(pcl_lseek(fd, file_size - 1, SEEK_SET));
+    if (result < 0) {
+        pcl_close(fd);
+        resetLockingPermissions(file_name, file_lock);
+        PCL_ERROR("[pcl::PCDWriter::writeBinaryCompressedChunked] Error during "
+                  "lseek ()!\n");
+        return (-1);
+    }
+    // Write a bogus entry so that the new file size comes in effect
+    result = static_cast<int>(::write(fd, "", 1));
+    if (result != 1) {
+        pcl_close(fd);
+        resetLockingPermissions(file_name, file_lock);
+        PCL_ERROR("[pcl::PCDWriter::writeBinaryCompressedChunked] Error during "
+                  "write ()!\n");
+        return (-1);
+    }
+#endif
+
+    // Prepare the map
+#ifdef _WIN32
+    HANDLE fm = CreateFileMapping(h_native_file, NULL, PAGE_READWRITE, 0,
+                                  static_cast<DWORD>(file_size), NULL);
+    char *map = static_cast<char *>(MapViewOfFile(
+        fm, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, file_size));
+    CloseHandle(fm);
+#else
+    char *map = static_cast<char *>(
+        mmap(0, file_size, PROT_WRITE, MAP_SHARED, fd, 0));
+    if (map == reinterpret_cast<char *>(-1)) // MAP_FAILED
+    {
+        pcl_close(fd);
+        resetLockingPermissions(file_name, file_lock);
+        PCL_ERROR("[pcl::PCDWriter::writeBinaryCompressedChunked] Error during "
+                  "mmap ()!\n");
+        return (-1);
+    }
+#endif
+
+    // Copy the header, the block table and the blocks
+    memcpy(&map[0], oss.str().c_str(), data_idx);
+    memcpy(&map[data_idx], &table[0], table_size);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(getNumberOfThreads(threads_))
+#endif
+    for (int b = 0; b < nr_blocks; ++b)
+        if (!blocks[b].empty())
+            memcpy(&map[blocks_offsets[b]], &blocks[b][0], blocks[b].size());
+
+#if !_WIN32
+    // If the user set the synchronization flag on, call msync
+    if (map_synchronization_)
+        msync(map, file_size, MS_SYNC);
+#endif
+
+    // Unmap the pages of memory
+#if _WIN32
+    UnmapViewOfFile(map);
+#else
+    if (munmap(map, file_size) == -1) {
+        pcl_close(fd);
+        resetLockingPermissions(file_name, file_lock);
+        PCL_ERROR("[pcl::PCDWriter::writeBinaryCompressedChunked] Error during "
+                  "munmap ()!\n");
+        return (-1);
+    }
+#endif
+    // Close file
+#if _WIN32
+    CloseHandle(h_native_file);
+#else
+    pcl_close(fd);
+#endif
+    resetLockingPermissions(file_name, file_lock);
+    return (0);
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 std::string pcl::PCDWriter::generateHeaderEigen(
     const pcl::PointCloud<Eigen::MatrixXf> &cloud, const int nr_points) {
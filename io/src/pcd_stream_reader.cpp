@@ -0,0 +1,523 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Point Cloud Library (PCL) - www.pointclouds.org
+ *  Copyright (c) 2010-2011, Willow Garage, Inc.
+ *  Copyright (c) 2012-, Open Perception, Inc.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <pcl/io/boost.h>
+#include <pcl/io/lzf.h>
+#include <pcl/io/number_parser.h>
+#include <pcl/io/pcd_stream_reader.h>
+
+namespace pcl {
+namespace detail {
+/** \brief Sequential source of the bytes of one field column of a compressed
+ * PCD data section.
+ */
+class PCDFieldStream {
+  public:
+    virtual ~PCDFieldStream() {}
+
+    /** \brief Copy the next n bytes of the column to out.
+     * \return false on a read or decoding error
+     */
+    virtual bool read(char *out, size_t n) = 0;
+};
+} // namespace detail
+} // namespace pcl
+
+namespace {
+/** \brief Incremental decoder for a single LZF stream (binary_compressed).
+ *
+ * The compressed data is read from disk in small blocks and only the last
+ * 8 KB of output (the largest back reference distance LZF can encode) are
+ * kept, so any prefix of the stream can be decoded in constant memory. As
+ * nothing older is ever referenced, that window and the position in the
+ * input are all it takes for another decoder to resume from the same point
+ * (see resume ()).
+ */
+class LZFFieldStream : public pcl::detail::PCDFieldStream {
+  public:
+    LZFFieldStream()
+        : fs_(), begin_(0), in_(1 << 16), in_pos_(0), in_len_(0),
+          remaining_(0), consumed_(0), window_(WINDOW_SIZE), out_pos_(0),
+          literal_(0), ref_len_(0), ref_dist_(0) {}
+
+    /** \brief Open the stream on compressed_size bytes of file_name,
+     * starting at begin.
+     */
+    bool open(const std::string &file_name, std::streamoff begin,
+              size_t compressed_size) {
+        fs_.open(file_name.c_str(), std::ios::binary);
+        if (!fs_.is_open())
+            return (false);
+        fs_.seekg(begin);
+        begin_ = begin;
+        remaining_ = compressed_size;
+        return (true);
+    }
+
+    /** \brief Open the stream on the file of other, at the point where
+     * other is, without decoding the data before it.
+     */
+    bool resume(const std::string &file_name, const LZFFieldStream &other) {
+        // The input left in the buffer of other is read again from the file
+        size_t buffered = other.in_len_ - other.in_pos_;
+        std::streamoff consumed =
+            static_cast<std::streamoff>(other.consumed_ - buffered);
+        if (!open(file_name, other.begin_ + consumed,
+                  other.remaining_ + buffered))
+            return (false);
+        consumed_ = static_cast<size_t>(consumed);
+        window_ = other.window_;
+        out_pos_ = other.out_pos_;
+        literal_ = other.literal_;
+        ref_len_ = other.ref_len_;
+        ref_dist_ = other.ref_dist_;
+        return (true);
+    }
+
+    /** \brief Drop the next n decompressed bytes. */
+    bool skip(size_t n) { return (decode(NULL, n)); }
+
+    bool read(char *out, size_t n) { return (decode(out, n)); }
+
+  private:
+    /** \brief Power of two, larger than the maximum back reference. */
+    static const size_t WINDOW_SIZE = 1 << 14;
+
+    inline bool nextByte(unsigned char &c) {
+        if (in_pos_ == in_len_) {
+            if (remaining_ == 0)
+                return (false);
+            in_len_ = std::min(in_.size(), remaining_);
+            fs_.read(&in_[0], in_len_);
+            if (static_cast<size_t>(fs_.gcount()) != in_len_)
+                return (false);
+            remaining_ -= in_len_;
+            consumed_ += in_len_;
+            in_pos_ = 0;
+        }
+        c = static_cast<unsigned char>(in_[in_pos_++]);
+        return (true);
+    }
+
+    inline void emit(unsigned char c, char *&out) {
+        window_[out_pos_++ & (WINDOW_SIZE - 1)] = c;
+        if (out)
+            *out++ = static_cast<char>(c);
+    }
+
+    /** \brief Decode the next n bytes into out (or drop them if out is
+     * NULL). Literal runs and back references may straddle calls.
+     */
+    bool decode(char *out, size_t n) {
+        unsigned char c;
+        while (n > 0) {
+            if (literal_ > 0) {
+                if (!nextByte(c))
+                    return (false);
+                emit(c, out);
+                --literal_;
+                --n;
+            } else if (ref_len_ > 0) {
+                emit(window_[(out_pos_ - ref_dist_) & (WINDOW_SIZE - 1)], out);
+                --ref_len_;
+                --n;
+            } else {
+                unsigned char ctrl;
+                if (!nextByte(ctrl))
+                    return (false);
+                if (ctrl < (1 << 5)) {
+                    literal_ = ctrl + 1u;
+                    continue;
+                }
+                unsigned int len = ctrl >> 5;
+                if (len == 7) {
+                    if (!nextByte(c))
+                        return (false);
+                    len += c;
+                }
+                if (!nextByte(c))
+                    return (false);
+                ref_dist_ = ((ctrl & 0x1fu) << 8) + c + 1u;
+                if (ref_dist_ > out_pos_)
+                    return (false);
+                ref_len_ = len + 2;
+            }
+        }
+        return (true);
+    }
+
+    std::ifstream fs_;
+    /** \brief Offset of the stream in the file. */
+    std::streamoff begin_;
+    std::vector<char> in_;
+    /** \brief Compressed bytes left in the file, and read so far. */
+    size_t in_pos_, in_len_, remaining_, consumed_;
+    std::vector<unsigned char> window_;
+    size_t out_pos_;
+    unsigned int literal_, ref_len_;
+    size_t ref_dist_;
+};
+
+/** \brief One field of a binary_compressed_chunked data section, read and
+ * decompressed one block at a time.
+ */
+class ChunkedFieldStream : public pcl::detail::PCDFieldStream {
+  public:
+    struct Block {
+        std::streamoff offset;
+        unsigned int stored_size, size;
+    };
+
+    ChunkedFieldStream(const std::string &file_name,
+                       const std::vector<Block> &blocks)
+        : fs_(file_name.c_str(), std::ios::binary), blocks_(blocks),
+          block_(0), pos_(0) {}
+
+    bool read(char *out, size_t n) {
+        while (n > 0) {
+            if (pos_ == data_.size()) {
+                if (!loadBlock())
+                    return (false);
+                continue;
+            }
+            size_t len = std::min(n, data_.size() - pos_);
+            memcpy(out, &data_[pos_], len);
+            pos_ += len;
+            out += len;
+            n -= len;
+        }
+        return (true);
+    }
+
+  private:
+    bool loadBlock() {
+        if (block_ == blocks_.size() || !fs_.is_open())
+            return (false);
+        const Block &b = blocks_[block_++];
+        data_.resize(b.size);
+        pos_ = 0;
+        fs_.seekg(b.offset);
+        if (b.stored_size == b.size) {
+            fs_.read(&data_[0], b.size);
+            return (static_cast<size_t>(fs_.gcount()) == b.size);
+        }
+        compressed_.resize(b.stored_size);
+        fs_.read(&compressed_[0], b.stored_size);
+        if (static_cast<size_t>(fs_.gcount()) != b.stored_size)
+            return (false);
+        return (pcl::lzfDecompress(&compressed_[0], b.stored_size, &data_[0],
+                                   b.size) == b.size);
+    }
+
+    std::ifstream fs_;
+    std::vector<Block> blocks_;
+    size_t block_, pos_;
+    std::vector<char> data_, compressed_;
+};
+
+/** \brief Read an unsigned int from the current position of fs. */
+inline bool readUInt(std::ifstream &fs, unsigned int &value) {
+    fs.read(reinterpret_cast<char *>(&value), sizeof(unsigned int));
+    return (fs.gcount() == sizeof(unsigned int));
+}
+
+/** \brief Check the floating point fields of a cloud for NaN/Inf values. */
+bool isDense(const sensor_msgs::PointCloud2 &cloud) {
+    size_t nr_points = cloud.width * cloud.height;
+    for (size_t d = 0; d < cloud.fields.size(); ++d) {
+        const sensor_msgs::PointField &field = cloud.fields[d];
+        if (field.datatype != sensor_msgs::PointField::FLOAT32 &&
+            field.datatype != sensor_msgs::PointField::FLOAT64)
+            continue;
+        for (size_t i = 0; i < nr_points; ++i) {
+            const uint8_t *p =
+                &cloud.data[i * cloud.point_step + field.offset];
+            for (unsigned int c = 0; c < field.count; ++c) {
+                if (field.datatype == sensor_msgs::PointField::FLOAT32) {
+                    float v;
+                    memcpy(&v, p + c * sizeof(float), sizeof(float));
+                    if (!pcl_isfinite(v))
+                        return (false);
+                } else {
+                    double v;
+                    memcpy(&v, p + c * sizeof(double), sizeof(double));
+                    if (!pcl_isfinite(v))
+                        return (false);
+                }
+            }
+        }
+    }
+    return (true);
+}
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////////////////
+pcl::PCDStreamReader::PCDStreamReader(unsigned int chunk_size)
+    : file_name_(), header_(), origin_(Eigen::Vector4f::Zero()),
+      orientation_(Eigen::Quaternionf::Identity()), data_type_(-1),
+      nr_points_(0), points_read_(0), chunk_size_(chunk_size > 0 ? chunk_size
+                                                                 : 1),
+      fs_(), field_ids_(), field_streams_(), column_(), blob_() {}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+pcl::PCDStreamReader::~PCDStreamReader() { close(); }
+
+///////////////////////////////////////////////////////////////////////////////////////////
+int pcl::PCDStreamReader::open(const std::string &file_name,
+                               const int offset) {
+    close();
+
+    pcl::PCDReader reader;
+    int pcd_version, data_type;
+    unsigned int data_idx;
+    if (reader.parseHeader(file_name, header_, origin_, orientation_,
+                           pcd_version, data_type, data_idx, offset) < 0)
+        return (-1);
+
+    nr_points_ = static_cast<size_t>(header_.width) * header_.height;
+    for (size_t i = 0; i < header_.fields.size(); ++i)
+        if (header_.fields[i].name != "_")
+            field_ids_.push_back(static_cast<int>(i));
+
+    std::ios::openmode mode = data_type == 0 ? std::ios::in : std::ios::binary;
+    fs_.open(file_name.c_str(), mode);
+    if (!fs_.is_open() || fs_.fail()) {
+        PCL_ERROR("[pcl::PCDStreamReader::open] Could not open file %s.\n",
+                  file_name.c_str());
+        close();
+        return (-1);
+    }
+    fs_.seekg(data_idx);
+
+    if (data_type == 2) {
+        unsigned int compressed_size, uncompressed_size;
+        if (!readUInt(fs_, compressed_size) ||
+            !readUInt(fs_, uncompressed_size)) {
+            PCL_ERROR("[pcl::PCDStreamReader::open] Could not read the "
+                      "compressed data size of %s.\n",
+                      file_name.c_str());
+            close();
+            return (-1);
+        }
+        // One decoder per field, each one positioned at the start of its
+        // column. A single scan of the stream finds these positions (and
+        // checks that the whole stream decodes), so that no decoder has to
+        // decode the columns before its own
+        LZFFieldStream scan;
+        bool ok = scan.open(file_name,
+                            static_cast<std::streamoff>(data_idx) + 8,
+                            compressed_size);
+        for (size_t f = 0; ok && f < field_ids_.size(); ++f) {
+            const sensor_msgs::PointField &field =
+                header_.fields[field_ids_[f]];
+            boost::shared_ptr<LZFFieldStream> stream(new LZFFieldStream);
+            ok = stream->resume(file_name, scan) &&
+                 scan.skip(nr_points_ * field.count *
+                           getFieldSize(field.datatype));
+            field_streams_.push_back(stream);
+        }
+        if (!ok) {
+            PCL_ERROR("[pcl::PCDStreamReader::open] Corrupted compressed "
+                      "data in %s.\n",
+                      file_name.c_str());
+            close();
+            return (-1);
+        }
+        fs_.close();
+    } else if (data_type == 3) {
+        unsigned int chunk_size, nr_chunks, nr_fields;
+        if (!readUInt(fs_, chunk_size) || !readUInt(fs_, nr_chunks) ||
+            !readUInt(fs_, nr_fields) || chunk_size == 0 ||
+            nr_fields != field_ids_.size() ||
+            nr_chunks != (nr_points_ + chunk_size - 1) / chunk_size) {
+            PCL_ERROR("[pcl::PCDStreamReader::open] Corrupted "
+                      "binary_compressed_chunked block table in %s.\n",
+                      file_name.c_str());
+            close();
+            return (-1);
+        }
+        std::streamoff payload_idx =
+            static_cast<std::streamoff>(data_idx) + 12 +
+            static_cast<std::streamoff>(nr_chunks) * nr_fields * 16;
+        for (unsigned int f = 0; f < nr_fields; ++f) {
+            std::vector<ChunkedFieldStream::Block> blocks(nr_chunks);
+            for (unsigned int c = 0; c < nr_chunks; ++c) {
+                pcl::uint64_t offset;
+                fs_.read(reinterpret_cast<char *>(&offset), sizeof(offset));
+                if (fs_.gcount() != sizeof(offset) ||
+                    !readUInt(fs_, blocks[c].stored_size) ||
+                    !readUInt(fs_, blocks[c].size)) {
+                    PCL_ERROR("[pcl::PCDStreamReader::open] Truncated block "
+                              "table in %s.\n",
+                              file_name.c_str());
+                    close();
+                    return (-1);
+                }
+                blocks[c].offset =
+                    payload_idx + static_cast<std::streamoff>(offset);
+            }
+            field_streams_.push_back(boost::shared_ptr<ChunkedFieldStream>(
+                new ChunkedFieldStream(file_name, blocks)));
+        }
+        fs_.close();
+    }
+
+    file_name_ = file_name;
+    data_type_ = data_type;
+    return (0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+void pcl::PCDStreamReader::close() {
+    if (fs_.is_open())
+        fs_.close();
+    fs_.clear();
+    field_streams_.clear();
+    field_ids_.clear();
+    std::vector<char>().swap(column_);
+    file_name_.clear();
+    header_ = sensor_msgs::PointCloud2();
+    data_type_ = -1;
+    nr_points_ = points_read_ = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+int pcl::PCDStreamReader::readChunk(sensor_msgs::PointCloud2 &chunk) {
+    if (!isOpen()) {
+        PCL_ERROR("[pcl::PCDStreamReader::readChunk] No file open!\n");
+        return (-1);
+    }
+
+    unsigned int n = static_cast<unsigned int>(
+        std::min(static_cast<size_t>(chunk_size_), nr_points_ - points_read_));
+    chunk.header = header_.header;
+    chunk.fields = header_.fields;
+    chunk.is_bigendian = header_.is_bigendian;
+    chunk.point_step = header_.point_step;
+    chunk.height = 1;
+    chunk.width = n;
+    chunk.row_step = n * header_.point_step;
+    chunk.is_dense = true;
+    chunk.data.resize(chunk.row_step);
+    if (n == 0)
+        return (0);
+
+    int res = 0;
+    if (data_type_ == 0)
+        res = readASCII(chunk, n);
+    else if (data_type_ == 1) {
+        fs_.read(reinterpret_cast<char *>(&chunk.data[0]), chunk.row_step);
+        if (static_cast<size_t>(fs_.gcount()) != chunk.row_step) {
+            PCL_ERROR("[pcl::PCDStreamReader::readChunk] Unexpected end of "
+                      "file in %s!\n",
+                      file_name_.c_str());
+            res = -1;
+        }
+    } else
+        res = readColumns(chunk, n);
+    if (res < 0)
+        return (res);
+
+    if (data_type_ != 0)
+        chunk.is_dense = isDense(chunk);
+    points_read_ += n;
+    return (static_cast<int>(n));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+int pcl::PCDStreamReader::readASCII(sensor_msgs::PointCloud2 &chunk,
+                                    unsigned int n) {
+    std::string line;
+    unsigned int idx = 0;
+    bool is_dense = true;
+    while (idx < n && getline(fs_, line)) {
+        const char *p = line.data(), *end = p + line.size();
+        // Ignore empty lines
+        pcl::io::skipBlanks(p, end);
+        if (p == end)
+            continue;
+
+        if (!pcl::io::parseASCIIPoint(p, end, chunk,
+                                      &chunk.data[idx * chunk.point_step],
+                                      is_dense)) {
+            PCL_ERROR("[pcl::PCDStreamReader::readChunk] Could not parse "
+                      "point %u: missing or invalid values!\n",
+                      static_cast<unsigned int>(points_read_ + idx));
+            return (-1);
+        }
+        idx++;
+    }
+    if (!is_dense)
+        chunk.is_dense = false;
+
+    if (idx != n) {
+        PCL_ERROR("[pcl::PCDStreamReader::readChunk] Number of points read "
+                  "(%u) is different than expected (%u)\n",
+                  static_cast<unsigned int>(points_read_ + idx),
+                  static_cast<unsigned int>(nr_points_));
+        return (-1);
+    }
+    return (0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+int pcl::PCDStreamReader::readColumns(sensor_msgs::PointCloud2 &chunk,
+                                      unsigned int n) {
+    for (size_t f = 0; f < field_ids_.size(); ++f) {
+        const sensor_msgs::PointField &field = chunk.fields[field_ids_[f]];
+        size_t field_size = field.count * getFieldSize(field.datatype);
+        column_.resize(n * field_size);
+        if (!field_streams_[f]->read(&column_[0], column_.size())) {
+            PCL_ERROR("[pcl::PCDStreamReader::readChunk] Corrupted or "
+                      "truncated compressed data in %s!\n",
+                      file_name_.c_str());
+            return (-1);
+        }
+        // Unpack the xxyyzz to xyz
+        const char *src = &column_[0];
+        uint8_t *dst = &chunk.data[field.offset];
+        for (unsigned int i = 0; i < n;
+             ++i, src += field_size, dst += chunk.point_step)
+            memcpy(dst, src, field_size);
+    }
+    return (0);
+}
@@ -518,18 +518,20 @@ bool pcl::io::ply::ply_parser::parse(const std::string &filename) {
                     return false;
                 }
                 ++line_number_;
-                std::istringstream stringstream(line);
-                stringstream.unsetf(std::ios_base::skipws);
-                stringstream >> std::ws;
+                // Values are converted in place, without any per line stream
+                const char *p = line.c_str();
+                const char *end = p + line.size();
+                while (p != end && isspace(static_cast<unsigned char>(*p)))
+                    ++p;
                 for (std::vector<boost::shared_ptr<property>>::const_iterator
                          property_iterator = element.properties.begin();
                      property_iterator != element.properties.end();
                      ++property_iterator) {
                     struct property &property = *(property_iterator->get());
-                    if (property.parse(*this, format, stringstream) == false)
+                    if (property.parse(*this, p, end) == false)
                         return false;
                 }
-                if (!stringstream.eof()) {
+                if (p != end) {
                     if (error_callback_)
                         error_callback_(line_number_, "parse error");
                     return false;
@@ -558,6 +560,37 @@ bool pcl::io::ply::ply_parser::parse(const std::string &filename) {
                  element_iterator = elements.begin();
              element_iterator != elements.end(); ++element_iterator) {
             struct element &element = *(element_iterator->get());
+            if (fixed_size_element_callback_) {
+                element_layout_type layout;
+                std::vector<boost::shared_ptr<property>>::const_iterator
+                    property_iterator = element.properties.begin();
+                for (; property_iterator != element.properties.end();
+                     ++property_iterator) {
+                    property_layout property;
+                    property.name = (*property_iterator)->name;
+                    property.size = (*property_iterator)->binary_size();
+                    property.handled = (*property_iterator)->handled();
+                    if (property.size == 0)
+                        break;
+                    layout.push_back(property);
+                }
+                bool swap_bytes =
+                    ((format == binary_big_endian_format) &&
+                     (host_byte_order == little_endian_byte_order)) ||
+                    ((format == binary_little_endian_format) &&
+                     (host_byte_order == big_endian_byte_order));
+                // Records without list properties may be read in bulk
+                if (property_iterator == element.properties.end() &&
+                    fixed_size_element_callback_(element.name, element.count,
+                                                 layout, swap_bytes, istream)) {
+                    if (!istream) {
+                        if (error_callback_)
+                            error_callback_(line_number_, "parse error");
+                        return false;
+                    }
+                    continue;
+                }
+            }
             for (std::size_t element_index = 0; element_index < element.count;
                  ++element_index) {
                 if (element.begin_element_callback) {
@@ -37,6 +37,7 @@
 
 #include <fstream>
 #include <fcntl.h>
+#include <algorithm>
 #include <string>
 #include <map>
 #include <stdlib.h>
@@ -331,6 +332,148 @@ void pcl::PLYReader::vertexIntensityCallback(pcl::io::ply::uint8 intensity) {
     vertex_offset_before_ += static_cast<int>(sizeof(pcl::io::ply::float32));
 }
 
+namespace {
+/** \brief What to do with a vertex property read in bulk. */
+enum { COPY, RED, GREEN, BLUE, ALPHA, INTENSITY };
+
+/** \brief Move a property from offset src of a record to offset dst of a
+ * point.
+ */
+struct VertexOperation {
+    int type;
+    size_t src, dst;
+};
+} // namespace
+
+bool pcl::PLYReader::fixedSizeElementCallback(
+    const std::string &element_name, std::size_t count,
+    const pcl::io::ply::ply_parser::element_layout_type &layout,
+    bool swap_bytes, std::istream &istream) {
+    if (element_name != "vertex" || count == 0 ||
+        (vertex_count_ + count) * cloud_->point_step > cloud_->data.size())
+        return (false);
+
+    // Mirror what the per property callbacks do, property by property
+    std::vector<VertexOperation> operations;
+    size_t stride = 0, offset = 0, rgb_offset = 0;
+    int colors = 0;
+    bool identity = true;
+    for (size_t i = 0; i < layout.size(); ++i) {
+        const pcl::io::ply::ply_parser::property_layout &property = layout[i];
+        VertexOperation operation = {COPY, stride, offset};
+        stride += property.size;
+        if (!property.handled) {
+            identity = false;
+            continue;
+        }
+        const std::string &name = property.name;
+        if (property.size == 4)
+            offset += 4;
+        else if (property.size != 1)
+            return (false);
+        else if (name == "red" || name == "diffuse_red") {
+            operation.type = RED;
+            rgb_offset = offset;
+            colors = 1;
+        } else if (name == "green" || name == "diffuse_green") {
+            // The callbacks expect red, green, blue [, alpha] in this order
+            if (colors != 1)
+                return (false);
+            operation.type = GREEN;
+            colors = 2;
+        } else if (name == "blue" || name == "diffuse_blue") {
+            if (colors != 2)
+                return (false);
+            operation.type = BLUE;
+            operation.dst = rgb_offset;
+            offset += 4;
+            colors = 3;
+        } else if (name == "alpha") {
+            if (colors != 3)
+                return (false);
+            operation.type = ALPHA;
+            operation.dst = rgb_offset;
+        } else if (name == "intensity") {
+            operation.type = INTENSITY;
+            offset += 4;
+        } else
+            return (false);
+        identity = identity && operation.type == COPY &&
+                   operation.src == operation.dst;
+        operations.push_back(operation);
+    }
+    if (offset != cloud_->point_step || (colors != 0 && colors != 3))
+        return (false);
+
+    uint8_t *out = &cloud_->data[vertex_count_ * cloud_->point_step];
+    if (identity && stride == cloud_->point_step) {
+        // Same layout on disk and in memory: a single read does it all
+        istream.read(reinterpret_cast<char *>(out),
+                     static_cast<std::streamsize>(count * stride));
+        if (swap_bytes)
+            for (size_t i = 0; i < count * stride; i += 4)
+                pcl::io::ply::swap_byte_order<4>(
+                    reinterpret_cast<char *>(out + i));
+        vertex_count_ += count;
+        return (true);
+    }
+
+    // Otherwise read blocks of records and scatter them
+    const size_t block_size = 1 << 14;
+    std::vector<char> buffer(std::min(count, block_size) * stride);
+    uint32_t r = 0, g = 0, b = 0;
+    for (size_t first = 0; first < count; first += block_size) {
+        size_t n = std::min(count - first, block_size);
+        istream.read(&buffer[0], static_cast<std::streamsize>(n * stride));
+        if (!istream)
+            return (true);
+        for (size_t i = 0; i < n; ++i, out += cloud_->point_step) {
+            char *record = &buffer[i * stride];
+            for (size_t o = 0; o < operations.size(); ++o) {
+                const VertexOperation &operation = operations[o];
+                char *value = record + operation.src;
+                switch (operation.type) {
+                case COPY:
+                    if (swap_bytes)
+                        pcl::io::ply::swap_byte_order<4>(value);
+                    memcpy(out + operation.dst, value, 4);
+                    break;
+                case RED:
+                    r = static_cast<uint8_t>(*value);
+                    break;
+                case GREEN:
+                    g = static_cast<uint8_t>(*value);
+                    break;
+                case BLUE: {
+                    b = static_cast<uint8_t>(*value);
+                    uint32_t rgb = r << 16 | g << 8 | b;
+                    memcpy(out + operation.dst, &rgb, sizeof(uint32_t));
+                    break;
+                }
+                case ALPHA: {
+                    uint32_t rgba;
+                    memcpy(&rgba, out + operation.dst, sizeof(uint32_t));
+                    rgba |= static_cast<uint32_t>(
+                                static_cast<uint8_t>(*value))
+                            << 24;
+                    memcpy(out + operation.dst, &rgba, sizeof(uint32_t));
+                    break;
+                }
+                case INTENSITY: {
+                    pcl::io::ply::float32 intensity =
+                        static_cast<uint8_t>(*value);
+                    memcpy(out + operation.dst, &intensity,
+                           sizeof(pcl::io::ply::float32));
+                    break;
+                }
+                }
+            }
+        }
+    }
+    vertex_count_ += count;
+    return (true);
+}
+
 void pcl::PLYReader::vertexBeginCallback() { vertex_offset_before_ = 0; }
 
 void pcl::PLYReader::vertexEndCallback() { ++vertex_count_; }
@@ -392,6 +535,8 @@ bool pcl::PLYReader::parse(const std::string &istream_filename) {
         boost::bind(&pcl::PLYReader::elementDefinitionCallback, this, _1, _2));
     ply_parser.end_header_callback(
         boost::bind(&pcl::PLYReader::endHeaderCallback, this));
+    ply_parser.fixed_size_element_callback(boost::bind(
+        &pcl::PLYReader::fixedSizeElementCallback, this, _1, _2, _3, _4, _5));
 
     pcl::io::ply::ply_parser::scalar_property_definition_callbacks_type
         scalar_property_definition_callbacks;
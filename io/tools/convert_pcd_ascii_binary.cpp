@@ -54,8 +54,9 @@ using namespace std;
 int main(int argc, char **argv) {
     if (argc < 4) {
         std::cerr << "Syntax is: " << argv[0]
-                  << " <file_in.pcd> <file_out.pcd> 0/1/2 "
-                     "(ascii/binary/binary_compressed) [precision (ASCII)]"
+                  << " <file_in.pcd> <file_out.pcd> 0/1/2/3 "
+                     "(ascii/binary/binary_compressed/"
+                     "binary_compressed_chunked) [precision (ASCII)]"
                   << std::endl;
         return (-1);
     }
@@ -88,6 +89,11 @@ int main(int argc, char **argv) {
         std::cerr << "Saving file " << argv[2] << " as binary_compressed."
                   << std::endl;
         w.writeBinaryCompressed(string(argv[2]), cloud, origin, orientation);
+    } else if (type == 3) {
+        std::cerr << "Saving file " << argv[2]
+                  << " as binary_compressed_chunked." << std::endl;
+        w.writeBinaryCompressedChunked(string(argv[2]), cloud, origin,
+                                       orientation);
     }
 }
 /* ]--- */
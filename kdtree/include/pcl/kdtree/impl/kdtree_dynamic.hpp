@@ -0,0 +1,331 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Point Cloud Library (PCL) - www.pointclouds.org
+ *  Copyright (c) 2010-2011, Willow Garage, Inc.
+ *  Copyright (c) 2012-, Open Perception, Inc.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_KDTREE_KDTREE_DYNAMIC_IMPL_H_
+#define PCL_KDTREE_KDTREE_DYNAMIC_IMPL_H_
+
+#include <pcl/kdtree/kdtree_dynamic.h>
+#include <pcl/kdtree/impl/kdtree_static.hpp>
+#include <pcl/console/print.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::KdTreeDynamic<PointT>::setInputCloud(
+    const PointCloudConstPtr &cloud, const IndicesConstPtr &indices) {
+    if (!cloud) {
+        PCL_ERROR("[pcl::KdTreeDynamic::setInputCloud] Invalid input!\n");
+        return;
+    }
+    if (point_representation_->getNumberOfDimensions() > 3) {
+        PCL_ERROR("[pcl::KdTreeDynamic::setInputCloud] The point "
+                  "representation has %d dimensions, at most 3 are "
+                  "supported!\n",
+                  point_representation_->getNumberOfDimensions());
+        return;
+    }
+
+    boost::shared_ptr<std::vector<int>> candidates(new std::vector<int>);
+    if (cloud.get() == cloud_.get()) {
+        // Rebuild from the points currently in the tree, e.g. after a change
+        // of point representation
+        for (size_t i = 0; i < removed_.size(); ++i)
+            if (!removed_[i])
+                candidates->push_back(static_cast<int>(i));
+    } else {
+        *cloud_ = *cloud;
+        indices_ = indices;
+        if (indices)
+            *candidates = *indices;
+        else {
+            candidates->resize(cloud_->size());
+            for (size_t i = 0; i < cloud_->size(); ++i)
+                (*candidates)[i] = static_cast<int>(i);
+        }
+    }
+    input_ = cloud_;
+
+    boost::shared_ptr<std::vector<int>> valid(new std::vector<int>);
+    valid->reserve(candidates->size());
+    for (size_t i = 0; i < candidates->size(); ++i)
+        if (point_representation_->isValid(cloud_->points[(*candidates)[i]]))
+            valid->push_back((*candidates)[i]);
+
+    trees_.clear();
+    removed_.assign(cloud_->size(), 1);
+    tree_ids_.assign(cloud_->size(), -1);
+    for (size_t i = 0; i < valid->size(); ++i)
+        removed_[(*valid)[i]] = 0;
+    free_ids_.clear();
+    for (size_t i = removed_.size(); i-- > 0;)
+        if (removed_[i])
+            free_ids_.push_back(static_cast<int>(i));
+    if (!valid->empty()) {
+        trees_.push_back(buildTree(valid));
+        updateTreeIds(0);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::KdTreeDynamic<PointT>::addPoints(const PointCloud &cloud,
+                                          std::vector<int> &indices) {
+    if (!input_)
+        input_ = cloud_;
+
+    // Take the places of removed points first, then append the other points
+    const size_t nr_reused = std::min(free_ids_.size(), cloud.size());
+    indices.resize(cloud.size());
+    for (size_t i = 0; i < nr_reused; ++i) {
+        indices[i] = free_ids_.back();
+        free_ids_.pop_back();
+        cloud_->points[indices[i]] = cloud.points[i];
+    }
+    const size_t first = cloud_->size();
+    cloud_->points.insert(cloud_->points.end(),
+                          cloud.points.begin() + nr_reused,
+                          cloud.points.end());
+    for (size_t i = nr_reused; i < cloud.size(); ++i)
+        indices[i] = static_cast<int>(first + i - nr_reused);
+    cloud_->width = static_cast<uint32_t>(cloud_->points.size());
+    cloud_->height = 1;
+    cloud_->is_dense = cloud_->is_dense && cloud.is_dense;
+    removed_.resize(cloud_->size(), 1);
+    tree_ids_.resize(cloud_->size(), -1);
+
+    boost::shared_ptr<std::vector<int>> valid(new std::vector<int>);
+    valid->reserve(cloud.size());
+    for (size_t i = 0; i < indices.size(); ++i) {
+        if (point_representation_->isValid(cloud_->points[indices[i]])) {
+            valid->push_back(indices[i]);
+            removed_[indices[i]] = 0;
+        } else
+            free_ids_.push_back(indices[i]);
+    }
+    if (valid->empty())
+        return;
+
+    trees_.push_back(buildTree(valid));
+    updateTreeIds(trees_.size() - 1);
+    balance();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+int pcl::KdTreeDynamic<PointT>::removeIndices(const std::vector<int> &indices) {
+    int nr_removed = 0;
+    for (size_t i = 0; i < indices.size(); ++i) {
+        const int index = indices[i];
+        if (index < 0 || index >= static_cast<int>(removed_.size()) ||
+            removed_[index])
+            continue;
+        removed_[index] = 1;
+        ++trees_[tree_ids_[index]].nr_removed;
+        tree_ids_[index] = -1;
+        ++nr_removed;
+    }
+    if (nr_removed > 0)
+        balance();
+    return (nr_removed);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+int pcl::KdTreeDynamic<PointT>::removePointsInBox(
+    const Eigen::Vector4f &min_pt, const Eigen::Vector4f &max_pt) {
+    std::vector<int> indices;
+    for (size_t i = 0; i < cloud_->size(); ++i) {
+        const PointT &point = cloud_->points[i];
+        if (!removed_[i] && point.x >= min_pt[0] && point.x <= max_pt[0] &&
+            point.y >= min_pt[1] && point.y <= max_pt[1] &&
+            point.z >= min_pt[2] && point.z <= max_pt[2])
+            indices.push_back(static_cast<int>(i));
+    }
+    return (removeIndices(indices));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+typename pcl::KdTreeDynamic<PointT>::Tree pcl::KdTreeDynamic<PointT>::buildTree(
+    const boost::shared_ptr<std::vector<int>> &indices) const {
+    Tree tree;
+    tree.tree.reset(new StaticTree(sorted_, leaf_size_));
+    tree.tree->setPointRepresentation(point_representation_);
+    tree.tree->setEpsilon(epsilon_);
+    tree.tree->setInputCloud(cloud_, indices);
+    tree.nr_removed = 0;
+    return (tree);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::KdTreeDynamic<PointT>::getLivePoints(
+    size_t t, std::vector<int> &indices) const {
+    const std::vector<int> &point_ids = trees_[t].tree->point_ids_;
+    indices.reserve(indices.size() + trees_[t].size());
+    for (size_t i = 0; i < point_ids.size(); ++i)
+        if (!removed_[point_ids[i]])
+            indices.push_back(point_ids[i]);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::KdTreeDynamic<PointT>::releaseRemovedPoints(size_t t) {
+    const std::vector<int> &point_ids = trees_[t].tree->point_ids_;
+    for (size_t i = 0; i < point_ids.size(); ++i)
+        if (removed_[point_ids[i]])
+            free_ids_.push_back(point_ids[i]);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> void pcl::KdTreeDynamic<PointT>::balance() {
+    // Compact the trees having lost more than half of their points
+    for (size_t t = 0; t < trees_.size();) {
+        if (2 * trees_[t].nr_removed <= trees_[t].tree->size()) {
+            ++t;
+            continue;
+        }
+        boost::shared_ptr<std::vector<int>> indices(new std::vector<int>);
+        getLivePoints(t, *indices);
+        releaseRemovedPoints(t);
+        if (indices->empty()) {
+            trees_.erase(trees_.begin() + t);
+            updateTreeIds(t);
+        } else {
+            trees_[t] = buildTree(indices);
+            ++t;
+        }
+    }
+
+    // Merge the trees not at least twice as large as the next one
+    for (size_t t = 1; t < trees_.size();) {
+        if (trees_[t - 1].size() >= 2 * trees_[t].size()) {
+            ++t;
+            continue;
+        }
+        boost::shared_ptr<std::vector<int>> indices(new std::vector<int>);
+        getLivePoints(t - 1, *indices);
+        getLivePoints(t, *indices);
+        releaseRemovedPoints(t - 1);
+        releaseRemovedPoints(t);
+        trees_[t - 1] = buildTree(indices);
+        trees_.erase(trees_.begin() + t);
+        updateTreeIds(t - 1);
+        t = 1;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::KdTreeDynamic<PointT>::updateTreeIds(size_t t) {
+    for (; t < trees_.size(); ++t) {
+        const std::vector<int> &point_ids = trees_[t].tree->point_ids_;
+        for (size_t i = 0; i < point_ids.size(); ++i) {
+            if (!removed_[point_ids[i]])
+                tree_ids_[point_ids[i]] = static_cast<int>(t);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+int pcl::KdTreeDynamic<PointT>::nearestKSearch(
+    const PointT &point, int k, std::vector<int> &k_indices,
+    std::vector<float> &k_sqr_distances) const {
+    float query[3];
+    k = std::min(k, size());
+    if (k <= 0 || !toQuery(point, query)) {
+        k_indices.clear();
+        k_sqr_distances.clear();
+        return (0);
+    }
+
+    k_indices.resize(k);
+    k_sqr_distances.resize(k);
+    KNNResultSet result_set(k, std::numeric_limits<float>::max(),
+                            &k_indices[0], &k_sqr_distances[0]);
+    LiveResultSet<KNNResultSet> live_result_set(result_set, removed_);
+    for (size_t t = 0; t < trees_.size(); ++t)
+        trees_[t].tree->searchTree(query, live_result_set);
+
+    k_indices.resize(result_set.found_);
+    k_sqr_distances.resize(result_set.found_);
+    return (result_set.found_);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+int pcl::KdTreeDynamic<PointT>::radiusSearch(
+    const PointT &point, double radius, std::vector<int> &k_indices,
+    std::vector<float> &k_sqr_distances, unsigned int max_nn) const {
+    float query[3];
+    k_indices.clear();
+    k_sqr_distances.clear();
+    if (!toQuery(point, query))
+        return (0);
+
+    const float sqr_radius = static_cast<float>(radius * radius);
+    if (max_nn > 0 && static_cast<int>(max_nn) < size()) {
+        // Only the max_nn nearest neighbors in the radius
+        k_indices.resize(max_nn);
+        k_sqr_distances.resize(max_nn);
+        KNNResultSet result_set(static_cast<int>(max_nn), sqr_radius,
+                                &k_indices[0], &k_sqr_distances[0]);
+        LiveResultSet<KNNResultSet> live_result_set(result_set, removed_);
+        for (size_t t = 0; t < trees_.size(); ++t)
+            trees_[t].tree->searchTree(query, live_result_set);
+        k_indices.resize(result_set.found_);
+        k_sqr_distances.resize(result_set.found_);
+        return (result_set.found_);
+    }
+
+    RadiusResultSet result_set(sqr_radius, k_indices, k_sqr_distances);
+    LiveResultSet<RadiusResultSet> live_result_set(result_set, removed_);
+    for (size_t t = 0; t < trees_.size(); ++t)
+        trees_[t].tree->searchTree(query, live_result_set);
+    if (sorted_ && k_indices.size() > 1)
+        pcl::detail::sortNeighbors(&k_indices[0], &k_sqr_distances[0],
+                                   static_cast<int>(k_indices.size()));
+    return (static_cast<int>(k_indices.size()));
+}
+
+#define PCL_INSTANTIATE_KdTreeDynamic(T)                                       \
+    template class PCL_EXPORTS pcl::KdTreeDynamic<T>;
+
+#endif //#ifndef PCL_KDTREE_KDTREE_DYNAMIC_IMPL_H_
@@ -149,6 +149,101 @@ int pcl::KdTreeFLANN<PointT, Dist>::radiusSearch(
     return (neighbors_in_radius);
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT, typename Dist>
+void pcl::KdTreeFLANN<PointT, Dist>::nearestKSearch(
+    const PointCloud &cloud, const std::vector<int> &indices, int k,
+    Neighborhoods &neighborhoods, unsigned int nr_threads) const {
+    if (k > total_nr_points_)
+        k = total_nr_points_;
+
+    int nr_queries =
+        static_cast<int>(indices.empty() ? cloud.size() : indices.size());
+    pcl::detail::searchNeighborhoods(
+        NearestKSearchFunctor(*this, cloud, indices, k), nr_queries, k,
+        nr_threads, neighborhoods);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT, typename Dist>
+void pcl::KdTreeFLANN<PointT, Dist>::radiusSearch(
+    const PointCloud &cloud, const std::vector<int> &indices, double radius,
+    Neighborhoods &neighborhoods, unsigned int max_nn,
+    unsigned int nr_threads) const {
+    // Has max_nn been set properly?
+    if (max_nn == 0 || max_nn > static_cast<unsigned int>(total_nr_points_))
+        max_nn = total_nr_points_;
+
+    flann::SearchParams params(param_radius_);
+    if (max_nn == static_cast<unsigned int>(total_nr_points_)) {
+        params.max_neighbors = -1; // return all neighbors in radius
+        max_nn = 0;
+    } else
+        params.max_neighbors = max_nn;
+
+    int nr_queries =
+        static_cast<int>(indices.empty() ? cloud.size() : indices.size());
+    // FLANN bounds the neighbors itself, reserving max_nn slots per query
+    // would only waste memory when few points are in the radius
+    pcl::detail::searchNeighborhoods(
+        RadiusSearchFunctor(*this, cloud, indices, radius, params), nr_queries,
+        0, nr_threads, neighborhoods);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT, typename Dist>
+int pcl::KdTreeFLANN<PointT, Dist>::NearestKSearchFunctor::operator()(
+    int i, std::vector<int> &k_indices, std::vector<float> &k_sqr_distances) {
+    const PointT &point = cloud_.points[indices_.empty() ? i : indices_[i]];
+    if (k_ <= 0 || !tree_.point_representation_->isValid(point))
+        return (0);
+
+    k_indices.resize(k_);
+    k_sqr_distances.resize(k_);
+    tree_.point_representation_->vectorize(point, query_);
+
+    flann::Matrix<int> k_indices_mat(&k_indices[0], 1, k_);
+    flann::Matrix<float> k_distances_mat(&k_sqr_distances[0], 1, k_);
+    tree_.flann_index_->knnSearch(
+        flann::Matrix<float>(&query_[0], 1, tree_.dim_), k_indices_mat,
+        k_distances_mat, k_, tree_.param_k_);
+
+    // Do mapping to original point cloud
+    if (!tree_.identity_mapping_) {
+        for (int j = 0; j < k_; ++j)
+            k_indices[j] = tree_.index_mapping_[k_indices[j]];
+    }
+    return (k_);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT, typename Dist>
+int pcl::KdTreeFLANN<PointT, Dist>::RadiusSearchFunctor::operator()(
+    int i, std::vector<int> &k_indices, std::vector<float> &k_sqr_distances) {
+    const PointT &point = cloud_.points[indices_.empty() ? i : indices_[i]];
+    if (!tree_.point_representation_->isValid(point))
+        return (0);
+
+    tree_.point_representation_->vectorize(point, query_);
+
+    indices_buf_[0].clear();
+    dists_buf_[0].clear();
+    int neighbors_in_radius = tree_.flann_index_->radiusSearch(
+        flann::Matrix<float>(&query_[0], 1, tree_.dim_), indices_buf_,
+        dists_buf_, sqr_radius_, params_);
+
+    // Hand the results over, the old buffers being reused for the next query
+    k_indices.swap(indices_buf_[0]);
+    k_sqr_distances.swap(dists_buf_[0]);
+
+    // Do mapping to original point cloud
+    if (!tree_.identity_mapping_) {
+        for (int j = 0; j < neighbors_in_radius; ++j)
+            k_indices[j] = tree_.index_mapping_[k_indices[j]];
+    }
+    return (neighbors_in_radius);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointT, typename Dist>
 void pcl::KdTreeFLANN<PointT, Dist>::cleanup() {
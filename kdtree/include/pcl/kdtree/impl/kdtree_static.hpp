@@ -0,0 +1,373 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Point Cloud Library (PCL) - www.pointclouds.org
+ *  Copyright (c) 2010-2011, Willow Garage, Inc.
+ *  Copyright (c) 2012-, Open Perception, Inc.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_KDTREE_KDTREE_STATIC_IMPL_H_
+#define PCL_KDTREE_KDTREE_STATIC_IMPL_H_
+
+#include <pcl/kdtree/kdtree_static.h>
+#include <pcl/console/print.h>
+#include <algorithm>
+#include <limits>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+namespace pcl {
+namespace detail {
+/** \brief Orders point indices by one of their coordinates. */
+struct KdTreeStaticCompare {
+    KdTreeStaticCompare(const std::vector<float> &coordinates, int dim)
+        : coordinates_(coordinates), dim_(dim) {}
+
+    inline bool operator()(int a, int b) const {
+        return (coordinates_[3 * a + dim_] < coordinates_[3 * b + dim_]);
+    }
+
+    const std::vector<float> &coordinates_;
+    int dim_;
+};
+
+/** \brief Restore the max heap property of the n first neighbors below
+ * root.
+ */
+inline void siftDownNeighbors(int *indices, float *sqr_dists, int root,
+                              int n) {
+    for (int child = 2 * root + 1; child < n; child = 2 * root + 1) {
+        if (child + 1 < n && sqr_dists[child + 1] > sqr_dists[child])
+            ++child;
+        if (sqr_dists[root] >= sqr_dists[child])
+            return;
+        std::swap(sqr_dists[root], sqr_dists[child]);
+        std::swap(indices[root], indices[child]);
+        root = child;
+    }
+}
+
+/** \brief Sort n neighbors by squared distance in place (heap sort, so that
+ * no memory is allocated).
+ */
+inline void sortNeighbors(int *indices, float *sqr_dists, int n) {
+    for (int i = n / 2 - 1; i >= 0; --i)
+        siftDownNeighbors(indices, sqr_dists, i, n);
+    for (int i = n - 1; i > 0; --i) {
+        std::swap(sqr_dists[0], sqr_dists[i]);
+        std::swap(indices[0], indices[i]);
+        siftDownNeighbors(indices, sqr_dists, 0, i);
+    }
+}
+} // namespace detail
+} // namespace pcl
+
+////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::KdTreeStatic<PointT>::setInputCloud(const PointCloudConstPtr &cloud,
+                                              const IndicesConstPtr &indices) {
+    input_ = cloud;
+    indices_ = indices;
+    depth_ = 0;
+    nodes_.clear();
+    leaf_offsets_.clear();
+    x_.clear();
+    y_.clear();
+    z_.clear();
+    point_ids_.clear();
+
+    if (!input_) {
+        PCL_ERROR("[pcl::KdTreeStatic::setInputCloud] Invalid input!\n");
+        return;
+    }
+    if (point_representation_->getNumberOfDimensions() > 3) {
+        PCL_ERROR("[pcl::KdTreeStatic::setInputCloud] The point "
+                  "representation has %d dimensions, at most 3 are "
+                  "supported!\n",
+                  point_representation_->getNumberOfDimensions());
+        return;
+    }
+
+    // Gather the valid points
+    size_t nr_candidates = indices_ ? indices_->size() : input_->size();
+    std::vector<float> coordinates;
+    coordinates.reserve(3 * nr_candidates);
+    point_ids_.reserve(nr_candidates);
+    for (size_t i = 0; i < nr_candidates; ++i) {
+        int id = indices_ ? (*indices_)[i] : static_cast<int>(i);
+        float point[3];
+        if (!toQuery(input_->points[id], point))
+            continue;
+        coordinates.insert(coordinates.end(), point, point + 3);
+        point_ids_.push_back(id);
+    }
+
+    // Split until the leaves hold at most leaf_size_ points
+    const int nr_points = size();
+    while (((nr_points + (1 << depth_) - 1) >> depth_) > leaf_size_)
+        ++depth_;
+    nodes_.resize((1 << depth_) - 1);
+    leaf_offsets_.resize((1 << depth_) + 1);
+    leaf_offsets_.back() = nr_points;
+
+    std::vector<int> order(nr_points);
+    for (int i = 0; i < nr_points; ++i)
+        order[i] = i;
+    buildNode(0, 0, nr_points, 0, order, coordinates);
+
+    // Store the points leaf by leaf. The padding lets the leaf scans read 4
+    // coordinates at a time up to the last point.
+    const float pad = std::numeric_limits<float>::infinity();
+    x_.assign(nr_points + 3, pad);
+    y_.assign(nr_points + 3, pad);
+    z_.assign(nr_points + 3, pad);
+    std::vector<int> point_ids(nr_points);
+    for (int i = 0; i < nr_points; ++i) {
+        x_[i] = coordinates[3 * order[i]];
+        y_[i] = coordinates[3 * order[i] + 1];
+        z_[i] = coordinates[3 * order[i] + 2];
+        point_ids[i] = point_ids_[order[i]];
+    }
+    point_ids_.swap(point_ids);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::KdTreeStatic<PointT>::buildNode(
+    int node, int begin, int end, int depth, std::vector<int> &order,
+    const std::vector<float> &coordinates) {
+    if (depth == depth_) {
+        leaf_offsets_[node - static_cast<int>(nodes_.size())] = begin;
+        return;
+    }
+
+    // Split the widest dimension of the bounding box at the median
+    int dim = 0;
+    int mid = begin + (end - begin) / 2;
+    float split = 0.0f;
+    if (begin < end) {
+        float min_pt[3], max_pt[3];
+        for (int d = 0; d < 3; ++d)
+            min_pt[d] = max_pt[d] = coordinates[3 * order[begin] + d];
+        for (int i = begin + 1; i < end; ++i) {
+            const float *point = &coordinates[3 * order[i]];
+            for (int d = 0; d < 3; ++d) {
+                min_pt[d] = std::min(min_pt[d], point[d]);
+                max_pt[d] = std::max(max_pt[d], point[d]);
+            }
+        }
+        for (int d = 1; d < 3; ++d)
+            if (max_pt[d] - min_pt[d] > max_pt[dim] - min_pt[dim])
+                dim = d;
+
+        std::nth_element(order.begin() + begin, order.begin() + mid,
+                         order.begin() + end,
+                         pcl::detail::KdTreeStaticCompare(coordinates, dim));
+        split = coordinates[3 * order[mid] + dim];
+    }
+    nodes_[node].split = split;
+    nodes_[node].dim = dim;
+
+    buildNode(2 * node + 1, begin, mid, depth + 1, order, coordinates);
+    buildNode(2 * node + 2, mid, end, depth + 1, order, coordinates);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+bool pcl::KdTreeStatic<PointT>::toQuery(const PointT &point,
+                                        float query[3]) const {
+    const int nr_dims = point_representation_->getNumberOfDimensions();
+    query[0] = query[1] = query[2] = 0.0f;
+    if (point_representation_->isTrivial()) {
+        // Avoid the temporary buffer of vectorize ()
+        const float *data = reinterpret_cast<const float *>(&point);
+        for (int d = 0; d < nr_dims; ++d)
+            query[d] = data[d];
+    } else {
+        if (!point_representation_->isValid(point))
+            return (false);
+        point_representation_->vectorize(point, query);
+    }
+    return (pcl_isfinite(query[0]) && pcl_isfinite(query[1]) &&
+            pcl_isfinite(query[2]));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+template <typename ResultSet>
+void pcl::KdTreeStatic<PointT>::searchTree(const float query[3],
+                                           ResultSet &result_set) const {
+    if (point_ids_.empty())
+        return;
+
+    const int nr_internal = static_cast<int>(nodes_.size());
+    const float eps_scale = (1.0f + epsilon_) * (1.0f + epsilon_);
+#ifdef __SSE__
+    const __m128 qx = _mm_set1_ps(query[0]);
+    const __m128 qy = _mm_set1_ps(query[1]);
+    const __m128 qz = _mm_set1_ps(query[2]);
+#endif
+
+    // Every level pushes at most one node, so the stack never holds more
+    // entries than the depth of the tree (at most 31)
+    StackEntry stack[32];
+    int top = 0;
+    StackEntry &root = stack[top++];
+    root.node = 0;
+    root.min_dist = 0.0f;
+    root.offsets[0] = root.offsets[1] = root.offsets[2] = 0.0f;
+
+    while (top > 0) {
+        StackEntry entry = stack[--top];
+        if (entry.min_dist * eps_scale > result_set.worst())
+            continue;
+
+        // Go down to the leaf containing the query, keeping the far children
+        int node = entry.node;
+        while (node < nr_internal) {
+            const Node &split = nodes_[node];
+            const float diff = query[split.dim] - split.split;
+            const int near = 2 * node + (diff < 0.0f ? 1 : 2);
+            const float far_dist = entry.min_dist -
+                                   entry.offsets[split.dim] *
+                                       entry.offsets[split.dim] +
+                                   diff * diff;
+            if (far_dist * eps_scale <= result_set.worst()) {
+                StackEntry &far = stack[top++];
+                far = entry;
+                far.node = 4 * node + 3 - near;
+                far.min_dist = far_dist;
+                far.offsets[split.dim] = diff;
+            }
+            node = near;
+        }
+
+        // Scan the leaf
+        const int leaf = node - nr_internal;
+        const int end = leaf_offsets_[leaf + 1];
+        for (int i = leaf_offsets_[leaf]; i < end; i += 4) {
+            float sqr_dists[4];
+#ifdef __SSE__
+            const __m128 dx = _mm_sub_ps(_mm_loadu_ps(&x_[i]), qx);
+            const __m128 dy = _mm_sub_ps(_mm_loadu_ps(&y_[i]), qy);
+            const __m128 dz = _mm_sub_ps(_mm_loadu_ps(&z_[i]), qz);
+            const __m128 d = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                _mm_mul_ps(dz, dz));
+            int mask = _mm_movemask_ps(
+                _mm_cmple_ps(d, _mm_set1_ps(result_set.worst())));
+            if (end - i < 4)
+                mask &= (1 << (end - i)) - 1;
+            if (mask == 0)
+                continue;
+            _mm_storeu_ps(sqr_dists, d);
+#else
+            int mask = 0;
+            for (int j = 0; j < 4 && i + j < end; ++j) {
+                const float dx = x_[i + j] - query[0];
+                const float dy = y_[i + j] - query[1];
+                const float dz = z_[i + j] - query[2];
+                sqr_dists[j] = dx * dx + dy * dy + dz * dz;
+                mask |= (sqr_dists[j] <= result_set.worst()) << j;
+            }
+#endif
+            for (int j = 0; j < 4; ++j)
+                if (mask & (1 << j))
+                    result_set.add(point_ids_[i + j], sqr_dists[j]);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+int pcl::KdTreeStatic<PointT>::nearestKSearch(
+    const PointT &point, int k, std::vector<int> &k_indices,
+    std::vector<float> &k_sqr_distances) const {
+    float query[3];
+    k = std::min(k, size());
+    if (k <= 0 || !toQuery(point, query)) {
+        k_indices.clear();
+        k_sqr_distances.clear();
+        return (0);
+    }
+
+    k_indices.resize(k);
+    k_sqr_distances.resize(k);
+    KNNResultSet result_set(k, std::numeric_limits<float>::max(),
+                            &k_indices[0], &k_sqr_distances[0]);
+    searchTree(query, result_set);
+
+    k_indices.resize(result_set.found_);
+    k_sqr_distances.resize(result_set.found_);
+    return (result_set.found_);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+int pcl::KdTreeStatic<PointT>::radiusSearch(
+    const PointT &point, double radius, std::vector<int> &k_indices,
+    std::vector<float> &k_sqr_distances, unsigned int max_nn) const {
+    float query[3];
+    k_indices.clear();
+    k_sqr_distances.clear();
+    if (point_ids_.empty() || !toQuery(point, query))
+        return (0);
+
+    const float sqr_radius = static_cast<float>(radius * radius);
+    if (max_nn > 0 && max_nn < point_ids_.size()) {
+        // Only the max_nn nearest neighbors in the radius
+        k_indices.resize(max_nn);
+        k_sqr_distances.resize(max_nn);
+        KNNResultSet result_set(static_cast<int>(max_nn), sqr_radius,
+                                &k_indices[0], &k_sqr_distances[0]);
+        searchTree(query, result_set);
+        k_indices.resize(result_set.found_);
+        k_sqr_distances.resize(result_set.found_);
+        return (result_set.found_);
+    }
+
+    RadiusResultSet result_set(sqr_radius, k_indices, k_sqr_distances);
+    searchTree(query, result_set);
+    if (sorted_ && k_indices.size() > 1)
+        pcl::detail::sortNeighbors(&k_indices[0], &k_sqr_distances[0],
+                                   static_cast<int>(k_indices.size()));
+    return (static_cast<int>(k_indices.size()));
+}
+
+#define PCL_INSTANTIATE_KdTreeStatic(T)                                        \
+    template class PCL_EXPORTS pcl::KdTreeStatic<T>;
+
+#endif //#ifndef PCL_KDTREE_KDTREE_STATIC_IMPL_H_
@@ -0,0 +1,287 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Point Cloud Library (PCL) - www.pointclouds.org
+ *  Copyright (c) 2010-2011, Willow Garage, Inc.
+ *  Copyright (c) 2012-, Open Perception, Inc.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_KDTREE_KDTREE_DYNAMIC_H_
+#define PCL_KDTREE_KDTREE_DYNAMIC_H_
+
+#include <pcl/kdtree/kdtree_static.h>
+
+namespace pcl {
+/** \brief KdTreeDynamic is a kd-tree supporting the insertion and the removal
+ * of points without being rebuilt as a whole.
+ *
+ * It follows the logarithmic method: the points are spread over a few
+ * KdTreeStatic, whose sizes decrease at least geometrically. New points go
+ * to a new tree, which is then merged (i.e. rebuilt together) with the
+ * smaller trees preceding it until every tree is at least twice as large as
+ * the next one. Each point is thus rebuilt O(log n) times in total, and a
+ * search visits O(log n) trees, sharing its current k-th distance bound
+ * between them.
+ *
+ * Removed points are only flagged and skipped by the searches; a tree is
+ * compacted (rebuilt from its remaining points) as soon as more than half
+ * of its points have been removed.
+ *
+ * The tree keeps its own copy of the points in getInputCloud (), and the
+ * searches return indices in that cloud. The index of a point never changes
+ * while it is in the tree. The indices of the removed points are given to
+ * the points added later, once no static tree refers to them anymore (i.e.
+ * after the tree they were in has been rebuilt), so the cloud does not grow
+ * beyond about twice the largest number of points the tree ever held.
+ *
+ * \ingroup kdtree
+ */
+template <typename PointT> class KdTreeDynamic : public pcl::KdTree<PointT> {
+  public:
+    using KdTree<PointT>::input_;
+    using KdTree<PointT>::indices_;
+    using KdTree<PointT>::epsilon_;
+    using KdTree<PointT>::sorted_;
+    using KdTree<PointT>::point_representation_;
+    using KdTree<PointT>::nearestKSearch;
+    using KdTree<PointT>::radiusSearch;
+
+    typedef typename KdTree<PointT>::PointCloud PointCloud;
+    typedef typename KdTree<PointT>::PointCloudPtr PointCloudPtr;
+    typedef typename KdTree<PointT>::PointCloudConstPtr PointCloudConstPtr;
+
+    typedef boost::shared_ptr<std::vector<int>> IndicesPtr;
+    typedef boost::shared_ptr<const std::vector<int>> IndicesConstPtr;
+
+    typedef boost::shared_ptr<KdTreeDynamic<PointT>> Ptr;
+    typedef boost::shared_ptr<const KdTreeDynamic<PointT>> ConstPtr;
+
+    /** \brief Constructor.
+     * \param[in] sorted set to true if the radius searches have to return
+     * their neighbors sorted by distance (the k-nearest neighbor searches
+     * always do)
+     * \param[in] leaf_size the maximum number of points per leaf
+     */
+    KdTreeDynamic(bool sorted = true, int leaf_size = 16)
+        : pcl::KdTree<PointT>(sorted), leaf_size_(leaf_size),
+          cloud_(new PointCloud), removed_(), tree_ids_(), free_ids_(),
+          trees_() {}
+
+    /** \brief Destructor. */
+    virtual ~KdTreeDynamic() {}
+
+    /** \brief Set whether the radius searches have to return their neighbors
+     * sorted by distance.
+     */
+    inline void setSortedResults(bool sorted) { sorted_ = sorted; }
+
+    /** \brief Set the search epsilon precision (error bound) for nearest
+     * neighbors searches.
+     * \param[in] eps precision (error bound) for nearest neighbors searches
+     */
+    inline void setEpsilon(float eps) {
+        epsilon_ = eps;
+        for (size_t t = 0; t < trees_.size(); ++t)
+            trees_[t].tree->setEpsilon(eps);
+    }
+
+    /** \brief Copy a cloud and build the tree over its valid points.
+     * \param[in] cloud the const boost shared pointer to a PointCloud message
+     * \param[in] indices the point indices subset that is to be inserted in
+     * the tree - if NULL the whole cloud is used
+     */
+    void setInputCloud(const PointCloudConstPtr &cloud,
+                       const IndicesConstPtr &indices = IndicesConstPtr());
+
+    /** \brief Insert new points in the tree. They take the place of removed
+     * points in the cloud returned by getInputCloud () when possible, and are
+     * appended to it otherwise.
+     * \param[in] cloud the points to insert (invalid points are stored but not
+     * inserted)
+     * \param[out] indices the index of each point of \a cloud in
+     * getInputCloud ()
+     */
+    void addPoints(const PointCloud &cloud, std::vector<int> &indices);
+
+    /** \brief Insert new points in the tree, see addPoints (cloud, indices).
+     * Only when no point has been removed are the points of \a cloud simply
+     * appended to getInputCloud ().
+     * \param[in] cloud the points to insert
+     */
+    inline void addPoints(const PointCloud &cloud) {
+        std::vector<int> indices;
+        addPoints(cloud, indices);
+    }
+
+    /** \brief Remove points from the tree.
+     * \param[in] indices the indices of the points to remove in the cloud
+     * returned by getInputCloud ()
+     * \return the number of points removed (indices out of range or of points
+     * already removed are ignored)
+     */
+    int removeIndices(const std::vector<int> &indices);
+
+    /** \brief Remove all the points of the tree inside an axis aligned box.
+     * \param[in] min_pt the minimum corner of the box
+     * \param[in] max_pt the maximum corner of the box
+     * \return the number of points removed
+     */
+    int removePointsInBox(const Eigen::Vector4f &min_pt,
+                          const Eigen::Vector4f &max_pt);
+
+    /** \brief Search for the k-nearest neighbors of a query point.
+     * \param[in] point the query point
+     * \param[in] k the number of neighbors to search for
+     * \param[out] k_indices the resultant indices of the neighboring points
+     * \param[out] k_sqr_distances the resultant squared distances to the
+     * neighboring points, in ascending order
+     * \return the number of neighbors found (0 for an invalid query point)
+     */
+    int nearestKSearch(const PointT &point, int k, std::vector<int> &k_indices,
+                       std::vector<float> &k_sqr_distances) const;
+
+    /** \brief Search for all the neighbors of a query point in a given
+     * radius.
+     * \param[in] point the query point
+     * \param[in] radius the radius of the sphere bounding the neighbors
+     * \param[out] k_indices the resultant indices of the neighboring points
+     * \param[out] k_sqr_distances the resultant squared distances to the
+     * neighboring points
+     * \param[in] max_nn if given, only the \a max_nn nearest neighbors in
+     * \a radius are returned
+     * \return the number of neighbors found (0 for an invalid query point)
+     */
+    int radiusSearch(const PointT &point, double radius,
+                     std::vector<int> &k_indices,
+                     std::vector<float> &k_sqr_distances,
+                     unsigned int max_nn = 0) const;
+
+    /** \brief Get the number of points in the tree (removed points
+     * excluded). */
+    inline int size() const {
+        int nr_points = 0;
+        for (size_t t = 0; t < trees_.size(); ++t)
+            nr_points += trees_[t].size();
+        return (nr_points);
+    }
+
+    /** \brief Get the number of static trees the points are spread over. */
+    inline int getNumberOfTrees() const {
+        return (static_cast<int>(trees_.size()));
+    }
+
+  private:
+    typedef pcl::KdTreeStatic<PointT> StaticTree;
+    typedef typename StaticTree::KNNResultSet KNNResultSet;
+    typedef typename StaticTree::RadiusResultSet RadiusResultSet;
+
+    /** \brief A static tree and the number of its points removed since it was
+     * built.
+     */
+    struct Tree {
+        boost::shared_ptr<StaticTree> tree;
+        int nr_removed;
+
+        /** \brief The number of points of the tree not removed. */
+        inline int size() const { return (tree->size() - nr_removed); }
+    };
+
+    /** \brief Forwards the points not removed to a result set. */
+    template <typename ResultSet> struct LiveResultSet {
+        LiveResultSet(ResultSet &result_set,
+                      const std::vector<uint8_t> &removed)
+            : result_set_(result_set), removed_(removed) {}
+
+        inline float worst() const { return (result_set_.worst()); }
+
+        inline void add(int index, float sqr_dist) {
+            if (!removed_[index])
+                result_set_.add(index, sqr_dist);
+        }
+
+        ResultSet &result_set_;
+        const std::vector<uint8_t> &removed_;
+    };
+
+    /** \brief Build a static tree over the given points of cloud_. */
+    Tree buildTree(const boost::shared_ptr<std::vector<int>> &indices) const;
+
+    /** \brief Gather the points of tree t that were not removed. */
+    void getLivePoints(size_t t, std::vector<int> &indices) const;
+
+    /** \brief Make the indices of the points removed from tree t available
+     * to new points, before the tree is rebuilt or dropped. */
+    void releaseRemovedPoints(size_t t);
+
+    /** \brief Rebuild the trees with too many removed points, then merge the
+     * trees until each one is at least twice as large as the next one.
+     */
+    void balance();
+
+    /** \brief Record that the points of the trees from t onwards belong to
+     * them. */
+    void updateTreeIds(size_t t);
+
+    /** \brief Convert a point with the point representation.
+     * \return false if the point is not valid
+     */
+    inline bool toQuery(const PointT &point, float query[3]) const {
+        return (!trees_.empty() && trees_[0].tree->toQuery(point, query));
+    }
+
+    /** \brief Class getName method. */
+    virtual std::string getName() const { return ("KdTreeDynamic"); }
+
+    /** \brief The maximum number of points per leaf of the static trees. */
+    int leaf_size_;
+
+    /** \brief All the points, including the removed ones. */
+    PointCloudPtr cloud_;
+
+    /** \brief Whether each point of cloud_ is absent from the trees. */
+    std::vector<uint8_t> removed_;
+
+    /** \brief The tree containing each point of cloud_ (-1 if none). */
+    std::vector<int> tree_ids_;
+
+    /** \brief The indices of cloud_ no tree refers to, to be reused. */
+    std::vector<int> free_ids_;
+
+    /** \brief The static trees, by decreasing size. */
+    std::vector<Tree> trees_;
+};
+} // namespace pcl
+
+#endif // PCL_KDTREE_KDTREE_DYNAMIC_H_
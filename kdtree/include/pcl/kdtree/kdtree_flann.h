@@ -191,7 +191,91 @@ class KdTreeFLANN : public pcl::KdTree<PointT> {
                      std::vector<float> &k_sqr_distances,
                      unsigned int max_nn = 0) const;
 
+    /** \brief Search for the k-nearest neighbors of many query points at
+     * once, possibly in parallel.
+     * \param[in] cloud the point cloud data
+     * \param[in] indices a vector of point cloud indices to query for nearest
+     * neighbors (all the points of \a cloud if empty)
+     * \param[in] k the number of neighbors to search for
+     * \param[out] neighborhoods the resultant neighbors, the i-th query
+     * corresponding to the i-th index (or point). Invalid queries get no
+     * neighbors.
+     * \param[in] nr_threads the number of threads to use (0 for automatic)
+     */
+    void nearestKSearch(const PointCloud &cloud,
+                        const std::vector<int> &indices, int k,
+                        Neighborhoods &neighborhoods,
+                        unsigned int nr_threads = 1) const;
+
+    /** \brief Search for all the neighbors of many query points in a given
+     * radius at once, possibly in parallel.
+     * \param[in] cloud the point cloud data
+     * \param[in] indices a vector of point cloud indices to query for nearest
+     * neighbors (all the points of \a cloud if empty)
+     * \param[in] radius the radius of the sphere bounding the neighbors
+     * \param[out] neighborhoods the resultant neighbors, the i-th query
+     * corresponding to the i-th index (or point). Invalid queries get no
+     * neighbors.
+     * \param[in] max_nn if given, bounds the maximum returned neighbors of
+     * each query to this value
+     * \param[in] nr_threads the number of threads to use (0 for automatic)
+     */
+    void radiusSearch(const PointCloud &cloud, const std::vector<int> &indices,
+                      double radius, Neighborhoods &neighborhoods,
+                      unsigned int max_nn = 0,
+                      unsigned int nr_threads = 1) const;
+
   private:
+    /** \brief Searches the k-nearest neighbors of the i-th query of a batch
+     * directly in the FLANN index, for detail::searchNeighborhoods ().
+     */
+    struct NearestKSearchFunctor {
+        NearestKSearchFunctor(const KdTreeFLANN &tree, const PointCloud &cloud,
+                              const std::vector<int> &indices, int k)
+            : tree_(tree), cloud_(cloud), indices_(indices), k_(k),
+              query_(tree.dim_) {}
+
+        int operator()(int i, std::vector<int> &k_indices,
+                       std::vector<float> &k_sqr_distances);
+
+        const KdTreeFLANN &tree_;
+        const PointCloud &cloud_;
+        const std::vector<int> &indices_;
+        int k_;
+        /** \brief The vectorized query, one per thread. */
+        std::vector<float> query_;
+    };
+
+    /** \brief Searches the neighbors within a radius of the i-th query of a
+     * batch directly in the FLANN index, for detail::searchNeighborhoods ().
+     */
+    struct RadiusSearchFunctor {
+        RadiusSearchFunctor(const KdTreeFLANN &tree, const PointCloud &cloud,
+                            const std::vector<int> &indices, double radius,
+                            const ::flann::SearchParams &params)
+            : tree_(tree), cloud_(cloud), indices_(indices),
+              sqr_radius_(static_cast<float>(radius * radius)),
+              params_(params), query_(tree.dim_), indices_buf_(1),
+              dists_buf_(1) {}
+
+        int operator()(int i, std::vector<int> &k_indices,
+                       std::vector<float> &k_sqr_distances);
+
+        const KdTreeFLANN &tree_;
+        const PointCloud &cloud_;
+        const std::vector<int> &indices_;
+        float sqr_radius_;
+        ::flann::SearchParams params_;
+        /** \brief The vectorized query and the FLANN results, one per
+         * thread. */
+        std::vector<float> query_;
+        std::vector<std::vector<int> > indices_buf_;
+        std::vector<std::vector<float> > dists_buf_;
+    };
+
+    friend struct NearestKSearchFunctor;
+    friend struct RadiusSearchFunctor;
+
     /** \brief Internal cleanup method. */
     void cleanup();
 
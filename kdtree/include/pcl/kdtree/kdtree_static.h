@@ -0,0 +1,275 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Point Cloud Library (PCL) - www.pointclouds.org
+ *  Copyright (c) 2010-2011, Willow Garage, Inc.
+ *  Copyright (c) 2012-, Open Perception, Inc.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_KDTREE_KDTREE_STATIC_H_
+#define PCL_KDTREE_KDTREE_STATIC_H_
+
+#include <pcl/kdtree/kdtree.h>
+
+namespace pcl {
+/** \brief KdTreeStatic is a kD-tree dedicated to 3D nearest neighbor
+ * queries, built once for a given cloud.
+ *
+ * Unlike KdTreeFLANN, which goes through the generic FLANN index, the tree
+ * is laid out for the 3 dimensional case:
+ *  - it is balanced and complete, so the internal nodes (a split dimension
+ *    and value each) are stored implicitly in breadth first order, the
+ *    children of node i being nodes 2 i + 1 and 2 i + 2;
+ *  - the points are reordered leaf by leaf, in structure of arrays form, so
+ *    the scan of a leaf (at most getLeafSize () points) reads contiguous
+ *    memory and computes 4 distances at a time when SSE is available;
+ *  - the searches keep the nodes left to visit on a fixed size stack and
+ *    write the neighbors directly in the output vectors, so they allocate no
+ *    memory once the output vectors are large enough.
+ *
+ * The points are converted with the point representation of the tree, which
+ * must have at most 3 dimensions (x, y and z by default). The searches are
+ * const and thread safe.
+ *
+ * \ingroup kdtree
+ */
+template <typename PointT> class KdTreeStatic : public pcl::KdTree<PointT> {
+  public:
+    using KdTree<PointT>::input_;
+    using KdTree<PointT>::indices_;
+    using KdTree<PointT>::epsilon_;
+    using KdTree<PointT>::sorted_;
+    using KdTree<PointT>::point_representation_;
+    using KdTree<PointT>::nearestKSearch;
+    using KdTree<PointT>::radiusSearch;
+
+    typedef typename KdTree<PointT>::PointCloud PointCloud;
+    typedef typename KdTree<PointT>::PointCloudConstPtr PointCloudConstPtr;
+
+    typedef boost::shared_ptr<std::vector<int>> IndicesPtr;
+    typedef boost::shared_ptr<const std::vector<int>> IndicesConstPtr;
+
+    typedef boost::shared_ptr<KdTreeStatic<PointT>> Ptr;
+    typedef boost::shared_ptr<const KdTreeStatic<PointT>> ConstPtr;
+
+    /** \brief Constructor.
+     * \param[in] sorted set to true if the radius searches have to return
+     * their neighbors sorted by distance (the k-nearest neighbor searches
+     * always do)
+     * \param[in] leaf_size the maximum number of points per leaf
+     */
+    KdTreeStatic(bool sorted = true, int leaf_size = 16)
+        : pcl::KdTree<PointT>(sorted), leaf_size_(leaf_size), depth_(0),
+          nodes_(), leaf_offsets_(), x_(), y_(), z_(), point_ids_() {}
+
+    /** \brief Destructor. */
+    virtual ~KdTreeStatic() {}
+
+    inline Ptr makeShared() { return (Ptr(new KdTreeStatic<PointT>(*this))); }
+
+    /** \brief Set the maximum number of points per leaf, used by the next call
+     * to setInputCloud (). Small leaves make deeper trees, large leaves scan
+     * more points.
+     * \param[in] leaf_size the maximum number of points per leaf
+     */
+    inline void setLeafSize(int leaf_size) {
+        leaf_size_ = leaf_size > 0 ? leaf_size : 1;
+    }
+
+    /** \brief Get the maximum number of points per leaf. */
+    inline int getLeafSize() const { return (leaf_size_); }
+
+    /** \brief Set whether the radius searches have to return their neighbors
+     * sorted by distance.
+     */
+    inline void setSortedResults(bool sorted) { sorted_ = sorted; }
+
+    /** \brief Build the tree over the valid points of a cloud.
+     * \param[in] cloud the const boost shared pointer to a PointCloud message
+     * \param[in] indices the point indices subset that is to be used from \a
+     * cloud - if NULL the whole cloud is used
+     */
+    void setInputCloud(const PointCloudConstPtr &cloud,
+                       const IndicesConstPtr &indices = IndicesConstPtr());
+
+    /** \brief Search for the k-nearest neighbors of a query point.
+     * \param[in] point the query point
+     * \param[in] k the number of neighbors to search for
+     * \param[out] k_indices the resultant indices of the neighboring points
+     * \param[out] k_sqr_distances the resultant squared distances to the
+     * neighboring points, in ascending order
+     * \return the number of neighbors found (0 for an invalid query point)
+     */
+    int nearestKSearch(const PointT &point, int k, std::vector<int> &k_indices,
+                       std::vector<float> &k_sqr_distances) const;
+
+    /** \brief Search for all the neighbors of a query point in a given
+     * radius.
+     * \param[in] point the query point
+     * \param[in] radius the radius of the sphere bounding the neighbors
+     * \param[out] k_indices the resultant indices of the neighboring points
+     * \param[out] k_sqr_distances the resultant squared distances to the
+     * neighboring points
+     * \param[in] max_nn if given, only the \a max_nn nearest neighbors in
+     * \a radius are returned
+     * \return the number of neighbors found (0 for an invalid query point)
+     */
+    int radiusSearch(const PointT &point, double radius,
+                     std::vector<int> &k_indices,
+                     std::vector<float> &k_sqr_distances,
+                     unsigned int max_nn = 0) const;
+
+    /** \brief Get the number of points in the tree. */
+    inline int size() const { return (static_cast<int>(point_ids_.size())); }
+
+  private:
+    template <typename> friend class KdTreeDynamic;
+
+    /** \brief An internal node: the points of its left subtree have their
+     * coordinate dim lower than or equal to split, the points of its right
+     * subtree greater than or equal to it.
+     */
+    struct Node {
+        float split;
+        int dim;
+    };
+
+    /** \brief A node left to visit, with the lower bound of the squared
+     * distance from the query to its cell and the per dimension offsets the
+     * bound is made of.
+     */
+    struct StackEntry {
+        int node;
+        float min_dist;
+        float offsets[3];
+    };
+
+    /** \brief Collects the k nearest neighbors, sorted by distance, directly
+     * in the output arrays.
+     */
+    struct KNNResultSet {
+        KNNResultSet(int k, float max_sqr_dist, int *indices, float *sqr_dists)
+            : k_(k), found_(0), worst_(max_sqr_dist), indices_(indices),
+              sqr_dists_(sqr_dists) {}
+
+        /** \brief The squared distance a point has to beat to be added. */
+        inline float worst() const { return (worst_); }
+
+        inline void add(int index, float sqr_dist) {
+            if (found_ == k_ ? sqr_dist >= worst_ : sqr_dist > worst_)
+                return;
+            int pos = found_ < k_ ? found_++ : k_ - 1;
+            for (; pos > 0 && sqr_dists_[pos - 1] > sqr_dist; --pos) {
+                sqr_dists_[pos] = sqr_dists_[pos - 1];
+                indices_[pos] = indices_[pos - 1];
+            }
+            sqr_dists_[pos] = sqr_dist;
+            indices_[pos] = index;
+            if (found_ == k_)
+                worst_ = sqr_dists_[k_ - 1];
+        }
+
+        int k_, found_;
+        float worst_;
+        int *indices_;
+        float *sqr_dists_;
+    };
+
+    /** \brief Collects all the neighbors in a radius, unsorted. */
+    struct RadiusResultSet {
+        RadiusResultSet(float sqr_radius, std::vector<int> &indices,
+                        std::vector<float> &sqr_dists)
+            : sqr_radius_(sqr_radius), indices_(indices),
+              sqr_dists_(sqr_dists) {}
+
+        inline float worst() const { return (sqr_radius_); }
+
+        inline void add(int index, float sqr_dist) {
+            if (sqr_dist > sqr_radius_)
+                return;
+            indices_.push_back(index);
+            sqr_dists_.push_back(sqr_dist);
+        }
+
+        float sqr_radius_;
+        std::vector<int> &indices_;
+        std::vector<float> &sqr_dists_;
+    };
+
+    /** \brief Convert a point with the point representation.
+     * \return false if the point is not valid
+     */
+    inline bool toQuery(const PointT &point, float query[3]) const;
+
+    /** \brief Recursively split the points of [begin, end) at node. */
+    void buildNode(int node, int begin, int end, int depth,
+                   std::vector<int> &order,
+                   const std::vector<float> &coordinates);
+
+    /** \brief Visit the leaves that may contain points closer to query than
+     * result_set.worst (), and add their points to result_set with
+     * result_set.add (index in the input cloud, squared distance).
+     */
+    template <typename ResultSet>
+    void searchTree(const float query[3], ResultSet &result_set) const;
+
+    /** \brief Class getName method. */
+    virtual std::string getName() const { return ("KdTreeStatic"); }
+
+    /** \brief The maximum number of points per leaf. */
+    int leaf_size_;
+
+    /** \brief The depth of the tree: it has 2^depth_ - 1 internal nodes and
+     * 2^depth_ leaves.
+     */
+    int depth_;
+
+    /** \brief The internal nodes, in breadth first order. */
+    std::vector<Node> nodes_;
+
+    /** \brief The first point of each leaf, plus the number of points. */
+    std::vector<int> leaf_offsets_;
+
+    /** \brief The coordinates of the points in leaf order, padded to a
+     * multiple of 4 entries.
+     */
+    std::vector<float> x_, y_, z_;
+
+    /** \brief The index in the input cloud of the points, in leaf order. */
+    std::vector<int> point_ids_;
+};
+} // namespace pcl
+
+#endif // PCL_KDTREE_KDTREE_STATIC_H_
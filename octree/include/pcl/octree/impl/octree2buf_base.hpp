@@ -45,16 +45,17 @@ namespace octree {
 template <typename DataT, typename LeafContainerT, typename BranchContainerT>
 Octree2BufBase<DataT, LeafContainerT, BranchContainerT>::Octree2BufBase()
     : leafCount_(0), branchCount_(1), objectCount_(0),
-      rootNode_(new BranchNode()), depthMask_(0), maxKey_(), branchNodePool_(),
+      rootNode_(0), depthMask_(0), maxKey_(), branchNodePool_(),
       leafNodePool_(), bufferSelector_(0), treeDirtyFlag_(false),
-      octreeDepth_(0) {}
+      octreeDepth_(0), leafParentCache_(0), leafParentKey_(), leafSizes_(),
+      prevLeafSizes_(), leafSizesValid_(false), prevLeafSizesValid_(false) {
+    rootNode_ = branchNodePool_.popNode();
+}
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename DataT, typename LeafContainerT, typename BranchContainerT>
 Octree2BufBase<DataT, LeafContainerT, BranchContainerT>::~Octree2BufBase() {
-    // deallocate tree structure
-    deleteTree();
-    delete (rootNode_);
+    // all the nodes, root included, belong to the node pools
     poolCleanUp();
 }
 
@@ -75,6 +76,9 @@ void Octree2BufBase<DataT, LeafContainerT, BranchContainerT>::setMaxVoxelIndex(
     // define depthMask_ by setting a single bit to 1 at bit position == tree
     // depth
     depthMask_ = (1 << (treeDepth - 1));
+
+    // keys change meaning with the depth
+    leafParentCache_ = 0;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
@@ -92,6 +96,9 @@ void Octree2BufBase<DataT, LeafContainerT, BranchContainerT>::setTreeDepth(
 
     // define max. keys
     maxKey_.x = maxKey_.y = maxKey_.z = (1 << depth_arg) - 1;
+
+    // keys change meaning with the depth
+    leafParentCache_ = 0;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
@@ -150,21 +157,26 @@ void Octree2BufBase<DataT, LeafContainerT, BranchContainerT>::removeLeaf(
 template <typename DataT, typename LeafContainerT, typename BranchContainerT>
 void Octree2BufBase<DataT, LeafContainerT, BranchContainerT>::deleteTree(
     bool freeMemory_arg) {
-    if (rootNode_) {
-        // reset octree
+    if (freeMemory_arg) {
+        // destroy all the nodes at once and start over from a new root
+        poolCleanUp();
+        rootNode_ = branchNodePool_.popNode();
+    } else {
+        // push the nodes to the node pools for later reuse
         deleteBranch(*rootNode_);
-        leafCount_ = 0;
-        branchCount_ = 1;
-        objectCount_ = 0;
-
-        treeDirtyFlag_ = false;
-        depthMask_ = 0;
-        octreeDepth_ = 0;
     }
 
-    // delete node pool
-    if (freeMemory_arg)
-        poolCleanUp();
+    // reset octree
+    leafCount_ = 0;
+    branchCount_ = 1;
+    objectCount_ = 0;
+
+    treeDirtyFlag_ = false;
+    depthMask_ = 0;
+    octreeDepth_ = 0;
+
+    leafParentCache_ = 0;
+    leafSizesValid_ = prevLeafSizesValid_ = false;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
@@ -179,6 +191,12 @@ void Octree2BufBase<DataT, LeafContainerT, BranchContainerT>::switchBuffers() {
     // switch butter selector
     bufferSelector_ = !bufferSelector_;
 
+    // the leaf sizes of the current buffer become the previous ones
+    leafSizes_.swap(prevLeafSizes_);
+    prevLeafSizesValid_ = leafSizesValid_;
+    leafSizesValid_ = false;
+    leafParentCache_ = 0;
+
     // reset flags
     treeDirtyFlag_ = true;
     leafCount_ = 0;
@@ -256,6 +274,8 @@ void Octree2BufBase<DataT, LeafContainerT, BranchContainerT>::deserializeTree(
 
     // we will rebuild an octree -> reset leafCount
     leafCount_ = 0;
+    leafParentCache_ = 0;
+    leafSizesValid_ = false;
 
     // iterator for binary tree structure vector
     std::vector<char>::const_iterator binaryTreeVectorIterator =
@@ -288,6 +308,8 @@ void Octree2BufBase<DataT, LeafContainerT, BranchContainerT>::deserializeTree(
 
     // we will rebuild an octree -> reset leafCount
     leafCount_ = 0;
+    leafParentCache_ = 0;
+    leafSizesValid_ = false;
 
     // iterator for binary tree structure vector
     std::vector<char>::const_iterator binaryTreeVectorIterator =
@@ -322,6 +344,71 @@ void Octree2BufBase<DataT, LeafContainerT, BranchContainerT>::serializeNewLeafs(
     treeDirtyFlag_ = false;
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename DataT, typename LeafContainerT, typename BranchContainerT>
+void Octree2BufBase<DataT, LeafContainerT, BranchContainerT>::serializeChanges(
+    std::vector<char> &binaryDiffOut_arg, std::vector<DataT> &newDataVector_arg,
+    std::vector<DataT> &changedDataVector_arg,
+    std::vector<OctreeKey> &removedLeafKeys_arg,
+    std::size_t minSizeChange_arg) {
+    OctreeKey newKey;
+    std::size_t prevLeafIdx = 0;
+
+    // clear output vectors, their capacity is kept from frame to frame
+    binaryDiffOut_arg.clear();
+    newDataVector_arg.clear();
+    changedDataVector_arg.clear();
+    removedLeafKeys_arg.clear();
+
+    // record the leaf sizes of the current buffer
+    leafSizes_.clear();
+    leafSizes_.reserve(leafCount_);
+
+    serializeChangesRecursive(rootNode_, depthMask_, newKey, false,
+                              binaryDiffOut_arg, newDataVector_arg,
+                              changedDataVector_arg, removedLeafKeys_arg,
+                              std::max<std::size_t>(minSizeChange_arg, 1),
+                              prevLeafIdx);
+
+    leafSizesValid_ = true;
+
+    // serializeChangesRecursive cleans-up unused octree nodes in previous
+    // octree
+    treeDirtyFlag_ = false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename DataT, typename LeafContainerT, typename BranchContainerT>
+void Octree2BufBase<DataT, LeafContainerT, BranchContainerT>::
+    deserializeChanges(const std::vector<char> &binaryDiffIn_arg,
+                       std::vector<OctreeKey> &newLeafKeys_arg,
+                       std::vector<OctreeKey> &removedLeafKeys_arg) {
+    OctreeKey newKey;
+
+    newLeafKeys_arg.clear();
+    removedLeafKeys_arg.clear();
+
+    // we will rebuild the current buffer -> reset leafCount
+    leafCount_ = 0;
+    branchCount_ = 1;
+    leafParentCache_ = 0;
+    leafSizesValid_ = false;
+
+    // iterator for binary diff vector
+    std::vector<char>::const_iterator binaryDiffVectorIterator =
+        binaryDiffIn_arg.begin();
+    const std::vector<char>::const_iterator binaryDiffVectorIteratorEnd =
+        binaryDiffIn_arg.end();
+
+    deserializeChangesRecursive(rootNode_, depthMask_, newKey, false,
+                                binaryDiffVectorIterator,
+                                binaryDiffVectorIteratorEnd, newLeafKeys_arg,
+                                removedLeafKeys_arg);
+
+    // the unused nodes of the previous buffer have been deleted
+    treeDirtyFlag_ = false;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename DataT, typename LeafContainerT, typename BranchContainerT>
 void Octree2BufBase<DataT, LeafContainerT, BranchContainerT>::
@@ -390,6 +477,10 @@ void Octree2BufBase<DataT, LeafContainerT, BranchContainerT>::
     } else {
         // branch childs are leaf nodes
         LeafNode *childLeaf;
+
+        // let the next key skip the descent if it shares this branch
+        leafParentCache_ = branch_arg;
+
         if (!branch_arg->hasChild(bufferSelector_, childIdx)) {
             // leaf node at childIdx does not exist
 
@@ -773,6 +864,339 @@ void Octree2BufBase<DataT, LeafContainerT, BranchContainerT>::
     }
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename DataT, typename LeafContainerT, typename BranchContainerT>
+bool Octree2BufBase<DataT, LeafContainerT, BranchContainerT>::
+    serializeChangesRecursive(BranchNode *branch_arg,
+                              unsigned int depthMask_arg, OctreeKey &key_arg,
+                              bool newBranch_arg,
+                              std::vector<char> &binaryDiffOut_arg,
+                              std::vector<DataT> &newDataVector_arg,
+                              std::vector<DataT> &changedDataVector_arg,
+                              std::vector<OctreeKey> &removedLeafKeys_arg,
+                              std::size_t minSizeChange_arg,
+                              std::size_t &prevLeafIdx_arg) {
+    // child iterator
+    unsigned char childIdx;
+
+    // a new branch has no children in the previous buffer
+    const char branchBitPatternCurrBuffer =
+        getBranchBitPattern(*branch_arg, bufferSelector_);
+    const char branchBitPatternPrevBuffer =
+        newBranch_arg ? 0 : getBranchBitPattern(*branch_arg, !bufferSelector_);
+
+    binaryDiffOut_arg.push_back(branchBitPatternCurrBuffer ^
+                                branchBitPatternPrevBuffer);
+
+    // bit pattern of the child branches of both buffers whose structure
+    // changed, written once they have been explored if there are such children
+    const bool sharedBranches =
+        (depthMask_arg > 1) &&
+        ((branchBitPatternCurrBuffer & branchBitPatternPrevBuffer) != 0);
+    char changedBitPattern = 0;
+    const std::size_t changedBitPatternPos = binaryDiffOut_arg.size();
+    if (sharedBranches)
+        binaryDiffOut_arg.push_back(0);
+
+    for (childIdx = 0; childIdx < 8; childIdx++) {
+        OctreeNode *currChild =
+            branch_arg->getChildPtr(bufferSelector_, childIdx);
+        OctreeNode *prevChild =
+            newBranch_arg ? 0
+                          : branch_arg->getChildPtr(!bufferSelector_, childIdx);
+
+        if (!currChild && !prevChild)
+            continue;
+
+        // children of both buffers share their node
+        const bool sharedChild = (currChild == prevChild);
+
+        // add current branch voxel to key
+        key_arg.pushBranch(childIdx);
+
+        if (prevChild && !sharedChild) {
+            // removed child
+            if (depthMask_arg > 1) {
+                prevLeafIdx_arg += getPreviousLeafKeysRecursive(
+                    static_cast<BranchNode *>(prevChild), depthMask_arg / 2,
+                    key_arg, removedLeafKeys_arg);
+            } else {
+                removedLeafKeys_arg.push_back(key_arg);
+                ++prevLeafIdx_arg;
+            }
+
+            // delete branch, free memory
+            deleteBranchChild(*branch_arg, !bufferSelector_, childIdx);
+        }
+
+        if (currChild && (depthMask_arg > 1)) {
+            const std::size_t childStart = binaryDiffOut_arg.size();
+
+            // recursively proceed with indexed child branch
+            const bool childChanged = serializeChangesRecursive(
+                static_cast<BranchNode *>(currChild), depthMask_arg / 2,
+                key_arg, !sharedChild, binaryDiffOut_arg, newDataVector_arg,
+                changedDataVector_arg, removedLeafKeys_arg, minSizeChange_arg,
+                prevLeafIdx_arg);
+
+            if (sharedChild) {
+                if (childChanged)
+                    changedBitPattern |= static_cast<char>(1 << childIdx);
+                else
+                    // nothing to describe in an unchanged sub-tree
+                    binaryDiffOut_arg.resize(childStart);
+            }
+        } else if (currChild) {
+            LeafNode *childLeaf = static_cast<LeafNode *>(currChild);
+            const std::size_t leafSize = childLeaf->getSize();
+
+            if (!sharedChild) {
+                // new leaf
+                childLeaf->getData(newDataVector_arg);
+            } else if (prevLeafSizesValid_ &&
+                       (prevLeafIdx_arg < prevLeafSizes_.size())) {
+                // compare with the size recorded for the previous buffer
+                const std::size_t prevLeafSize =
+                    prevLeafSizes_[prevLeafIdx_arg++];
+                const std::size_t sizeChange = (leafSize > prevLeafSize)
+                                                   ? leafSize - prevLeafSize
+                                                   : prevLeafSize - leafSize;
+                if (sizeChange >= minSizeChange_arg)
+                    childLeaf->getData(changedDataVector_arg);
+            }
+
+            leafSizes_.push_back(leafSize);
+        }
+
+        // pop current branch voxel from key
+        key_arg.popBranch();
+    }
+
+    if (sharedBranches)
+        binaryDiffOut_arg[changedBitPatternPos] = changedBitPattern;
+
+    return (newBranch_arg || changedBitPattern ||
+            (branchBitPatternCurrBuffer != branchBitPatternPrevBuffer));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename DataT, typename LeafContainerT, typename BranchContainerT>
+void Octree2BufBase<DataT, LeafContainerT, BranchContainerT>::
+    deserializeChangesRecursive(
+        BranchNode *branch_arg, unsigned int depthMask_arg, OctreeKey &key_arg,
+        bool newBranch_arg,
+        std::vector<char>::const_iterator &binaryDiffIT_arg,
+        const std::vector<char>::const_iterator &binaryDiffIT_End_arg,
+        std::vector<OctreeKey> &newLeafKeys_arg,
+        std::vector<OctreeKey> &removedLeafKeys_arg) {
+    // child iterator
+    unsigned char childIdx;
+
+    // the current buffer of this branch is rebuilt from scratch
+    for (childIdx = 0; childIdx < 8; childIdx++)
+        branch_arg->setChildPtr(bufferSelector_, childIdx, 0);
+
+    if (binaryDiffIT_arg == binaryDiffIT_End_arg)
+        return;
+
+    // read XOR occupancy bit pattern and recover the occupancy bit pattern of
+    // the current buffer
+    const char nodeXORBits = *binaryDiffIT_arg++;
+    const char prevNodeBits =
+        newBranch_arg ? 0 : getBranchBitPattern(*branch_arg, !bufferSelector_);
+    const char nodeBits = prevNodeBits ^ nodeXORBits;
+
+    // read the changed child branches bit pattern, if there are shared ones
+    char changedBits = 0;
+    if ((depthMask_arg > 1) && (nodeBits & prevNodeBits)) {
+        if (binaryDiffIT_arg == binaryDiffIT_End_arg)
+            return;
+        changedBits = *binaryDiffIT_arg++;
+    }
+
+    for (childIdx = 0; childIdx < 8; childIdx++) {
+        const bool currChild = (nodeBits & (1 << childIdx)) != 0;
+        const bool prevChild = (prevNodeBits & (1 << childIdx)) != 0;
+
+        if (!currChild && !prevChild)
+            continue;
+
+        // add current branch voxel to key
+        key_arg.pushBranch(childIdx);
+
+        if (currChild && prevChild) {
+            // child of both buffers, shared
+            OctreeNode *childNode =
+                branch_arg->getChildPtr(!bufferSelector_, childIdx);
+            branch_arg->setChildPtr(bufferSelector_, childIdx, childNode);
+
+            if (depthMask_arg > 1) {
+                BranchNode *childBranch = static_cast<BranchNode *>(childNode);
+                branchCount_++;
+
+                if (changedBits & (1 << childIdx))
+                    deserializeChangesRecursive(
+                        childBranch, depthMask_arg / 2, key_arg, false,
+                        binaryDiffIT_arg, binaryDiffIT_End_arg,
+                        newLeafKeys_arg, removedLeafKeys_arg);
+                else
+                    linkPreviousBranchRecursive(childBranch);
+            } else {
+                leafCount_++;
+            }
+        } else if (currChild) {
+            // new child
+            if (depthMask_arg > 1) {
+                BranchNode *childBranch;
+                createBranchChild(*branch_arg, childIdx, childBranch);
+                branchCount_++;
+
+                deserializeChangesRecursive(
+                    childBranch, depthMask_arg / 2, key_arg, true,
+                    binaryDiffIT_arg, binaryDiffIT_End_arg, newLeafKeys_arg,
+                    removedLeafKeys_arg);
+            } else {
+                LeafNode *childLeaf;
+                createLeafChild(*branch_arg, childIdx, childLeaf);
+                newLeafKeys_arg.push_back(key_arg);
+                leafCount_++;
+            }
+        } else {
+            // removed child
+            if (depthMask_arg > 1)
+                getPreviousLeafKeysRecursive(
+                    static_cast<const BranchNode *>(
+                        branch_arg->getChildPtr(!bufferSelector_, childIdx)),
+                    depthMask_arg / 2, key_arg, removedLeafKeys_arg);
+            else
+                removedLeafKeys_arg.push_back(key_arg);
+
+            // delete branch, free memory
+            deleteBranchChild(*branch_arg, !bufferSelector_, childIdx);
+        }
+
+        // pop current branch voxel from key
+        key_arg.popBranch();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename DataT, typename LeafContainerT, typename BranchContainerT>
+std::size_t Octree2BufBase<DataT, LeafContainerT, BranchContainerT>::
+    getPreviousLeafKeysRecursive(const BranchNode *branch_arg,
+                                 unsigned int depthMask_arg,
+                                 OctreeKey &key_arg,
+                                 std::vector<OctreeKey> &leafKeys_arg) const {
+    // child iterator
+    unsigned char childIdx;
+    std::size_t leafCount = 0;
+
+    for (childIdx = 0; childIdx < 8; childIdx++) {
+        const OctreeNode *childNode =
+            branch_arg->getChildPtr(!bufferSelector_, childIdx);
+
+        if (!childNode)
+            continue;
+
+        // add current branch voxel to key
+        key_arg.pushBranch(childIdx);
+
+        if (depthMask_arg > 1) {
+            leafCount += getPreviousLeafKeysRecursive(
+                static_cast<const BranchNode *>(childNode), depthMask_arg / 2,
+                key_arg, leafKeys_arg);
+        } else {
+            leafKeys_arg.push_back(key_arg);
+            ++leafCount;
+        }
+
+        // pop current branch voxel from key
+        key_arg.popBranch();
+    }
+
+    return (leafCount);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename DataT, typename LeafContainerT, typename BranchContainerT>
+void Octree2BufBase<DataT, LeafContainerT, BranchContainerT>::
+    linkPreviousBranchRecursive(BranchNode *branch_arg) {
+    // child iterator
+    unsigned char childIdx;
+
+    for (childIdx = 0; childIdx < 8; childIdx++) {
+        OctreeNode *childNode =
+            branch_arg->getChildPtr(!bufferSelector_, childIdx);
+
+        branch_arg->setChildPtr(bufferSelector_, childIdx, childNode);
+
+        if (!childNode)
+            continue;
+
+        switch (childNode->getNodeType()) {
+        case BRANCH_NODE: {
+            branchCount_++;
+            linkPreviousBranchRecursive(static_cast<BranchNode *>(childNode));
+            break;
+        }
+        case LEAF_NODE: {
+            leafCount_++;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename DataT, typename LeafContainerT, typename BranchContainerT>
+void Octree2BufBase<DataT, LeafContainerT, BranchContainerT>::
+    copyBranchRecursive(const BranchNode &source_arg, BranchNode &target_arg) {
+    // index to branch child
+    unsigned char childIdx;
+    unsigned char bufferIdx;
+
+    target_arg.copyContainer(source_arg);
+
+    for (bufferIdx = 0; bufferIdx < 2; ++bufferIdx) {
+        for (childIdx = 0; childIdx < 8; ++childIdx) {
+            const OctreeNode *childNode =
+                source_arg.getChildPtr(bufferIdx, childIdx);
+
+            if (!childNode)
+                continue;
+
+            if (bufferIdx &&
+                (childNode == source_arg.getChildPtr(0, childIdx))) {
+                // child shared with the first buffer
+                target_arg.setChildPtr(1, childIdx,
+                                       target_arg.getChildPtr(0, childIdx));
+                continue;
+            }
+
+            switch (childNode->getNodeType()) {
+            case BRANCH_NODE: {
+                BranchNode *newBranch = branchNodePool_.popNode();
+                target_arg.setChildPtr(bufferIdx, childIdx, newBranch);
+                copyBranchRecursive(*static_cast<const BranchNode *>(childNode),
+                                    *newBranch);
+                break;
+            }
+            case LEAF_NODE: {
+                LeafNode *newLeaf = leafNodePool_.popNode();
+                target_arg.setChildPtr(bufferIdx, childIdx, newLeaf);
+                static_cast<LeafContainerT &>(*newLeaf) =
+                    static_cast<const LeafNode &>(*childNode);
+                break;
+            }
+            default:
+                break;
+            }
+        }
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename DataT, typename LeafContainerT, typename BranchContainerT>
 void Octree2BufBase<DataT, LeafContainerT, BranchContainerT>::
@@ -54,16 +54,17 @@ namespace octree {
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename DataT, typename LeafContainerT, typename BranchContainerT>
 OctreeBase<DataT, LeafContainerT, BranchContainerT>::OctreeBase()
-    : leafCount_(0), branchCount_(1), objectCount_(0),
-      rootNode_(new BranchNode()), maxObjsPerLeaf_(0), depthMask_(0),
-      octreeDepth_(0), maxKey_(), branchNodePool_(), leafNodePool_() {}
+    : leafCount_(0), branchCount_(1), objectCount_(0), rootNode_(0),
+      maxObjsPerLeaf_(0), depthMask_(0), octreeDepth_(0), maxKey_(),
+      branchNodePool_(), leafNodePool_(), leafIndexEnabled_(false),
+      leafIndex_() {
+    rootNode_ = branchNodePool_.popNode();
+}
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename DataT, typename LeafContainerT, typename BranchContainerT>
 OctreeBase<DataT, LeafContainerT, BranchContainerT>::~OctreeBase() {
-    // deallocate tree structure
-    deleteTree();
-    delete (rootNode_);
+    // all the nodes, root included, belong to the node pools
     poolCleanUp();
 }
 
@@ -101,6 +102,49 @@ void OctreeBase<DataT, LeafContainerT, BranchContainerT>::setTreeDepth(
 
     // define max. keys
     maxKey_.x = maxKey_.y = maxKey_.z = (1 << depth_arg) - 1;
+
+    // the keys of the leaf nodes change with the depth of the octree
+    rebuildLeafIndex();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename DataT, typename LeafContainerT, typename BranchContainerT>
+void OctreeBase<DataT, LeafContainerT, BranchContainerT>::enableLeafIndex(
+    bool enable_arg) {
+    leafIndexEnabled_ = enable_arg;
+    rebuildLeafIndex();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename DataT, typename LeafContainerT, typename BranchContainerT>
+std::size_t
+OctreeBase<DataT, LeafContainerT, BranchContainerT>::findNeighborLeaves(
+    const OctreeKey &key_arg, unsigned int radius_arg,
+    std::vector<LeafNode *> &leaves_arg) const {
+    leaves_arg.clear();
+
+    if (!(key_arg <= maxKey_))
+        return (0);
+
+    // clip the cube to the key range
+    const OctreeKey minKey(key_arg.x - std::min(key_arg.x, radius_arg),
+                           key_arg.y - std::min(key_arg.y, radius_arg),
+                           key_arg.z - std::min(key_arg.z, radius_arg));
+    const OctreeKey maxKey(
+        key_arg.x + std::min(maxKey_.x - key_arg.x, radius_arg),
+        key_arg.y + std::min(maxKey_.y - key_arg.y, radius_arg),
+        key_arg.z + std::min(maxKey_.z - key_arg.z, radius_arg));
+
+    OctreeKey key;
+    for (key.x = minKey.x; key.x <= maxKey.x; key.x++)
+        for (key.y = minKey.y; key.y <= maxKey.y; key.y++)
+            for (key.z = minKey.z; key.z <= maxKey.z; key.z++) {
+                LeafNode *leaf = findLeaf(key);
+                if (leaf)
+                    leaves_arg.push_back(leaf);
+            }
+
+    return (leaves_arg.size());
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
@@ -161,17 +205,41 @@ template <typename DataT, typename LeafContainerT, typename BranchContainerT>
 void OctreeBase<DataT, LeafContainerT, BranchContainerT>::deleteTree(
     bool freeMemory_arg) {
 
-    if (rootNode_) {
-        // reset octree
+    if (freeMemory_arg) {
+        // destroy all the nodes at once and start over from a new root
+        poolCleanUp();
+        rootNode_ = branchNodePool_.popNode();
+    } else {
+        // push the nodes to the node pools for later reuse
         deleteBranch(*rootNode_);
-        leafCount_ = 0;
-        branchCount_ = 1;
-        objectCount_ = 0;
     }
 
-    // delete node pool
-    if (freeMemory_arg)
-        poolCleanUp();
+    // reset octree
+    leafCount_ = 0;
+    branchCount_ = 1;
+    objectCount_ = 0;
+
+    leafIndex_.clear();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename DataT, typename LeafContainerT, typename BranchContainerT>
+void OctreeBase<DataT, LeafContainerT,
+                BranchContainerT>::sortNodesDepthFirst() {
+    // copy the tree into new pools, the current nodes are destroyed with the
+    // old pools
+    OctreeNodePool<BranchNode> branchNodePool;
+    OctreeNodePool<LeafNode> leafNodePool;
+    branchNodePool_.swap(branchNodePool);
+    leafNodePool_.swap(leafNodePool);
+
+    BranchNode *oldRootNode = rootNode_;
+    setSlabAllocation(true);
+    rootNode_ = branchNodePool_.popNode();
+    copyBranchRecursive(*oldRootNode, *rootNode_);
+    setSlabAllocation(false);
+
+    rebuildLeafIndex();
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
@@ -319,6 +387,9 @@ void OctreeBase<DataT, LeafContainerT, BranchContainerT>::createLeafRecursive(
             // if leaf node at childIdx does not exist
             createLeafChild(*branch_arg, childIdx, returnLeaf_arg);
             leafCount_++;
+
+            if (leafIndexActive())
+                leafIndex_.insert(key_arg, returnLeaf_arg);
         }
     } else {
 
@@ -468,6 +539,9 @@ bool OctreeBase<DataT, LeafContainerT, BranchContainerT>::deleteLeafRecursive(
             // our child is a leaf node -> delete it
             deleteBranchChild(*branch_arg, childIdx);
             leafCount_--;
+
+            if (leafIndexActive())
+                leafIndex_.erase(key_arg);
             break;
         }
     }
@@ -538,6 +612,50 @@ void OctreeBase<DataT, LeafContainerT, BranchContainerT>::
     }
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename DataT, typename LeafContainerT, typename BranchContainerT>
+void OctreeBase<DataT, LeafContainerT, BranchContainerT>::copyBranchRecursive(
+    const BranchNode &source_arg, BranchNode &target_arg) {
+    // index to branch child
+    unsigned char childIdx;
+
+    target_arg.copyContainer(source_arg);
+
+    // allocate all the children first, so that siblings are contiguous
+    for (childIdx = 0; childIdx < 8; childIdx++) {
+        const OctreeNode *childNode = source_arg.getChildPtr(childIdx);
+
+        if (childNode) {
+            switch (childNode->getNodeType()) {
+            case BRANCH_NODE: {
+                BranchNode *newBranch;
+                createBranchChild(target_arg, childIdx, newBranch);
+                break;
+            }
+            case LEAF_NODE: {
+                LeafNode *newLeaf;
+                createLeafChild(target_arg, childIdx, newLeaf);
+                static_cast<LeafContainerT &>(*newLeaf) =
+                    static_cast<const LeafNode &>(*childNode);
+                break;
+            }
+            default:
+                break;
+            }
+        }
+    }
+
+    // then copy the sub-trees one after the other
+    for (childIdx = 0; childIdx < 8; childIdx++) {
+        const OctreeNode *childNode = source_arg.getChildPtr(childIdx);
+
+        if (childNode && (childNode->getNodeType() == BRANCH_NODE))
+            copyBranchRecursive(
+                *static_cast<const BranchNode *>(childNode),
+                *static_cast<BranchNode *>(target_arg.getChildPtr(childIdx)));
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename DataT, typename LeafContainerT, typename BranchContainerT>
 void OctreeBase<DataT, LeafContainerT, BranchContainerT>::
@@ -617,6 +735,9 @@ void OctreeBase<DataT, LeafContainerT, BranchContainerT>::
 
                     leafCount_++;
 
+                    if (leafIndexActive())
+                        leafIndex_.insert(key_arg, childLeaf);
+
                     // execute deserialization callback
                     deserializeTreeCallback(*childLeaf, key_arg);
                 }
@@ -628,6 +749,48 @@ void OctreeBase<DataT, LeafContainerT, BranchContainerT>::
     }
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename DataT, typename LeafContainerT, typename BranchContainerT>
+void OctreeBase<DataT, LeafContainerT, BranchContainerT>::
+    rebuildLeafIndexRecursive(const BranchNode *branch_arg,
+                              OctreeKey &key_arg) {
+    // child iterator
+    unsigned char childIdx;
+
+    for (childIdx = 0; childIdx < 8; childIdx++) {
+        const OctreeNode *childNode = branch_arg->getChildPtr(childIdx);
+        if (!childNode)
+            continue;
+
+        // add current branch voxel to key
+        key_arg.pushBranch(childIdx);
+
+        if (childNode->getNodeType() == BRANCH_NODE)
+            rebuildLeafIndexRecursive(
+                static_cast<const BranchNode *>(childNode), key_arg);
+        else
+            leafIndex_.insert(key_arg,
+                              const_cast<LeafNode *>(
+                                  static_cast<const LeafNode *>(childNode)));
+
+        // pop current branch voxel from key
+        key_arg.popBranch();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename DataT, typename LeafContainerT, typename BranchContainerT>
+void OctreeBase<DataT, LeafContainerT, BranchContainerT>::rebuildLeafIndex() {
+    leafIndex_.clear();
+
+    if (!leafIndexActive() || !leafCount_)
+        return;
+
+    OctreeKey newKey;
+    leafIndex_.reserve(leafCount_);
+    rebuildLeafIndexRecursive(rootNode_, newKey);
+}
+
 } // namespace octree
 } // namespace pcl
 
@@ -55,7 +55,7 @@ pcl::octree::OctreePointCloud<PointT, LeafContainerT, BranchContainerT,
     : OctreeT(), input_(PointCloudConstPtr()), indices_(IndicesConstPtr()),
       epsilon_(0), resolution_(resolution), minX_(0.0f), maxX_(resolution),
       minY_(0.0f), maxY_(resolution), minZ_(0.0f), maxZ_(resolution),
-      boundingBoxDefined_(false) {
+      boundingBoxDefined_(false), threads_(1) {
     assert(resolution > 0.0f);
 }
 
@@ -65,32 +65,165 @@ template <typename PointT, typename LeafContainerT, typename BranchContainerT,
 pcl::octree::OctreePointCloud<PointT, LeafContainerT, BranchContainerT,
                               OctreeT>::~OctreePointCloud() {}
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+namespace pcl {
+namespace octree {
+namespace detail {
+/** \brief Stable LSD radix sort of (Morton code, point index) pairs on the
+ * nrBits_arg lowest bits of their codes, 8 bits per pass. Every pass
+ * histograms and scatters fixed blocks of pairs in parallel.
+ * \param[in,out] codes_arg the pairs to sort
+ * \param[in] nrBits_arg the number of significant bits of the codes
+ * \param[in] nrThreads_arg the number of threads to use (0 for automatic)
+ */
+inline void sortMortonCodes(std::vector<std::pair<uint64_t, int>> &codes_arg,
+                            unsigned int nrBits_arg,
+                            unsigned int nrThreads_arg) {
+    const int radix = 256;
+    const int blockSize = 1 << 16;
+    const int nrCodes = static_cast<int>(codes_arg.size());
+    const int nrBlocks = (nrCodes + blockSize - 1) / blockSize;
+
+    std::vector<std::pair<uint64_t, int>> buffer(codes_arg.size());
+    std::vector<int> histograms(static_cast<size_t>(nrBlocks) * radix);
+
+    for (unsigned int shift = 0; shift < nrBits_arg; shift += 8) {
+        std::fill(histograms.begin(), histograms.end(), 0);
+
+#pragma omp parallel for num_threads(nrThreads_arg)
+        for (int b = 0; b < nrBlocks; ++b) {
+            int *histogram = &histograms[static_cast<size_t>(b) * radix];
+            const int end = std::min(nrCodes, (b + 1) * blockSize);
+            for (int i = b * blockSize; i < end; ++i)
+                ++histogram[(codes_arg[i].first >> shift) & (radix - 1)];
+        }
+
+        // turn the counts into the first output position of each digit in
+        // each block, digits first then blocks to keep the sort stable
+        int offset = 0;
+        bool sorted = false;
+        for (int digit = 0; digit < radix; ++digit)
+            for (int b = 0; b < nrBlocks; ++b) {
+                int &count = histograms[static_cast<size_t>(b) * radix + digit];
+                sorted = sorted || (count == nrCodes);
+                const int first = offset;
+                offset += count;
+                count = first;
+            }
+
+        // all the codes share this digit
+        if (sorted)
+            continue;
+
+#pragma omp parallel for num_threads(nrThreads_arg)
+        for (int b = 0; b < nrBlocks; ++b) {
+            int *position = &histograms[static_cast<size_t>(b) * radix];
+            const int end = std::min(nrCodes, (b + 1) * blockSize);
+            for (int i = b * blockSize; i < end; ++i)
+                buffer[position[(codes_arg[i].first >> shift) &
+                                (radix - 1)]++] = codes_arg[i];
+        }
+
+        codes_arg.swap(buffer);
+    }
+}
+} // namespace detail
+} // namespace octree
+} // namespace pcl
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointT, typename LeafContainerT, typename BranchContainerT,
           typename OctreeT>
 void pcl::octree::OctreePointCloud<PointT, LeafContainerT, BranchContainerT,
                                    OctreeT>::addPointsFromInputCloud() {
-    size_t i;
-
+    // gather the finite points in insertion order
+    std::vector<int> pointIndices;
     if (indices_) {
+        pointIndices.reserve(indices_->size());
         for (std::vector<int>::const_iterator current = indices_->begin();
              current != indices_->end(); ++current) {
             if (isFinite(input_->points[*current])) {
                 assert((*current >= 0) &&
                        (*current < static_cast<int>(input_->points.size())));
-
-                // add points to octree
-                this->addPointIdx(*current);
+                pointIndices.push_back(*current);
             }
         }
     } else {
-        for (i = 0; i < input_->points.size(); i++) {
-            if (isFinite(input_->points[i])) {
-                // add points to octree
-                this->addPointIdx(static_cast<unsigned int>(i));
+        pointIndices.reserve(input_->points.size());
+        for (size_t i = 0; i < input_->points.size(); i++) {
+            if (isFinite(input_->points[i]))
+                pointIndices.push_back(static_cast<int>(i));
+        }
+    }
+
+    // dynamic octrees split their leaf nodes while being filled, add the
+    // points one by one
+    if (this->dynamicDepthEnabled()) {
+        for (size_t i = 0; i < pointIndices.size(); i++)
+            this->addPointIdx(pointIndices[i]);
+        return;
+    }
+
+    // Grow the bounding box in insertion order. Every growth starts a new
+    // epoch: the keys of the points of an epoch are computed in its bounding
+    // box, exactly like addPointIdx does, then offset into the final one.
+    std::vector<int> epochStart;
+    std::vector<double> epochMin;
+    for (size_t i = 0; i < pointIndices.size(); i++) {
+        const double minX = minX_, minY = minY_, minZ = minZ_;
+
+        adoptBoundingBoxToPoint(input_->points[pointIndices[i]]);
+
+        if (epochStart.empty() || (minX != minX_) || (minY != minY_) ||
+            (minZ != minZ_)) {
+            epochStart.push_back(static_cast<int>(i));
+            epochMin.push_back(minX_);
+            epochMin.push_back(minY_);
+            epochMin.push_back(minZ_);
+        }
+    }
+    epochStart.push_back(static_cast<int>(pointIndices.size()));
+
+    const int nrEpochs = static_cast<int>(epochStart.size()) - 1;
+
+    // Octrees too deep for 64 bit Morton codes are filled in insertion order
+    if (this->octreeDepth_ > OctreeKey::maxMortonDepth) {
+        for (int e = 0; e < nrEpochs; ++e) {
+            OctreeKey key;
+            for (int i = epochStart[e]; i < epochStart[e + 1]; ++i) {
+                genOctreeKeyforPoint(input_->points[pointIndices[i]],
+                                     &epochMin[3 * e], key);
+                this->addData(key, pointIndices[i]);
             }
         }
+        return;
+    }
+
+    std::vector<std::pair<uint64_t, int>> codes(pointIndices.size());
+    for (int e = 0; e < nrEpochs; ++e) {
+        const double *epochMinXYZ = &epochMin[3 * e];
+#pragma omp parallel for num_threads(threads_)
+        for (int i = epochStart[e]; i < epochStart[e + 1]; ++i) {
+            OctreeKey key;
+            genOctreeKeyforPoint(input_->points[pointIndices[i]], epochMinXYZ,
+                                 key);
+            codes[i] = std::make_pair(key.getMortonCode(), pointIndices[i]);
+        }
+    }
+
+    // sorting the codes orders the leaf nodes depth first, and the points
+    // within a leaf node by insertion order
+    detail::sortMortonCodes(codes, 3 * this->octreeDepth_, threads_);
+
+    // the nodes are created depth first as well, which slab allocation
+    // keeps in this order in memory
+    OctreeKey key;
+    this->setSlabAllocation(true);
+    for (size_t i = 0; i < codes.size(); i++) {
+        key.setMortonCode(codes[i].first);
+        this->addData(key, codes[i].second);
     }
+    this->setSlabAllocation(false);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
@@ -664,6 +797,30 @@ void pcl::octree::OctreePointCloud<
     genOctreeKeyforPoint(tempPoint, key_arg);
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT, typename LeafContainerT, typename BranchContainerT,
+          typename OctreeT>
+void pcl::octree::OctreePointCloud<
+    PointT, LeafContainerT, BranchContainerT,
+    OctreeT>::genOctreeKeyforPoint(const PointT &point_arg,
+                                   const double *min_arg,
+                                   OctreeKey &key_arg) const {
+    // key within the former bounding box, plus the amount of voxels the
+    // bounding box grew by towards the negative axes since
+    key_arg.x = static_cast<unsigned int>((point_arg.x - min_arg[0]) /
+                                          this->resolution_) +
+                static_cast<unsigned int>(
+                    (min_arg[0] - this->minX_) / this->resolution_ + 0.5);
+    key_arg.y = static_cast<unsigned int>((point_arg.y - min_arg[1]) /
+                                          this->resolution_) +
+                static_cast<unsigned int>(
+                    (min_arg[1] - this->minY_) / this->resolution_ + 0.5);
+    key_arg.z = static_cast<unsigned int>((point_arg.z - min_arg[2]) /
+                                          this->resolution_) +
+                static_cast<unsigned int>(
+                    (min_arg[2] - this->minZ_) / this->resolution_ + 0.5);
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointT, typename LeafContainerT, typename BranchContainerT,
           typename OctreeT>
@@ -43,7 +43,13 @@
 #include <pcl/point_types.h>
 
 #include <pcl/common/common.h>
+#include <pcl/console/print.h>
 #include <assert.h>
+#include <algorithm>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 
@@ -81,6 +87,29 @@ bool pcl::octree::OctreePointCloudSearch<
     return (this->voxelSearch(search_point, pointIdx_data));
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT, typename LeafContainerT, typename BranchContainerT>
+int pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
+                                        BranchContainerT>::
+    voxelNeighborSearch(const PointT &point, unsigned int voxelRadius,
+                        std::vector<int> &pointIdx_data) const {
+    pointIdx_data.clear();
+
+    if (!isFinite(point) || !this->isPointWithinBoundingBox(point))
+        return (0);
+
+    OctreeKey key;
+    this->genOctreeKeyforPoint(point, key);
+
+    std::vector<LeafNode *> leaves;
+    this->findNeighborLeaves(key, voxelRadius, leaves);
+
+    for (size_t i = 0; i < leaves.size(); i++)
+        leaves[i]->getData(pointIdx_data);
+
+    return (static_cast<int>(leaves.size()));
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointT, typename LeafContainerT, typename BranchContainerT>
 int pcl::octree::OctreePointCloudSearch<
@@ -204,23 +233,142 @@ int pcl::octree::OctreePointCloudSearch<
         radiusSearch(search_point, radius, k_indices, k_sqr_distances, max_nn));
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+namespace pcl {
+namespace octree {
+namespace detail {
+/** \brief The six planes bounding a box, inside of which are the points
+ * strictly inside of the box. */
+template <typename PlaneVector>
+inline void getBoxPlanes(const Eigen::Vector3f &min_pt,
+                         const Eigen::Vector3f &max_pt, PlaneVector &planes) {
+    planes.resize(6);
+    for (int i = 0; i < 3; ++i) {
+        planes[2 * i] = Eigen::Vector4f::Zero();
+        planes[2 * i](i) = 1.0f;
+        planes[2 * i](3) = -min_pt(i);
+        planes[2 * i + 1] = Eigen::Vector4f::Zero();
+        planes[2 * i + 1](i) = -1.0f;
+        planes[2 * i + 1](3) = max_pt(i);
+    }
+}
+
+/** \brief Get the mask of the rays (bit j for the j-th one) intersecting a
+ * node, given the parameters at which the four rays enter (min) and leave
+ * (max) its slabs along each axis: the ray has to be inside of all the slabs
+ * at once, not only before its origin.
+ */
+inline int intersectRaySlabs(const double *const *min,
+                             const double *const *max) {
+#ifdef __SSE2__
+    // Two rays per register
+    int mask = 0;
+    for (int j = 0; j < 4; j += 2) {
+        const __m128d enter = _mm_max_pd(
+            _mm_max_pd(_mm_loadu_pd(min[0] + j), _mm_loadu_pd(min[1] + j)),
+            _mm_loadu_pd(min[2] + j));
+        const __m128d exit = _mm_min_pd(
+            _mm_min_pd(_mm_loadu_pd(max[0] + j), _mm_loadu_pd(max[1] + j)),
+            _mm_loadu_pd(max[2] + j));
+        mask |= _mm_movemask_pd(_mm_and_pd(
+                    _mm_cmplt_pd(enter, exit),
+                    _mm_cmpge_pd(exit, _mm_setzero_pd())))
+                << j;
+    }
+    return (mask);
+#else
+    int mask = 0;
+    for (int j = 0; j < 4; ++j) {
+        const double enter =
+            std::max(std::max(min[0][j], min[1][j]), min[2][j]);
+        const double exit = std::min(std::min(max[0][j], max[1][j]), max[2][j]);
+        if (enter < exit && exit >= 0.0)
+            mask |= 1 << j;
+    }
+    return (mask);
+#endif
+}
+} // namespace detail
+} // namespace octree
+} // namespace pcl
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointT, typename LeafContainerT, typename BranchContainerT>
 int pcl::octree::
     OctreePointCloudSearch<PointT, LeafContainerT, BranchContainerT>::boxSearch(
         const Eigen::Vector3f &min_pt, const Eigen::Vector3f &max_pt,
         std::vector<int> &k_indices) const {
+    // x > min_x is evaluated exactly as x + 0 y + 0 z - min_x > 0
+    PlaneVector planes;
+    detail::getBoxPlanes(min_pt, max_pt, planes);
+    return (frustumSearch(planes, k_indices));
+}
 
-    OctreeKey key;
-    key.x = key.y = key.z = 0;
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT, typename LeafContainerT, typename BranchContainerT>
+int pcl::octree::
+    OctreePointCloudSearch<PointT, LeafContainerT, BranchContainerT>::boxSearch(
+        const Eigen::Vector3f &min_pt, const Eigen::Vector3f &max_pt,
+        AlignedPointTVector &voxelCenterList) const {
+    PlaneVector planes;
+    detail::getBoxPlanes(min_pt, max_pt, planes);
+    return (frustumSearch(planes, voxelCenterList));
+}
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT, typename LeafContainerT, typename BranchContainerT>
+int pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
+                                        BranchContainerT>::
+    frustumSearch(const PlaneVector &planes,
+                  std::vector<int> &k_indices) const {
     k_indices.clear();
+    if (planes.size() > 32) {
+        PCL_ERROR("[pcl::octree::OctreePointCloudSearch::frustumSearch] At "
+                  "most 32 planes are supported, %lu given!\n",
+                  planes.size());
+        return (0);
+    }
 
-    boxSearchRecursive(min_pt, max_pt, this->rootNode_, key, 1, k_indices);
+    OctreeKey key;
+    key.x = key.y = key.z = 0;
+    const unsigned int planeMask =
+        planes.size() == 32 ? 0xffffffffu : (1u << planes.size()) - 1;
+    if (planeMask == 0)
+        addLeavesRecursive(this->rootNode_, key, k_indices);
+    else
+        regionSearchRecursive(planes, planeMask, this->rootNode_, key, 1,
+                              k_indices);
 
     return (static_cast<int>(k_indices.size()));
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT, typename LeafContainerT, typename BranchContainerT>
+int pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
+                                        BranchContainerT>::
+    frustumSearch(const PlaneVector &planes,
+                  AlignedPointTVector &voxelCenterList) const {
+    voxelCenterList.clear();
+    if (planes.size() > 32) {
+        PCL_ERROR("[pcl::octree::OctreePointCloudSearch::frustumSearch] At "
+                  "most 32 planes are supported, %lu given!\n",
+                  planes.size());
+        return (0);
+    }
+
+    OctreeKey key;
+    key.x = key.y = key.z = 0;
+    const unsigned int planeMask =
+        planes.size() == 32 ? 0xffffffffu : (1u << planes.size()) - 1;
+    if (planeMask == 0)
+        addLeavesRecursive(this->rootNode_, key, voxelCenterList);
+    else
+        regionSearchRecursive(planes, planeMask, this->rootNode_, key, 1,
+                              voxelCenterList);
+
+    return (static_cast<int>(voxelCenterList.size()));
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointT, typename LeafContainerT, typename BranchContainerT>
 double
@@ -271,6 +419,9 @@ pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT, BranchContainerT>::
 
     std::sort(searchEntryHeap.begin(), searchEntryHeap.end());
 
+    // indices of the points of a leaf, reused from one leaf to the next
+    vector<int> decodedPointVector;
+
     // iterate over all children in priority queue
     // check if the distance to search candidate is smaller than the best point
     // distance (smallestSquaredDist)
@@ -295,12 +446,12 @@ pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT, BranchContainerT>::
 
             float squaredDist;
             size_t i;
-            vector<int> decodedPointVector;
 
             const LeafNode *childLeaf =
                 static_cast<const LeafNode *>(childNode);
 
             // decode leaf node into decodedPointVector
+            decodedPointVector.clear();
             childLeaf->getData(decodedPointVector);
 
             // Linearly iterate over all decoded (unsorted) points
@@ -352,6 +503,14 @@ void pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
     // get spatial voxel information
     double voxelSquaredDiameter = this->getVoxelSquaredDiameter(treeDepth);
 
+    // squared distance beyond which a voxel center is too far for its voxel
+    // to intersect the search sphere
+    const double maxSquaredDist = voxelSquaredDiameter / 4.0 + radiusSquared +
+                                  sqrt(voxelSquaredDiameter * radiusSquared);
+
+    // indices of the points of a leaf, reused from one leaf to the next
+    vector<int> decodedPointVector;
+
     // iterate over all children
     for (childIdx = 0; childIdx < 8; childIdx++) {
         if (!this->branchHasChild(*node, childIdx))
@@ -377,9 +536,7 @@ void pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
             pointSquaredDist(static_cast<const PointT &>(voxelCenter), point);
 
         // if distance is smaller than search radius
-        if (squaredDist + this->epsilon_ <=
-            voxelSquaredDiameter / 4.0 + radiusSquared +
-                sqrt(voxelSquaredDiameter * radiusSquared)) {
+        if (squaredDist + this->epsilon_ <= maxSquaredDist) {
 
             if (treeDepth < this->octreeDepth_) {
                 // we have not reached maximum tree depth
@@ -396,9 +553,9 @@ void pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
                 size_t i;
                 const LeafNode *childLeaf =
                     static_cast<const LeafNode *>(childNode);
-                vector<int> decodedPointVector;
 
                 // decode leaf node into decodedPointVector
+                decodedPointVector.clear();
                 childLeaf->getData(decodedPointVector);
 
                 // Linearly iterate over all decoded (unsorted) points
@@ -531,23 +688,15 @@ float pcl::octree::OctreePointCloudSearch<
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointT, typename LeafContainerT, typename BranchContainerT>
-void pcl::octree::OctreePointCloudSearch<
-    PointT, LeafContainerT,
-    BranchContainerT>::boxSearchRecursive(const Eigen::Vector3f &min_pt,
-                                          const Eigen::Vector3f &max_pt,
-                                          const BranchNode *node,
-                                          const OctreeKey &key,
-                                          unsigned int treeDepth,
-                                          std::vector<int> &k_indices) const {
-    // child iterator
-    unsigned char childIdx;
-
+template <typename OutputT>
+void pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
+                                         BranchContainerT>::
+    regionSearchRecursive(const PlaneVector &planes, unsigned int planeMask,
+                          const BranchNode *node, const OctreeKey &key,
+                          unsigned int treeDepth, OutputT &output) const {
     // iterate over all children
-    for (childIdx = 0; childIdx < 8; childIdx++) {
-
-        const OctreeNode *childNode;
-        childNode = this->getBranchChildPtr(*node, childIdx);
-
+    for (unsigned char childIdx = 0; childIdx < 8; childIdx++) {
+        const OctreeNode *childNode = this->getBranchChildPtr(*node, childIdx);
         if (!childNode)
             continue;
 
@@ -557,59 +706,104 @@ void pcl::octree::OctreePointCloudSearch<
         newKey.y = (key.y << 1) + (!!(childIdx & (1 << 1)));
         newKey.z = (key.z << 1) + (!!(childIdx & (1 << 0)));
 
-        // voxel corners
-        Eigen::Vector3f lowerVoxelCorner;
-        Eigen::Vector3f upperVoxelCorner;
-        // get voxel coordinates
+        Eigen::Vector3f lowerVoxelCorner, upperVoxelCorner;
         this->genVoxelBoundsFromOctreeKey(newKey, treeDepth, lowerVoxelCorner,
                                           upperVoxelCorner);
 
-        // test if search region overlap with voxel space
-
-        if (!((lowerVoxelCorner(0) > max_pt(0)) ||
-              (min_pt(0) > upperVoxelCorner(0)) ||
-              (lowerVoxelCorner(1) > max_pt(1)) ||
-              (min_pt(1) > upperVoxelCorner(1)) ||
-              (lowerVoxelCorner(2) > max_pt(2)) ||
-              (min_pt(2) > upperVoxelCorner(2)))) {
+        // Evaluate each plane on the voxel corners farthest inside and
+        // outside of it: the voxel is either outside of the plane, entirely
+        // inside of it or crossing it
+        unsigned int childMask = planeMask;
+        bool outside = false;
+        for (unsigned int i = 0; (planeMask >> i) != 0 && !outside; ++i) {
+            if (!(planeMask & (1u << i)))
+                continue;
+            const Eigen::Vector4f &plane = planes[i];
+            float inner = plane(3), outer = plane(3);
+            for (int axis = 0; axis < 3; ++axis) {
+                if (plane(axis) >= 0.0f) {
+                    inner += plane(axis) * upperVoxelCorner(axis);
+                    outer += plane(axis) * lowerVoxelCorner(axis);
+                } else {
+                    inner += plane(axis) * lowerVoxelCorner(axis);
+                    outer += plane(axis) * upperVoxelCorner(axis);
+                }
+            }
+            if (inner <= 0.0f)
+                outside = true;
+            else if (outer > 0.0f)
+                childMask &= ~(1u << i);
+        }
+        if (outside)
+            continue;
 
-            if (treeDepth < this->octreeDepth_) {
-                // we have not reached maximum tree depth
-                boxSearchRecursive(min_pt, max_pt,
-                                   static_cast<const BranchNode *>(childNode),
-                                   newKey, treeDepth + 1, k_indices);
-            } else {
-                // we reached leaf node level
-                size_t i;
-                vector<int> decodedPointVector;
-                bool bInBox;
+        if (childMask == 0)
+            addLeavesRecursive(childNode, newKey, output);
+        else if (treeDepth < this->octreeDepth_)
+            regionSearchRecursive(planes, childMask,
+                                  static_cast<const BranchNode *>(childNode),
+                                  newKey, treeDepth + 1, output);
+        else
+            addLeaf(static_cast<const LeafNode *>(childNode), newKey, planes,
+                    childMask, output);
+    }
+}
 
-                const LeafNode *childLeaf =
-                    static_cast<const LeafNode *>(childNode);
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT, typename LeafContainerT, typename BranchContainerT>
+template <typename OutputT>
+void pcl::octree::OctreePointCloudSearch<
+    PointT, LeafContainerT,
+    BranchContainerT>::addLeavesRecursive(const OctreeNode *node,
+                                          const OctreeKey &key,
+                                          OutputT &output) const {
+    if (node->getNodeType() == LEAF_NODE) {
+        addLeaf(static_cast<const LeafNode *>(node), key, PlaneVector(), 0,
+                output);
+        return;
+    }
 
-                // decode leaf node into decodedPointVector
-                childLeaf->getData(decodedPointVector);
+    for (unsigned char childIdx = 0; childIdx < 8; childIdx++) {
+        const OctreeNode *childNode = this->getBranchChildPtr(
+            static_cast<const BranchNode &>(*node), childIdx);
+        if (!childNode)
+            continue;
 
-                // Linearly iterate over all decoded (unsorted) points
-                for (i = 0; i < decodedPointVector.size(); i++) {
-                    const PointT &candidatePoint =
-                        this->getPointByIndex(decodedPointVector[i]);
+        OctreeKey newKey;
+        newKey.x = (key.x << 1) + (!!(childIdx & (1 << 2)));
+        newKey.y = (key.y << 1) + (!!(childIdx & (1 << 1)));
+        newKey.z = (key.z << 1) + (!!(childIdx & (1 << 0)));
+        addLeavesRecursive(childNode, newKey, output);
+    }
+}
 
-                    // check if point falls within search box
-                    bInBox = ((candidatePoint.x > min_pt(0)) &&
-                              (candidatePoint.x < max_pt(0)) &&
-                              (candidatePoint.y > min_pt(1)) &&
-                              (candidatePoint.y < max_pt(1)) &&
-                              (candidatePoint.z > min_pt(2)) &&
-                              (candidatePoint.z < max_pt(2)));
-
-                    if (bInBox)
-                        // add to result vector
-                        k_indices.push_back(decodedPointVector[i]);
-                }
-            }
-        }
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT, typename LeafContainerT, typename BranchContainerT>
+void pcl::octree::OctreePointCloudSearch<
+    PointT, LeafContainerT,
+    BranchContainerT>::addLeaf(const LeafNode *leaf, const OctreeKey &,
+                               const PlaneVector &planes,
+                               unsigned int planeMask,
+                               std::vector<int> &k_indices) const {
+    // decode the leaf at the end of k_indices, then keep the points inside
+    const size_t first = k_indices.size();
+    leaf->getData(k_indices);
+    if (planeMask == 0)
+        return;
+
+    size_t end = first;
+    for (size_t i = first; i < k_indices.size(); ++i) {
+        const PointT &point = this->getPointByIndex(k_indices[i]);
+        bool inside = true;
+        for (unsigned int j = 0; (planeMask >> j) != 0 && inside; ++j)
+            if (planeMask & (1u << j))
+                inside = planes[j](0) * point.x + planes[j](1) * point.y +
+                             planes[j](2) * point.z + planes[j](3) >
+                         0.0f;
+        if (inside)
+            k_indices[end++] = k_indices[i];
     }
+    k_indices.resize(end);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
@@ -668,6 +862,268 @@ int pcl::octree::OctreePointCloudSearch<
     return (0);
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT, typename LeafContainerT, typename BranchContainerT>
+void pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
+                                         BranchContainerT>::
+    getIntersectedVoxelCenters(const std::vector<Eigen::Vector3f> &origins,
+                               const std::vector<Eigen::Vector3f> &directions,
+                               AlignedPointTVector &voxelCenterList,
+                               std::vector<size_t> &offsets, int maxVoxelCount,
+                               unsigned int nr_threads) const {
+    std::vector<IntersectedLeaf> leaves;
+    getIntersectedLeaves(origins, directions, maxVoxelCount, nr_threads,
+                         offsets, leaves);
+
+    voxelCenterList.resize(leaves.size());
+    const int nr_leaves = static_cast<int>(leaves.size());
+#pragma omp parallel for num_threads(nr_threads)
+    for (int i = 0; i < nr_leaves; ++i)
+        this->genLeafNodeCenterFromOctreeKey(leaves[i].second,
+                                             voxelCenterList[i]);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT, typename LeafContainerT, typename BranchContainerT>
+void pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
+                                         BranchContainerT>::
+    getIntersectedVoxelIndices(const std::vector<Eigen::Vector3f> &origins,
+                               const std::vector<Eigen::Vector3f> &directions,
+                               Neighborhoods &neighborhoods, int maxVoxelCount,
+                               unsigned int nr_threads) const {
+    std::vector<size_t> leaf_offsets;
+    std::vector<IntersectedLeaf> leaves;
+    getIntersectedLeaves(origins, directions, maxVoxelCount, nr_threads,
+                         leaf_offsets, leaves);
+
+    // Count the points of the rays, then decode their leaves in place
+    const int nr_rays = static_cast<int>(origins.size());
+    std::vector<size_t> &offsets = neighborhoods.offsets;
+    offsets.resize(nr_rays + 1);
+    offsets[0] = 0;
+    for (int i = 0; i < nr_rays; ++i) {
+        size_t nr_points = 0;
+        for (size_t j = leaf_offsets[i]; j < leaf_offsets[i + 1]; ++j)
+            nr_points += leaves[j].first->getSize();
+        offsets[i + 1] = offsets[i] + nr_points;
+    }
+    neighborhoods.indices.resize(offsets[nr_rays]);
+    neighborhoods.sqr_distances.resize(offsets[nr_rays]);
+
+    std::vector<int> leaf_indices;
+#pragma omp parallel for private(leaf_indices) num_threads(nr_threads)       \
+    schedule(dynamic, 64)
+    for (int i = 0; i < nr_rays; ++i) {
+        leaf_indices.clear();
+        for (size_t j = leaf_offsets[i]; j < leaf_offsets[i + 1]; ++j)
+            leaves[j].first->getData(leaf_indices);
+        for (size_t j = 0; j < leaf_indices.size(); ++j) {
+            neighborhoods.indices[offsets[i] + j] = leaf_indices[j];
+            neighborhoods.sqr_distances[offsets[i] + j] =
+                (this->getPointByIndex(leaf_indices[j]).getVector3fMap() -
+                 origins[i])
+                    .squaredNorm();
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT, typename LeafContainerT, typename BranchContainerT>
+void pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
+                                         BranchContainerT>::
+    getIntersectedLeaves(const std::vector<Eigen::Vector3f> &origins,
+                         const std::vector<Eigen::Vector3f> &directions,
+                         int maxVoxelCount, unsigned int nr_threads,
+                         std::vector<size_t> &offsets,
+                         std::vector<IntersectedLeaf> &leaves) const {
+    const int nr_rays = static_cast<int>(origins.size());
+    offsets.assign(nr_rays + 1, 0);
+    leaves.clear();
+    if (directions.size() != origins.size()) {
+        PCL_ERROR("[pcl::octree::OctreePointCloudSearch::"
+                  "getIntersectedVoxels] %lu origins but %lu directions!\n",
+                  origins.size(), directions.size());
+        offsets.assign(1, 0);
+        return;
+    }
+
+    // Sort the rays by the signs of their directions, keeping the order of
+    // the rays with the same signs, and cut each group in packets of 4
+    std::vector<unsigned char> signs(nr_rays);
+    std::vector<int> group_start(9, 0);
+    for (int i = 0; i < nr_rays; ++i) {
+        signs[i] = static_cast<unsigned char>((directions[i].x() < 0) << 2 |
+                                              (directions[i].y() < 0) << 1 |
+                                              (directions[i].z() < 0));
+        ++group_start[signs[i] + 1];
+    }
+    std::vector<int> packet_start;
+    for (int g = 0; g < 8; ++g) {
+        for (int i = 0; i < group_start[g + 1]; i += 4)
+            packet_start.push_back(group_start[g] + i);
+        group_start[g + 1] += group_start[g];
+    }
+    packet_start.push_back(nr_rays);
+    std::vector<int> order(nr_rays);
+    std::vector<int> next(group_start.begin(), group_start.end() - 1);
+    for (int i = 0; i < nr_rays; ++i)
+        order[next[signs[i]]++] = i;
+
+    // Traverse blocks of packets in parallel, each one gathering the leaves
+    // of its rays in its own buffer
+    const int block_size = 16;
+    const int nr_packets = static_cast<int>(packet_start.size()) - 1;
+    const int nr_blocks = (nr_packets + block_size - 1) / block_size;
+    std::vector<std::vector<IntersectedLeaf>> block_leaves(nr_blocks);
+    std::vector<int> ray_block(nr_rays);
+    std::vector<size_t> ray_start(nr_rays);
+
+#pragma omp parallel for num_threads(nr_threads) schedule(dynamic)
+    for (int b = 0; b < nr_blocks; ++b) {
+        std::vector<IntersectedLeaf> ray_leaves[4];
+        const int end = std::min(nr_packets, (b + 1) * block_size);
+        for (int p = b * block_size; p < end; ++p) {
+            const int size = packet_start[p + 1] - packet_start[p];
+            const int *rays = &order[packet_start[p]];
+            const unsigned char a = signs[rays[0]];
+
+            RaySlabs slabs;
+            memset(&slabs, 0, sizeof(slabs));
+            int rayMask = 0;
+            int voxelCounts[4] = {0, 0, 0, 0};
+            for (int j = 0; j < size; ++j) {
+                Eigen::Vector3f origin = origins[rays[j]];
+                Eigen::Vector3f direction = directions[rays[j]];
+                unsigned char ray_a;
+                double minX, minY, minZ, maxX, maxY, maxZ;
+                initIntersectedVoxel(origin, direction, minX, minY, minZ,
+                                     maxX, maxY, maxZ, ray_a);
+                slabs.min[0][j] = minX;
+                slabs.min[1][j] = minY;
+                slabs.min[2][j] = minZ;
+                slabs.max[0][j] = maxX;
+                slabs.max[1][j] = maxY;
+                slabs.max[2][j] = maxZ;
+                // Same tests as the single ray searches on the root
+                if (max(max(minX, minY), minZ) < min(min(maxX, maxY), maxZ) &&
+                    min(min(maxX, maxY), maxZ) >= 0.0)
+                    rayMask |= 1 << j;
+                ray_leaves[j].clear();
+            }
+
+            if (rayMask != 0) {
+                OctreeKey key;
+                key.x = key.y = key.z = 0;
+                getIntersectedLeavesRecursive(slabs, rayMask, a,
+                                              this->rootNode_, key,
+                                              maxVoxelCount, voxelCounts,
+                                              ray_leaves);
+            }
+
+            for (int j = 0; j < size; ++j) {
+                ray_block[rays[j]] = b;
+                ray_start[rays[j]] = block_leaves[b].size();
+                offsets[rays[j] + 1] = ray_leaves[j].size();
+                block_leaves[b].insert(block_leaves[b].end(),
+                                       ray_leaves[j].begin(),
+                                       ray_leaves[j].end());
+            }
+        }
+    }
+
+    for (int i = 0; i < nr_rays; ++i)
+        offsets[i + 1] += offsets[i];
+    leaves.resize(offsets[nr_rays]);
+#pragma omp parallel for num_threads(nr_threads) schedule(dynamic, 256)
+    for (int i = 0; i < nr_rays; ++i) {
+        const std::vector<IntersectedLeaf> &block = block_leaves[ray_block[i]];
+        std::copy(block.begin() + ray_start[i],
+                  block.begin() + ray_start[i] + (offsets[i + 1] - offsets[i]),
+                  leaves.begin() + offsets[i]);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT, typename LeafContainerT, typename BranchContainerT>
+void pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
+                                         BranchContainerT>::
+    getIntersectedLeavesRecursive(const RaySlabs &slabs, int rayMask,
+                                  unsigned char a, const BranchNode *node,
+                                  const OctreeKey &key, int maxVoxelCount,
+                                  int *voxelCounts,
+                                  std::vector<IntersectedLeaf> *rayLeaves)
+        const {
+    // Voxel mid lines along the rays
+    double mid[3][4];
+    for (int axis = 0; axis < 3; ++axis) {
+#ifdef __SSE2__
+        for (int j = 0; j < 4; j += 2)
+            _mm_storeu_pd(
+                mid[axis] + j,
+                _mm_mul_pd(_mm_add_pd(_mm_loadu_pd(slabs.min[axis] + j),
+                                      _mm_loadu_pd(slabs.max[axis] + j)),
+                           _mm_set1_pd(0.5)));
+#else
+        for (int j = 0; j < 4; ++j)
+            mid[axis][j] = 0.5 * (slabs.min[axis][j] + slabs.max[axis][j]);
+#endif
+    }
+
+    // As the directions are positive, every ray crosses the children in
+    // increasing order of their (remapped) index
+    for (int i = 0; i < 8; ++i) {
+        if (maxVoxelCount > 0)
+            for (int j = 0; j < 4; ++j)
+                if (voxelCounts[j] >= maxVoxelCount)
+                    rayMask &= ~(1 << j);
+        if (rayMask == 0)
+            return;
+
+        const unsigned char childIdx = static_cast<unsigned char>(i ^ a);
+        const OctreeNode *childNode = this->getBranchChildPtr(*node, childIdx);
+        if (!childNode)
+            continue;
+
+        // Lower or upper half of the node along each axis
+        const double *childMin[3], *childMax[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            const bool upper = (i & (4 >> axis)) != 0;
+            childMin[axis] = upper ? mid[axis] : slabs.min[axis];
+            childMax[axis] = upper ? slabs.max[axis] : mid[axis];
+        }
+        const int childMask =
+            rayMask & detail::intersectRaySlabs(childMin, childMax);
+        if (childMask == 0)
+            continue;
+
+        OctreeKey childKey;
+        childKey.x = (key.x << 1) | (!!(childIdx & (1 << 2)));
+        childKey.y = (key.y << 1) | (!!(childIdx & (1 << 1)));
+        childKey.z = (key.z << 1) | (!!(childIdx & (1 << 0)));
+
+        if (childNode->getNodeType() == LEAF_NODE) {
+            const IntersectedLeaf leaf(static_cast<const LeafNode *>(childNode),
+                                       childKey);
+            for (int j = 0; j < 4; ++j) {
+                if (childMask & (1 << j)) {
+                    rayLeaves[j].push_back(leaf);
+                    ++voxelCounts[j];
+                }
+            }
+        } else {
+            RaySlabs childSlabs;
+            for (int axis = 0; axis < 3; ++axis) {
+                memcpy(childSlabs.min[axis], childMin[axis], sizeof(mid[0]));
+                memcpy(childSlabs.max[axis], childMax[axis], sizeof(mid[0]));
+            }
+            getIntersectedLeavesRecursive(
+                childSlabs, childMask, a,
+                static_cast<const BranchNode *>(childNode), childKey,
+                maxVoxelCount, voxelCounts, rayLeaves);
+        }
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointT, typename LeafContainerT, typename BranchContainerT>
 int pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
@@ -692,7 +1148,8 @@ int pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
         return (1);
     }
 
-    // Voxel intersection count for branches children
+    // Voxel intersection count for branches children, which are given the
+    // number of voxels left to find (0 or less: no limit)
     int voxelCount = 0;
 
     // Voxel mid lines
@@ -732,7 +1189,7 @@ int pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
             if (childNode)
                 voxelCount += getIntersectedVoxelCentersRecursive(
                     minX, minY, minZ, midX, midY, midZ, a, childNode, childKey,
-                    voxelCenterList, maxVoxelCount);
+                    voxelCenterList, maxVoxelCount - voxelCount);
             currNode = getNextIntersectedNode(midX, midY, midZ, 4, 2, 1);
             break;
 
@@ -740,7 +1197,7 @@ int pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
             if (childNode)
                 voxelCount += getIntersectedVoxelCentersRecursive(
                     minX, minY, midZ, midX, midY, maxZ, a, childNode, childKey,
-                    voxelCenterList, maxVoxelCount);
+                    voxelCenterList, maxVoxelCount - voxelCount);
             currNode = getNextIntersectedNode(midX, midY, maxZ, 5, 3, 8);
             break;
 
@@ -748,7 +1205,7 @@ int pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
             if (childNode)
                 voxelCount += getIntersectedVoxelCentersRecursive(
                     minX, midY, minZ, midX, maxY, midZ, a, childNode, childKey,
-                    voxelCenterList, maxVoxelCount);
+                    voxelCenterList, maxVoxelCount - voxelCount);
             currNode = getNextIntersectedNode(midX, maxY, midZ, 6, 8, 3);
             break;
 
@@ -756,7 +1213,7 @@ int pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
             if (childNode)
                 voxelCount += getIntersectedVoxelCentersRecursive(
                     minX, midY, midZ, midX, maxY, maxZ, a, childNode, childKey,
-                    voxelCenterList, maxVoxelCount);
+                    voxelCenterList, maxVoxelCount - voxelCount);
             currNode = getNextIntersectedNode(midX, maxY, maxZ, 7, 8, 8);
             break;
 
@@ -764,7 +1221,7 @@ int pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
             if (childNode)
                 voxelCount += getIntersectedVoxelCentersRecursive(
                     midX, minY, minZ, maxX, midY, midZ, a, childNode, childKey,
-                    voxelCenterList, maxVoxelCount);
+                    voxelCenterList, maxVoxelCount - voxelCount);
             currNode = getNextIntersectedNode(maxX, midY, midZ, 8, 6, 5);
             break;
 
@@ -772,7 +1229,7 @@ int pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
             if (childNode)
                 voxelCount += getIntersectedVoxelCentersRecursive(
                     midX, minY, midZ, maxX, midY, maxZ, a, childNode, childKey,
-                    voxelCenterList, maxVoxelCount);
+                    voxelCenterList, maxVoxelCount - voxelCount);
             currNode = getNextIntersectedNode(maxX, midY, maxZ, 8, 7, 8);
             break;
 
@@ -780,7 +1237,7 @@ int pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
             if (childNode)
                 voxelCount += getIntersectedVoxelCentersRecursive(
                     midX, midY, minZ, maxX, maxY, midZ, a, childNode, childKey,
-                    voxelCenterList, maxVoxelCount);
+                    voxelCenterList, maxVoxelCount - voxelCount);
             currNode = getNextIntersectedNode(maxX, maxY, midZ, 8, 8, 7);
             break;
 
@@ -788,7 +1245,7 @@ int pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
             if (childNode)
                 voxelCount += getIntersectedVoxelCentersRecursive(
                     midX, midY, midZ, maxX, maxY, maxZ, a, childNode, childKey,
-                    voxelCenterList, maxVoxelCount);
+                    voxelCenterList, maxVoxelCount - voxelCount);
             currNode = 8;
             break;
         }
@@ -820,7 +1277,8 @@ int pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
         return (1);
     }
 
-    // Voxel intersection count for branches children
+    // Voxel intersection count for branches children, which are given the
+    // number of voxels left to find (0 or less: no limit)
     int voxelCount = 0;
 
     // Voxel mid lines
@@ -857,7 +1315,7 @@ int pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
             if (childNode)
                 voxelCount += getIntersectedVoxelIndicesRecursive(
                     minX, minY, minZ, midX, midY, midZ, a, childNode, childKey,
-                    k_indices, maxVoxelCount);
+                    k_indices, maxVoxelCount - voxelCount);
             currNode = getNextIntersectedNode(midX, midY, midZ, 4, 2, 1);
             break;
 
@@ -865,7 +1323,7 @@ int pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
             if (childNode)
                 voxelCount += getIntersectedVoxelIndicesRecursive(
                     minX, minY, midZ, midX, midY, maxZ, a, childNode, childKey,
-                    k_indices, maxVoxelCount);
+                    k_indices, maxVoxelCount - voxelCount);
             currNode = getNextIntersectedNode(midX, midY, maxZ, 5, 3, 8);
             break;
 
@@ -873,7 +1331,7 @@ int pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
             if (childNode)
                 voxelCount += getIntersectedVoxelIndicesRecursive(
                     minX, midY, minZ, midX, maxY, midZ, a, childNode, childKey,
-                    k_indices, maxVoxelCount);
+                    k_indices, maxVoxelCount - voxelCount);
             currNode = getNextIntersectedNode(midX, maxY, midZ, 6, 8, 3);
             break;
 
@@ -881,7 +1339,7 @@ int pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
             if (childNode)
                 voxelCount += getIntersectedVoxelIndicesRecursive(
                     minX, midY, midZ, midX, maxY, maxZ, a, childNode, childKey,
-                    k_indices, maxVoxelCount);
+                    k_indices, maxVoxelCount - voxelCount);
             currNode = getNextIntersectedNode(midX, maxY, maxZ, 7, 8, 8);
             break;
 
@@ -889,7 +1347,7 @@ int pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
             if (childNode)
                 voxelCount += getIntersectedVoxelIndicesRecursive(
                     midX, minY, minZ, maxX, midY, midZ, a, childNode, childKey,
-                    k_indices, maxVoxelCount);
+                    k_indices, maxVoxelCount - voxelCount);
             currNode = getNextIntersectedNode(maxX, midY, midZ, 8, 6, 5);
             break;
 
@@ -897,7 +1355,7 @@ int pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
             if (childNode)
                 voxelCount += getIntersectedVoxelIndicesRecursive(
                     midX, minY, midZ, maxX, midY, maxZ, a, childNode, childKey,
-                    k_indices, maxVoxelCount);
+                    k_indices, maxVoxelCount - voxelCount);
             currNode = getNextIntersectedNode(maxX, midY, maxZ, 8, 7, 8);
             break;
 
@@ -905,7 +1363,7 @@ int pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
             if (childNode)
                 voxelCount += getIntersectedVoxelIndicesRecursive(
                     midX, midY, minZ, maxX, maxY, midZ, a, childNode, childKey,
-                    k_indices, maxVoxelCount);
+                    k_indices, maxVoxelCount - voxelCount);
             currNode = getNextIntersectedNode(maxX, maxY, midZ, 8, 8, 7);
             break;
 
@@ -913,7 +1371,7 @@ int pcl::octree::OctreePointCloudSearch<PointT, LeafContainerT,
             if (childNode)
                 voxelCount += getIntersectedVoxelIndicesRecursive(
                     midX, midY, midZ, maxX, maxY, maxZ, a, childNode, childKey,
-                    k_indices, maxVoxelCount);
+                    k_indices, maxVoxelCount - voxelCount);
             currNode = 8;
             break;
         }
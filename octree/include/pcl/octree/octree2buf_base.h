@@ -134,6 +134,13 @@ class BufferedBranchNode : public OctreeNode, ContainerT {
         ContainerT::reset();
     }
 
+    /** \brief Copy the container of another branch, but not its children.
+     *  \param source: branch to copy the container from
+     * */
+    inline void copyContainer(const BufferedBranchNode &source) {
+        ContainerT::operator=(source);
+    }
+
   protected:
     OctreeNode *childNodeArray_[2][8];
 };
@@ -210,25 +217,39 @@ class Octree2BufBase {
     /** \brief Copy constructor. */
     Octree2BufBase(const Octree2BufBase &source)
         : leafCount_(source.leafCount_), branchCount_(source.branchCount_),
-          objectCount_(source.objectCount_),
-          rootNode_(new (BranchNode)(*(source.rootNode_))),
+          objectCount_(source.objectCount_), rootNode_(0),
           depthMask_(source.depthMask_), maxKey_(source.maxKey_),
           branchNodePool_(), leafNodePool_(),
           bufferSelector_(source.bufferSelector_),
           treeDirtyFlag_(source.treeDirtyFlag_),
-          octreeDepth_(source.octreeDepth_) {}
+          octreeDepth_(source.octreeDepth_), leafParentCache_(0),
+          leafParentKey_(), leafSizes_(), prevLeafSizes_(),
+          leafSizesValid_(false), prevLeafSizesValid_(false) {
+        setSlabAllocation(true);
+        rootNode_ = branchNodePool_.popNode();
+        copyBranchRecursive(*(source.rootNode_), *rootNode_);
+        setSlabAllocation(false);
+    }
 
     /** \brief Copy constructor. */
     inline Octree2BufBase &operator=(const Octree2BufBase &source) {
+        if (this == &source)
+            return (*this);
+        poolCleanUp();
         leafCount_ = source.leafCount_;
         branchCount_ = source.branchCount_;
         objectCount_ = source.objectCount_;
-        rootNode_ = new (BranchNode)(*(source.rootNode_));
+        setSlabAllocation(true);
+        rootNode_ = branchNodePool_.popNode();
+        copyBranchRecursive(*(source.rootNode_), *rootNode_);
+        setSlabAllocation(false);
         depthMask_ = source.depthMask_;
         maxKey_ = source.maxKey_;
         bufferSelector_ = source.bufferSelector_;
         treeDirtyFlag_ = source.treeDirtyFlag_;
         octreeDepth_ = source.octreeDepth_;
+        leafParentCache_ = 0;
+        leafSizesValid_ = prevLeafSizesValid_ = false;
         return (*this);
     }
 
@@ -247,6 +268,11 @@ class Octree2BufBase {
      * */
     inline unsigned int getTreeDepth() const { return this->octreeDepth_; }
 
+    /** \brief Check whether the dynamic octree structure is enabled.
+     *  \return "false": double buffered octrees always have a fixed depth
+     * */
+    inline bool dynamicDepthEnabled() const { return (false); }
+
     /** \brief Add a const DataT element to leaf node at (idxX, idxY, idxZ). If
      * leaf node does not exist, it is added to the octree. \param idxX_arg:
      * index of leaf node in the X axis. \param idxY_arg: index of leaf node in
@@ -313,6 +339,8 @@ class Octree2BufBase {
         bufferSelector_ = !bufferSelector_;
         treeCleanUpRecursive(rootNode_);
         leafCount_ = 0;
+        leafParentCache_ = 0;
+        leafSizesValid_ = prevLeafSizesValid_ = false;
     }
 
     /** \brief Switch buffers and reset current octree structure. */
@@ -379,6 +407,52 @@ class Octree2BufBase {
                          std::vector<DataT> &dataVector_arg,
                          bool doXORDecoding_arg = false);
 
+    /** \brief Compare the current octree buffer with the previous one in a
+     * single traversal, and serialize the differences.
+     *
+     * Leaf nodes of the current buffer only are new, leaf nodes of the
+     * previous buffer only are removed. Leaf nodes of both buffers are
+     * changed when their number of DataT objects differs by at least
+     * minSizeChange_arg. Leaf sizes are recorded by every call, so changed
+     * leaf nodes are only found if the previous buffer was serialized with
+     * serializeChanges () and not modified afterwards.
+     *
+     * The binary description holds the new and removed leaf nodes. It only
+     * covers the branches leading to them: every branch node holds an XOR
+     * occupancy byte, followed, if it has child branches in both buffers, by
+     * a byte flagging those whose sub-tree changed. Unchanged sub-trees cost
+     * nothing. Like serializeTree (), this cleans up the unused nodes of the
+     * previous buffer.
+     * \param binaryDiffOut_arg: reference to output vector for writing the
+     * description of the new and removed leaf nodes
+     * \param newDataVector_arg: receives the DataT objects of the new leaf
+     * nodes
+     * \param changedDataVector_arg: receives the DataT objects of the changed
+     * leaf nodes
+     * \param removedLeafKeys_arg: receives the keys of the removed leaf nodes
+     * \param minSizeChange_arg: minimum change of the number of DataT objects
+     * of a leaf node for it to be changed (at least 1)
+     * */
+    void serializeChanges(std::vector<char> &binaryDiffOut_arg,
+                          std::vector<DataT> &newDataVector_arg,
+                          std::vector<DataT> &changedDataVector_arg,
+                          std::vector<OctreeKey> &removedLeafKeys_arg,
+                          std::size_t minSizeChange_arg = 1);
+
+    /** \brief Apply a description of changes written by serializeChanges ()
+     * to the previous buffer, building the current buffer. The new leaf nodes
+     * are empty, the other leaf nodes are shared with the previous buffer.
+     * \note Call switchBuffers () first, the previous buffer must hold the
+     * octree the changes were computed against.
+     * \param binaryDiffIn_arg: reference to input vector holding the
+     * description of the changes
+     * \param newLeafKeys_arg: receives the keys of the new leaf nodes
+     * \param removedLeafKeys_arg: receives the keys of the removed leaf nodes
+     * */
+    void deserializeChanges(const std::vector<char> &binaryDiffIn_arg,
+                            std::vector<OctreeKey> &newLeafKeys_arg,
+                            std::vector<OctreeKey> &removedLeafKeys_arg);
+
   protected:
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     // Protected octree methods based on octree keys
@@ -415,7 +489,7 @@ class Octree2BufBase {
     virtual void addData(const OctreeKey &key_arg, const DataT &data_arg) {
         // request a (new) leaf from tree
         LeafNode *newLeaf;
-        createLeafRecursive(key_arg, depthMask_, rootNode_, false, newLeaf);
+        createLeafFromParentCache(key_arg, newLeaf);
 
         // assign data to leaf
         if (newLeaf) {
@@ -443,7 +517,7 @@ class Octree2BufBase {
     inline LeafNode *createLeaf(const OctreeKey &key_arg) {
         LeafNode *result;
 
-        createLeafRecursive(key_arg, depthMask_, rootNode_, false, result);
+        createLeafFromParentCache(key_arg, result);
 
         // getLeafRecursive has changed the octree -> clean-up/tree-reset might
         // be required
@@ -452,6 +526,29 @@ class Octree2BufBase {
         return result;
     }
 
+    /** \brief Create or find the leaf node at octree key. Keys added in
+     * depth first order mostly share the parent branch of the previous leaf
+     * node, the descent then starts from there instead of from the root.
+     *  \param key_arg: octree key addressing a leaf node.
+     *  \param leaf_arg: pointer to an existing or created leaf node.
+     * */
+    inline void createLeafFromParentCache(const OctreeKey &key_arg,
+                                          LeafNode *&leaf_arg) {
+        if (leafParentCache_ && ((key_arg.x ^ leafParentKey_.x) <= 1) &&
+            ((key_arg.y ^ leafParentKey_.y) <= 1) &&
+            ((key_arg.z ^ leafParentKey_.z) <= 1)) {
+            createLeafRecursive(key_arg, 1, leafParentCache_, false, leaf_arg);
+        } else {
+            // createLeafRecursive caches the parent of the leaf node
+            createLeafRecursive(key_arg, depthMask_, rootNode_, false,
+                                leaf_arg);
+            leafParentKey_ = key_arg;
+        }
+
+        // the leaf sizes recorded by serializeChanges are outdated
+        leafSizesValid_ = false;
+    }
+
     /** \brief Check for leaf not existance in the octree
      *  \param key_arg: octree key addressing a leaf node.
      *  \return "true" if leaf node is found; "false" otherwise
@@ -472,6 +569,10 @@ class Octree2BufBase {
 
             // we changed the octree structure -> dirty
             treeDirtyFlag_ = true;
+
+            // the cached parent branch may have been deleted
+            leafParentCache_ = 0;
+            leafSizesValid_ = false;
         }
     }
 
@@ -730,6 +831,15 @@ class Octree2BufBase {
         leafNodePool_.deletePool();
     }
 
+    /** \brief Set whether the new nodes are constructed in memory blocks
+     * (for nodes created in depth first order) or allocated one by one.
+     *  \param enable_arg: true to construct the nodes in blocks
+     * */
+    inline void setSlabAllocation(bool enable_arg) {
+        branchNodePool_.setSlabAllocation(enable_arg);
+        leafNodePool_.setSlabAllocation(enable_arg);
+    }
+
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     // Recursive octree methods
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -804,6 +914,62 @@ class Octree2BufBase {
         typename std::vector<DataT>::const_iterator *dataVectorEndIterator_arg,
         bool branchReset_arg = false, bool doXORDecoding_arg = false);
 
+    /** \brief Recursively compare the current and previous buffers below a
+     *branch, write the description of their differences and remove the unused
+     *nodes of the previous buffer. \param branch_arg: current branch node
+     *\param depthMask_arg: depth mask of the children of the branch \param
+     *key_arg: reference to an octree key \param newBranch_arg: the branch only
+     *exists in the current buffer \param binaryDiffOut_arg: binary output
+     *vector \param newDataVector_arg: receives the DataT objects of new leaf
+     *nodes \param changedDataVector_arg: receives the DataT objects of changed
+     *leaf nodes \param removedLeafKeys_arg: receives the keys of removed leaf
+     *nodes \param minSizeChange_arg: minimum size change of a changed leaf
+     *node \param prevLeafIdx_arg: index of the recorded size of the next leaf
+     *node of the previous buffer \return "true" if the structure of the
+     *sub-tree differs between both buffers
+     **/
+    bool serializeChangesRecursive(
+        BranchNode *branch_arg, unsigned int depthMask_arg, OctreeKey &key_arg,
+        bool newBranch_arg, std::vector<char> &binaryDiffOut_arg,
+        std::vector<DataT> &newDataVector_arg,
+        std::vector<DataT> &changedDataVector_arg,
+        std::vector<OctreeKey> &removedLeafKeys_arg,
+        std::size_t minSizeChange_arg, std::size_t &prevLeafIdx_arg);
+
+    /** \brief Rebuild the current buffer below a branch from the description
+     *of the changes written by serializeChangesRecursive. \param branch_arg:
+     *current branch node \param depthMask_arg: depth mask of the children of
+     *the branch \param key_arg: reference to an octree key \param
+     *newBranch_arg: the branch only exists in the current buffer \param
+     *binaryDiffIT_arg: iterator to input vector \param binaryDiffIT_End_arg:
+     *end of the input vector \param newLeafKeys_arg: receives the keys of new
+     *leaf nodes \param removedLeafKeys_arg: receives the keys of removed leaf
+     *nodes
+     **/
+    void deserializeChangesRecursive(
+        BranchNode *branch_arg, unsigned int depthMask_arg, OctreeKey &key_arg,
+        bool newBranch_arg,
+        std::vector<char>::const_iterator &binaryDiffIT_arg,
+        const std::vector<char>::const_iterator &binaryDiffIT_End_arg,
+        std::vector<OctreeKey> &newLeafKeys_arg,
+        std::vector<OctreeKey> &removedLeafKeys_arg);
+
+    /** \brief Recursively collect the keys of the leaf nodes of the previous
+     *buffer below a branch. \param branch_arg: current branch node \param
+     *depthMask_arg: depth mask of the children of the branch \param key_arg:
+     *reference to an octree key \param leafKeys_arg: receives the keys of the
+     *leaf nodes \return the number of leaf nodes
+     **/
+    std::size_t getPreviousLeafKeysRecursive(
+        const BranchNode *branch_arg, unsigned int depthMask_arg,
+        OctreeKey &key_arg, std::vector<OctreeKey> &leafKeys_arg) const;
+
+    /** \brief Recursively make the current buffer below a branch point to the
+     *same children as the previous buffer. \param branch_arg: current branch
+     *node
+     **/
+    void linkPreviousBranchRecursive(BranchNode *branch_arg);
+
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     // Serialization callbacks
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -825,6 +991,14 @@ class Octree2BufBase {
      **/
     void treeCleanUpRecursive(BranchNode *branch_arg);
 
+    /** \brief Recursively copy a branch and its children in both buffers into
+     *new nodes of the node pools. Children shared by both buffers stay
+     *shared. \param source_arg: branch to copy \param target_arg: empty
+     *branch receiving the copy
+     **/
+    void copyBranchRecursive(const BranchNode &source_arg,
+                             BranchNode &target_arg);
+
     /** \brief Helper function to calculate the binary logarithm
      * \param n_arg: some value
      * \return binary logarithm (log2) of argument n_arg
@@ -888,6 +1062,20 @@ class Octree2BufBase {
 
     /** \brief Octree depth */
     unsigned int octreeDepth_;
+
+    /** \brief Parent branch of the last leaf node created from the root, in
+     * the current buffer (0 if unknown), and the key of that leaf node */
+    BranchNode *leafParentCache_;
+    OctreeKey leafParentKey_;
+
+    /** \brief Sizes of the leaf nodes of the current and previous buffers in
+     * depth first order, as recorded by serializeChanges () */
+    std::vector<std::size_t> leafSizes_;
+    std::vector<std::size_t> prevLeafSizes_;
+
+    /** \brief Whether the recorded leaf sizes match their buffer */
+    bool leafSizesValid_;
+    bool prevLeafSizesValid_;
 };
 } // namespace octree
 } // namespace pcl
@@ -46,6 +46,7 @@
 #include "octree_container.h"
 #include "octree_key.h"
 #include "octree_iterator.h"
+#include "octree_leaf_index.h"
 #include "octree_node_pool.h"
 
 namespace pcl {
@@ -122,20 +123,36 @@ class OctreeBase {
     /** \brief Copy constructor. */
     OctreeBase(const OctreeBase &source)
         : leafCount_(source.leafCount_), branchCount_(source.branchCount_),
-          objectCount_(source.objectCount_),
-          rootNode_(new (BranchNode)(*(source.rootNode_))),
+          objectCount_(source.objectCount_), rootNode_(0),
+          maxObjsPerLeaf_(source.maxObjsPerLeaf_),
           depthMask_(source.depthMask_), octreeDepth_(source.octreeDepth_),
-          maxKey_(source.maxKey_), branchNodePool_(), leafNodePool_() {}
+          maxKey_(source.maxKey_), branchNodePool_(), leafNodePool_(),
+          leafIndexEnabled_(source.leafIndexEnabled_), leafIndex_() {
+        setSlabAllocation(true);
+        rootNode_ = branchNodePool_.popNode();
+        copyBranchRecursive(*(source.rootNode_), *rootNode_);
+        setSlabAllocation(false);
+        rebuildLeafIndex();
+    }
 
     /** \brief Copy operator. */
     inline OctreeBase &operator=(const OctreeBase &source) {
+        if (this == &source)
+            return (*this);
+        poolCleanUp();
         leafCount_ = source.leafCount_;
         branchCount_ = source.branchCount_;
         objectCount_ = source.objectCount_;
-        rootNode_ = new (BranchNode)(*(source.rootNode_));
+        setSlabAllocation(true);
+        rootNode_ = branchNodePool_.popNode();
+        copyBranchRecursive(*(source.rootNode_), *rootNode_);
+        setSlabAllocation(false);
+        maxObjsPerLeaf_ = source.maxObjsPerLeaf_;
         depthMask_ = source.depthMask_;
         maxKey_ = source.maxKey_;
         octreeDepth_ = source.octreeDepth_;
+        leafIndexEnabled_ = source.leafIndexEnabled_;
+        rebuildLeafIndex();
         return (*this);
     }
 
@@ -165,6 +182,39 @@ class OctreeBase {
         maxObjsPerLeaf_ = maxObjsPerLeaf;
     }
 
+    /** \brief Check whether the dynamic octree structure is enabled.
+     *  \return "true" if leaf nodes are expanded on demand only
+     * */
+    inline bool dynamicDepthEnabled() const { return (maxObjsPerLeaf_ > 0); }
+
+    /** \brief Enable the leaf index: a hash table of the leaf nodes keyed by
+     * Morton code, through which findLeaf (), existLeaf () and removeLeaf ()
+     * locate leaf nodes in constant time instead of descending from the root.
+     * \note The index is only used by fixed depth octrees of at most
+     * OctreeKey::maxMortonDepth levels. It takes about 32 bytes per leaf node
+     * and is rebuilt whenever the depth of the octree changes.
+     * \param enable_arg: "true" to build the index, "false" to release it
+     * */
+    void enableLeafIndex(bool enable_arg = true);
+
+    /** \brief Check whether the leaf index is enabled.
+     *  \return "true" if leaf nodes are looked up in the leaf index
+     * */
+    inline bool leafIndexEnabled() const { return (leafIndexEnabled_); }
+
+    /** \brief Find the leaf nodes of the voxels within a cube centered on a
+     * voxel, by key arithmetic. Every voxel of the cube is looked up, which
+     * is a constant time operation with the leaf index enabled.
+     *  \param key_arg: octree key addressing the voxel at the center
+     *  \param radius_arg: half side length of the cube in voxels (1 for the
+     * voxel and its 26 neighbors)
+     *  \param leaves_arg: the leaf nodes found are written to this vector
+     *  \return number of leaf nodes found
+     * */
+    std::size_t findNeighborLeaves(const OctreeKey &key_arg,
+                                   unsigned int radius_arg,
+                                   std::vector<LeafNode *> &leaves_arg) const;
+
     /** \brief Add a const DataT element to leaf node at (idxX, idxY, idxZ). If
      * leaf node does not exist, it is created and added to the octree. \param
      * idxX_arg: index of leaf node in the X axis. \param idxY_arg: index of
@@ -219,6 +269,22 @@ class OctreeBase {
      * */
     void deleteTree(bool freeMemory_arg = true);
 
+    /** \brief Move the nodes of the octree to new memory blocks, in depth
+     * first order, the children of a branch being next to each other. This
+     * speeds up the searches through an octree built by random insertions.
+     * \note Pointers to octree nodes, and thus iterators, are invalidated.
+     * */
+    void sortNodesDepthFirst();
+
+    /** \brief Get the number of octree nodes allocated, including the unused
+     * nodes kept in the node pools.
+     *  \return amount of allocated branch and leaf nodes
+     * */
+    inline std::size_t getNumberOfAllocatedNodes() const {
+        return (branchNodePool_.getNumberOfNodes() +
+                leafNodePool_.getNumberOfNodes());
+    }
+
     /** \brief Serialize octree into a binary output vector describing its
      * branch node structure. \param binaryTreeOut_arg: reference to output
      * vector for writing binary tree structure.
@@ -304,6 +370,9 @@ class OctreeBase {
      * returns 0.
      * */
     inline LeafNode *findLeaf(const OctreeKey &key_arg) const {
+        if (leafIndexActive())
+            return ((key_arg <= maxKey_) ? leafIndex_.find(key_arg) : 0);
+
         LeafNode *result = 0;
         findLeafRecursive(key_arg, depthMask_, rootNode_, result);
         return result;
@@ -314,6 +383,9 @@ class OctreeBase {
      *  \return "true" if leaf node is found; "false" otherwise
      * */
     inline bool existLeaf(const OctreeKey &key_arg) const {
+        if (leafIndexActive())
+            return ((key_arg <= maxKey_) && leafIndex_.find(key_arg));
+
         LeafNode *leafNode = 0;
         if (key_arg <= maxKey_)
             findLeafRecursive(key_arg, depthMask_, rootNode_, leafNode);
@@ -324,6 +396,8 @@ class OctreeBase {
      *  \param key_arg: octree key addressing a leaf node.
      * */
     inline void removeLeaf(const OctreeKey &key_arg) {
+        if (leafIndexActive() && !existLeaf(key_arg))
+            return;
         if (key_arg <= maxKey_)
             deleteLeafRecursive(key_arg, depthMask_, rootNode_);
     }
@@ -521,6 +595,15 @@ class OctreeBase {
         leafNodePool_.deletePool();
     }
 
+    /** \brief Set whether the new nodes are constructed in memory blocks
+     * (for nodes created in depth first order) or allocated one by one.
+     *  \param enable_arg: true to construct the nodes in blocks
+     * */
+    inline void setSlabAllocation(bool enable_arg) {
+        branchNodePool_.setSlabAllocation(enable_arg);
+        leafNodePool_.setSlabAllocation(enable_arg);
+    }
+
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     // Recursive octree methods
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -567,6 +650,15 @@ class OctreeBase {
                            std::vector<char> *binaryTreeOut_arg,
                            typename std::vector<DataT> *dataVector_arg) const;
 
+    /** \brief Recursively copy a branch and its children into new nodes of
+     *the node pools. The children of a branch are allocated together, before
+     *the sub-trees below them, so that the copy is laid out depth first.
+     *\param source_arg: branch to copy \param target_arg: empty branch
+     *receiving the copy
+     **/
+    void copyBranchRecursive(const BranchNode &source_arg,
+                             BranchNode &target_arg);
+
     /** \brief Rebuild an octree based on binary XOR octree description and
      *DataT objects for leaf node initialization. \param binaryTreeIn_arg:
      *iterator to input vector \param branch_arg: current branch node \param
@@ -584,6 +676,26 @@ class OctreeBase {
         typename std::vector<DataT>::const_iterator *dataVectorIterator_arg,
         typename std::vector<DataT>::const_iterator *dataVectorEndIterator_arg);
 
+    /** \brief Recursively add the leaf nodes below a branch to the leaf index.
+     *\param branch_arg: current branch node \param key_arg: reference to the
+     *octree key of the branch
+     **/
+    void rebuildLeafIndexRecursive(const BranchNode *branch_arg,
+                                   OctreeKey &key_arg);
+
+    /** \brief Rebuild the leaf index from the octree structure, or release
+     *it if it is disabled or cannot address the octree.
+     **/
+    void rebuildLeafIndex();
+
+    /** \brief Test if leaf nodes are looked up in the leaf index.
+     *\return "true" if the index is enabled and addresses the octree
+     **/
+    inline bool leafIndexActive() const {
+        return (leafIndexEnabled_ && !maxObjsPerLeaf_ &&
+                (octreeDepth_ <= OctreeKey::maxMortonDepth));
+    }
+
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     // Serialization callbacks
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -647,6 +759,12 @@ class OctreeBase {
 
     /** \brief Pool of unused branch nodes   **/
     OctreeNodePool<LeafNode> leafNodePool_;
+
+    /** \brief Enable the leaf index **/
+    bool leafIndexEnabled_;
+
+    /** \brief Leaf nodes keyed by Morton code **/
+    OctreeLeafIndex<LeafNode> leafIndex_;
 };
 } // namespace octree
 } // namespace pcl
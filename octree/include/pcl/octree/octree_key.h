@@ -112,14 +112,62 @@ class OctreeKey {
                                           (!!(this->z & depthMask)));
     }
 
+    /** \brief Get the Morton code of the key: the bits of the x, y and z
+     * indices interleaved, x taking the most significant bit of each triplet.
+     * Each triplet is thus the child node index at its depth, and sorting keys
+     * by Morton code sorts their leaf nodes in depth first order.
+     * \note Only the maxMortonDepth lowest bits of each index are encoded.
+     * \return the Morton code of the key
+     */
+    inline uint64_t getMortonCode() const {
+        return ((spreadBits(this->x) << 2) | (spreadBits(this->y) << 1) |
+                spreadBits(this->z));
+    }
+
+    /** \brief Set the key from a Morton code (see getMortonCode).
+     *  \param[in] code the Morton code of the key
+     * */
+    inline void setMortonCode(uint64_t code) {
+        this->x = compactBits(code >> 2);
+        this->y = compactBits(code >> 1);
+        this->z = compactBits(code);
+    }
+
     /* \brief maximum depth that can be addressed */
     static const unsigned char maxDepth =
         static_cast<const unsigned char>(sizeof(uint32_t) * 8);
 
+    /* \brief maximum depth that can be encoded in a Morton code */
+    static const unsigned char maxMortonDepth = 21;
+
     // Indices addressing a voxel at (X, Y, Z)
     uint32_t x;
     uint32_t y;
     uint32_t z;
+
+  private:
+    /** \brief Insert two zero bits in front of each of the 21 lowest bits of
+     * an index. */
+    static inline uint64_t spreadBits(uint32_t index) {
+        uint64_t v = index & 0x1fffff;
+        v = (v | (v << 32)) & 0x1f00000000ffffULL;
+        v = (v | (v << 16)) & 0x1f0000ff0000ffULL;
+        v = (v | (v << 8)) & 0x100f00f00f00f00fULL;
+        v = (v | (v << 4)) & 0x10c30c30c30c30c3ULL;
+        v = (v | (v << 2)) & 0x1249249249249249ULL;
+        return (v);
+    }
+
+    /** \brief Inverse of spreadBits: gather every third bit of a code. */
+    static inline uint32_t compactBits(uint64_t code) {
+        uint64_t v = code & 0x1249249249249249ULL;
+        v = (v ^ (v >> 2)) & 0x10c30c30c30c30c3ULL;
+        v = (v ^ (v >> 4)) & 0x100f00f00f00f00fULL;
+        v = (v ^ (v >> 8)) & 0x1f0000ff0000ffULL;
+        v = (v ^ (v >> 16)) & 0x1f00000000ffffULL;
+        v = (v ^ (v >> 32)) & 0x1fffffULL;
+        return (static_cast<uint32_t>(v));
+    }
 };
 } // namespace octree
 } // namespace pcl
@@ -0,0 +1,208 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Point Cloud Library (PCL) - www.pointclouds.org
+ *  Copyright (c) 2010-2011, Willow Garage, Inc.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef PCL_OCTREE_LEAF_INDEX_H
+#define PCL_OCTREE_LEAF_INDEX_H
+
+#include <cstddef>
+#include <vector>
+
+#include "octree_key.h"
+
+namespace pcl {
+namespace octree {
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/** \brief @b Octree leaf index
+ * \note Hash table mapping the keys of the leaf nodes of an octree to the
+ * leaf nodes, for constant time voxel lookups. Keys are stored as Morton
+ * codes (see OctreeKey::getMortonCode) in a single open addressing table with
+ * linear probing, kept at most half full.
+ * \note The codes of each 4x4x4 block of voxels hash to the same run of 64
+ * slots, so that neighboring voxels share cache lines.
+ * \note Keys must not address more than OctreeKey::maxMortonDepth levels.
+ */
+template <typename LeafT> class OctreeLeafIndex {
+  public:
+    /** \brief Empty constructor. */
+    OctreeLeafIndex() : entries_(), size_(0), shift_(64) {}
+
+    /** \brief Find the leaf node of a key.
+     *  \param key_arg: octree key addressing a leaf node
+     *  \return pointer to the leaf node, 0 if the key is not in the index
+     *  */
+    inline LeafT *find(const OctreeKey &key_arg) const {
+        if (!size_)
+            return (0);
+
+        const uint64_t code = key_arg.getMortonCode();
+        const std::size_t mask = entries_.size() - 1;
+        for (std::size_t i = slot(code);; i = (i + 1) & mask) {
+            const Entry &entry = entries_[i];
+            if (entry.code == code)
+                return (entry.leaf);
+            if (entry.code == emptyCode)
+                return (0);
+        }
+    }
+
+    /** \brief Add a leaf node, or replace the leaf node of a key.
+     *  \param key_arg: octree key addressing the leaf node
+     *  \param leaf_arg: pointer to the leaf node
+     *  */
+    inline void insert(const OctreeKey &key_arg, LeafT *leaf_arg) {
+        if (2 * (size_ + 1) > entries_.size())
+            rehash(std::max<std::size_t>(128, 2 * entries_.size()));
+
+        const uint64_t code = key_arg.getMortonCode();
+        const std::size_t mask = entries_.size() - 1;
+        std::size_t i = slot(code);
+        while ((entries_[i].code != emptyCode) && (entries_[i].code != code))
+            i = (i + 1) & mask;
+
+        if (entries_[i].code == emptyCode)
+            size_++;
+        entries_[i].code = code;
+        entries_[i].leaf = leaf_arg;
+    }
+
+    /** \brief Remove the leaf node of a key, if any.
+     *  \param key_arg: octree key addressing the leaf node
+     *  */
+    inline void erase(const OctreeKey &key_arg) {
+        if (!size_)
+            return;
+
+        const uint64_t code = key_arg.getMortonCode();
+        const std::size_t mask = entries_.size() - 1;
+        std::size_t i = slot(code);
+        while (entries_[i].code != code) {
+            if (entries_[i].code == emptyCode)
+                return;
+            i = (i + 1) & mask;
+        }
+
+        // shift back the following entries of the probe sequence into the
+        // hole, so that lookups never stop early
+        for (std::size_t j = (i + 1) & mask; entries_[j].code != emptyCode;
+             j = (j + 1) & mask) {
+            const std::size_t home = slot(entries_[j].code);
+            if (((j - home) & mask) >= ((j - i) & mask)) {
+                entries_[i] = entries_[j];
+                i = j;
+            }
+        }
+        entries_[i].code = emptyCode;
+        size_--;
+    }
+
+    /** \brief Remove all the entries and release the table. */
+    inline void clear() {
+        std::vector<Entry>().swap(entries_);
+        size_ = 0;
+        shift_ = 64;
+    }
+
+    /** \brief Prepare the table for a number of leaf nodes.
+     *  \param size_arg: expected number of leaf nodes
+     *  */
+    inline void reserve(std::size_t size_arg) {
+        std::size_t capacity = 128;
+        while (capacity < 2 * size_arg)
+            capacity *= 2;
+        if (capacity > entries_.size())
+            rehash(capacity);
+    }
+
+    /** \brief Get the number of leaf nodes in the index. */
+    inline std::size_t size() const { return (size_); }
+
+  private:
+    /** \brief Table entry: the Morton code of a key and its leaf node. */
+    struct Entry {
+        uint64_t code;
+        LeafT *leaf;
+    };
+
+    /** \brief Code of the unused entries, which no key can produce. */
+    static const uint64_t emptyCode = ~static_cast<uint64_t>(0);
+
+    /** \brief Home slot of a code: the 4x4x4 block of the code selects a run
+     * of 64 slots (Fibonacci hashing), the code a slot within the run. */
+    inline std::size_t slot(uint64_t code_arg) const {
+        const uint64_t hash = (code_arg >> 6) * 0x9e3779b97f4a7c15ULL;
+        return ((static_cast<std::size_t>(hash >> shift_) << 6) |
+                static_cast<std::size_t>((code_arg ^ (hash >> 32)) & 63));
+    }
+
+    /** \brief Move the entries to a new table.
+     *  \param capacity_arg: size of the new table, a power of two
+     *  */
+    void rehash(std::size_t capacity_arg) {
+        std::vector<Entry> entries(capacity_arg);
+        for (std::size_t i = 0; i < capacity_arg; i++)
+            entries[i].code = emptyCode;
+        entries.swap(entries_);
+
+        shift_ = 70;
+        for (std::size_t capacity = capacity_arg; capacity > 1; capacity /= 2)
+            shift_--;
+
+        const std::size_t mask = capacity_arg - 1;
+        for (std::size_t i = 0; i < entries.size(); i++) {
+            if (entries[i].code == emptyCode)
+                continue;
+            std::size_t j = slot(entries[i].code);
+            while (entries_[j].code != emptyCode)
+                j = (j + 1) & mask;
+            entries_[j] = entries[i];
+        }
+    }
+
+    /** \brief Hash table, its size is a power of two. */
+    std::vector<Entry> entries_;
+
+    /** \brief Number of used entries. */
+    std::size_t size_;
+
+    /** \brief Shift turning a 64 bit hash into the index of a run of slots. */
+    unsigned int shift_;
+};
+} // namespace octree
+} // namespace pcl
+
+#endif
@@ -38,6 +38,8 @@
 #ifndef PCL_OCTREE_NODE_POOL_H
 #define PCL_OCTREE_NODE_POOL_H
 
+#include <algorithm>
+#include <new>
 #include <vector>
 
 #include <pcl/pcl_macros.h>
@@ -48,12 +50,24 @@ namespace octree {
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /** \brief @b Octree node pool
  * \note Used to reduce memory allocation and class instantiation events when
- * generating octrees at high rate \author Julius Kammerl (julius@kammerl.de)
+ * generating octrees at high rate
+ * \note By default nodes are allocated one by one, so that a leaf node and
+ * the data its container allocates right after it stay next to each other,
+ * whatever the order in which the leaves are created. With slab allocation
+ * (see setSlabAllocation ()), nodes are constructed in large blocks of
+ * contiguous memory owned by the pool instead, which saves one heap
+ * allocation and its bookkeeping per node: it suits nodes created in depth
+ * first order, e.g. when copying a tree. Nodes pushed back to the pool are
+ * reused by popNode (). All the nodes are destroyed together by
+ * deletePool ().
+ * \author Julius Kammerl (julius@kammerl.de)
  */
 template <typename NodeT> class OctreeNodePool {
   public:
     /** \brief Empty constructor. */
-    OctreeNodePool() : nodePool_() {}
+    OctreeNodePool()
+        : nodePool_(), nodes_(), blocks_(), blockSizes_(), blockUsed_(0),
+          slabAllocation_(false) {}
 
     /** \brief Empty deconstructor. */
     virtual ~OctreeNodePool() { deletePool(); }
@@ -71,9 +85,17 @@ template <typename NodeT> class OctreeNodePool {
         NodeT *newLeafNode;
 
         if (!nodePool_.size()) {
-            // leaf pool is empty
-            // we need to create a new octree leaf class
-            newLeafNode = new NodeT();
+            if (slabAllocation_) {
+                // pool is empty - construct a new node in the current block
+                if (blocks_.empty() || (blockUsed_ == blockSizes_.back()))
+                    allocateBlock();
+                newLeafNode = new (blocks_.back() + blockUsed_) NodeT();
+                ++blockUsed_;
+            } else {
+                // pool is empty - allocate a new node
+                newLeafNode = new NodeT();
+                nodes_.push_back(newLeafNode);
+            }
         } else {
             // reuse leaf node from branch pool
             newLeafNode = nodePool_.back();
@@ -84,18 +106,89 @@ template <typename NodeT> class OctreeNodePool {
         return newLeafNode;
     }
 
-    /** \brief Delete all nodes in pool
+    /** \brief Destroy all nodes allocated by this pool, including the nodes
+     * not pushed back to it
      *  */
     void deletePool() {
-        // delete all branch instances from branch pool
-        while (!nodePool_.empty()) {
-            delete (nodePool_.back());
-            nodePool_.pop_back();
+        for (size_t i = 0; i < nodes_.size(); ++i)
+            delete nodes_[i];
+        nodes_.clear();
+        for (size_t b = 0; b < blocks_.size(); ++b) {
+            const size_t used =
+                (b + 1 < blocks_.size()) ? blockSizes_[b] : blockUsed_;
+            for (size_t i = 0; i < used; ++i)
+                blocks_[b][i].~NodeT();
+            ::operator delete(blocks_[b]);
         }
+        blocks_.clear();
+        blockSizes_.clear();
+        blockUsed_ = 0;
+        nodePool_.clear();
+    }
+
+    /** \brief Exchange the nodes of two pools
+     *  \param pool_arg: the other pool
+     *  */
+    void swap(OctreeNodePool &pool_arg) {
+        nodePool_.swap(pool_arg.nodePool_);
+        nodes_.swap(pool_arg.nodes_);
+        blocks_.swap(pool_arg.blocks_);
+        blockSizes_.swap(pool_arg.blockSizes_);
+        std::swap(blockUsed_, pool_arg.blockUsed_);
+        std::swap(slabAllocation_, pool_arg.slabAllocation_);
+    }
+
+    /** \brief Get the number of nodes allocated by this pool
+     *  \return the number of nodes, in use or not
+     *  */
+    size_t getNumberOfNodes() const {
+        size_t nodeCount = nodes_.size() + blockUsed_;
+        for (size_t b = 0; b + 1 < blocks_.size(); ++b)
+            nodeCount += blockSizes_[b];
+        return nodeCount;
+    }
+
+    /** \brief Set whether the new nodes are constructed in memory blocks
+     * owned by the pool, or allocated one by one (default)
+     *  \param enable_arg: true to construct the nodes in blocks
+     *  */
+    inline void setSlabAllocation(bool enable_arg) {
+        slabAllocation_ = enable_arg;
     }
 
   protected:
+    /** \brief Pools own their nodes and cannot be copied */
+    OctreeNodePool(const OctreeNodePool &);
+    OctreeNodePool &operator=(const OctreeNodePool &);
+
+    /** \brief Allocate a new block, twice as large as the previous one up to
+     * a limit, so that small octrees stay small
+     *  */
+    void allocateBlock() {
+        const size_t blockSize =
+            blockSizes_.empty() ? 64 : std::min<size_t>(2 * blockSizes_.back(),
+                                                        1 << 14);
+        blocks_.push_back(
+            static_cast<NodeT *>(::operator new(blockSize * sizeof(NodeT))));
+        blockSizes_.push_back(blockSize);
+        blockUsed_ = 0;
+    }
+
+    /** \brief Nodes pushed back to the pool, ready for reuse */
     std::vector<NodeT *> nodePool_;
+
+    /** \brief Nodes allocated one by one */
+    std::vector<NodeT *> nodes_;
+
+    /** \brief Memory blocks holding the nodes, and their capacities */
+    std::vector<NodeT *> blocks_;
+    std::vector<size_t> blockSizes_;
+
+    /** \brief Number of nodes constructed in the last block */
+    size_t blockUsed_;
+
+    /** \brief Whether new nodes are constructed in blocks */
+    bool slabAllocation_;
 };
 
 } // namespace octree
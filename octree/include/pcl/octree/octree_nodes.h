@@ -159,6 +159,13 @@ class OctreeBranchNode : public OctreeNode, ContainerT {
         ContainerT::reset();
     }
 
+    /** \brief Copy the container of another branch, but not its children.
+     *  \param source: branch to copy the container from
+     * */
+    inline void copyContainer(const OctreeBranchNode &source) {
+        ContainerT::operator=(source);
+    }
+
     /** \brief Access operator.
      *  \param childIdx_arg: index to child node
      *  \return OctreeNode pointer
@@ -197,7 +197,23 @@ class OctreePointCloud : public OctreeT {
      * */
     inline unsigned int getTreeDepth() const { return this->octreeDepth_; }
 
-    /** \brief Add points from input point cloud to octree. */
+    /** \brief Set the number of threads used by addPointsFromInputCloud ().
+     * \param[in] nrThreads_arg the number of threads to use (0 for automatic)
+     */
+    inline void setNumberOfThreads(unsigned int nrThreads_arg = 0) {
+        threads_ = nrThreads_arg;
+    }
+
+    /** \brief Get the number of threads used by addPointsFromInputCloud (). */
+    inline unsigned int getNumberOfThreads() const { return (threads_); }
+
+    /** \brief Add points from input point cloud to octree.
+     * \note The points are added in bulk: their octree keys are computed in
+     * parallel and sorted in depth first (Morton) order before being inserted,
+     * which builds the tree with a single cache coherent pass. The resulting
+     * octree is identical to the one obtained by adding the points one by one
+     * with addPointFromCloud (), leaf data order included.
+     */
     void addPointsFromInputCloud();
 
     /** \brief Add point at given index from input point cloud to octree. Index
@@ -443,6 +459,15 @@ class OctreePointCloud : public OctreeT {
                               const double pointZ_arg,
                               OctreeKey &key_arg) const;
 
+    /** \brief Generate the octree key addPointIdx gave to a point while the
+     * lower corner of the bounding box was at min_arg, offset into the current
+     * bounding box. \param[in] point_arg the point addressing a voxel
+     * \param[in] min_arg the former lower corner of the bounding box (x, y, z)
+     * \param[out] key_arg write octree key to this reference
+     */
+    void genOctreeKeyforPoint(const PointT &point_arg, const double *min_arg,
+                              OctreeKey &key_arg) const;
+
     /** \brief Virtual method for generating octree key for a given point index.
      * \note This method enables to assign indices to leaf nodes during octree
      * deserialization. \param[in] data_arg index value representing a point in
@@ -518,6 +543,9 @@ class OctreePointCloud : public OctreeT {
 
     /** \brief Flag indicating if octree has defined bounding box. */
     bool boundingBoxDefined_;
+
+    /** \brief The number of threads used to add the input cloud. */
+    unsigned int threads_;
 };
 } // namespace octree
 } // namespace pcl
@@ -69,6 +69,10 @@ class OctreePointCloudChangeDetector
 {
 
   public:
+    // Eigen aligned allocator
+    typedef std::vector<PointT, Eigen::aligned_allocator<PointT>>
+        AlignedPointTVector;
+
     /** \brief Constructor.
      *  \param resolution_arg:  octree resolution at lowest octree level
      * */
@@ -76,7 +80,8 @@ class OctreePointCloudChangeDetector
         : OctreePointCloud<
               PointT, LeafContainerT, BranchContainerT,
               Octree2BufBase<int, LeafContainerT, BranchContainerT>>(
-              resolution_arg) {}
+              resolution_arg),
+          removedLeafKeys_() {}
 
     /** \brief Empty class constructor. */
     virtual ~OctreePointCloudChangeDetector() {}
@@ -92,6 +97,49 @@ class OctreePointCloudChangeDetector
         this->serializeNewLeafs(indicesVector_arg, minPointsPerLeaf_arg);
         return (static_cast<int>(indicesVector_arg.size()));
     }
+
+    /** \brief Compare the current buffer with the previous one in a single
+     * traversal, and get the points of the new and changed voxels, the
+     * removed voxels and a compact description of the changes.
+     * \note Voxels of both buffers are changed when their number of points
+     * differs by at least minPointsChange_arg. The number of points of the
+     * voxels is recorded by every call, so changed voxels are only found if
+     * the previous buffer was also compared this way.
+     * \note The output vectors keep their memory from one call to the next.
+     * \param[out] newIndices_arg indices of the points of the voxels that
+     * did not exist in the previous buffer
+     * \param[out] changedIndices_arg indices of the points of the changed
+     * voxels
+     * \param[out] removedVoxelCenters_arg centers of the voxels that only
+     * exist in the previous buffer
+     * \param[out] binaryDiffOut_arg compact description of the changes, which
+     * deserializeChanges () applies to the previous octree of a receiver
+     * \param[in] minPointsChange_arg minimum change of the number of points
+     * of a changed voxel
+     * \return number of new and changed point indices
+     */
+    int getPointIndicesFromChangedVoxels(
+        std::vector<int> &newIndices_arg, std::vector<int> &changedIndices_arg,
+        AlignedPointTVector &removedVoxelCenters_arg,
+        std::vector<char> &binaryDiffOut_arg,
+        const int minPointsChange_arg = 1) {
+        this->serializeChanges(
+            binaryDiffOut_arg, newIndices_arg, changedIndices_arg,
+            removedLeafKeys_,
+            static_cast<std::size_t>(std::max(minPointsChange_arg, 1)));
+
+        removedVoxelCenters_arg.resize(removedLeafKeys_.size());
+        for (std::size_t i = 0; i < removedLeafKeys_.size(); ++i)
+            this->genLeafNodeCenterFromOctreeKey(removedLeafKeys_[i],
+                                                 removedVoxelCenters_arg[i]);
+
+        return (static_cast<int>(newIndices_arg.size() +
+                                 changedIndices_arg.size()));
+    }
+
+  protected:
+    /** \brief Keys of the removed voxels, kept from one call to the next. */
+    std::vector<OctreeKey> removedLeafKeys_;
 };
 } // namespace octree
 } // namespace pcl
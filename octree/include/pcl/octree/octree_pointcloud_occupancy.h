@@ -101,10 +101,10 @@ class OctreePointCloudOccupancy
         OctreeKey key;
 
         // make sure bounding box is big enough
-        adoptBoundingBoxToPoint(point_arg);
+        this->adoptBoundingBoxToPoint(point_arg);
 
         // generate key
-        genOctreeKeyforPoint(point_arg, key);
+        this->genOctreeKeyforPoint(point_arg, key);
 
         // add point to octree at key
         this->addData(key, 0);
@@ -41,6 +41,7 @@
 
 #include <pcl/point_cloud.h>
 #include <pcl/point_types.h>
+#include <pcl/neighborhoods.h>
 
 #include "octree_pointcloud.h"
 
@@ -82,6 +83,12 @@ class OctreePointCloudSearch
     typedef std::vector<PointT, Eigen::aligned_allocator<PointT>>
         AlignedPointTVector;
 
+    /** \brief Planes (a, b, c, d) bounding a convex region, the inside of a
+     * plane being where a x + b y + c z + d > 0. */
+    typedef std::vector<Eigen::Vector4f,
+                        Eigen::aligned_allocator<Eigen::Vector4f>>
+        PlaneVector;
+
     typedef OctreePointCloud<PointT, LeafContainerT, BranchContainerT> OctreeT;
     typedef typename OctreeT::LeafNode LeafNode;
     typedef typename OctreeT::BranchNode BranchNode;
@@ -111,6 +118,19 @@ class OctreePointCloudSearch
      */
     bool voxelSearch(const int index, std::vector<int> &pointIdx_data);
 
+    /** \brief Search for the points within the voxels around the voxel at
+     * given point. The voxels are enumerated by key arithmetic, see
+     * enableLeafIndex () to look them up in constant time.
+     * \param[in] point point addressing the voxel at the center
+     * \param[in] voxelRadius half side length in voxels of the cube of voxels
+     * to search (1 for the voxel and its 26 neighbors)
+     * \param[out] pointIdx_data the resultant indices of the points in these
+     * voxels
+     * \return number of occupied voxels found
+     */
+    int voxelNeighborSearch(const PointT &point, unsigned int voxelRadius,
+                            std::vector<int> &pointIdx_data) const;
+
     /** \brief Search for k-nearest neighbors at the query point.
      * \param[in] cloud the point cloud data
      * \param[in] index the index in \a cloud representing the query point
@@ -251,6 +271,44 @@ class OctreePointCloudSearch
                                    std::vector<int> &k_indices,
                                    int maxVoxelCount = 0) const;
 
+    /** \brief Get the centers of the voxels intersected by each ray of a
+     * batch. The rays are sorted by the signs of their directions and
+     * traversed four at a time (packets), so coherent rays, e.g. the pixels
+     * of a camera given in image order, share most of the traversal.
+     * \param[in] origins the ray origins
+     * \param[in] directions the ray direction vectors
+     * \param[out] voxelCenterList the centers of the voxels intersected by
+     * the i-th ray, in the order of the ray, are voxelCenterList[offsets[i]]
+     * ... voxelCenterList[offsets[i + 1] - 1]
+     * \param[out] offsets the start of the voxels of each ray, plus the total
+     * number of voxels as last element
+     * \param[in] maxVoxelCount stop raycasting when this many voxels
+     * intersected (0: disable)
+     * \param[in] nr_threads the number of threads to use (0 for automatic)
+     */
+    void getIntersectedVoxelCenters(
+        const std::vector<Eigen::Vector3f> &origins,
+        const std::vector<Eigen::Vector3f> &directions,
+        AlignedPointTVector &voxelCenterList, std::vector<size_t> &offsets,
+        int maxVoxelCount = 0, unsigned int nr_threads = 1) const;
+
+    /** \brief Get the indices of the points of the voxels intersected by each
+     * ray of a batch, see the batch getIntersectedVoxelCenters ().
+     * \param[in] origins the ray origins
+     * \param[in] directions the ray direction vectors
+     * \param[out] neighborhoods the indices of the points of the voxels
+     * intersected by the i-th ray, voxel after voxel in the order of the ray,
+     * with their squared distances to its origin
+     * \param[in] maxVoxelCount stop raycasting when this many voxels
+     * intersected (0: disable)
+     * \param[in] nr_threads the number of threads to use (0 for automatic)
+     */
+    void getIntersectedVoxelIndices(
+        const std::vector<Eigen::Vector3f> &origins,
+        const std::vector<Eigen::Vector3f> &directions,
+        Neighborhoods &neighborhoods, int maxVoxelCount = 0,
+        unsigned int nr_threads = 1) const;
+
     /** \brief Search for points within rectangular search area
      * \param[in] min_pt lower corner of search area
      * \param[in] max_pt upper corner of search area
@@ -260,6 +318,42 @@ class OctreePointCloudSearch
     int boxSearch(const Eigen::Vector3f &min_pt, const Eigen::Vector3f &max_pt,
                   std::vector<int> &k_indices) const;
 
+    /** \brief Get the centers of the occupied voxels overlapping a
+     * rectangular search area.
+     * \param[in] min_pt lower corner of search area
+     * \param[in] max_pt upper corner of search area
+     * \param[out] voxelCenterList the resultant voxel centers
+     * \return number of voxels found
+     */
+    int boxSearch(const Eigen::Vector3f &min_pt, const Eigen::Vector3f &max_pt,
+                  AlignedPointTVector &voxelCenterList) const;
+
+    /** \brief Search for points within a convex region bounded by planes,
+     * such as the view frustum of a camera.
+     *
+     * The voxels entirely inside the region are returned without testing
+     * their points, and the planes a voxel is entirely inside of are not
+     * tested again below it.
+     * \param[in] planes the planes bounding the region (at most 32), the
+     * inside of a plane (a, b, c, d) being where a x + b y + c z + d > 0
+     * \param[out] k_indices the resultant point indices
+     * \return number of points found within the region
+     */
+    int frustumSearch(const PlaneVector &planes,
+                      std::vector<int> &k_indices) const;
+
+    /** \brief Get the centers of the occupied voxels that are not entirely
+     * outside of one of the planes bounding a convex region. This is the
+     * usual conservative culling test: a few voxels close to the edges of
+     * the region may lie just outside of it.
+     * \param[in] planes the planes bounding the region (at most 32), the
+     * inside of a plane (a, b, c, d) being where a x + b y + c z + d > 0
+     * \param[out] voxelCenterList the resultant voxel centers
+     * \return number of voxels found
+     */
+    int frustumSearch(const PlaneVector &planes,
+                      AlignedPointTVector &voxelCenterList) const;
+
   protected:
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     // Octree-based search routines & helpers
@@ -408,18 +502,83 @@ class OctreePointCloudSearch
         const OctreeKey &key, AlignedPointTVector &voxelCenterList,
         int maxVoxelCount) const;
 
-    /** \brief Recursive search method that explores the octree and finds points
-     * within a rectangular search area \param[in] min_pt lower corner of search
-     * area \param[in] max_pt upper corner of search area \param[in] node
-     * current octree node to be explored \param[in] key octree key addressing a
-     * leaf node. \param[in] treeDepth current depth/level in the octree
-     * \param[out] k_indices the resultant point indices
+    /** \brief Recursive search method that explores the octree and finds the
+     * voxels within a convex region
+     * \param[in] planes the planes bounding the region
+     * \param[in] planeMask the planes the node is not known to be entirely
+     * inside of (bit i for planes[i])
+     * \param[in] node current octree node to be explored
+     * \param[in] key octree key addressing a leaf node.
+     * \param[in] treeDepth current depth/level in the octree
+     * \param[out] output the resultant point indices or voxel centers
+     */
+    template <typename OutputT>
+    void regionSearchRecursive(const PlaneVector &planes,
+                               unsigned int planeMask, const BranchNode *node,
+                               const OctreeKey &key, unsigned int treeDepth,
+                               OutputT &output) const;
+
+    /** \brief Add all the leaves below a node (or the node, if it is a leaf)
+     * to the output of regionSearchRecursive ().
+     */
+    template <typename OutputT>
+    void addLeavesRecursive(const OctreeNode *node, const OctreeKey &key,
+                            OutputT &output) const;
+
+    /** \brief Add the points of a leaf inside the planes of planeMask. */
+    void addLeaf(const LeafNode *leaf, const OctreeKey &key,
+                 const PlaneVector &planes, unsigned int planeMask,
+                 std::vector<int> &k_indices) const;
+
+    /** \brief Add the center of a leaf. */
+    inline void addLeaf(const LeafNode *, const OctreeKey &key,
+                        const PlaneVector &, unsigned int,
+                        AlignedPointTVector &voxelCenterList) const {
+        PointT center;
+        this->genLeafNodeCenterFromOctreeKey(key, center);
+        voxelCenterList.push_back(center);
+    }
+
+    /** \brief A leaf intersected by a ray, and its key. */
+    typedef std::pair<const LeafNode *, OctreeKey> IntersectedLeaf;
+
+    /** \brief The parameters along up to four rays at which they enter
+     * (min) and leave (max) the slabs of a node, one array of four rays per
+     * axis, in the space where the directions are positive (see
+     * initIntersectedVoxel ()). They are kept in double precision, as in
+     * the single ray searches, so that both take the same decisions.
+     */
+    struct RaySlabs {
+        double min[3][4];
+        double max[3][4];
+    };
+
+    /** \brief Get the leaves intersected by each ray of a batch, the ones of
+     * the i-th ray being leaves[offsets[i]] ... leaves[offsets[i + 1] - 1].
+     */
+    void getIntersectedLeaves(const std::vector<Eigen::Vector3f> &origins,
+                              const std::vector<Eigen::Vector3f> &directions,
+                              int maxVoxelCount, unsigned int nr_threads,
+                              std::vector<size_t> &offsets,
+                              std::vector<IntersectedLeaf> &leaves) const;
+
+    /** \brief Recursively search the tree for the leaves intersected by a
+     * packet of rays whose directions have the same signs.
+     * \param[in] slabs the parameters of the node along the rays
+     * \param[in] rayMask the rays intersecting the node (bit j for the j-th
+     * ray)
+     * \param[in] a the signs of the directions, as in initIntersectedVoxel ()
+     * \param[in] node current octree node to be explored
+     * \param[in] key octree key addressing a leaf node.
+     * \param[in] maxVoxelCount stop raycasting a ray when this many voxels
+     * intersected (0: disable)
+     * \param[in,out] voxelCounts the number of leaves found for each ray
+     * \param[out] rayLeaves the leaves found for each ray, in order
      */
-    void boxSearchRecursive(const Eigen::Vector3f &min_pt,
-                            const Eigen::Vector3f &max_pt,
-                            const BranchNode *node, const OctreeKey &key,
-                            unsigned int treeDepth,
-                            std::vector<int> &k_indices) const;
+    void getIntersectedLeavesRecursive(
+        const RaySlabs &slabs, int rayMask, unsigned char a,
+        const BranchNode *node, const OctreeKey &key, int maxVoxelCount,
+        int *voxelCounts, std::vector<IntersectedLeaf> *rayLeaves) const;
 
     /** \brief Recursively search the tree for all intersected leaf nodes and
      * return a vector of indices. This algorithm is based off the paper An
@@ -77,6 +77,9 @@ template <typename PointT> class BruteForce : public Search<PointT> {
     float getDistSqr(const PointT &point1, const PointT &point2) const;
 
   public:
+    using pcl::search::Search<PointT>::nearestKSearch;
+    using pcl::search::Search<PointT>::radiusSearch;
+
     BruteForce(bool sorted_results = false)
         : Search<PointT>("BruteForce", sorted_results) {}
 
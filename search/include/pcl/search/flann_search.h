@@ -83,6 +83,9 @@ class FlannSearch : public Search<PointT> {
     using Search<PointT>::sorted_results_;
 
   public:
+    using Search<PointT>::nearestKSearch;
+    using Search<PointT>::radiusSearch;
+
     typedef boost::shared_ptr<FlannSearch<PointT, FlannDistance>> Ptr;
     typedef boost::shared_ptr<const FlannSearch<PointT, FlannDistance>>
         ConstPtr;
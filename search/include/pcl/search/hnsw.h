@@ -0,0 +1,371 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Point Cloud Library (PCL) - www.pointclouds.org
+ *  Copyright (c) 2010-2011, Willow Garage, Inc.
+ *  Copyright (c) 2012-, Open Perception, Inc.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_SEARCH_HNSW_H_
+#define PCL_SEARCH_HNSW_H_
+
+#include <pcl/search/search.h>
+#include <pcl/point_representation.h>
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pcl {
+namespace search {
+/** \brief @b search::HNSW is an approximate nearest neighbor search for high
+ * dimensional points, such as local descriptors, over a Hierarchical
+ * Navigable Small World graph (Y. A. Malkov, D. A. Yashunin, "Efficient and
+ * robust approximate nearest neighbor search using Hierarchical Navigable
+ * Small World graphs", 2016).
+ *
+ * Every point is a node of the graph, linked to its closest neighbors on a
+ * hierarchy of layers, each one holding an exponentially decreasing fraction
+ * of the points. A query walks greedily down the upper layers, then explores
+ * the bottom one keeping the getEf () closest nodes found so far: the larger
+ * this beam, the higher the recall and the query time. The number of links
+ * and the beam used while building the graph trade its build time and memory
+ * for the recall reachable at a given query time.
+ *
+ * Building the graph costs much more than a kd-tree: saveIndex () writes it
+ * to a file, and loadIndex () restores it for the same cloud without
+ * rebuilding it. The single query searches are thread safe, so the batch
+ * searches of Search run them in parallel.
+ *
+ * The distances are squared Euclidean distances between the vectors of the
+ * point representation, as with FlannSearch.
+ * \ingroup search
+ */
+template <typename PointT> class HNSW : public Search<PointT> {
+  public:
+    typedef typename Search<PointT>::PointCloud PointCloud;
+    typedef typename Search<PointT>::PointCloudConstPtr PointCloudConstPtr;
+    typedef boost::shared_ptr<const std::vector<int>> IndicesConstPtr;
+
+    typedef pcl::PointRepresentation<PointT> PointRepresentation;
+    typedef boost::shared_ptr<const PointRepresentation>
+        PointRepresentationConstPtr;
+
+    using Search<PointT>::input_;
+    using Search<PointT>::indices_;
+    using Search<PointT>::sorted_results_;
+    using Search<PointT>::nearestKSearch;
+    using Search<PointT>::radiusSearch;
+
+    typedef boost::shared_ptr<HNSW<PointT>> Ptr;
+    typedef boost::shared_ptr<const HNSW<PointT>> ConstPtr;
+
+    /** \brief Constructor.
+     * \param[in] sorted set to true if the radius search results need to be
+     * sorted in ascending order based on their distance to the query point
+     * \param[in] nr_links the number of links of a node, see
+     * setNumberOfLinks ()
+     * \param[in] ef_construction the beam width used to build the graph, see
+     * setEfConstruction ()
+     */
+    HNSW(bool sorted = true, int nr_links = 16, int ef_construction = 200);
+
+    /** \brief Destructor. */
+    virtual ~HNSW() {}
+
+    /** \brief Set the number of links of a node (M): a node gets M links on
+     * its upper layers and up to 2 M on the bottom one. Typical values range
+     * from 8 for low dimensional data to 48 for high recalls on high
+     * dimensional data. Applies to the next setInputCloud ().
+     */
+    inline void setNumberOfLinks(int nr_links) {
+        nr_links_ = std::max(2, nr_links);
+    }
+
+    /** \brief Get the number of links of a node. */
+    inline int getNumberOfLinks() const { return (nr_links_); }
+
+    /** \brief Set the number of closest nodes kept while searching the
+     * neighbors of a new node during the construction. Larger values build
+     * better graphs, more slowly. Applies to the next setInputCloud ().
+     */
+    inline void setEfConstruction(int ef_construction) {
+        ef_construction_ = std::max(1, ef_construction);
+    }
+
+    /** \brief Get the beam width used to build the graph. */
+    inline int getEfConstruction() const { return (ef_construction_); }
+
+    /** \brief Set the number of closest nodes kept while searching (at least
+     * k is used): the recall / query time trade-off.
+     */
+    inline void setEf(int ef) { ef_ = std::max(1, ef); }
+
+    /** \brief Get the beam width of the searches. */
+    inline int getEf() const { return (ef_); }
+
+    /** \brief Set the seed of the random levels of the nodes, to build
+     * reproducible graphs. Applies to the next setInputCloud ().
+     */
+    inline void setSeed(unsigned int seed) { seed_ = seed; }
+
+    /** \brief Provide a pointer to the point representation to use to convert
+     * points into k-D vectors, and rebuild the graph if there is an input.
+     * \param[in] point_representation the const boost shared pointer to a
+     * PointRepresentation
+     */
+    inline void setPointRepresentation(
+        const PointRepresentationConstPtr &point_representation) {
+        point_representation_ = point_representation;
+        dim_ = point_representation_->getNumberOfDimensions();
+        if (input_)
+            setInputCloud(input_, indices_);
+    }
+
+    /** \brief Get a pointer to the point representation used when converting
+     * points into k-D vectors. */
+    inline PointRepresentationConstPtr getPointRepresentation() const {
+        return (point_representation_);
+    }
+
+    /** \brief Provide a pointer to the input dataset and build the graph over
+     * its valid points.
+     * \param[in] cloud the const boost shared pointer to a PointCloud message
+     * \param[in] indices the point indices subset that is to be used from \a
+     * cloud
+     */
+    virtual void
+    setInputCloud(const PointCloudConstPtr &cloud,
+                  const IndicesConstPtr &indices = IndicesConstPtr());
+
+    /** \brief Search for the approximate k-nearest neighbors of a point.
+     * \param[in] point the given query point
+     * \param[in] k the number of neighbors to search for
+     * \param[out] k_indices the resultant indices of the neighboring points
+     * \param[out] k_sqr_distances the resultant squared distances to the
+     * neighboring points, in ascending order
+     * \return number of neighbors found (0 for a non finite query)
+     */
+    int nearestKSearch(const PointT &point, int k, std::vector<int> &k_indices,
+                       std::vector<float> &k_sqr_distances) const;
+
+    /** \brief Search for the neighbors of a point within a radius, among the
+     * max (getEf (), max_nn) closest nodes found by the graph search.
+     * \param[in] point the given query point
+     * \param[in] radius the radius of the sphere bounding the neighbors
+     * \param[out] k_indices the resultant indices of the neighboring points
+     * \param[out] k_sqr_distances the resultant squared distances to the
+     * neighboring points
+     * \param[in] max_nn if given, bounds the maximum returned neighbors to
+     * this value
+     * \return number of neighbors found in radius
+     */
+    int radiusSearch(const PointT &point, double radius,
+                     std::vector<int> &k_indices,
+                     std::vector<float> &k_sqr_distances,
+                     unsigned int max_nn = 0) const;
+
+    /** \brief Save the graph to a binary file (in the byte order of the
+     * machine).
+     * \param[in] file_name the name of the file to write
+     * \return true on success
+     */
+    bool saveIndex(const std::string &file_name) const;
+
+    /** \brief Set the input cloud and load its graph from a file written by
+     * saveIndex (), instead of building it.
+     * \param[in] file_name the name of the file to read
+     * \param[in] cloud the cloud the graph was built from
+     * \param[in] indices the point indices subset the graph was built from
+     * \return true on success. On failure, the searches find no neighbors
+     * until the next setInputCloud () or loadIndex ().
+     */
+    bool loadIndex(const std::string &file_name,
+                   const PointCloudConstPtr &cloud,
+                   const IndicesConstPtr &indices = IndicesConstPtr());
+
+  protected:
+    /** \brief A node and its squared distance to the query. */
+    typedef std::pair<float, int> Candidate;
+
+    /** \brief Set of integers, for the nodes visited by a search: open
+     * addressing with linear probing, sized for the nodes actually visited
+     * rather than for the whole graph.
+     */
+    class VisitedSet {
+      public:
+        VisitedSet() : table_(64, -1), size_(0) {}
+
+        /** \brief Insert a node, return false if it was already there. */
+        inline bool insert(int node) {
+            size_t mask = table_.size() - 1;
+            size_t slot = (static_cast<size_t>(node) * 2654435761u) & mask;
+            while (table_[slot] != -1) {
+                if (table_[slot] == node)
+                    return (false);
+                slot = (slot + 1) & mask;
+            }
+            table_[slot] = node;
+            if (++size_ * 2 > table_.size())
+                grow();
+            return (true);
+        }
+
+        inline void clear() {
+            std::fill(table_.begin(), table_.end(), -1);
+            size_ = 0;
+        }
+
+      private:
+        void grow() {
+            std::vector<int> table(table_.size() * 2, -1);
+            table.swap(table_);
+            size_ = 0;
+            for (size_t i = 0; i < table.size(); ++i)
+                if (table[i] != -1)
+                    insert(table[i]);
+        }
+
+        std::vector<int> table_;
+        size_t size_;
+    };
+
+    /** \brief Vectorize a point, return false if it is not finite. */
+    template <typename OutputType>
+    inline bool vectorize(const PointT &point, OutputType &out) const {
+        point_representation_->vectorize(point, out);
+        for (int i = 0; i < dim_; ++i)
+            if (!pcl_isfinite(out[i]))
+                return (false);
+        return (true);
+    }
+
+    /** \brief Squared Euclidean distance between two vectors. */
+    float squaredDistance(const float *a, const float *b) const;
+
+    /** \brief Get the vector of a node. */
+    inline const float *getVector(int node) const {
+        return (&data_[static_cast<size_t>(node) * dim_]);
+    }
+
+    /** \brief Get the links of a node on a layer: their number, followed by
+     * the linked nodes. */
+    inline int *getLinks(int node, int level) {
+        if (level == 0)
+            return (&links0_[static_cast<size_t>(node) * (2 * links_ + 1)]);
+        return (&upper_links_[node][(level - 1) * (links_ + 1)]);
+    }
+
+    inline const int *getLinks(int node, int level) const {
+        return (const_cast<HNSW *>(this)->getLinks(node, level));
+    }
+
+    /** \brief Convert the valid input points to vectors, in data_, and fill
+     * index_mapping_. */
+    void convertInput();
+
+    /** \brief Build the graph over data_. */
+    void buildIndex();
+
+    /** \brief Clear the graph. */
+    void clearIndex();
+
+    /** \brief Walk greedily down the upper layers, from the entry point to
+     * the closest node of layer \a level found. */
+    Candidate searchUpperLayers(const float *query, int level) const;
+
+    /** \brief Search the ef closest nodes of a layer, starting from entry.
+     * \param[in] query the query vector
+     * \param[in] entry the node to start from
+     * \param[in] ef the number of nodes to keep
+     * \param[in] level the layer to search
+     * \param[in] visited the set of visited nodes (cleared)
+     * \param[out] results the closest nodes found, in ascending order of
+     * distance
+     */
+    void searchLayer(const float *query, const Candidate &entry, int ef,
+                     int level, VisitedSet &visited,
+                     std::vector<Candidate> &results) const;
+
+    /** \brief Keep at most \a max_links of candidates (sorted), each one
+     * closer to the node than to the ones kept before, so that the links
+     * spread in all directions. */
+    void selectNeighbors(std::vector<Candidate> &candidates,
+                         int max_links) const;
+
+    /** \brief Link two nodes on a layer, pruning the links of \a node if it
+     * has too many. */
+    void addLink(int node, int neighbor, int level);
+
+    /** \brief The point representation used to vectorize the points. */
+    PointRepresentationConstPtr point_representation_;
+
+    /** \brief The number of dimensions of the vectors. */
+    int dim_;
+
+    /** \brief Parameters of the next build, and of the searches. */
+    int nr_links_, ef_construction_, ef_;
+    unsigned int seed_;
+
+    /** \brief The vectors of the nodes, one after the other. */
+    std::vector<float> data_;
+
+    /** \brief The index in the input cloud of every node. */
+    std::vector<int> index_mapping_;
+
+    /** \brief The number of links of a node (on the upper layers) of the
+     * current graph. */
+    int links_;
+
+    /** \brief The top layer of every node. */
+    std::vector<int> levels_;
+
+    /** \brief The links of every node on the bottom layer: 2 * links_ + 1
+     * integers per node. */
+    std::vector<int> links0_;
+
+    /** \brief The links of every node on its upper layers: links_ + 1
+     * integers per layer. */
+    std::vector<std::vector<int>> upper_links_;
+
+    /** \brief The node the searches start from, and its layer. */
+    int entry_point_, max_level_;
+};
+} // namespace search
+} // namespace pcl
+
+#define PCL_INSTANTIATE_HNSW(T) template class PCL_EXPORTS pcl::search::HNSW<T>;
+
+#endif // PCL_SEARCH_HNSW_H_
@@ -0,0 +1,513 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Point Cloud Library (PCL) - www.pointclouds.org
+ *  Copyright (c) 2010-2011, Willow Garage, Inc.
+ *  Copyright (c) 2012-, Open Perception, Inc.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_SEARCH_IMPL_HNSW_H_
+#define PCL_SEARCH_IMPL_HNSW_H_
+
+#include <pcl/search/hnsw.h>
+#include <pcl/console/print.h>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <queue>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+namespace pcl {
+namespace search {
+namespace detail {
+/** \brief Identifies the files written by HNSW::saveIndex (). */
+static const char hnsw_magic[8] = {'P', 'C', 'L', '_', 'H', 'N', 'S', 'W'};
+static const int hnsw_version = 1;
+
+template <typename T>
+inline void writeArray(std::ofstream &fs, const std::vector<T> &array) {
+    if (!array.empty())
+        fs.write(reinterpret_cast<const char *>(&array[0]),
+                 array.size() * sizeof(T));
+}
+
+/** \brief Read size elements, return false if the file is too short. */
+template <typename T>
+inline bool readArray(std::ifstream &fs, std::vector<T> &array, size_t size) {
+    const std::streampos position = fs.tellg();
+    fs.seekg(0, std::ios::end);
+    const std::streamoff remaining = fs.tellg() - position;
+    fs.seekg(position);
+    if (!fs || static_cast<double>(size) * sizeof(T) > remaining)
+        return (false);
+    array.resize(size);
+    if (size)
+        fs.read(reinterpret_cast<char *>(&array[0]), size * sizeof(T));
+    return (!fs.fail());
+}
+} // namespace detail
+} // namespace search
+} // namespace pcl
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+pcl::search::HNSW<PointT>::HNSW(bool sorted, int nr_links,
+                                int ef_construction)
+    : pcl::search::Search<PointT>("HNSW", sorted),
+      point_representation_(new DefaultPointRepresentation<PointT>), dim_(0),
+      nr_links_(std::max(2, nr_links)),
+      ef_construction_(std::max(1, ef_construction)), ef_(50), seed_(0),
+      data_(), index_mapping_(), links_(0), levels_(), links0_(),
+      upper_links_(), entry_point_(-1), max_level_(-1) {
+    dim_ = point_representation_->getNumberOfDimensions();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::search::HNSW<PointT>::setInputCloud(const PointCloudConstPtr &cloud,
+                                              const IndicesConstPtr &indices) {
+    input_ = cloud;
+    indices_ = indices;
+    convertInput();
+    buildIndex();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+int pcl::search::HNSW<PointT>::nearestKSearch(
+    const PointT &point, int k, std::vector<int> &k_indices,
+    std::vector<float> &k_sqr_distances) const {
+    k_indices.clear();
+    k_sqr_distances.clear();
+    std::vector<float> query(dim_);
+    if (entry_point_ < 0 || k < 1 || !vectorize(point, query))
+        return (0);
+
+    VisitedSet visited;
+    std::vector<Candidate> results;
+    searchLayer(&query[0], searchUpperLayers(&query[0], 0), std::max(ef_, k),
+                0, visited, results);
+
+    const int nr_neighbors = std::min(k, static_cast<int>(results.size()));
+    k_indices.resize(nr_neighbors);
+    k_sqr_distances.resize(nr_neighbors);
+    for (int i = 0; i < nr_neighbors; ++i) {
+        k_indices[i] = index_mapping_[results[i].second];
+        k_sqr_distances[i] = results[i].first;
+    }
+    return (nr_neighbors);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+int pcl::search::HNSW<PointT>::radiusSearch(
+    const PointT &point, double radius, std::vector<int> &k_indices,
+    std::vector<float> &k_sqr_distances, unsigned int max_nn) const {
+    k_indices.clear();
+    k_sqr_distances.clear();
+    std::vector<float> query(dim_);
+    if (entry_point_ < 0 || !vectorize(point, query))
+        return (0);
+
+    VisitedSet visited;
+    std::vector<Candidate> results;
+    const int ef = std::max(
+        ef_, static_cast<int>(std::min(max_nn, static_cast<unsigned int>(
+                                                   index_mapping_.size()))));
+    searchLayer(&query[0], searchUpperLayers(&query[0], 0), ef, 0, visited,
+                results);
+
+    // The results are sorted: stop at the first one outside of the sphere
+    const double squared_radius = radius * radius;
+    for (size_t i = 0; i < results.size() && results[i].first <= squared_radius;
+         ++i) {
+        if (max_nn > 0 && k_indices.size() == max_nn)
+            break;
+        k_indices.push_back(index_mapping_[results[i].second]);
+        k_sqr_distances.push_back(results[i].first);
+    }
+    return (static_cast<int>(k_indices.size()));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+bool pcl::search::HNSW<PointT>::saveIndex(const std::string &file_name) const {
+    std::ofstream fs(file_name.c_str(), std::ios::binary);
+    if (!fs.is_open()) {
+        PCL_ERROR("[pcl::search::HNSW::saveIndex] Could not open %s for "
+                  "writing!\n",
+                  file_name.c_str());
+        return (false);
+    }
+
+    const int header[] = {detail::hnsw_version,
+                          dim_,
+                          static_cast<int>(index_mapping_.size()),
+                          links_,
+                          max_level_,
+                          entry_point_};
+    fs.write(detail::hnsw_magic, sizeof(detail::hnsw_magic));
+    fs.write(reinterpret_cast<const char *>(header), sizeof(header));
+    detail::writeArray(fs, index_mapping_);
+    detail::writeArray(fs, levels_);
+    detail::writeArray(fs, links0_);
+    for (size_t node = 0; node < levels_.size(); ++node)
+        detail::writeArray(fs, upper_links_[node]);
+
+    if (!fs.good()) {
+        PCL_ERROR("[pcl::search::HNSW::saveIndex] Error writing %s!\n",
+                  file_name.c_str());
+        return (false);
+    }
+    return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+bool pcl::search::HNSW<PointT>::loadIndex(const std::string &file_name,
+                                          const PointCloudConstPtr &cloud,
+                                          const IndicesConstPtr &indices) {
+    input_ = cloud;
+    indices_ = indices;
+    convertInput();
+    clearIndex();
+
+    std::ifstream fs(file_name.c_str(), std::ios::binary);
+    if (!fs.is_open()) {
+        PCL_ERROR("[pcl::search::HNSW::loadIndex] Could not open %s!\n",
+                  file_name.c_str());
+        return (false);
+    }
+
+    char magic[sizeof(detail::hnsw_magic)];
+    int header[6];
+    fs.read(magic, sizeof(magic));
+    fs.read(reinterpret_cast<char *>(header), sizeof(header));
+    if (!fs || memcmp(magic, detail::hnsw_magic, sizeof(magic)) != 0 ||
+        header[0] != detail::hnsw_version) {
+        PCL_ERROR("[pcl::search::HNSW::loadIndex] %s is not a HNSW index "
+                  "file!\n",
+                  file_name.c_str());
+        return (false);
+    }
+
+    const int nr_nodes = header[2];
+    std::vector<int> index_mapping;
+    if (header[1] != dim_ ||
+        nr_nodes != static_cast<int>(index_mapping_.size()) ||
+        !detail::readArray(fs, index_mapping, nr_nodes) ||
+        index_mapping != index_mapping_) {
+        PCL_ERROR("[pcl::search::HNSW::loadIndex] The index in %s was not "
+                  "built from the input cloud!\n",
+                  file_name.c_str());
+        return (false);
+    }
+
+    if (nr_nodes == 0)
+        return (true);
+
+    // Check the graph, a corrupted file must not make the searches crash
+    links_ = header[3];
+    max_level_ = header[4];
+    entry_point_ = header[5];
+    bool valid = links_ >= 2 && entry_point_ >= 0 && entry_point_ < nr_nodes &&
+                 detail::readArray(fs, levels_, nr_nodes) &&
+                 detail::readArray(fs, links0_,
+                                   static_cast<size_t>(nr_nodes) *
+                                       (2 * static_cast<size_t>(links_) + 1));
+    upper_links_.resize(nr_nodes);
+    for (int node = 0; valid && node < nr_nodes; ++node)
+        valid = levels_[node] >= 0 && levels_[node] <= max_level_ &&
+                detail::readArray(fs, upper_links_[node],
+                                  static_cast<size_t>(levels_[node]) *
+                                      (static_cast<size_t>(links_) + 1));
+    valid = valid && levels_[entry_point_] == max_level_;
+    for (int node = 0; valid && node < nr_nodes; ++node) {
+        for (int level = 0; valid && level <= levels_[node]; ++level) {
+            const int *links = getLinks(node, level);
+            valid = links[0] >= 0 && links[0] <= (level ? 1 : 2) * links_;
+            for (int i = 1; valid && i <= links[0]; ++i)
+                valid = links[i] >= 0 && links[i] < nr_nodes &&
+                        levels_[links[i]] >= level;
+        }
+    }
+    if (!valid) {
+        PCL_ERROR("[pcl::search::HNSW::loadIndex] %s is corrupted!\n",
+                  file_name.c_str());
+        clearIndex();
+        return (false);
+    }
+    return (true);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+float pcl::search::HNSW<PointT>::squaredDistance(const float *a,
+                                                 const float *b) const {
+    int i = 0;
+    float distance = 0.0f;
+#ifdef __SSE__
+    // Two independent sums, to hide the latency of the additions
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    for (; i + 8 <= dim_; i += 8) {
+        const __m128 d0 = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+        const __m128 d1 =
+            _mm_sub_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4));
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(d0, d0));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(d1, d1));
+    }
+    if (i + 4 <= dim_) {
+        const __m128 d0 = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(d0, d0));
+        i += 4;
+    }
+    float sums[4];
+    _mm_storeu_ps(sums, _mm_add_ps(sum0, sum1));
+    distance = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+#endif
+    for (; i < dim_; ++i) {
+        const float d = a[i] - b[i];
+        distance += d * d;
+    }
+    return (distance);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> void pcl::search::HNSW<PointT>::convertInput() {
+    data_.clear();
+    index_mapping_.clear();
+    if (!input_)
+        return;
+
+    const bool use_indices = indices_ && !indices_->empty();
+    const size_t nr_points = use_indices ? indices_->size() : input_->size();
+    data_.resize(nr_points * dim_);
+    index_mapping_.reserve(nr_points);
+
+    // Vectorize every point at the end of data_, keep it if valid
+    for (size_t i = 0; i < nr_points; ++i) {
+        const int index = use_indices ? (*indices_)[i] : static_cast<int>(i);
+        float *vector = &data_[index_mapping_.size() * dim_];
+        if (vectorize(input_->points[index], vector))
+            index_mapping_.push_back(index);
+    }
+    data_.resize(index_mapping_.size() * dim_);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> void pcl::search::HNSW<PointT>::clearIndex() {
+    links_ = 0;
+    levels_.clear();
+    links0_.clear();
+    upper_links_.clear();
+    entry_point_ = max_level_ = -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT> void pcl::search::HNSW<PointT>::buildIndex() {
+    clearIndex();
+    const int nr_nodes = static_cast<int>(index_mapping_.size());
+    if (nr_nodes == 0)
+        return;
+
+    // Layer l holds a fraction 1 / links_^l of the nodes
+    links_ = nr_links_;
+    boost::variate_generator<boost::mt19937, boost::uniform_real<double>>
+        uniform(boost::mt19937(seed_), boost::uniform_real<double>(0.0, 1.0));
+    const double level_factor = 1.0 / std::log(static_cast<double>(links_));
+    levels_.resize(nr_nodes);
+    upper_links_.resize(nr_nodes);
+    for (int node = 0; node < nr_nodes; ++node) {
+        levels_[node] =
+            static_cast<int>(-std::log(1.0 - uniform()) * level_factor);
+        upper_links_[node].assign(
+            static_cast<size_t>(levels_[node]) * (links_ + 1), 0);
+    }
+    links0_.assign(static_cast<size_t>(nr_nodes) * (2 * links_ + 1), 0);
+
+    entry_point_ = 0;
+    max_level_ = levels_[0];
+    VisitedSet visited;
+    std::vector<Candidate> neighbors;
+    for (int node = 1; node < nr_nodes; ++node) {
+        const float *vector = getVector(node);
+        const int level = levels_[node];
+        Candidate entry = searchUpperLayers(vector, level);
+        for (int l = std::min(level, max_level_); l >= 0; --l) {
+            searchLayer(vector, entry, ef_construction_, l, visited,
+                        neighbors);
+            entry = neighbors[0];
+            selectNeighbors(neighbors, links_);
+
+            int *links = getLinks(node, l);
+            links[0] = static_cast<int>(neighbors.size());
+            for (size_t i = 0; i < neighbors.size(); ++i) {
+                links[i + 1] = neighbors[i].second;
+                addLink(neighbors[i].second, node, l);
+            }
+        }
+        if (level > max_level_) {
+            max_level_ = level;
+            entry_point_ = node;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+typename pcl::search::HNSW<PointT>::Candidate
+pcl::search::HNSW<PointT>::searchUpperLayers(const float *query,
+                                             int level) const {
+    Candidate current(squaredDistance(query, getVector(entry_point_)),
+                      entry_point_);
+    for (int l = max_level_; l > level; --l) {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            const int *links = getLinks(current.second, l);
+            for (int i = 1; i <= links[0]; ++i) {
+                const float distance =
+                    squaredDistance(query, getVector(links[i]));
+                if (distance < current.first) {
+                    current = Candidate(distance, links[i]);
+                    changed = true;
+                }
+            }
+        }
+    }
+    return (current);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::search::HNSW<PointT>::searchLayer(
+    const float *query, const Candidate &entry, int ef, int level,
+    VisitedSet &visited, std::vector<Candidate> &results) const {
+    // The nodes left to expand, closest first, and the ef closest nodes
+    // found, farthest first
+    std::priority_queue<Candidate, std::vector<Candidate>,
+                        std::greater<Candidate>>
+        candidates;
+    std::priority_queue<Candidate> best;
+    visited.clear();
+    visited.insert(entry.second);
+    candidates.push(entry);
+    best.push(entry);
+
+    while (!candidates.empty()) {
+        const Candidate current = candidates.top();
+        if (current.first > best.top().first &&
+            static_cast<int>(best.size()) >= ef)
+            break;
+        candidates.pop();
+
+        const int *links = getLinks(current.second, level);
+        for (int i = 1; i <= links[0]; ++i) {
+            const int node = links[i];
+            if (!visited.insert(node))
+                continue;
+            const float distance = squaredDistance(query, getVector(node));
+            if (static_cast<int>(best.size()) < ef ||
+                distance < best.top().first) {
+                candidates.push(Candidate(distance, node));
+                best.push(Candidate(distance, node));
+                if (static_cast<int>(best.size()) > ef)
+                    best.pop();
+            }
+        }
+    }
+
+    results.resize(best.size());
+    for (size_t i = results.size(); i-- > 0; best.pop())
+        results[i] = best.top();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::search::HNSW<PointT>::selectNeighbors(
+    std::vector<Candidate> &candidates, int max_links) const {
+    if (static_cast<int>(candidates.size()) <= max_links)
+        return;
+
+    std::vector<Candidate> selected;
+    selected.reserve(max_links);
+    for (size_t i = 0; i < candidates.size() &&
+                       static_cast<int>(selected.size()) < max_links;
+         ++i) {
+        const float *vector = getVector(candidates[i].second);
+        bool keep = true;
+        for (size_t j = 0; keep && j < selected.size(); ++j)
+            keep = squaredDistance(vector, getVector(selected[j].second)) >=
+                   candidates[i].first;
+        if (keep)
+            selected.push_back(candidates[i]);
+    }
+    candidates.swap(selected);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::search::HNSW<PointT>::addLink(int node, int neighbor, int level) {
+    int *links = getLinks(node, level);
+    const int max_links = level == 0 ? 2 * links_ : links_;
+    if (links[0] < max_links) {
+        links[++links[0]] = neighbor;
+        return;
+    }
+
+    // Full: keep the best spread links among the current ones and the new one
+    const float *vector = getVector(node);
+    std::vector<Candidate> candidates(max_links + 1);
+    for (int i = 0; i < max_links; ++i)
+        candidates[i] = Candidate(
+            squaredDistance(vector, getVector(links[i + 1])), links[i + 1]);
+    candidates[max_links] =
+        Candidate(squaredDistance(vector, getVector(neighbor)), neighbor);
+    std::sort(candidates.begin(), candidates.end());
+    selectNeighbors(candidates, max_links);
+
+    links[0] = static_cast<int>(candidates.size());
+    for (size_t i = 0; i < candidates.size(); ++i)
+        links[i + 1] = candidates[i].second;
+}
+
+#endif // PCL_SEARCH_IMPL_HNSW_H_
@@ -44,6 +44,10 @@
 #include <pcl/common/eigen.h>
 #include <pcl/common/time.h>
 #include <Eigen/Eigenvalues>
+#include <cstring>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
 
 //////////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointT>
@@ -56,14 +60,11 @@ int pcl::search::OrganizedNeighbor<PointT>::radiusSearch(
 
     // search window
     unsigned left, right, top, bottom;
-    // unsigned x, y, idx;
-    float squared_distance;
-    double squared_radius;
 
     k_indices.clear();
     k_sqr_distances.clear();
 
-    squared_radius = radius * radius;
+    double squared_radius = radius * radius;
 
     this->getProjectedRadiusSearchBox(query, static_cast<float>(squared_radius),
                                       left, right, top, bottom);
@@ -73,37 +74,187 @@ int pcl::search::OrganizedNeighbor<PointT>::radiusSearch(
         max_nn >= static_cast<unsigned int>(input_->points.size()))
         max_nn = static_cast<unsigned int>(input_->points.size());
 
-    k_indices.reserve(max_nn);
-    k_sqr_distances.reserve(max_nn);
+    searchWindow(query, squared_radius, left, right, top, bottom, max_nn,
+                 k_indices, k_sqr_distances);
 
-    unsigned yEnd = (bottom + 1) * input_->width + right + 1;
-    register unsigned idx = top * input_->width + left;
-    unsigned skip = input_->width - right + left - 1;
-    unsigned xEnd = idx - left + right + 1;
+    if (sorted_results_)
+        this->sortResults(k_indices, k_sqr_distances);
+    return (static_cast<int>(k_indices.size()));
+}
 
-    for (; xEnd != yEnd; idx += skip, xEnd += input_->width) {
-        for (; idx < xEnd; ++idx) {
-            if (!mask_[idx] || !isFinite(input_->points[idx]))
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::search::OrganizedNeighbor<PointT>::radiusSearch(
+    const PointCloud &cloud, const std::vector<int> &indices, double radius,
+    Neighborhoods &neighborhoods, unsigned int max_nn,
+    unsigned int nr_threads) const {
+    const int nr_queries =
+        static_cast<int>(indices.empty() ? cloud.size() : indices.size());
+    const double squared_radius = radius * radius;
+    if (max_nn == 0 ||
+        max_nn >= static_cast<unsigned int>(input_->points.size()))
+        max_nn = static_cast<unsigned int>(input_->points.size());
+
+    std::vector<size_t> &offsets = neighborhoods.offsets;
+    offsets.resize(nr_queries + 1);
+    offsets[0] = 0;
+
+    // Ranges of consecutive queries (i.e. of image rows for a whole cloud)
+    // are searched in parallel, each one appending the neighbors to its own
+    // buffers. The first range reuses the memory of neighborhoods, so that a
+    // single thread writes the results in place.
+    const int nr_ranges = std::max(1, std::min(nr_threads == 1 ? 1 : 64,
+                                               nr_queries));
+    std::vector<std::vector<int> > range_indices(nr_ranges);
+    std::vector<std::vector<float> > range_sqr_distances(nr_ranges);
+    neighborhoods.indices.clear();
+    neighborhoods.sqr_distances.clear();
+    range_indices[0].swap(neighborhoods.indices);
+    range_sqr_distances[0].swap(neighborhoods.sqr_distances);
+
+    std::vector<int> k_indices;
+    std::vector<float> k_sqr_distances;
+#pragma omp parallel for private(k_indices, k_sqr_distances)                  \
+    num_threads(nr_threads) schedule(dynamic)
+    for (int r = 0; r < nr_ranges; ++r) {
+        std::vector<int> &r_indices = range_indices[r];
+        std::vector<float> &r_sqr_distances = range_sqr_distances[r];
+        const int end = static_cast<int>(
+            static_cast<long long>(nr_queries) * (r + 1) / nr_ranges);
+        for (int i = static_cast<int>(static_cast<long long>(nr_queries) * r /
+                                      nr_ranges);
+             i < end; ++i) {
+            const PointT &point =
+                cloud.points[indices.empty() ? i : indices[i]];
+            if (!isFinite(point)) {
+                offsets[i + 1] = 0;
                 continue;
+            }
+            const size_t first = r_indices.size();
+            if (sorted_results_) {
+                // Sorted the same way as the single query results
+                OrganizedNeighbor::radiusSearch(point, radius, k_indices,
+                                                k_sqr_distances, max_nn);
+                r_indices.insert(r_indices.end(), k_indices.begin(),
+                                 k_indices.end());
+                r_sqr_distances.insert(r_sqr_distances.end(),
+                                       k_sqr_distances.begin(),
+                                       k_sqr_distances.end());
+            } else {
+                unsigned left, right, top, bottom;
+                getProjectedRadiusSearchBox(
+                    point, static_cast<float>(squared_radius), left, right,
+                    top, bottom);
+                searchWindow(point, squared_radius, left, right, top, bottom,
+                             max_nn, r_indices, r_sqr_distances);
+            }
+            offsets[i + 1] = r_indices.size() - first;
+        }
+    }
 
-            squared_distance =
-                (input_->points[idx].getVector3fMap() - query.getVector3fMap())
-                    .squaredNorm();
-            if (squared_distance <= squared_radius) {
-                k_indices.push_back(idx);
-                k_sqr_distances.push_back(squared_distance);
-                // already done ?
-                if (k_indices.size() == max_nn) {
-                    if (sorted_results_)
-                        this->sortResults(k_indices, k_sqr_distances);
-                    return (max_nn);
-                }
+    for (int i = 0; i < nr_queries; ++i)
+        offsets[i + 1] += offsets[i];
+    range_indices[0].swap(neighborhoods.indices);
+    range_sqr_distances[0].swap(neighborhoods.sqr_distances);
+    neighborhoods.indices.resize(offsets[nr_queries]);
+    neighborhoods.sqr_distances.resize(offsets[nr_queries]);
+#pragma omp parallel for num_threads(nr_threads)
+    for (int r = 1; r < nr_ranges; ++r) {
+        const size_t first =
+            offsets[static_cast<long long>(nr_queries) * r / nr_ranges];
+        std::copy(range_indices[r].begin(), range_indices[r].end(),
+                  neighborhoods.indices.begin() + first);
+        std::copy(range_sqr_distances[r].begin(),
+                  range_sqr_distances[r].end(),
+                  neighborhoods.sqr_distances.begin() + first);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::search::OrganizedNeighbor<PointT>::searchWindow(
+    const PointT &query, double squared_radius, unsigned left, unsigned right,
+    unsigned top, unsigned bottom, unsigned max_nn, std::vector<int> &k_indices,
+    std::vector<float> &k_sqr_distances) const {
+    // Every point tested is written after the results, which only grow if
+    // it is a neighbor: 3 slots of padding for the last group of 4
+    const size_t first = k_indices.size();
+    const size_t area = static_cast<size_t>(right - left + 1) *
+                        static_cast<size_t>(bottom - top + 1);
+    k_indices.resize(first + std::min(area, static_cast<size_t>(max_nn)) + 3);
+    k_sqr_distances.resize(k_indices.size());
+    int *indices = &k_indices[first];
+    float *sqr_distances = &k_sqr_distances[first];
+    unsigned nr_neighbors = 0;
+
+    // The largest float not above the squared radius, so that the float
+    // comparisons give the same results as with the exact squared radius.
+    // Points with non finite coordinates never pass them.
+    float sqr_radius = static_cast<float>(squared_radius);
+    if (sqr_radius > squared_radius) {
+        uint32_t bits;
+        memcpy(&bits, &sqr_radius, sizeof(bits));
+        --bits;
+        memcpy(&sqr_radius, &bits, sizeof(bits));
+    }
+    const float qx = query.x, qy = query.y, qz = query.z;
+#ifdef __SSE__
+    const __m128 qx4 = _mm_set1_ps(qx);
+    const __m128 qy4 = _mm_set1_ps(qy);
+    const __m128 qz4 = _mm_set1_ps(qz);
+    const __m128 sqr_radius4 = _mm_set1_ps(sqr_radius);
+    float distances[4];
+#endif
+
+    for (unsigned yIdx = top; yIdx <= bottom; ++yIdx) {
+        unsigned idx = yIdx * input_->width + left;
+        const unsigned end = yIdx * input_->width + right + 1;
+#ifdef __SSE__
+        // Four points at a time: transpose their x, y, z, w coordinates into
+        // one register each
+        for (; idx + 4 <= end; idx += 4) {
+            __m128 x = _mm_loadu_ps(input_->points[idx].data);
+            __m128 y = _mm_loadu_ps(input_->points[idx + 1].data);
+            __m128 z = _mm_loadu_ps(input_->points[idx + 2].data);
+            __m128 w = _mm_loadu_ps(input_->points[idx + 3].data);
+            _MM_TRANSPOSE4_PS(x, y, z, w);
+            x = _mm_sub_ps(x, qx4);
+            y = _mm_sub_ps(y, qy4);
+            z = _mm_sub_ps(z, qz4);
+            const __m128 d = _mm_add_ps(
+                _mm_mul_ps(x, x),
+                _mm_add_ps(_mm_mul_ps(y, y), _mm_mul_ps(z, z)));
+            const int inside = _mm_movemask_ps(_mm_cmple_ps(d, sqr_radius4));
+            if (!inside)
+                continue;
+            _mm_storeu_ps(distances, d);
+            for (unsigned i = 0; i < 4; ++i) {
+                indices[nr_neighbors] = idx + i;
+                sqr_distances[nr_neighbors] = distances[i];
+                // mask_ holds 0 or 1
+                nr_neighbors += (inside >> i) & mask_[idx + i];
+            }
+            if (nr_neighbors >= max_nn) {
+                nr_neighbors = max_nn;
+                break;
             }
         }
+#endif
+        for (; idx < end && nr_neighbors < max_nn; ++idx) {
+            const PointT &point = input_->points[idx];
+            const float dx = point.x - qx, dy = point.y - qy,
+                        dz = point.z - qz;
+            const float squared_distance = dx * dx + (dy * dy + dz * dz);
+            indices[nr_neighbors] = idx;
+            sqr_distances[nr_neighbors] = squared_distance;
+            nr_neighbors += (squared_distance <= sqr_radius) & mask_[idx];
+        }
+        if (nr_neighbors == max_nn)
+            break;
     }
-    if (sorted_results_)
-        this->sortResults(k_indices, k_sqr_distances);
-    return (static_cast<int>(k_indices.size()));
+
+    k_indices.resize(first + nr_neighbors);
+    k_sqr_distances.resize(first + nr_neighbors);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
@@ -319,6 +470,7 @@ void pcl::search::OrganizedNeighbor<PointT>::estimateProjectionMatrix() {
     // matrices.
     typedef double Scalar;
     projection_matrix_.setZero();
+    projection_width_ = projection_height_ = 0;
     if (input_->height == 1 || input_->width == 1) {
         PCL_ERROR("[pcl::%s::estimateProjectionMatrix] Input dataset is not "
                   "organized!\n",
@@ -326,22 +478,8 @@ void pcl::search::OrganizedNeighbor<PointT>::estimateProjectionMatrix() {
         return;
     }
 
-    const unsigned ySkip = (input_->height >> pyramid_level_);
-    const unsigned xSkip = (input_->width >> pyramid_level_);
-
     std::vector<int> indices;
-    indices.reserve(input_->size() >> (pyramid_level_ << 1));
-
-    for (unsigned yIdx = 0, idx = 0; yIdx < input_->height;
-         yIdx += ySkip, idx += input_->width * (ySkip - 1)) {
-        for (unsigned xIdx = 0; xIdx < input_->width;
-             xIdx += xSkip, idx += xSkip) {
-            if (!mask_[idx])
-                continue;
-
-            indices.push_back(idx);
-        }
-    }
+    getProjectionMatrixSamples(indices);
 
     double residual_sqr = pcl::estimateProjectionMatrix<PointT>(
         input_, projection_matrix_, indices);
@@ -361,6 +499,64 @@ void pcl::search::OrganizedNeighbor<PointT>::estimateProjectionMatrix() {
 
     // precalculate KR * KR^T needed by calculations during nn-search
     KR_KRT_ = KR_ * KR_.transpose();
+
+    projection_width_ = input_->width;
+    projection_height_ = input_->height;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+void pcl::search::OrganizedNeighbor<PointT>::getProjectionMatrixSamples(
+    std::vector<int> &indices) const {
+    const unsigned ySkip = (input_->height >> pyramid_level_);
+    const unsigned xSkip = (input_->width >> pyramid_level_);
+
+    indices.clear();
+    indices.reserve(input_->size() >> (pyramid_level_ << 1));
+
+    for (unsigned yIdx = 0, idx = 0; yIdx < input_->height;
+         yIdx += ySkip, idx += input_->width * (ySkip - 1)) {
+        for (unsigned xIdx = 0; xIdx < input_->width;
+             xIdx += xSkip, idx += xSkip) {
+            if (!mask_[idx])
+                continue;
+
+            indices.push_back(idx);
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT>
+bool pcl::search::OrganizedNeighbor<PointT>::fitsProjectionMatrix() const {
+    if (projection_width_ != input_->width ||
+        projection_height_ != input_->height)
+        return (false);
+
+    std::vector<int> indices;
+    getProjectionMatrixSamples(indices);
+
+    // Same algebraic error as the one minimized by
+    // pcl::estimateProjectionMatrix (), for a projection matrix of unit norm
+    const Eigen::Matrix<double, 3, 4> projection_matrix =
+        projection_matrix_.cast<double>();
+    double residual_sqr = 0.0;
+    for (std::vector<int>::const_iterator iIt = indices.begin();
+         iIt != indices.end(); ++iIt) {
+        const PointT &point = input_->points[*iIt];
+        if (!pcl_isfinite(point.x))
+            continue;
+        const double xIdx = *iIt % input_->width;
+        const double yIdx = *iIt / input_->width;
+        const Eigen::Vector3d q =
+            projection_matrix *
+            Eigen::Vector4d(point.x, point.y, point.z, 1.0);
+        residual_sqr += (q[0] - xIdx * q[2]) * (q[0] - xIdx * q[2]) +
+                        (q[1] - yIdx * q[2]) * (q[1] - yIdx * q[2]);
+    }
+    residual_sqr /= projection_matrix.squaredNorm();
+
+    return (residual_sqr <= eps_ * float(indices.size()));
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
@@ -42,6 +42,7 @@
 #include <pcl/search/search.h>
 #include <pcl/kdtree/kdtree.h>
 #include <pcl/kdtree/kdtree_flann.h>
+#include <pcl/kdtree/kdtree_static.h>
 
 namespace pcl {
 namespace search {
@@ -49,12 +50,19 @@ namespace search {
  * class for performing search functions using KdTree structure. KdTree is a
  * generic type of 3D spatial locator using kD-tree structures. The class is
  * making use of the FLANN (Fast Library for Approximate Nearest Neighbor)
- * project by Marius Muja and David Lowe.
+ * project by Marius Muja and David Lowe by default.
+ *
+ * The kd-tree implementation is given by Tree, which has to derive from
+ * pcl::KdTree. Use pcl::KdTreeStatic for faster 3D searches:
+ * \code
+ * pcl::search::KdTree<pcl::PointXYZ, pcl::KdTreeStatic<pcl::PointXYZ> > tree;
+ * \endcode
  *
  * \author Radu B. Rusu
  * \ingroup search
  */
-template <typename PointT> class KdTree : public Search<PointT> {
+template <typename PointT, class Tree = pcl::KdTreeFLANN<PointT>>
+class KdTree : public Search<PointT> {
   public:
     typedef typename Search<PointT>::PointCloud PointCloud;
     typedef typename Search<PointT>::PointCloudConstPtr PointCloudConstPtr;
@@ -70,12 +78,11 @@ template <typename PointT> class KdTree : public Search<PointT> {
     using pcl::search::Search<PointT>::radiusSearch;
     using pcl::search::Search<PointT>::sorted_results_;
 
-    typedef boost::shared_ptr<KdTree<PointT>> Ptr;
-    typedef boost::shared_ptr<const KdTree<PointT>> ConstPtr;
+    typedef boost::shared_ptr<KdTree<PointT, Tree>> Ptr;
+    typedef boost::shared_ptr<const KdTree<PointT, Tree>> ConstPtr;
 
-    typedef boost::shared_ptr<pcl::KdTreeFLANN<PointT>> KdTreeFLANNPtr;
-    typedef boost::shared_ptr<const pcl::KdTreeFLANN<PointT>>
-        KdTreeFLANNConstPtr;
+    typedef boost::shared_ptr<Tree> KdTreeFLANNPtr;
+    typedef boost::shared_ptr<const Tree> KdTreeFLANNConstPtr;
 
     /** \brief Constructor for KdTree.
      *
@@ -86,7 +93,7 @@ template <typename PointT> class KdTree : public Search<PointT> {
      */
     KdTree(bool sorted = true)
         : Search<PointT>("KdTree", sorted),
-          tree_(new pcl::KdTreeFLANN<PointT>(sorted)) {}
+          tree_(new Tree(sorted)) {}
 
     /** \brief Destructor for KdTree. */
     virtual ~KdTree() {}
@@ -155,8 +162,44 @@ template <typename PointT> class KdTree : public Search<PointT> {
                                     max_nn));
     }
 
+    /** \brief Search for the k-nearest neighbors of many query points at
+     * once, in parallel if \a nr_threads is not 1.
+     * \param[in] cloud the point cloud data
+     * \param[in] indices a vector of point cloud indices to query for nearest
+     * neighbors (all the points of \a cloud if empty)
+     * \param[in] k the number of neighbors to search for
+     * \param[out] neighborhoods the resultant neighbors
+     * \param[in] nr_threads the number of threads to use (0 for automatic)
+     */
+    inline void nearestKSearch(const PointCloud &cloud,
+                               const std::vector<int> &indices, int k,
+                               Neighborhoods &neighborhoods,
+                               unsigned int nr_threads = 1) const {
+        tree_->nearestKSearch(cloud, indices, k, neighborhoods, nr_threads);
+    }
+
+    /** \brief Search for all the neighbors of many query points in a given
+     * radius at once, in parallel if \a nr_threads is not 1.
+     * \param[in] cloud the point cloud data
+     * \param[in] indices a vector of point cloud indices to query for nearest
+     * neighbors (all the points of \a cloud if empty)
+     * \param[in] radius the radius of the sphere bounding the neighbors
+     * \param[out] neighborhoods the resultant neighbors
+     * \param[in] max_nn if given, bounds the maximum returned neighbors of
+     * each query to this value
+     * \param[in] nr_threads the number of threads to use (0 for automatic)
+     */
+    inline void radiusSearch(const PointCloud &cloud,
+                             const std::vector<int> &indices, double radius,
+                             Neighborhoods &neighborhoods,
+                             unsigned int max_nn = 0,
+                             unsigned int nr_threads = 1) const {
+        tree_->radiusSearch(cloud, indices, radius, neighborhoods, max_nn,
+                            nr_threads);
+    }
+
   protected:
-    /** \brief A pointer to the internal KdTreeFLANN object. */
+    /** \brief A pointer to the internal kd-tree object. */
     KdTreeFLANNPtr tree_;
 };
 } // namespace search
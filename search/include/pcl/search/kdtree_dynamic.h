@@ -0,0 +1,133 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Point Cloud Library (PCL) - www.pointclouds.org
+ *  Copyright (c) 2010-2011, Willow Garage, Inc.
+ *  Copyright (c) 2012-, Open Perception, Inc.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#ifndef PCL_SEARCH_KDTREE_DYNAMIC_H_
+#define PCL_SEARCH_KDTREE_DYNAMIC_H_
+
+#include <pcl/search/kdtree.h>
+#include <pcl/kdtree/kdtree_dynamic.h>
+
+namespace pcl {
+namespace search {
+/** \brief @b search::KdTreeDynamic exposes pcl::KdTreeDynamic through the
+ * search interface, so that points can be inserted in and removed from the
+ * search structure between two queries.
+ *
+ * The searches return indices in getInputCloud (), which is the internal
+ * copy of the input cloud and of the added points.
+ *
+ * \ingroup search
+ */
+template <typename PointT>
+class KdTreeDynamic
+    : public pcl::search::KdTree<PointT, pcl::KdTreeDynamic<PointT>> {
+  public:
+    typedef pcl::search::KdTree<PointT, pcl::KdTreeDynamic<PointT>> BaseClass;
+    typedef typename BaseClass::PointCloud PointCloud;
+    typedef typename BaseClass::PointCloudConstPtr PointCloudConstPtr;
+    typedef typename BaseClass::IndicesConstPtr IndicesConstPtr;
+
+    using BaseClass::indices_;
+    using BaseClass::input_;
+    using BaseClass::tree_;
+
+    typedef boost::shared_ptr<KdTreeDynamic<PointT>> Ptr;
+    typedef boost::shared_ptr<const KdTreeDynamic<PointT>> ConstPtr;
+
+    /** \brief Constructor.
+     * \param[in] sorted set to true if the radius search results need to be
+     * sorted in ascending order based on their distance to the query point
+     */
+    KdTreeDynamic(bool sorted = true) : BaseClass(sorted) {}
+
+    /** \brief Destructor. */
+    virtual ~KdTreeDynamic() {}
+
+    /** \brief Copy a cloud and build the tree over its points.
+     * \param[in] cloud the const boost shared pointer to a PointCloud message
+     * \param[in] indices the point indices subset that is to be inserted
+     */
+    inline void
+    setInputCloud(const PointCloudConstPtr &cloud,
+                  const IndicesConstPtr &indices = IndicesConstPtr()) {
+        tree_->setInputCloud(cloud, indices);
+        input_ = tree_->getInputCloud();
+        indices_ = indices;
+    }
+
+    /** \brief Insert new points in getInputCloud (), in the places of removed
+     * points when possible.
+     * \param[in] cloud the points to insert
+     * \param[out] indices the index of each point of \a cloud in
+     * getInputCloud ()
+     */
+    inline void addPoints(const PointCloud &cloud, std::vector<int> &indices) {
+        tree_->addPoints(cloud, indices);
+        input_ = tree_->getInputCloud();
+    }
+
+    /** \brief Insert new points, appended to getInputCloud () if no point was
+     * removed.
+     * \param[in] cloud the points to insert
+     */
+    inline void addPoints(const PointCloud &cloud) {
+        tree_->addPoints(cloud);
+        input_ = tree_->getInputCloud();
+    }
+
+    /** \brief Remove points given by their indices in getInputCloud ().
+     * \return the number of points removed
+     */
+    inline int removeIndices(const std::vector<int> &indices) {
+        return (tree_->removeIndices(indices));
+    }
+
+    /** \brief Remove all the points inside an axis aligned box.
+     * \return the number of points removed
+     */
+    inline int removePointsInBox(const Eigen::Vector4f &min_pt,
+                                 const Eigen::Vector4f &max_pt) {
+        return (tree_->removePointsInBox(min_pt, max_pt));
+    }
+};
+} // namespace search
+} // namespace pcl
+
+#endif // PCL_SEARCH_KDTREE_DYNAMIC_H_
@@ -74,6 +74,8 @@ class OrganizedNeighbor : public pcl::search::Search<PointT> {
     using pcl::search::Search<PointT>::indices_;
     using pcl::search::Search<PointT>::sorted_results_;
     using pcl::search::Search<PointT>::input_;
+    using pcl::search::Search<PointT>::nearestKSearch;
+    using pcl::search::Search<PointT>::radiusSearch;
 
     /** \brief Constructor
      * \param[in] sorted_results whether the results should be return sorted in
@@ -92,7 +94,8 @@ class OrganizedNeighbor : public pcl::search::Search<PointT> {
               Eigen::Matrix<float, 3, 4, Eigen::RowMajor>::Zero()),
           KR_(Eigen::Matrix<float, 3, 3, Eigen::RowMajor>::Zero()),
           KR_KRT_(Eigen::Matrix<float, 3, 3, Eigen::RowMajor>::Zero()),
-          eps_(eps), pyramid_level_(pyramid_level), mask_() {}
+          eps_(eps), pyramid_level_(pyramid_level), projection_width_(0),
+          projection_height_(0), mask_() {}
 
     /** \brief Empty deconstructor. */
     virtual ~OrganizedNeighbor() {}
@@ -125,6 +128,11 @@ class OrganizedNeighbor : public pcl::search::Search<PointT> {
      * he must set it before calling this \param[in] cloud the const boost
      * shared pointer to a PointCloud message \param[in] indices the const boost
      * shared pointer to PointIndices
+     * \note The projection matrix of the previous cloud is kept, without a new
+     * estimation, if the new cloud has the same size and fits it with the
+     * same accuracy as required for an estimation: consecutive frames of a
+     * sensor share the same intrinsics. Call estimateProjectionMatrix () to
+     * force a new estimation.
      */
     virtual void
     setInputCloud(const PointCloudConstPtr &cloud,
@@ -143,7 +151,8 @@ class OrganizedNeighbor : public pcl::search::Search<PointT> {
         } else
             mask_.assign(input_->size(), 1);
 
-        estimateProjectionMatrix();
+        if (!fitsProjectionMatrix())
+            estimateProjectionMatrix();
     }
 
     /** \brief Search for all neighbors of query point that are within a given
@@ -161,6 +170,25 @@ class OrganizedNeighbor : public pcl::search::Search<PointT> {
                      std::vector<float> &k_sqr_distances,
                      unsigned int max_nn = 0) const;
 
+    /** \brief Search for all the neighbors of many query points in a given
+     * radius at once, in parallel blocks of consecutive queries (i.e. of
+     * image rows for a whole organized cloud). Same results as the single
+     * query radiusSearch (), see Search::radiusSearch ().
+     * \param[in] cloud the point cloud data
+     * \param[in] indices a vector of point cloud indices to query for nearest
+     * neighbors (all the points of \a cloud if empty)
+     * \param[in] radius the radius of the sphere bounding the neighbors
+     * \param[out] neighborhoods the resultant neighbors
+     * \param[in] max_nn if given, bounds the maximum returned neighbors of
+     * each query to this value
+     * \param[in] nr_threads the number of threads to use (0 for automatic)
+     */
+    virtual void radiusSearch(const PointCloud &cloud,
+                              const std::vector<int> &indices, double radius,
+                              Neighborhoods &neighborhoods,
+                              unsigned int max_nn = 0,
+                              unsigned int nr_threads = 1) const;
+
     /** \brief estimated the projection matrix from the input cloud. */
     void estimateProjectionMatrix();
 
@@ -222,6 +250,35 @@ class OrganizedNeighbor : public pcl::search::Search<PointT> {
         return false;
     }
 
+    /** \brief Append the points of a window of the image that lie within a
+     * sphere to k_indices and k_sqr_distances, in row major order.
+     * \param[in] query the sphere center
+     * \param[in] squared_radius the squared sphere radius
+     * \param[in] left the first column of the window
+     * \param[in] right the last column of the window
+     * \param[in] top the first row of the window
+     * \param[in] bottom the last row of the window
+     * \param[in] max_nn stop once k_indices holds this many points
+     * \param[out] k_indices the indices of the points found
+     * \param[out] k_sqr_distances their squared distances to the query
+     */
+    void searchWindow(const PointT &query, double squared_radius,
+                      unsigned left, unsigned right, unsigned top,
+                      unsigned bottom, unsigned max_nn,
+                      std::vector<int> &k_indices,
+                      std::vector<float> &k_sqr_distances) const;
+
+    /** \brief Get the points used to estimate the projection matrix: one
+     * point per cell of the grid given by pyramid_level_, if in the mask.
+     */
+    void getProjectionMatrixSamples(std::vector<int> &indices) const;
+
+    /** \brief Test whether the current projection matrix was estimated for a
+     * cloud of the same size and fits the input cloud with a residual within
+     * the estimation threshold.
+     */
+    bool fitsProjectionMatrix() const;
+
     inline void clipRange(int &begin, int &end, int min, int max) const {
         begin = std::max(std::min(begin, max), min);
         end = std::min(std::max(end, min), max);
@@ -231,13 +288,13 @@ class OrganizedNeighbor : public pcl::search::Search<PointT> {
      * \param[in] point the query point (sphere center)
      * \param[in] squared_radius the squared sphere radius
      * \param[out] minX the min X box coordinate
-     * \param[out] minY the min Y box coordinate
      * \param[out] maxX the max X box coordinate
+     * \param[out] minY the min Y box coordinate
      * \param[out] maxY the max Y box coordinate
      */
     void getProjectedRadiusSearchBox(const PointT &point, float squared_radius,
-                                     unsigned &minX, unsigned &minY,
-                                     unsigned &maxX, unsigned &maxY) const;
+                                     unsigned &minX, unsigned &maxX,
+                                     unsigned &minY, unsigned &maxY) const;
 
     /** \brief the projection matrix. Either set by user or calculated by the
      * first / each input cloud */
@@ -258,6 +315,10 @@ class OrganizedNeighbor : public pcl::search::Search<PointT> {
      * matrix. pyramid_level_ = use down sampled cloud given by pyramid_level_*/
     const unsigned pyramid_level_;
 
+    /** \brief size of the cloud the projection matrix was estimated from, 0 if
+     * the estimation failed.*/
+    unsigned projection_width_, projection_height_;
+
     /** \brief mask, indicating whether the point was in the indices list or
      * not.*/
     std::vector<unsigned char> mask_;
@@ -42,6 +42,7 @@
 
 #include <pcl/point_cloud.h>
 #include <pcl/common/io.h>
+#include <pcl/neighborhoods.h>
 
 namespace pcl {
 namespace search {
@@ -248,6 +249,32 @@ template <typename PointT> class Search {
         }
     }
 
+    /** \brief Search for the k-nearest neighbors of many query points at
+     * once, possibly in parallel.
+     * \param[in] cloud the point cloud data
+     * \param[in] indices a vector of point cloud indices to query for nearest
+     * neighbors (all the points of \a cloud if empty)
+     * \param[in] k the number of neighbors to search for
+     * \param[out] neighborhoods the resultant neighbors, the i-th query
+     * corresponding to the i-th index (or point). Queries with non finite
+     * coordinates get no neighbors.
+     * \param[in] nr_threads the number of threads to use (0 for automatic).
+     * The single query searches must be thread safe to use more than one.
+     */
+    virtual void nearestKSearch(const PointCloud &cloud,
+                                const std::vector<int> &indices, int k,
+                                Neighborhoods &neighborhoods,
+                                unsigned int nr_threads = 1) const {
+        if (input_ && k > static_cast<int>(input_->size()))
+            k = static_cast<int>(input_->size());
+        int nr_queries = static_cast<int>(indices.empty() ? cloud.size()
+                                                          : indices.size());
+        pcl::detail::searchNeighborhoods(
+            pcl::detail::NearestKSearchFunctor<Search<PointT>, PointT>(
+                *this, cloud, indices, k),
+            nr_queries, k, nr_threads, neighborhoods);
+    }
+
     /** \brief Search for the k-nearest neighbors for the given query point. Use
      * this method if the query points are of a different type than the points
      * in the data set (e.g. PointXYZRGBA instead of PointXYZ). \param[in] cloud
@@ -441,6 +468,38 @@ template <typename PointT> class Search {
         }
     }
 
+    /** \brief Search for all the neighbors of many query points in a given
+     * radius at once, possibly in parallel.
+     * \param[in] cloud the point cloud data
+     * \param[in] indices a vector of point cloud indices to query for nearest
+     * neighbors (all the points of \a cloud if empty)
+     * \param[in] radius the radius of the sphere bounding the neighbors
+     * \param[out] neighborhoods the resultant neighbors, the i-th query
+     * corresponding to the i-th index (or point). Queries with non finite
+     * coordinates get no neighbors.
+     * \param[in] max_nn if given, bounds the maximum returned neighbors of
+     * each query to this value
+     * \param[in] nr_threads the number of threads to use (0 for automatic).
+     * The single query searches must be thread safe to use more than one.
+     */
+    virtual void radiusSearch(const PointCloud &cloud,
+                              const std::vector<int> &indices, double radius,
+                              Neighborhoods &neighborhoods,
+                              unsigned int max_nn = 0,
+                              unsigned int nr_threads = 1) const {
+        // No query can get more neighbors than there are points, and the
+        // bound is only applied by the single searches: gather the results
+        // without reserving max_nn slots per query
+        if (input_ && max_nn > input_->size())
+            max_nn = static_cast<unsigned int>(input_->size());
+        int nr_queries = static_cast<int>(indices.empty() ? cloud.size()
+                                                          : indices.size());
+        pcl::detail::searchNeighborhoods(
+            pcl::detail::RadiusSearchFunctor<Search<PointT>, PointT>(
+                *this, cloud, indices, radius, max_nn),
+            nr_queries, 0, nr_threads, neighborhoods);
+    }
+
     /** \brief Search for all the nearest neighbors of the query points in a
      * given radius. \param[in] cloud the point cloud data \param[in] indices a
      * vector of point cloud indices to query for nearest neighbors \param[in]
@@ -41,6 +41,7 @@
 #include <pcl/features/normal_3d.h>
 #include <pcl/features/integral_image_normal.h>
 
+#include <cstring>
 #include <iostream>
 
 using namespace pcl;
@@ -563,6 +564,89 @@ TEST(PCL, IINormalEstimationSimple3DGradient) {
     }
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TEST(PCL, IINormalEstimationMultiThreaded) {
+    // curved surface with a depth step, so that smoothing sizes vary
+    PointCloud<PointXYZ>::Ptr wave(new PointCloud<PointXYZ>);
+    wave->width = 320;
+    wave->height = 240;
+    wave->points.resize(wave->width * wave->height);
+    for (size_t v = 0; v < wave->height; ++v) {
+        for (size_t u = 0; u < wave->width; ++u) {
+            (*wave)(u, v).x = static_cast<float>(u) * 0.01f;
+            (*wave)(u, v).y = static_cast<float>(v) * 0.01f;
+            (*wave)(u, v).z =
+                2.0f + 0.1f * sinf(static_cast<float>(u) * 0.05f) +
+                0.1f * cosf(static_cast<float>(v) * 0.07f) +
+                (u > 200 ? 0.5f : 0.0f);
+        }
+    }
+
+    // integral images summed in several bands equal the sequential sums
+    IntegralImage2D<float, 1> ii_serial(true), ii_parallel(true);
+    ii_parallel.setNumberOfThreads(4);
+    std::vector<float> depth(wave->points.size());
+    for (size_t i = 0; i < depth.size(); ++i)
+        depth[i] = static_cast<float>(i % 17);
+    ii_serial.setInput(&depth[0], wave->width, wave->height, 1, wave->width);
+    ii_parallel.setInput(&depth[0], wave->width, wave->height, 1, wave->width);
+    for (unsigned yIdx = 0; yIdx < wave->height - 5; yIdx += 7) {
+        for (unsigned xIdx = 0; xIdx < wave->width - 5; xIdx += 3) {
+            EXPECT_EQ(ii_serial.getFirstOrderSum(xIdx, yIdx, 5, 5),
+                      ii_parallel.getFirstOrderSum(xIdx, yIdx, 5, 5));
+            EXPECT_EQ(ii_serial.getSecondOrderSum(xIdx, yIdx, 5, 5),
+                      ii_parallel.getSecondOrderSum(xIdx, yIdx, 5, 5));
+        }
+    }
+
+    IntegralImageNormalEstimation<PointXYZ, Normal> ne_serial, ne_parallel;
+    ne_parallel.setNumberOfThreads(4);
+    typedef IntegralImageNormalEstimation<PointXYZ, Normal> IINormals;
+    const IINormals::NormalEstimationMethod methods[] = {
+        IINormals::COVARIANCE_MATRIX, IINormals::AVERAGE_3D_GRADIENT,
+        IINormals::AVERAGE_DEPTH_CHANGE};
+    // covariance sums are accumulated in a different order per band
+    const float tolerances[] = {1e-2f, 1e-5f, 1e-5f};
+    for (int m = 0; m < 3; ++m) {
+        ne_serial.setNormalEstimationMethod(methods[m]);
+        ne_parallel.setNormalEstimationMethod(methods[m]);
+        ne_serial.setNormalSmoothingSize(10.0f);
+        ne_parallel.setNormalSmoothingSize(10.0f);
+
+        // the second, smaller input reuses the buffers of the first one
+        for (unsigned scale = 1; scale <= 2; ++scale) {
+            PointCloud<PointXYZ>::Ptr input(new PointCloud<PointXYZ>);
+            input->width = wave->width / scale;
+            input->height = wave->height / scale;
+            for (size_t v = 0; v < input->height; ++v)
+                for (size_t u = 0; u < input->width; ++u)
+                    input->points.push_back((*wave)(u, v));
+
+            PointCloud<Normal> output_serial, output_parallel;
+            ne_serial.setInputCloud(input);
+            ne_serial.compute(output_serial);
+            ne_parallel.setInputCloud(input);
+            ne_parallel.compute(output_parallel);
+
+            ASSERT_EQ(output_serial.points.size(),
+                      output_parallel.points.size());
+            for (size_t i = 0; i < output_serial.points.size(); ++i) {
+                const Normal &a = output_serial.points[i];
+                const Normal &b = output_parallel.points[i];
+                ASSERT_EQ(pcl_isfinite(a.normal_x), pcl_isfinite(b.normal_x));
+                if (!pcl_isfinite(a.normal_x))
+                    continue;
+                EXPECT_NEAR(a.normal_x, b.normal_x, tolerances[m]);
+                EXPECT_NEAR(a.normal_y, b.normal_y, tolerances[m]);
+                EXPECT_NEAR(a.normal_z, b.normal_z, tolerances[m]);
+            }
+            EXPECT_EQ(0, memcmp(ne_serial.getDistanceMap(),
+                                ne_parallel.getDistanceMap(),
+                                input->points.size() * sizeof(float)));
+        }
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 TEST(PCL, IINormalEstimationSimple3DGradientUnorganized) {
     PointCloud<Normal> output;
@@ -173,6 +173,90 @@ TEST(PCL, NormalEstimationOpenMP) {
     }
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TEST(PCL, NormalEstimationBatched) {
+    PointCloud<PointXYZ>::Ptr cloudptr = cloud.makeShared();
+    boost::shared_ptr<vector<int>> indicesptr(new vector<int>(indices));
+
+    // Neighborhoods spanning the whole cloud give the same plane everywhere
+    NormalEstimation<PointXYZ, Normal> n;
+    PointCloud<Normal> normals;
+    n.setInputCloud(cloudptr);
+    n.setIndices(indicesptr);
+    n.setSearchMethod(tree);
+    n.setKSearch(static_cast<int>(indices.size()));
+    n.setBatchedComputation(true);
+    EXPECT_TRUE(n.getBatchedComputation());
+
+    n.compute(normals);
+    EXPECT_EQ(normals.points.size(), indices.size());
+    for (size_t i = 0; i < normals.points.size(); ++i) {
+        EXPECT_NEAR(normals.points[i].normal[0], -0.035592, 1e-4);
+        EXPECT_NEAR(normals.points[i].normal[1], -0.369596, 1e-4);
+        EXPECT_NEAR(normals.points[i].normal[2], -0.928511, 1e-4);
+        EXPECT_NEAR(normals.points[i].curvature, 0.0693136, 1e-4);
+    }
+
+    // Local neighborhoods, compared with the point by point estimation
+    PointCloud<Normal> normals_single, normals_batched, normals_omp;
+    n.setKSearch(10);
+    n.setBatchedComputation(false);
+    n.compute(normals_single);
+    n.setBatchedComputation(true);
+    n.compute(normals_batched);
+
+    NormalEstimationOMP<PointXYZ, Normal> n_omp(4);
+    n_omp.setInputCloud(cloudptr);
+    n_omp.setIndices(indicesptr);
+    n_omp.setSearchMethod(tree);
+    n_omp.setKSearch(10);
+    n_omp.setBatchedComputation(true);
+    n_omp.compute(normals_omp);
+
+    ASSERT_EQ(normals_batched.points.size(), normals_single.points.size());
+    ASSERT_EQ(normals_omp.points.size(), normals_single.points.size());
+    for (size_t i = 0; i < normals_single.points.size(); ++i) {
+        Eigen::Vector3f normal =
+            normals_single.points[i].getNormalVector3fMap();
+        EXPECT_NEAR(
+            fabs(normals_batched.points[i].getNormalVector3fMap().dot(normal)),
+            1.0, 1e-3);
+        EXPECT_EQ(normals_omp.points[i].normal[0],
+                  normals_batched.points[i].normal[0]);
+        EXPECT_NEAR(normals_batched.points[i].curvature,
+                    normals_single.points[i].curvature, 1e-3);
+        EXPECT_EQ(normals_omp.points[i].curvature,
+                  normals_batched.points[i].curvature);
+    }
+
+    // Non finite points are skipped, empty neighborhoods give NaN normals
+    PointCloud<PointXYZ> surface;
+    surface.push_back(PointXYZ(0.0f, 0.0f, 0.0f));
+    surface.push_back(PointXYZ(1.0f, 0.0f, 0.0f));
+    surface.push_back(PointXYZ(std::numeric_limits<float>::quiet_NaN(), 0.0f,
+                               0.0f));
+    surface.push_back(PointXYZ(0.0f, 1.0f, 0.0f));
+    surface.push_back(PointXYZ(1.0f, 1.0f, 0.0f));
+    surface.is_dense = false;
+
+    Neighborhoods neighborhoods;
+    neighborhoods.offsets.push_back(0);
+    for (int i = 0; i < 5; ++i)
+        neighborhoods.indices.push_back(i);
+    neighborhoods.offsets.push_back(5);
+    neighborhoods.offsets.push_back(5);
+    neighborhoods.indices.push_back(2);
+    neighborhoods.offsets.push_back(6);
+
+    computePointNormals(surface, neighborhoods, normals);
+    ASSERT_EQ(normals.points.size(), static_cast<size_t>(3));
+    EXPECT_FALSE(normals.is_dense);
+    EXPECT_NEAR(fabs(normals.points[0].normal[2]), 1.0, 1e-4);
+    EXPECT_NEAR(normals.points[0].curvature, 0.0, 1e-4);
+    EXPECT_FALSE(pcl_isfinite(normals.points[1].normal[0]));
+    EXPECT_FALSE(pcl_isfinite(normals.points[2].normal[0]));
+}
+
 #ifndef PCL_ONLY_CORE_POINT_TYPES
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 TEST(PCL, NormalEstimationEigen) {
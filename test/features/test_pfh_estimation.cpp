@@ -41,6 +41,7 @@
 #include <pcl/point_cloud.h>
 #include <pcl/features/normal_3d.h>
 #include <pcl/features/pfh.h>
+#include <pcl/features/pfh_omp.h>
 #include <pcl/features/fpfh.h>
 #include <pcl/features/fpfh_omp.h>
 #include <pcl/features/vfh.h>
@@ -521,6 +522,97 @@ TEST(PCL, FPFHEstimationOpenMP) {
         FPFHSignature33>(cloud.makeShared(), normals, test_indices, 33);
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TEST(PCL, PFHEstimationOpenMP) {
+    // Estimate normals first
+    NormalEstimation<PointXYZ, Normal> n;
+    PointCloud<Normal>::Ptr normals(new PointCloud<Normal>());
+    // set parameters
+    n.setInputCloud(cloud.makeShared());
+    boost::shared_ptr<vector<int>> indicesptr(new vector<int>(indices));
+    n.setIndices(indicesptr);
+    n.setSearchMethod(tree);
+    n.setKSearch(10); // Use 10 nearest neighbors to estimate the normals
+    // estimate
+    n.compute(*normals);
+
+    // Reference signatures, computed point by point without cache
+    PFHEstimation<PointXYZ, Normal, PFHSignature125> pfh;
+    PointCloud<PFHSignature125> pfhs, pfhs_omp, pfhs_given;
+    pfh.setInputCloud(cloud.makeShared());
+    pfh.setInputNormals(normals);
+    pfh.setIndices(indicesptr);
+    pfh.setSearchMethod(tree);
+    pfh.setKSearch(10);
+    pfh.compute(pfhs);
+
+    // A shared cache too small to hold all the pairs must not change them
+    PFHEstimationOMP<PointXYZ, Normal, PFHSignature125> pfh_omp(
+        4); // instantiate 4 threads
+    pfh_omp.setInputCloud(cloud.makeShared());
+    pfh_omp.setInputNormals(normals);
+    pfh_omp.setIndices(indicesptr);
+    pfh_omp.setSearchMethod(tree);
+    pfh_omp.setKSearch(10);
+    pfh_omp.setUseInternalCache(true);
+    pfh_omp.setMaximumCacheSize(256);
+    pfh_omp.compute(pfhs_omp);
+
+    // Neighborhoods given beforehand
+    boost::shared_ptr<Neighborhoods> neighborhoods(new Neighborhoods);
+    tree->nearestKSearch(cloud, vector<int>(), 10, *neighborhoods);
+    pfh_omp.setSearchNeighborhoods(neighborhoods);
+    pfh_omp.compute(pfhs_given);
+
+    ASSERT_EQ(pfhs_omp.points.size(), pfhs.points.size());
+    ASSERT_EQ(pfhs_given.points.size(), pfhs.points.size());
+    for (size_t i = 0; i < pfhs.points.size(); ++i) {
+        for (int d = 0; d < 125; ++d) {
+            EXPECT_NEAR(pfhs_omp.points[i].histogram[d],
+                        pfhs.points[i].histogram[d], 1e-4);
+            EXPECT_NEAR(pfhs_given.points[i].histogram[d],
+                        pfhs.points[i].histogram[d], 1e-4);
+        }
+    }
+
+    // The same neighborhoods serve both FPFH passes
+    FPFHEstimation<PointXYZ, Normal, FPFHSignature33> fpfh;
+    FPFHEstimationOMP<PointXYZ, Normal, FPFHSignature33> fpfh_omp(4);
+    PointCloud<FPFHSignature33> fpfhs, fpfhs_given;
+    fpfh.setInputCloud(cloud.makeShared());
+    fpfh.setInputNormals(normals);
+    fpfh.setSearchMethod(tree);
+    fpfh.setKSearch(10);
+    fpfh.compute(fpfhs);
+    fpfh_omp.setInputCloud(cloud.makeShared());
+    fpfh_omp.setInputNormals(normals);
+    fpfh_omp.setSearchMethod(tree);
+    fpfh_omp.setKSearch(10);
+    fpfh_omp.setSearchNeighborhoods(neighborhoods);
+    fpfh_omp.compute(fpfhs_given);
+
+    ASSERT_EQ(fpfhs_given.points.size(), fpfhs.points.size());
+    for (size_t i = 0; i < fpfhs.points.size(); ++i)
+        for (int d = 0; d < 33; ++d)
+            EXPECT_NEAR(fpfhs_given.points[i].histogram[d],
+                        fpfhs.points[i].histogram[d], 1e-4);
+
+    // Neighborhoods of another cloud are refused
+    neighborhoods->offsets.resize(cloud.points.size());
+    fpfh_omp.compute(fpfhs_given);
+    EXPECT_EQ(fpfhs_given.points.size(), 0);
+
+    // Test results when setIndices and/or setSearchSurface are used
+
+    boost::shared_ptr<vector<int>> test_indices(new vector<int>(0));
+    for (size_t i = 0; i < cloud.size(); i += 3)
+        test_indices->push_back(static_cast<int>(i));
+
+    testIndicesAndSearchSurface<
+        PFHEstimationOMP<PointXYZ, Normal, PFHSignature125>, PointXYZ, Normal,
+        PFHSignature125>(cloud.makeShared(), normals, test_indices, 125);
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 TEST(PCL, VFHEstimation) {
     // Estimate normals first
@@ -39,13 +39,16 @@
 
 #include <gtest/gtest.h>
 #include <pcl/point_cloud.h>
+#include <pcl/common/common.h>
 #include <pcl/features/normal_3d_omp.h>
 #include <pcl/io/pcd_io.h>
 #include <pcl/features/shot.h>
 #include <pcl/features/shot_omp.h>
 #include "pcl/features/shot_lrf.h"
 #include <pcl/features/3dsc.h>
+#include <pcl/features/3dsc_omp.h>
 #include <pcl/features/usc.h>
+#include <pcl/features/usc_omp.h>
 
 using namespace pcl;
 using namespace pcl::io;
@@ -791,6 +794,92 @@ TEST(PCL, SHOTShapeEstimationOpenMP) {
         cloud.makeShared(), normals, test_indices);
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TEST(PCL, SHOTShapeEstimationFused) {
+    // Estimate normals first
+    double mr = 0.002;
+    NormalEstimation<PointXYZ, Normal> n;
+    PointCloud<Normal>::Ptr normals(new PointCloud<Normal>());
+    // set parameters
+    n.setInputCloud(cloud.makeShared());
+    boost::shared_ptr<vector<int>> indicesptr(new vector<int>(indices));
+    n.setIndices(indicesptr);
+    n.setSearchMethod(tree);
+    n.setRadiusSearch(20 * mr);
+    n.compute(*normals);
+
+    // Reference: frames estimated by SHOTLocalReferenceFrameEstimation
+    SHOTEstimation<PointXYZ, Normal, SHOT352> shot;
+    shot.setInputNormals(normals);
+    shot.setRadiusSearch(20 * mr);
+    shot.setInputCloud(cloud.makeShared());
+    shot.setIndices(indicesptr);
+    shot.setSearchMethod(tree);
+    PointCloud<SHOT352> shots;
+    shot.compute(shots);
+
+    // Frames estimated along the descriptors
+    SHOTEstimation<PointXYZ, Normal, SHOT352> fused;
+    EXPECT_FALSE(fused.getFusedComputation());
+    fused.setFusedComputation(true);
+    EXPECT_TRUE(fused.getFusedComputation());
+    fused.setInputNormals(normals);
+    fused.setRadiusSearch(20 * mr);
+    fused.setInputCloud(cloud.makeShared());
+    fused.setIndices(indicesptr);
+    fused.setSearchMethod(tree);
+    PointCloud<SHOT352> fused_shots;
+    fused.compute(fused_shots);
+
+#ifdef _OPENMP
+    SHOTEstimationOMP<PointXYZ, Normal, SHOT352> fused_omp(
+        omp_get_max_threads());
+#else
+    SHOTEstimationOMP<PointXYZ, Normal, SHOT352> fused_omp;
+#endif
+    fused_omp.setFusedComputation(true);
+    fused_omp.setInputNormals(normals);
+    fused_omp.setRadiusSearch(20 * mr);
+    fused_omp.setInputCloud(cloud.makeShared());
+    fused_omp.setIndices(indicesptr);
+    fused_omp.setSearchMethod(tree);
+    PointCloud<SHOT352> fused_omp_shots;
+    fused_omp.compute(fused_omp_shots);
+
+    ASSERT_EQ(fused_shots.size(), shots.size());
+    ASSERT_EQ(fused_omp_shots.size(), shots.size());
+    EXPECT_EQ(fused_shots.is_dense, shots.is_dense);
+    for (size_t i = 0; i < shots.size(); ++i) {
+        if (!pcl_isfinite(shots[i].descriptor[0])) {
+            EXPECT_FALSE(pcl_isfinite(fused_shots[i].descriptor[0]));
+            EXPECT_FALSE(pcl_isfinite(fused_omp_shots[i].descriptor[0]));
+            continue;
+        }
+        for (int d = 0; d < 9; ++d) {
+            EXPECT_NEAR(fused_shots[i].rf[d], shots[i].rf[d], 1e-4);
+            EXPECT_EQ(fused_omp_shots[i].rf[d], fused_shots[i].rf[d]);
+        }
+        for (int d = 0; d < 352; ++d) {
+            EXPECT_NEAR(fused_shots[i].descriptor[d], shots[i].descriptor[d],
+                        1e-4);
+            EXPECT_EQ(fused_omp_shots[i].descriptor[d],
+                      fused_shots[i].descriptor[d]);
+        }
+    }
+
+    EXPECT_NEAR(fused_omp_shots.points[103].descriptor[9], 0.0072018504, 1e-4);
+    EXPECT_NEAR(fused_omp_shots.points[103].descriptor[20], 0.17439659, 1e-4);
+    EXPECT_NEAR(fused_omp_shots.points[103].descriptor[55], 0.0050609680, 1e-4);
+
+    // The frames are kept as with the default estimation
+    ASSERT_TRUE(fused.getInputReferenceFrames());
+    ASSERT_EQ(fused.getInputReferenceFrames()->size(), shots.size());
+    for (size_t i = 0; i < shots.size(); ++i)
+        if (pcl_isfinite(fused_shots[i].rf[0]))
+            EXPECT_EQ(fused.getInputReferenceFrames()->points[i].x_axis[0],
+                      fused_shots[i].rf[0]);
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 TEST(PCL, SHOTShapeAndColorEstimationOpenMP) {
     double mr = 0.002;
@@ -1073,6 +1162,187 @@ TEST(PCL, USCEstimation) {
         cloud.makeShared(), normals, test_indices);
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TEST(PCL, 3DSCEstimationOpenMP) {
+    float meshRes = 0.002f;
+    float radius = 20.0f * meshRes;
+    float rmin = radius / 10.0f;
+    float ptDensityRad = radius / 5.0f;
+
+    PointCloud<PointXYZ>::Ptr cloudptr = cloud.makeShared();
+
+    // Estimate normals first
+    NormalEstimation<PointXYZ, Normal> ne;
+    PointCloud<Normal>::Ptr normals(new PointCloud<Normal>());
+    // set parameters
+    ne.setInputCloud(cloudptr);
+    ne.setSearchMethod(tree);
+    ne.setRadiusSearch(radius);
+    // estimate
+    ne.compute(*normals);
+
+    // The random X axes do not depend on the number of threads
+    ShapeContext3DEstimationOMP<PointXYZ, Normal, ShapeContext1980> sc3d(false,
+                                                                         4);
+    sc3d.setInputCloud(cloudptr);
+    sc3d.setInputNormals(normals);
+    sc3d.setSearchMethod(tree);
+    sc3d.setRadiusSearch(radius);
+    sc3d.setMinimalRadius(rmin);
+    sc3d.setPointDensityRadius(ptDensityRad);
+    // Compute the features
+    PointCloud<ShapeContext1980>::Ptr sc3ds(new PointCloud<ShapeContext1980>());
+    sc3d.compute(*sc3ds);
+    EXPECT_EQ(sc3ds->size(), cloud.size());
+
+    for (int d = 0; d < 9; ++d)
+        EXPECT_NEAR((*sc3ds)[0].rf[d], 0.0f, 1e-4f);
+
+    EXPECT_NEAR((*sc3ds)[94].descriptor[88], 55.2712f, 1e-4f);
+    EXPECT_NEAR((*sc3ds)[94].descriptor[584], 71.1088f, 1e-4f);
+    EXPECT_NEAR((*sc3ds)[94].descriptor[1106], 79.5896f, 1e-4f);
+    EXPECT_NEAR((*sc3ds)[94].descriptor[1560], 0.f, 1e-4f);
+    EXPECT_NEAR((*sc3ds)[94].descriptor[1929], 36.0636f, 1e-4f);
+
+    EXPECT_NEAR((*sc3ds)[108].descriptor[67], 0.f, 1e-4f);
+    EXPECT_NEAR((*sc3ds)[108].descriptor[548], 126.141f, 1e-4f);
+    EXPECT_NEAR((*sc3ds)[108].descriptor[1091], 30.4704f, 1e-4f);
+    EXPECT_NEAR((*sc3ds)[108].descriptor[1421], 38.088f, 1e-4f);
+    EXPECT_NEAR((*sc3ds)[108].descriptor[1900], 43.7994f, 1e-4f);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/** \brief 3DSC estimator giving access to its random number generator. */
+class ShapeContext3DEstimationRnd
+    : public ShapeContext3DEstimation<PointXYZ, Normal, ShapeContext1980> {
+  public:
+    using ShapeContext3DEstimation<PointXYZ, Normal, ShapeContext1980>::rnd;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TEST(PCL, 3DSCEstimationSearchSurface) {
+    float meshRes = 0.002f;
+    float radius = 20.0f * meshRes;
+
+    // The search surface is the left third of the bunny. The first input
+    // points are in its right third, more than radius away from the surface
+    // (empty neighborhoods), the next ones on the surface
+    Eigen::Vector4f min_pt, max_pt;
+    getMinMax3D(cloud, min_pt, max_pt);
+    float third = (max_pt[0] - min_pt[0]) / 3.0f;
+    ASSERT_GT(third, radius);
+    PointCloud<PointXYZ>::Ptr surface(new PointCloud<PointXYZ>());
+    PointCloud<PointXYZ>::Ptr input(new PointCloud<PointXYZ>());
+    PointCloud<PointXYZ>::Ptr on_surface(new PointCloud<PointXYZ>());
+    for (size_t i = 0; i < cloud.size(); ++i) {
+        if (cloud[i].x < min_pt[0] + third)
+            surface->push_back(cloud[i]);
+        else if (cloud[i].x > max_pt[0] - third && input->size() < 10)
+            input->push_back(cloud[i]);
+    }
+    const size_t nr_far = input->size();
+    ASSERT_GT(nr_far, 0u);
+    for (size_t i = 0; i < surface->size(); i += 10)
+        on_surface->push_back((*surface)[i]);
+    *input += *on_surface;
+
+    NormalEstimation<PointXYZ, Normal> ne;
+    PointCloud<Normal>::Ptr normals(new PointCloud<Normal>());
+    ne.setInputCloud(surface);
+    ne.setSearchMethod(KdTreePtr(new search::KdTree<PointXYZ>(false)));
+    ne.setRadiusSearch(radius);
+    ne.compute(*normals);
+
+    // 0: serial, 1: serial on the points with neighbors only, after drawing
+    // the axes of the others, 2: same without drawing them, 3: OpenMP
+    PointCloud<ShapeContext1980> sc3ds, near_sc3ds, shifted_sc3ds, omp_sc3ds;
+    PointCloud<ShapeContext1980> *outputs[4] = {&sc3ds, &near_sc3ds,
+                                                &shifted_sc3ds, &omp_sc3ds};
+    for (int run = 0; run < 4; ++run) {
+        ShapeContext3DEstimationOMP<PointXYZ, Normal, ShapeContext1980> omp(
+            false, 2);
+        ShapeContext3DEstimationRnd serial;
+        ShapeContext3DEstimation<PointXYZ, Normal, ShapeContext1980> &sc3d =
+            run == 3 ? static_cast<ShapeContext3DEstimation<
+                           PointXYZ, Normal, ShapeContext1980> &>(omp)
+                     : serial;
+        sc3d.setInputCloud(run == 0 || run == 3 ? input : on_surface);
+        sc3d.setSearchSurface(surface);
+        sc3d.setInputNormals(normals);
+        sc3d.setSearchMethod(KdTreePtr(new search::KdTree<PointXYZ>(false)));
+        sc3d.setRadiusSearch(radius);
+        sc3d.setMinimalRadius(radius / 10.0f);
+        sc3d.setPointDensityRadius(radius / 5.0f);
+        // Every finite point draws its X axis, even without neighbors
+        if (run == 1)
+            for (size_t i = 0; i < 3 * nr_far; ++i)
+                serial.rnd();
+        sc3d.compute(*outputs[run]);
+    }
+
+    ASSERT_EQ(sc3ds.size(), input->size());
+    ASSERT_EQ(near_sc3ds.size(), on_surface->size());
+    EXPECT_FALSE(sc3ds.is_dense);
+    for (size_t i = 0; i < nr_far; ++i)
+        EXPECT_TRUE(pcl_isnan(sc3ds[i].descriptor[0]));
+    size_t nr_shifted = 0;
+    for (size_t i = 0; i < on_surface->size(); ++i)
+        for (size_t j = 0; j < 1980; ++j) {
+            ASSERT_EQ(sc3ds[nr_far + i].descriptor[j],
+                      near_sc3ds[i].descriptor[j]);
+            ASSERT_EQ(sc3ds[nr_far + i].descriptor[j],
+                      omp_sc3ds[nr_far + i].descriptor[j]);
+            if (sc3ds[nr_far + i].descriptor[j] !=
+                shifted_sc3ds[i].descriptor[j])
+                ++nr_shifted;
+        }
+    // Without the draws of the empty neighborhoods, the axes differ
+    EXPECT_GT(nr_shifted, 0u);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TEST(PCL, USCEstimationOpenMP) {
+    float meshRes = 0.002f;
+    float radius = 20.0f * meshRes;
+    float rmin = radius / 10.0f;
+    float ptDensityRad = radius / 5.0f;
+
+    // estimate
+    UniqueShapeContextOMP<PointXYZ, ShapeContext1980> uscd(4);
+    uscd.setInputCloud(cloud.makeShared());
+    uscd.setSearchMethod(tree);
+    uscd.setRadiusSearch(radius);
+    uscd.setMinimalRadius(rmin);
+    uscd.setPointDensityRadius(ptDensityRad);
+    uscd.setLocalRadius(radius);
+    // Compute the features
+    PointCloud<ShapeContext1980>::Ptr uscds(new PointCloud<ShapeContext1980>);
+    uscd.compute(*uscds);
+    EXPECT_EQ(uscds->size(), cloud.size());
+
+    EXPECT_NEAR((*uscds)[160].rf[0], -0.97767f, 1e-4f);
+    EXPECT_NEAR((*uscds)[160].rf[1], 0.0353674f, 1e-4f);
+    EXPECT_NEAR((*uscds)[160].rf[2], -0.20715f, 1e-4f);
+    EXPECT_NEAR((*uscds)[160].rf[3], 0.0125394f, 1e-4f);
+    EXPECT_NEAR((*uscds)[160].rf[4], 0.993798f, 1e-4f);
+    EXPECT_NEAR((*uscds)[160].rf[5], 0.110493f, 1e-4f);
+    EXPECT_NEAR((*uscds)[160].rf[6], 0.209773f, 1e-4f);
+    EXPECT_NEAR((*uscds)[160].rf[7], 0.105428f, 1e-4f);
+    EXPECT_NEAR((*uscds)[160].rf[8], -0.972049f, 1e-4f);
+
+    EXPECT_NEAR((*uscds)[160].descriptor[56], 53.0597f, 1e-4f);
+    EXPECT_NEAR((*uscds)[160].descriptor[734], 80.1063f, 1e-4f);
+    EXPECT_NEAR((*uscds)[160].descriptor[1222], 93.8412f, 1e-4f);
+    EXPECT_NEAR((*uscds)[160].descriptor[1605], 0.f, 1e-4f);
+    EXPECT_NEAR((*uscds)[160].descriptor[1887], 32.6679f, 1e-4f);
+
+    EXPECT_NEAR((*uscds)[168].descriptor[72], 65.3358f, 1e-4f);
+    EXPECT_NEAR((*uscds)[168].descriptor[430], 88.8147f, 1e-4f);
+    EXPECT_NEAR((*uscds)[168].descriptor[987], 0.f, 1e-4f);
+    EXPECT_NEAR((*uscds)[168].descriptor[1563], 128.273f, 1e-4f);
+    EXPECT_NEAR((*uscds)[168].descriptor[1915], 59.2098f, 1e-4f);
+}
+
 #ifndef PCL_ONLY_CORE_POINT_TYPES
 ///////////////////////////////////////////////////////////////////////////////////
 template <typename FeatureEstimation, typename PointT, typename NormalT>
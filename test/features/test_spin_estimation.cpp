@@ -42,6 +42,7 @@
 #include <pcl/features/normal_3d.h>
 #include <pcl/io/pcd_io.h>
 #include <pcl/features/spin_image.h>
+#include <pcl/features/spin_image_omp.h>
 #include <pcl/features/intensity_spin.h>
 
 using namespace pcl;
@@ -232,6 +233,62 @@ TEST(PCL, SpinImageEstimation) {
     EXPECT_NEAR(spin_images->points[300].histogram[144], 0.272542, 1e-4);
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TEST(PCL, SpinImageEstimationOpenMP) {
+    // Estimate normals first
+    double mr = 0.002;
+    NormalEstimation<PointXYZ, Normal> n;
+    PointCloud<Normal>::Ptr normals(new PointCloud<Normal>());
+    // set parameters
+    n.setInputCloud(cloud.makeShared());
+    boost::shared_ptr<vector<int>> indicesptr(new vector<int>(indices));
+    n.setIndices(indicesptr);
+    n.setSearchMethod(tree);
+    n.setRadiusSearch(20 * mr);
+    n.compute(*normals);
+
+    typedef Histogram<153> SpinImage;
+    SpinImageEstimation<PointXYZ, Normal, SpinImage> spin_est(8, 0.5, 16);
+    SpinImageEstimationOMP<PointXYZ, Normal, SpinImage> spin_est_omp(8, 0.5,
+                                                                     16, 4);
+    spin_est.setInputCloud(cloud.makeShared());
+    spin_est.setInputNormals(normals);
+    spin_est.setIndices(indicesptr);
+    spin_est.setSearchMethod(tree);
+    spin_est.setRadiusSearch(40 * mr);
+    spin_est_omp.setInputCloud(cloud.makeShared());
+    spin_est_omp.setInputNormals(normals);
+    spin_est_omp.setIndices(indicesptr);
+    spin_est_omp.setSearchMethod(tree);
+    spin_est_omp.setRadiusSearch(40 * mr);
+
+    PointCloud<SpinImage> spin_images, spin_images_omp;
+
+    // rectangular, radial and angular spin-images
+    for (int variant = 0; variant < 3; ++variant) {
+        if (variant == 1) {
+            spin_est.setRadialStructure();
+            spin_est_omp.setRadialStructure();
+        } else if (variant == 2) {
+            spin_est.setAngularDomain();
+            spin_est_omp.setAngularDomain();
+        }
+
+        spin_est.compute(spin_images);
+        spin_est_omp.compute(spin_images_omp);
+        ASSERT_EQ(spin_images.points.size(), spin_images_omp.points.size());
+        for (size_t i = 0; i < spin_images.points.size(); ++i)
+            for (int j = 0; j < 153; ++j)
+                EXPECT_EQ(spin_images.points[i].histogram[j],
+                          spin_images_omp.points[i].histogram[j]);
+    }
+
+    // Errors raised by the threads are forwarded to the caller
+    spin_est_omp.setMinPointCountInNeighbourhood(
+        static_cast<unsigned int>(cloud.size()) + 1);
+    EXPECT_THROW(spin_est_omp.compute(spin_images_omp), PCLException);
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 TEST(PCL, IntensitySpinEstimation) {
     // Generate a sample point cloud
@@ -47,6 +47,7 @@
 #include <pcl/filters/sampling_surface_normal.h>
 #include <pcl/filters/voxel_grid.h>
 #include <pcl/filters/voxel_grid_covariance.h>
+#include <pcl/filters/voxel_grid_accumulator.h>
 #include <pcl/filters/extract_indices.h>
 #include <pcl/filters/project_inliers.h>
 #include <pcl/filters/radius_outlier_removal.h>
@@ -55,6 +56,7 @@
 #include <pcl/filters/random_sample.h>
 #include <pcl/filters/crop_box.h>
 
+#include <pcl/common/common.h>
 #include <pcl/common/transforms.h>
 #include <pcl/common/eigen.h>
 
@@ -1019,6 +1021,135 @@ TEST (VoxelGrid_XYZNormal, Filters)
 
 #endif
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TEST(VoxelGrid_LargeExtent, Filters) {
+    // 2.7e15 voxels, more than 32-bit voxel indices can address
+    PointCloud<PointXYZ> input;
+    for (int k = 0; k < 4; ++k)
+        for (int i = 0; i < 5; ++i)
+            input.points.push_back(PointXYZ(1000.0f * float(k) + 0.002f,
+                                            1000.0f * float(k) + 0.005f,
+                                            100.0f * float(k) + 0.001f * i));
+    input.width = static_cast<uint32_t>(input.points.size());
+    input.height = 1;
+
+    PointCloud<PointXYZ> output;
+    VoxelGrid<PointXYZ> grid;
+    grid.setLeafSize(0.01f, 0.01f, 0.01f);
+    grid.setInputCloud(input.makeShared());
+    grid.filter(output);
+
+    ASSERT_EQ(int(output.points.size()), 4);
+    for (int k = 0; k < 4; ++k) {
+        EXPECT_NEAR(output.points[k].x, 1000.0f * float(k) + 0.002f, 1e-3);
+        EXPECT_NEAR(output.points[k].y, 1000.0f * float(k) + 0.005f, 1e-3);
+        EXPECT_NEAR(output.points[k].z, 100.0f * float(k) + 0.002f, 1e-3);
+    }
+
+    // The leaf layout cannot hold that many voxels
+    grid.setSaveLeafLayout(true);
+    EXPECT_THROW(grid.filter(output), PCLException);
+
+    // The output does not depend on the number of threads
+    PointCloud<PointXYZ> output_mt;
+    grid.setSaveLeafLayout(false);
+    grid.setLeafSize(0.005f, 0.005f, 0.005f);
+    grid.setInputCloud(cloud);
+    grid.setNumberOfThreads(1);
+    grid.filter(output);
+    grid.setNumberOfThreads(4);
+    grid.filter(output_mt);
+    ASSERT_EQ(output.points.size(), output_mt.points.size());
+    for (size_t i = 0; i < output.points.size(); ++i) {
+        EXPECT_EQ(output.points[i].x, output_mt.points[i].x);
+        EXPECT_EQ(output.points[i].y, output_mt.points[i].y);
+        EXPECT_EQ(output.points[i].z, output_mt.points[i].z);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TEST(VoxelGridAccumulator, Filters) {
+    PointCloud<PointXYZ> output;
+    VoxelGrid<PointXYZ> grid;
+    grid.setLeafSize(0.02f, 0.02f, 0.02f);
+    grid.setInputCloud(cloud);
+    grid.filter(output);
+
+    // Adding the cloud in two batches gives the centroids of VoxelGrid
+    std::vector<int> first_half, second_half;
+    for (int i = 0; i < int(cloud->points.size()); ++i)
+        (i % 2 ? first_half : second_half).push_back(i);
+
+    Eigen::Vector4f min_pt, max_pt;
+    getMinMax3D(*cloud, min_pt, max_pt);
+    for (int dense = 0; dense < 2; ++dense) {
+        VoxelGridAccumulator<PointXYZ> acc;
+        acc.setLeafSize(0.02f, 0.02f, 0.02f);
+        if (dense)
+            ASSERT_TRUE(acc.setDenseStorage(min_pt, max_pt));
+        EXPECT_EQ(acc.isDense(), dense == 1);
+        EXPECT_EQ(acc.addPoints(*cloud, first_half), first_half.size());
+        EXPECT_EQ(acc.addPoints(*cloud, second_half), second_half.size());
+
+        PointCloud<PointXYZ> centroids;
+        acc.getCentroids(centroids);
+        EXPECT_EQ(acc.getNumberOfLeaves(), output.points.size());
+        ASSERT_EQ(centroids.points.size(), output.points.size());
+        EXPECT_EQ(int(centroids.width), 103);
+        EXPECT_EQ(bool(centroids.is_dense), true);
+        for (size_t i = 0; i < output.points.size(); ++i) {
+            const VoxelGridAccumulator<PointXYZ>::Leaf *leaf =
+                acc.getLeaf(output.points[i]);
+            ASSERT_TRUE(leaf != NULL);
+            EXPECT_NEAR(leaf->getMean()[0], output.points[i].x, 1e-5);
+            EXPECT_NEAR(leaf->getMean()[1], output.points[i].y, 1e-5);
+            EXPECT_NEAR(leaf->getMean()[2], output.points[i].z, 1e-5);
+            if (leaf->getPointCount() > 2) {
+                Eigen::Matrix3d cov = leaf->getCov();
+                EXPECT_NEAR(cov(0, 1), cov(1, 0), 1e-12);
+                EXPECT_GE(cov(2, 2), 0.0);
+            }
+        }
+
+        // Remove every voxel that intersects x <= 0
+        size_t nr_removed =
+            acc.removeRegion(min_pt, Eigen::Vector4f(0.0f, max_pt[1],
+                                                     max_pt[2], 0.0f));
+        EXPECT_GT(nr_removed, 0u);
+        EXPECT_EQ(acc.getNumberOfLeaves(), output.points.size() - nr_removed);
+        acc.getCentroids(centroids);
+        EXPECT_EQ(centroids.points.size(), acc.getNumberOfLeaves());
+        for (size_t i = 0; i < centroids.points.size(); ++i)
+            EXPECT_GE(centroids.points[i].x, 0.02f);
+
+        // Removed voxels can be filled again
+        acc.addPoints(*cloud);
+        EXPECT_EQ(acc.getNumberOfLeaves(), output.points.size());
+    }
+
+    // r/g/b are averaged separately
+    PointCloud<PointXYZRGB> colored;
+    PointXYZRGB p;
+    p.x = p.y = p.z = 0.001f;
+    p.r = 255;
+    p.g = p.b = 0;
+    colored.points.push_back(p);
+    p.x = p.y = p.z = 0.003f;
+    p.r = p.g = 0;
+    p.b = 255;
+    colored.points.push_back(p);
+    VoxelGridAccumulator<PointXYZRGB> acc_rgb;
+    acc_rgb.setLeafSize(0.01f, 0.01f, 0.01f);
+    acc_rgb.addPoints(colored);
+    PointCloud<PointXYZRGB> centroids_rgb;
+    acc_rgb.getCentroids(centroids_rgb);
+    ASSERT_EQ(int(centroids_rgb.points.size()), 1);
+    EXPECT_NEAR(centroids_rgb.points[0].x, 0.002f, 1e-6);
+    EXPECT_EQ(int(centroids_rgb.points[0].r), 127);
+    EXPECT_EQ(int(centroids_rgb.points[0].g), 0);
+    EXPECT_EQ(int(centroids_rgb.points[0].b), 127);
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 TEST(VoxelGridCovariance, Filters) {
     // Test the PointCloud<PointT> method
@@ -1225,6 +1356,21 @@ TEST(RadiusOutlierRemoval, Filters) {
     EXPECT_NEAR(cloud_out.points[cloud_out.points.size() - 1].y, 0.16039, 1e-4);
     EXPECT_NEAR(cloud_out.points[cloud_out.points.size() - 1].z, -0.021299,
                 1e-4);
+
+    // The multi threaded searches have to give the same kept and removed
+    // indices as the serial ones
+    std::vector<int> indices_st, indices_mt;
+    outrem_.filter(indices_st);
+    RadiusOutlierRemoval<PointXYZ> outrem_mt(true);
+    outrem_mt.setInputCloud(cloud);
+    outrem_mt.setRadiusSearch(0.02);
+    outrem_mt.setMinNeighborsInRadius(14);
+    outrem_mt.setNumberOfThreads(4);
+    outrem_mt.filter(indices_mt);
+
+    EXPECT_EQ(int(indices_mt.size()), 307);
+    EXPECT_TRUE(indices_mt == indices_st);
+    EXPECT_TRUE(*outrem_mt.getRemovedIndices() == *outrem_.getRemovedIndices());
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1465,6 +1611,49 @@ TEST(CropBox, Filters) {
     cropBoxFilter.filter(indices);
     EXPECT_EQ(int(indices.size()), 9);
 
+    // Invalid points are skipped, also when filtering a subset of the points
+    // (one full block of four indices followed by a partial one)
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    PointCloud<PointXYZ>::Ptr input_nan(new PointCloud<PointXYZ>());
+    input_nan->push_back(PointXYZ(0.0f, 0.0f, 0.0f));
+    input_nan->push_back(PointXYZ(0.5f, 0.5f, 0.5f));
+    input_nan->push_back(PointXYZ(nan, 0.0f, 0.0f));
+    input_nan->push_back(PointXYZ(2.0f, 0.0f, 0.0f));
+    input_nan->push_back(PointXYZ(0.0f, -0.5f, 0.9f));
+    input_nan->push_back(PointXYZ(0.0f, 0.0f, nan));
+    input_nan->is_dense = false;
+    IndicesPtr subset(new vector<int>());
+    subset->push_back(3);
+    subset->push_back(2);
+    subset->push_back(0);
+    subset->push_back(1);
+    subset->push_back(5);
+    subset->push_back(4);
+
+    CropBox<PointXYZ> cropBoxFilterNaN(true);
+    cropBoxFilterNaN.setInputCloud(input_nan);
+    cropBoxFilterNaN.setIndices(subset);
+    cropBoxFilterNaN.setMin(min_pt);
+    cropBoxFilterNaN.setMax(max_pt);
+    cropBoxFilterNaN.filter(indices);
+
+    ASSERT_EQ(int(indices.size()), 3);
+    EXPECT_EQ(indices[0], 0);
+    EXPECT_EQ(indices[1], 1);
+    EXPECT_EQ(indices[2], 4);
+    ASSERT_EQ(int(cropBoxFilterNaN.getRemovedIndices()->size()), 1);
+    EXPECT_EQ((*cropBoxFilterNaN.getRemovedIndices())[0], 3);
+
+    cropBoxFilterNaN.setNegative(true);
+    cropBoxFilterNaN.filter(indices);
+
+    ASSERT_EQ(int(indices.size()), 1);
+    EXPECT_EQ(indices[0], 3);
+    ASSERT_EQ(int(cropBoxFilterNaN.getRemovedIndices()->size()), 3);
+    EXPECT_EQ((*cropBoxFilterNaN.getRemovedIndices())[0], 0);
+    EXPECT_EQ((*cropBoxFilterNaN.getRemovedIndices())[1], 1);
+    EXPECT_EQ((*cropBoxFilterNaN.getRemovedIndices())[2], 4);
+
     // PointCloud2
     // -------------------------------------------------------------------------
 
@@ -1726,6 +1915,22 @@ TEST(StatisticalOutlierRemoval, Filters) {
     EXPECT_NEAR(output.points[output.points.size() - 1].x, -0.07793, 1e-4);
     EXPECT_NEAR(output.points[output.points.size() - 1].y, 0.17516, 1e-4);
     EXPECT_NEAR(output.points[output.points.size() - 1].z, -0.0444, 1e-4);
+
+    // The multi threaded searches have to give the same kept and removed
+    // indices as the serial ones
+    std::vector<int> indices_st, indices_mt;
+    outrem_.setNegative(false);
+    outrem_.filter(indices_st);
+    StatisticalOutlierRemoval<PointXYZ> outrem_mt(true);
+    outrem_mt.setInputCloud(cloud);
+    outrem_mt.setMeanK(50);
+    outrem_mt.setStddevMulThresh(1.0);
+    outrem_mt.setNumberOfThreads(4);
+    outrem_mt.filter(indices_mt);
+
+    EXPECT_EQ(int(indices_mt.size()), 352);
+    EXPECT_TRUE(indices_mt == indices_st);
+    EXPECT_TRUE(*outrem_mt.getRemovedIndices() == *outrem_.getRemovedIndices());
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
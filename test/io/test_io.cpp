@@ -44,8 +44,14 @@
 #include <pcl/common/io.h>
 #include <pcl/console/print.h>
 #include <pcl/io/pcd_io.h>
+#include <pcl/io/pcd_mapped_cloud.h>
+#include <pcl/io/pcd_stream_reader.h>
+#include <pcl/io/async_pcd_writer.h>
+#include <pcl/io/number_parser.h>
 #include <pcl/io/ply_io.h>
+#include <algorithm>
 #include <fstream>
+#include <iterator>
 #include <locale>
 #include <stdexcept>
 
@@ -1088,6 +1094,145 @@ TEST(PCL, PLYReaderWriter) {
     }
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/** \brief Write vertices to a PLY file.
+ * \param[in] file_name the output file
+ * \param[in] format ascii, binary_little_endian or binary_big_endian
+ * \param[in] properties the type and name of each property; list properties
+ * ("list uchar int") get two elements, value and value + 1
+ * \param[in] values the values of the properties of each vertex
+ */
+void writePLYVertices(const std::string &file_name, const std::string &format,
+                      const std::vector<std::pair<std::string, std::string> >
+                          &properties,
+                      const std::vector<std::vector<double> > &values) {
+    std::ofstream fs(file_name.c_str(), std::ios::binary);
+    fs << "ply\nformat " << format << " 1.0\nelement vertex " << values.size()
+       << "\n";
+    for (size_t p = 0; p < properties.size(); ++p)
+        fs << "property " << properties[p].first << " "
+           << properties[p].second << "\n";
+    fs << "end_header\n";
+    fs.precision(9);
+
+    const uint16_t one = 1;
+    const bool swap = (format == "binary_big_endian") ==
+                      (*reinterpret_cast<const char *>(&one) == 1);
+    for (size_t i = 0; i < values.size(); ++i) {
+        for (size_t p = 0; p < properties.size(); ++p) {
+            const std::string &type = properties[p].first;
+            const double value = values[i][p];
+            if (format == "ascii") {
+                if (type == "list uchar int")
+                    fs << "2 " << value << " " << value + 1 << " ";
+                else
+                    fs << value << " ";
+                continue;
+            }
+
+            char bytes[8];
+            size_t size = 4;
+            if (type == "float") {
+                float v = static_cast<float>(value);
+                memcpy(bytes, &v, size);
+            } else if (type == "uint") {
+                uint32_t v = static_cast<uint32_t>(value);
+                memcpy(bytes, &v, size);
+            } else if (type == "double") {
+                size = 8;
+                memcpy(bytes, &value, size);
+            } else if (type == "uchar") {
+                size = 1;
+                bytes[0] = static_cast<char>(static_cast<uint8_t>(value));
+            } else {
+                // Two elements list
+                fs.put(2);
+                for (int j = 0; j < 2; ++j) {
+                    int32_t v = static_cast<int32_t>(value) + j;
+                    memcpy(bytes, &v, size);
+                    if (swap)
+                        std::reverse(bytes, bytes + size);
+                    fs.write(bytes, size);
+                }
+                continue;
+            }
+            if (swap)
+                std::reverse(bytes, bytes + size);
+            fs.write(bytes, size);
+        }
+        if (format == "ascii")
+            fs << "\n";
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TEST(PCL, PLYReaderBinaryVertices) {
+    // The binary vertices are read in bulk when possible, and have to give
+    // exactly the cloud read by the property callbacks from the ASCII file
+    const char *layouts[][7] = {
+        // Same layout as the cloud
+        {"float x", "float y", "float z", "uint label", 0},
+        // Properties without callback
+        {"float x", "double quality", "float y", "float z",
+         "uchar confidence", 0},
+        // Colors
+        {"float x", "float y", "float z", "uchar red", "uchar green",
+         "uchar blue", 0},
+        {"float x", "float y", "float z", "uchar red", "uchar green",
+         "uchar blue", "uchar alpha"},
+        {"uchar intensity", "float x", "float y", "float z", 0},
+        // List property: read by the callbacks
+        {"float x", "float y", "float z", "list uchar int vertex_indices", 0}};
+    const char *formats[] = {"binary_little_endian", "binary_big_endian"};
+
+    for (size_t l = 0; l < sizeof(layouts) / sizeof(layouts[0]); ++l) {
+        std::vector<std::pair<std::string, std::string> > properties;
+        for (int p = 0; p < 7 && layouts[l][p]; ++p) {
+            std::string property(layouts[l][p]);
+            size_t space = property.rfind(' ');
+            properties.push_back(std::make_pair(property.substr(0, space),
+                                                property.substr(space + 1)));
+        }
+        std::vector<std::vector<double> > values(1000);
+        for (size_t i = 0; i < values.size(); ++i)
+            for (size_t p = 0; p < properties.size(); ++p)
+                values[i].push_back(
+                    properties[p].first == "float" ||
+                            properties[p].first == "double"
+                        ? 0.25 * static_cast<double>((i * 7 + p * 13) % 4001) -
+                              500.0
+                        : static_cast<double>((i * 31 + p * 17) % 256));
+
+        sensor_msgs::PointCloud2 ascii_cloud;
+        PLYReader reader;
+        writePLYVertices("test_pcl_io_vertices.ply", "ascii", properties,
+                         values);
+        ASSERT_EQ(0, reader.read("test_pcl_io_vertices.ply", ascii_cloud));
+        ASSERT_EQ(values.size(), ascii_cloud.width * ascii_cloud.height);
+
+        for (int f = 0; f < 2; ++f) {
+            SCOPED_TRACE(::testing::Message()
+                         << formats[f] << ", layout " << l);
+            sensor_msgs::PointCloud2 cloud;
+            writePLYVertices("test_pcl_io_vertices.ply", formats[f],
+                             properties, values);
+            ASSERT_EQ(0, reader.read("test_pcl_io_vertices.ply", cloud));
+            EXPECT_EQ(ascii_cloud.width, cloud.width);
+            EXPECT_EQ(ascii_cloud.height, cloud.height);
+            EXPECT_EQ(ascii_cloud.point_step, cloud.point_step);
+            ASSERT_EQ(ascii_cloud.fields.size(), cloud.fields.size());
+            for (size_t i = 0; i < cloud.fields.size(); ++i) {
+                EXPECT_EQ(ascii_cloud.fields[i].name, cloud.fields[i].name);
+                EXPECT_EQ(ascii_cloud.fields[i].offset, cloud.fields[i].offset);
+                EXPECT_EQ(ascii_cloud.fields[i].datatype,
+                          cloud.fields[i].datatype);
+            }
+            EXPECT_TRUE(ascii_cloud.data == cloud.data);
+        }
+    }
+    remove("test_pcl_io_vertices.ply");
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 struct PointXYZFPFH33 {
@@ -1336,6 +1481,526 @@ TEST(PCL, LZFExtended) {
     }
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TEST(PCL, LZFChunked) {
+    PointCloud<PointXYZRGBNormal> cloud, cloud2;
+    cloud.width = 640;
+    cloud.height = 480;
+    cloud.points.resize(cloud.width * cloud.height);
+    cloud.is_dense = true;
+
+    srand(static_cast<unsigned int>(time(NULL)));
+    size_t nr_p = cloud.points.size();
+    // Randomly create a new point cloud
+    for (size_t i = 0; i < nr_p; ++i) {
+        cloud.points[i].x =
+            static_cast<float>(1024 * rand() / (RAND_MAX + 1.0));
+        cloud.points[i].y =
+            static_cast<float>(1024 * rand() / (RAND_MAX + 1.0));
+        cloud.points[i].z =
+            static_cast<float>(1024 * rand() / (RAND_MAX + 1.0));
+        cloud.points[i].normal_x = cloud.points[i].normal_y = 0.0f;
+        cloud.points[i].normal_z = 1.0f;
+        cloud.points[i].rgb =
+            static_cast<float>(1024 * rand() / (RAND_MAX + 1.0));
+    }
+
+    PCDWriter writer;
+    // Use a chunk size that does not divide the number of points
+    writer.setChunkSize(10000);
+    int res = writer.writeBinaryCompressedChunked<PointXYZRGBNormal>(
+        "test_pcl_io_compressed_chunked.pcd", cloud);
+    EXPECT_EQ(res, 0);
+
+    PCDReader reader;
+    reader.read<PointXYZRGBNormal>("test_pcl_io_compressed_chunked.pcd",
+                                   cloud2);
+
+    EXPECT_EQ(cloud2.width, cloud.width);
+    EXPECT_EQ(cloud2.height, cloud.height);
+    EXPECT_EQ(cloud2.is_dense, cloud.is_dense);
+    EXPECT_EQ(cloud2.points.size(), cloud.points.size());
+
+    for (size_t i = 0; i < cloud2.points.size(); ++i) {
+        ASSERT_EQ(cloud2.points[i].x, cloud.points[i].x);
+        ASSERT_EQ(cloud2.points[i].y, cloud.points[i].y);
+        ASSERT_EQ(cloud2.points[i].z, cloud.points[i].z);
+        ASSERT_EQ(cloud2.points[i].normal_x, cloud.points[i].normal_x);
+        ASSERT_EQ(cloud2.points[i].normal_y, cloud.points[i].normal_y);
+        ASSERT_EQ(cloud2.points[i].normal_z, cloud.points[i].normal_z);
+        ASSERT_EQ(cloud2.points[i].rgb, cloud.points[i].rgb);
+    }
+
+    // Read back only a few fields over a range that spans several chunks
+    std::vector<std::string> fields;
+    fields.push_back("z");
+    fields.push_back("x");
+    sensor_msgs::PointCloud2 blob;
+    res = reader.readSubset("test_pcl_io_compressed_chunked.pcd", blob, fields,
+                            25000, 30000);
+    EXPECT_EQ(res, 0);
+    EXPECT_EQ(blob.width, 30000);
+    EXPECT_EQ(blob.height, 1);
+    ASSERT_EQ(blob.fields.size(), 2);
+    EXPECT_EQ(blob.fields[0].name, "x");
+    EXPECT_EQ(blob.fields[1].name, "z");
+
+    PointCloud<PointXYZ> subset;
+    fromROSMsg(blob, subset);
+    for (size_t i = 0; i < subset.points.size(); ++i) {
+        ASSERT_EQ(subset.points[i].x, cloud.points[25000 + i].x);
+        ASSERT_EQ(subset.points[i].z, cloud.points[25000 + i].z);
+    }
+
+    // Same subset from a file that is not chunked
+    writer.writeBinaryCompressed<PointXYZRGBNormal>(
+        "test_pcl_io_compressed.pcd", cloud);
+    sensor_msgs::PointCloud2 blob2;
+    res = reader.readSubset("test_pcl_io_compressed.pcd", blob2, fields,
+                            25000, 30000);
+    EXPECT_EQ(res, 0);
+    EXPECT_EQ(blob2.data, blob.data);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TEST(PCL, PCDMappedCloud) {
+    PointCloud<PointXYZ> cloud, cloud2;
+    cloud.width = 640;
+    cloud.height = 480;
+    cloud.points.resize(cloud.width * cloud.height);
+    cloud.is_dense = true;
+
+    srand(static_cast<unsigned int>(time(NULL)));
+    for (size_t i = 0; i < cloud.points.size(); ++i) {
+        cloud.points[i].x =
+            static_cast<float>(1024 * rand() / (RAND_MAX + 1.0));
+        cloud.points[i].y =
+            static_cast<float>(1024 * rand() / (RAND_MAX + 1.0));
+        cloud.points[i].z =
+            static_cast<float>(1024 * rand() / (RAND_MAX + 1.0));
+    }
+
+    // The blob keeps the padding of PointXYZ: with an aligned data section,
+    // it maps in place
+    sensor_msgs::PointCloud2 blob;
+    pcl::toROSMsg(cloud, blob);
+    PCDWriter writer;
+    EXPECT_FALSE(writer.getZeroCopyLayout());
+    writer.setZeroCopyLayout(true);
+    EXPECT_EQ(writer.writeBinary("test_pcl_io_mapped.pcd", blob), 0);
+
+    PCDMappedCloud<PointXYZ> mapped;
+    ASSERT_EQ(mapped.open("test_pcl_io_mapped.pcd"), 0);
+    EXPECT_TRUE(mapped.isOpen());
+    EXPECT_TRUE(mapped.isZeroCopy());
+    EXPECT_EQ(mapped.getWidth(), cloud.width);
+    EXPECT_EQ(mapped.getHeight(), cloud.height);
+    ASSERT_EQ(mapped.size(), cloud.points.size());
+    EXPECT_EQ(static_cast<size_t>(mapped.end() - mapped.begin()),
+              cloud.points.size());
+
+    size_t i = 0;
+    for (PCDMappedCloud<PointXYZ>::const_iterator it = mapped.begin();
+         it != mapped.end(); ++it, ++i) {
+        ASSERT_EQ(it->x, cloud.points[i].x);
+        ASSERT_EQ(it->y, cloud.points[i].y);
+        ASSERT_EQ(it->z, cloud.points[i].z);
+    }
+
+    // By default the templated writer packs the fields, and does not pad the
+    // header: points are assembled lazily
+    writer.setZeroCopyLayout(false);
+    EXPECT_EQ(writer.writeBinary<PointXYZ>("test_pcl_io_mapped.pcd", cloud),
+              0);
+    std::ifstream fs("test_pcl_io_mapped.pcd");
+    std::string line;
+    int nr_comments = 0;
+    while (getline(fs, line) && line.compare(0, 4, "DATA") != 0)
+        nr_comments += (line[0] == '#');
+    fs.close();
+    EXPECT_EQ(nr_comments, 1);
+    ASSERT_EQ(mapped.open("test_pcl_io_mapped.pcd"), 0);
+    EXPECT_FALSE(mapped.isZeroCopy());
+    EXPECT_TRUE(mapped.begin() == NULL);
+    ASSERT_EQ(mapped.size(), cloud.points.size());
+    for (size_t i = 0; i < mapped.size(); ++i) {
+        PointXYZ p = mapped.at(i);
+        ASSERT_EQ(p.x, cloud.points[i].x);
+        ASSERT_EQ(p.y, cloud.points[i].y);
+        ASSERT_EQ(p.z, cloud.points[i].z);
+    }
+
+    mapped.copyTo(cloud2);
+    EXPECT_EQ(cloud2.width, cloud.width);
+    EXPECT_EQ(cloud2.height, cloud.height);
+    EXPECT_EQ(cloud2.is_dense, cloud.is_dense);
+    ASSERT_EQ(cloud2.points.size(), cloud.points.size());
+    for (size_t i = 0; i < cloud2.points.size(); ++i)
+        ASSERT_EQ(cloud2.points[i].z, cloud.points[i].z);
+
+    mapped.close();
+    EXPECT_FALSE(mapped.isOpen());
+
+    // The zero copy layout keeps the memory layout of the point type, even
+    // when its fields are not registered in offset order
+    PointCloud<PointXYZRGBNormal> normals;
+    normals.points.resize(1000);
+    normals.width = 1000;
+    normals.height = 1;
+    std::vector<int> indices;
+    for (int i = 0; i < 1000; ++i) {
+        PointXYZRGBNormal &p = normals.points[i];
+        p.x = static_cast<float>(i);
+        p.y = static_cast<float>(i) * 0.5f;
+        p.z = static_cast<float>(-i);
+        p.normal_x = p.normal_y = p.normal_z = 1.0f / static_cast<float>(i + 1);
+        p.rgba = static_cast<uint32_t>(i * 7);
+        p.curvature = static_cast<float>(i % 13);
+        if (i % 3 == 0)
+            indices.push_back(i);
+    }
+    writer.setZeroCopyLayout(true);
+    for (int with_indices = 0; with_indices < 2; ++with_indices) {
+        if (with_indices)
+            writer.writeBinary("test_pcl_io_mapped.pcd", normals, indices);
+        else
+            writer.writeBinary("test_pcl_io_mapped.pcd", normals);
+        size_t n = with_indices ? indices.size() : normals.points.size();
+
+        PCDMappedCloud<PointXYZRGBNormal> mapped_normals;
+        ASSERT_EQ(mapped_normals.open("test_pcl_io_mapped.pcd"), 0);
+        EXPECT_TRUE(mapped_normals.isZeroCopy());
+        ASSERT_EQ(mapped_normals.size(), n);
+        PointCloud<PointXYZRGBNormal> normals2;
+        EXPECT_EQ(pcl::io::loadPCDFile("test_pcl_io_mapped.pcd", normals2), 0);
+        ASSERT_EQ(normals2.points.size(), n);
+        for (size_t i = 0; i < n; ++i) {
+            const PointXYZRGBNormal &p =
+                normals.points[with_indices ? indices[i] : i];
+            const PointXYZRGBNormal &q = mapped_normals.begin()[i];
+            const PointXYZRGBNormal &r = normals2.points[i];
+            ASSERT_EQ(q.x, p.x);
+            ASSERT_EQ(q.z, p.z);
+            ASSERT_EQ(q.normal_y, p.normal_y);
+            ASSERT_EQ(q.rgba, p.rgba);
+            ASSERT_EQ(q.curvature, p.curvature);
+            ASSERT_EQ(r.y, p.y);
+            ASSERT_EQ(r.normal_z, p.normal_z);
+            ASSERT_EQ(r.rgba, p.rgba);
+            ASSERT_EQ(r.curvature, p.curvature);
+        }
+    }
+
+    // Compressed files cannot be mapped
+    writer.writeBinaryCompressed<PointXYZ>("test_pcl_io_mapped.pcd", cloud);
+    EXPECT_LT(mapped.open("test_pcl_io_mapped.pcd"), 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TEST(PCL, PCDStreamReader) {
+    PointCloud<PointXYZRGBNormal> cloud;
+    cloud.width = 320;
+    cloud.height = 240;
+    cloud.points.resize(cloud.width * cloud.height);
+    cloud.is_dense = true;
+
+    srand(static_cast<unsigned int>(time(NULL)));
+    for (size_t i = 0; i < cloud.points.size(); ++i) {
+        cloud.points[i].x = static_cast<float>(i % 320);
+        cloud.points[i].y =
+            static_cast<float>(1024 * rand() / (RAND_MAX + 1.0));
+        cloud.points[i].z = static_cast<float>(i / 320) * 0.01f;
+        cloud.points[i].normal_x = 1.0f;
+        cloud.points[i].curvature = static_cast<float>(i % 7);
+        cloud.points[i].rgba = static_cast<uint32_t>(i * 11);
+    }
+
+    PCDWriter writer;
+    writer.setChunkSize(10000);
+    PCDStreamReader reader(7777);
+    for (int type = 0; type < 4; ++type) {
+        if (type == 0)
+            writer.writeASCII("test_pcl_io_stream.pcd", cloud);
+        else if (type == 1)
+            writer.writeBinary("test_pcl_io_stream.pcd", cloud);
+        else if (type == 2)
+            writer.writeBinaryCompressed("test_pcl_io_stream.pcd", cloud);
+        else
+            writer.writeBinaryCompressedChunked("test_pcl_io_stream.pcd",
+                                                cloud);
+
+        ASSERT_EQ(reader.open("test_pcl_io_stream.pcd"), 0);
+        EXPECT_EQ(reader.getNumberOfPoints(), cloud.points.size());
+
+        PointCloud<PointXYZRGBNormal> chunk;
+        size_t idx = 0;
+        int nr_chunks = 0;
+        while (reader.hasNext()) {
+            int n = reader.readChunk(chunk);
+            ASSERT_GT(n, 0);
+            ASSERT_LE(n, 7777);
+            ASSERT_EQ(chunk.points.size(), static_cast<size_t>(n));
+            EXPECT_TRUE(chunk.is_dense);
+            for (size_t i = 0; i < chunk.points.size(); ++i, ++idx) {
+                const PointXYZRGBNormal &p = chunk.points[i];
+                const PointXYZRGBNormal &q = cloud.points[idx];
+                ASSERT_EQ(p.x, q.x);
+                ASSERT_EQ(p.normal_x, q.normal_x);
+                ASSERT_EQ(p.curvature, q.curvature);
+                ASSERT_EQ(p.rgba, q.rgba);
+                if (type != 0) {
+                    ASSERT_EQ(p.y, q.y);
+                    ASSERT_EQ(p.z, q.z);
+                } else {
+                    ASSERT_NEAR(p.y, q.y, 1e-3);
+                    ASSERT_NEAR(p.z, q.z, 1e-5);
+                }
+            }
+            ++nr_chunks;
+        }
+        EXPECT_EQ(idx, cloud.points.size());
+        EXPECT_EQ(nr_chunks, (76800 + 7776) / 7777);
+        EXPECT_EQ(reader.readChunk(chunk), 0);
+        EXPECT_TRUE(chunk.points.empty());
+    }
+
+    reader.close();
+    EXPECT_FALSE(reader.hasNext());
+    EXPECT_LT(reader.readChunk(cloud), 0);
+
+    // binary_compressed data is decompressed when the file is opened
+    writer.writeBinaryCompressed("test_pcl_io_stream.pcd", cloud);
+    std::ifstream in("test_pcl_io_stream.pcd", std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)),
+                     std::istreambuf_iterator<char>());
+    in.close();
+    std::ofstream out("test_pcl_io_stream.pcd", std::ios::binary);
+    out.write(data.data(), data.size() / 2);
+    out.close();
+    EXPECT_LT(reader.open("test_pcl_io_stream.pcd"), 0);
+    EXPECT_FALSE(reader.isOpen());
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TEST(PCL, ASCIIParsing) {
+    const char *values[] = {"0",      "-1.5",     "+2.25e3",
+                            "1e-7",   "3.4e+38",  "1e-300",
+                            ".5",     "-0.00001", "7.",
+                            "12345678901234567"};
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+        const char *p = values[i], *end = p + strlen(p);
+        double d, d2;
+        float f, f2;
+        ASSERT_TRUE(pcl::io::parseNumber(p, end, d));
+        EXPECT_EQ(p, end);
+        p = values[i];
+        ASSERT_TRUE(pcl::io::parseNumber(p, end, f));
+        std::istringstream(values[i]) >> d2;
+        std::istringstream(values[i]) >> f2;
+        EXPECT_EQ(d, d2) << values[i];
+        EXPECT_EQ(f, f2) << values[i];
+    }
+
+    // Decimals whose nearest double lies exactly halfway between two floats:
+    // going through double would round them to the wrong float
+    const char *halfway[] = {"8.000000476837159", "8.000001430511474",
+                             "-8.000003337860107", "8.000004291534424"};
+    const float expected[] = {8.000000953674316f, 8.000000953674316f,
+                              -8.00000286102295f, 8.000004768371582f};
+    for (size_t i = 0; i < sizeof(halfway) / sizeof(halfway[0]); ++i) {
+        const char *p = halfway[i], *end = p + strlen(p);
+        float f;
+        ASSERT_TRUE(pcl::io::parseNumber(p, end, f));
+        EXPECT_EQ(p, end);
+        EXPECT_EQ(expected[i], f) << halfway[i];
+        EXPECT_EQ(strtof(halfway[i], NULL), f) << halfway[i];
+        EXPECT_NE(static_cast<float>(strtod(halfway[i], NULL)), f)
+            << halfway[i];
+    }
+
+    const char *bad = "abc", *p = bad;
+    float f;
+    EXPECT_FALSE(pcl::io::parseNumber(p, bad + 3, f));
+    const char *nan = "-nan", *q = nan;
+    EXPECT_TRUE(pcl::io::parseNumber(q, nan + 4, f));
+    EXPECT_TRUE(pcl_isnan(f));
+    const char *integer = "-17 ";
+    int i = 0;
+    p = integer;
+    EXPECT_TRUE(pcl::io::parseNumber(p, integer + 4, i));
+    EXPECT_EQ(i, -17);
+    EXPECT_EQ(*p, ' ');
+
+    // Integers which do not fit in the target type are rejected
+    const char *in_range[] = {"2147483647", "-2147483648", "255", "-0"};
+    const char *out_of_range[] = {"2147483648", "-2147483649",
+                                  "99999999999999999999999", "256", "-1"};
+    pcl::int32_t i32;
+    pcl::uint8_t u8;
+    p = in_range[0];
+    EXPECT_TRUE(pcl::io::parseNumber(p, p + strlen(p), i32));
+    EXPECT_EQ(i32, std::numeric_limits<pcl::int32_t>::max());
+    p = in_range[1];
+    EXPECT_TRUE(pcl::io::parseNumber(p, p + strlen(p), i32));
+    EXPECT_EQ(i32, std::numeric_limits<pcl::int32_t>::min());
+    p = in_range[2];
+    EXPECT_TRUE(pcl::io::parseNumber(p, p + strlen(p), u8));
+    EXPECT_EQ(u8, 255);
+    p = in_range[3];
+    EXPECT_TRUE(pcl::io::parseNumber(p, p + strlen(p), u8));
+    EXPECT_EQ(u8, 0);
+    for (size_t j = 0; j < 3; ++j) {
+        p = out_of_range[j];
+        EXPECT_FALSE(pcl::io::parseNumber(p, p + strlen(p), i32))
+            << out_of_range[j];
+    }
+    for (size_t j = 3; j < 5; ++j) {
+        p = out_of_range[j];
+        EXPECT_FALSE(pcl::io::parseNumber(p, p + strlen(p), u8))
+            << out_of_range[j];
+    }
+
+    // An ascii file large enough to be split between several threads, with
+    // empty lines and NaN values
+    PointCloud<PointXYZI> cloud;
+    cloud.width = 200000;
+    cloud.height = 1;
+    cloud.points.resize(cloud.width);
+    std::ofstream fs("test_pcl_io_ascii.pcd");
+    fs << "# .PCD v0.7 - Point Cloud Data file format\nVERSION 0.7\n"
+          "FIELDS x y z intensity\nSIZE 4 4 4 4\nTYPE F F F U\n"
+          "COUNT 1 1 1 1\nWIDTH 200000\nHEIGHT 1\n"
+          "VIEWPOINT 0 0 0 1 0 0 0\nPOINTS 200000\nDATA ascii\n";
+    for (size_t i = 0; i < cloud.points.size(); ++i) {
+        cloud.points[i].x = static_cast<float>(i) * 0.5f;
+        cloud.points[i].y = -static_cast<float>(i % 1000) * 0.25f;
+        cloud.points[i].z = i == 1234 ? std::numeric_limits<float>::quiet_NaN()
+                                      : 1.0f;
+        cloud.points[i].intensity = static_cast<float>(i);
+        fs << cloud.points[i].x << " " << cloud.points[i].y << "\t"
+           << (i == 1234 ? "nan" : "1") << " " << i << "\r\n";
+        if (i % 9999 == 0)
+            fs << "\n  \n";
+    }
+    fs.close();
+
+    PCDReader reader;
+    for (unsigned int threads = 1; threads <= 4; threads += 3) {
+        reader.setNumberOfThreads(threads);
+        sensor_msgs::PointCloud2 blob;
+        ASSERT_EQ(reader.read("test_pcl_io_ascii.pcd", blob), 0);
+        EXPECT_FALSE(blob.is_dense);
+        ASSERT_EQ(blob.width * blob.height, cloud.width);
+        for (size_t i = 0; i < cloud.points.size(); ++i) {
+            const pcl::uint8_t *pt = &blob.data[i * blob.point_step];
+            float x, y, z;
+            pcl::uint32_t intensity;
+            memcpy(&x, pt + blob.fields[0].offset, sizeof(float));
+            memcpy(&y, pt + blob.fields[1].offset, sizeof(float));
+            memcpy(&z, pt + blob.fields[2].offset, sizeof(float));
+            memcpy(&intensity, pt + blob.fields[3].offset, sizeof(intensity));
+            ASSERT_EQ(x, cloud.points[i].x);
+            ASSERT_EQ(y, cloud.points[i].y);
+            ASSERT_EQ(intensity, i);
+            if (i == 1234)
+                ASSERT_TRUE(pcl_isnan(z));
+            else
+                ASSERT_EQ(z, 1.0f);
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TEST(PCL, AsyncPCDWriter) {
+    PointCloud<PointXYZRGBA> cloud;
+    cloud.width = 640;
+    cloud.height = 48;
+    cloud.points.resize(cloud.width * cloud.height);
+    cloud.is_dense = true;
+    cloud.sensor_origin_ = Eigen::Vector4f(1.0f, 2.0f, 3.0f, 0.0f);
+
+    const int nr_frames = 20;
+    {
+        AsyncPCDWriter writer(4, 2);
+        EXPECT_EQ(writer.getOverflowPolicy(), AsyncPCDWriter::DROP_FRAME);
+        writer.setOverflowPolicy(AsyncPCDWriter::BLOCK);
+        for (int f = 0; f < nr_frames; ++f) {
+            for (size_t i = 0; i < cloud.points.size(); ++i) {
+                cloud.points[i].x = static_cast<float>(f);
+                cloud.points[i].y = static_cast<float>(i);
+                cloud.points[i].z = 1.0f;
+                cloud.points[i].rgba = static_cast<uint32_t>(f * 100 + i);
+            }
+            std::stringstream ss;
+            ss << "test_pcl_io_async_" << f << ".pcd";
+            if (f == nr_frames / 2)
+                writer.setFormat(AsyncPCDWriter::BINARY);
+            // The cloud is copied, so it can be modified right away
+            EXPECT_TRUE(writer.write(ss.str(), cloud));
+        }
+        writer.flush();
+        EXPECT_EQ(writer.getQueueSize(), 0u);
+        AsyncPCDWriter::Statistics stats = writer.getStatistics();
+        EXPECT_EQ(stats.submitted, static_cast<size_t>(nr_frames));
+        EXPECT_EQ(stats.written, static_cast<size_t>(nr_frames));
+        EXPECT_EQ(stats.dropped, 0u);
+        EXPECT_EQ(stats.failed, 0u);
+        EXPECT_LE(stats.max_queue_size, 4u);
+
+        // Frames for the same file are written one after the other, in
+        // order: the file holds the last one
+        writer.resetStatistics();
+        for (int f = 0; f < nr_frames; ++f) {
+            for (size_t i = 0; i < cloud.points.size(); ++i)
+                cloud.points[i].x = static_cast<float>(f);
+            EXPECT_TRUE(writer.write("test_pcl_io_async_same.pcd", cloud));
+        }
+        writer.flush();
+        stats = writer.getStatistics();
+        EXPECT_EQ(stats.written, static_cast<size_t>(nr_frames));
+        EXPECT_EQ(stats.failed, 0u);
+        PointCloud<PointXYZRGBA> last;
+        ASSERT_EQ(PCDReader().read("test_pcl_io_async_same.pcd", last), 0);
+        ASSERT_EQ(last.points.size(), cloud.points.size());
+        EXPECT_EQ(last.points[0].x, static_cast<float>(nr_frames - 1));
+        remove("test_pcl_io_async_same.pcd");
+
+        // Dropped frames are accounted for, and never written
+        writer.setOverflowPolicy(AsyncPCDWriter::DROP_FRAME);
+        writer.resetStatistics();
+        for (int f = 0; f < nr_frames; ++f) {
+            std::stringstream ss;
+            ss << "test_pcl_io_async_dropped_" << f << ".pcd";
+            writer.write(ss.str(), cloud);
+        }
+        writer.flush();
+        stats = writer.getStatistics();
+        EXPECT_EQ(stats.submitted, static_cast<size_t>(nr_frames));
+        EXPECT_EQ(stats.written + stats.dropped, stats.submitted);
+        EXPECT_EQ(stats.blocked, 0u);
+    }
+
+    PCDReader reader;
+    for (int f = 0; f < nr_frames; ++f) {
+        std::stringstream ss;
+        ss << "test_pcl_io_async_" << f << ".pcd";
+        PointCloud<PointXYZRGBA> frame;
+        ASSERT_EQ(reader.read(ss.str(), frame), 0);
+        ASSERT_EQ(frame.width, cloud.width);
+        ASSERT_EQ(frame.height, cloud.height);
+        EXPECT_EQ(frame.sensor_origin_, cloud.sensor_origin_);
+        for (size_t i = 0; i < frame.points.size(); ++i) {
+            ASSERT_EQ(frame.points[i].x, static_cast<float>(f));
+            ASSERT_EQ(frame.points[i].y, static_cast<float>(i));
+            ASSERT_EQ(frame.points[i].rgba, static_cast<uint32_t>(f * 100 + i));
+        }
+        remove(ss.str().c_str());
+        ss.str("");
+        ss << "test_pcl_io_async_dropped_" << f << ".pcd";
+        remove(ss.str().c_str());
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 TEST(PCL, Locale) {
 #ifndef __APPLE__
@@ -38,9 +38,12 @@
 
 #include <gtest/gtest.h>
 #include <iostream> // For debug
+#include <deque>
 #include <map>
 #include <pcl/common/time.h>
 #include <pcl/kdtree/kdtree_flann.h>
+#include <pcl/kdtree/kdtree_static.h>
+#include <pcl/kdtree/kdtree_dynamic.h>
 #include <pcl/point_cloud.h>
 #include <pcl/point_types.h>
 #include <pcl/common/distances.h>
@@ -61,6 +64,8 @@ PointCloud<Eigen::MatrixXf> cloud_eigen;
 
 // Includ the implementation so that KdTree<MyPoint> works
 #include <pcl/kdtree/impl/kdtree_flann.hpp>
+#include <pcl/kdtree/impl/kdtree_static.hpp>
+#include <pcl/kdtree/impl/kdtree_dynamic.hpp>
 
 void init() {
     float resolution = 0.1f;
@@ -401,6 +406,250 @@ TEST(PCL, KdTreeFLANN_setPointRepresentation) {
     }
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void expectSameNeighbors(const vector<int> &indices,
+                         const vector<float> &distances,
+                         const vector<int> &gt_indices,
+                         const vector<float> &gt_distances) {
+    EXPECT_EQ(indices, gt_indices);
+    ASSERT_EQ(distances.size(), gt_distances.size());
+    for (size_t i = 0; i < distances.size(); ++i)
+        EXPECT_NEAR(distances[i], gt_distances[i], 1e-4 * gt_distances[i]);
+}
+
+TEST(PCL, KdTreeStatic) {
+    // Uniformly distributed points, so that no two neighbors are at the same
+    // distance of a query
+    PointCloud<MyPoint>::Ptr random_cloud(new PointCloud<MyPoint>());
+    for (int i = 0; i < 100000; ++i)
+        random_cloud->points.push_back(
+            MyPoint(1024.0f * static_cast<float>(rand()) / RAND_MAX,
+                    1024.0f * static_cast<float>(rand()) / RAND_MAX,
+                    1024.0f * static_cast<float>(rand()) / RAND_MAX));
+
+    KdTreeFLANN<MyPoint> flann;
+    flann.setInputCloud(random_cloud);
+    KdTreeStatic<MyPoint> kdtree;
+    kdtree.setInputCloud(random_cloud);
+    EXPECT_EQ(kdtree.size(), int(random_cloud->points.size()));
+
+    vector<int> k_indices, flann_indices;
+    vector<float> k_distances, flann_distances;
+    for (size_t i = 0; i < random_cloud->points.size(); i += 97) {
+        const MyPoint &point = random_cloud->points[i];
+        flann.nearestKSearch(point, 20, flann_indices, flann_distances);
+        kdtree.nearestKSearch(point, 20, k_indices, k_distances);
+        expectSameNeighbors(k_indices, k_distances, flann_indices,
+                            flann_distances);
+
+        flann.radiusSearch(point, 50.0, flann_indices, flann_distances);
+        kdtree.radiusSearch(point, 50.0, k_indices, k_distances);
+        expectSameNeighbors(k_indices, k_distances, flann_indices,
+                            flann_distances);
+
+        flann.radiusSearch(point, 50.0, flann_indices, flann_distances, 5);
+        kdtree.radiusSearch(point, 50.0, k_indices, k_distances, 5);
+        expectSameNeighbors(k_indices, k_distances, flann_indices,
+                            flann_distances);
+    }
+
+    // Subsets and invalid points are left out of the tree
+    PointCloud<MyPoint>::Ptr sparse_cloud(new PointCloud<MyPoint>(cloud));
+    sparse_cloud->points[3].x = numeric_limits<float>::quiet_NaN();
+    boost::shared_ptr<vector<int>> indices(new vector<int>);
+    for (int i = 0; i < int(sparse_cloud->points.size()); i += 2)
+        indices->push_back(i);
+    kdtree.setInputCloud(sparse_cloud, indices);
+    EXPECT_EQ(kdtree.size(), int(indices->size()));
+    kdtree.nearestKSearch(MyPoint(0.0f, 0.0f, 0.0f), 1000, k_indices,
+                          k_distances);
+    EXPECT_EQ(k_indices.size(), indices->size());
+    for (size_t i = 0; i < k_indices.size(); ++i)
+        EXPECT_EQ(k_indices[i] % 2, 0);
+    EXPECT_EQ(kdtree.nearestKSearch(sparse_cloud->points[3], 1, k_indices,
+                                    k_distances),
+              0);
+
+    // Custom point representations
+    MyPoint p(50.0f, 50.0f, 50.0f);
+    DefaultPointRepresentation<MyPoint> point_rep;
+    float alpha[3] = {1.0f, 2.0f, 3.0f};
+    point_rep.setRescaleValues(alpha);
+    flann.setPointRepresentation(point_rep.makeShared());
+    kdtree.setPointRepresentation(point_rep.makeShared());
+    kdtree.setInputCloud(random_cloud);
+    flann.nearestKSearch(p, 10, flann_indices, flann_distances);
+    kdtree.nearestKSearch(p, 10, k_indices, k_distances);
+    expectSameNeighbors(k_indices, k_distances, flann_indices,
+                        flann_distances);
+
+    ScopeTime scopeTime("KdTreeStatic nearestKSearch");
+    {
+        KdTreeStatic<MyPoint> kdtree;
+        kdtree.setInputCloud(cloud_big.makeShared());
+        for (size_t i = 0; i < cloud_big.points.size(); ++i)
+            kdtree.nearestKSearch(cloud_big.points[i], 20, k_indices,
+                                  k_distances);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TEST(PCL, KdTreeDynamic) {
+    PointCloud<MyPoint>::Ptr random_cloud(new PointCloud<MyPoint>());
+    for (int i = 0; i < 50000; ++i)
+        random_cloud->points.push_back(
+            MyPoint(1024.0f * static_cast<float>(rand()) / RAND_MAX,
+                    1024.0f * static_cast<float>(rand()) / RAND_MAX,
+                    1024.0f * static_cast<float>(rand()) / RAND_MAX));
+    random_cloud->width = static_cast<uint32_t>(random_cloud->points.size());
+    random_cloud->height = 1;
+
+    // Build from the first points, then insert the others chunk by chunk
+    PointCloud<MyPoint>::Ptr first_points(new PointCloud<MyPoint>());
+    first_points->points.assign(random_cloud->points.begin(),
+                                random_cloud->points.begin() + 5000);
+    KdTreeDynamic<MyPoint> kdtree;
+    kdtree.setInputCloud(first_points);
+    for (size_t i = 5000; i < random_cloud->points.size(); i += 1500) {
+        PointCloud<MyPoint> chunk;
+        chunk.points.assign(
+            random_cloud->points.begin() + i,
+            random_cloud->points.begin() +
+                std::min(i + 1500, random_cloud->points.size()));
+        kdtree.addPoints(chunk);
+    }
+    EXPECT_EQ(kdtree.size(), int(random_cloud->points.size()));
+    EXPECT_EQ(kdtree.getInputCloud()->points.size(),
+              random_cloud->points.size());
+    EXPECT_LE(kdtree.getNumberOfTrees(), 16);
+
+    KdTreeStatic<MyPoint> ground_truth;
+    ground_truth.setInputCloud(random_cloud);
+    vector<int> k_indices, gt_indices;
+    vector<float> k_distances, gt_distances;
+    for (size_t i = 0; i < random_cloud->points.size(); i += 97) {
+        const MyPoint &point = random_cloud->points[i];
+        ground_truth.nearestKSearch(point, 20, gt_indices, gt_distances);
+        kdtree.nearestKSearch(point, 20, k_indices, k_distances);
+        expectSameNeighbors(k_indices, k_distances, gt_indices, gt_distances);
+
+        ground_truth.radiusSearch(point, 50.0, gt_indices, gt_distances);
+        kdtree.radiusSearch(point, 50.0, k_indices, k_distances);
+        expectSameNeighbors(k_indices, k_distances, gt_indices, gt_distances);
+    }
+
+    // Remove every third point and a box, the indices of the others do not
+    // change
+    vector<int> removed;
+    for (int i = 0; i < int(random_cloud->points.size()); i += 3)
+        removed.push_back(i);
+    EXPECT_EQ(kdtree.removeIndices(removed), int(removed.size()));
+    EXPECT_EQ(kdtree.removeIndices(removed), 0);
+    Eigen::Vector4f min_pt(0.0f, 0.0f, 0.0f, 0.0f);
+    Eigen::Vector4f max_pt(512.0f, 512.0f, 512.0f, 0.0f);
+    int nr_in_box = kdtree.removePointsInBox(min_pt, max_pt);
+    EXPECT_GT(nr_in_box, 0);
+
+    boost::shared_ptr<vector<int>> remaining(new vector<int>);
+    for (int i = 0; i < int(random_cloud->points.size()); ++i) {
+        const MyPoint &point = random_cloud->points[i];
+        if (i % 3 != 0 && (point.x > 512.0f || point.y > 512.0f ||
+                           point.z > 512.0f))
+            remaining->push_back(i);
+    }
+    EXPECT_EQ(kdtree.size(), int(remaining->size()));
+    ground_truth.setInputCloud(random_cloud, remaining);
+    for (size_t i = 0; i < random_cloud->points.size(); i += 97) {
+        const MyPoint &point = random_cloud->points[i];
+        ground_truth.nearestKSearch(point, 20, gt_indices, gt_distances);
+        kdtree.nearestKSearch(point, 20, k_indices, k_distances);
+        expectSameNeighbors(k_indices, k_distances, gt_indices, gt_distances);
+
+        ground_truth.radiusSearch(point, 50.0, gt_indices, gt_distances, 5);
+        kdtree.radiusSearch(point, 50.0, k_indices, k_distances, 5);
+        expectSameNeighbors(k_indices, k_distances, gt_indices, gt_distances);
+    }
+
+    // Removing everything leaves an empty tree
+    removed.resize(random_cloud->points.size());
+    for (int i = 0; i < int(removed.size()); ++i)
+        removed[i] = i;
+    EXPECT_EQ(kdtree.removeIndices(removed), int(remaining->size()));
+    EXPECT_EQ(kdtree.getNumberOfTrees(), 0);
+    EXPECT_EQ(kdtree.nearestKSearch(random_cloud->points[0], 1, k_indices,
+                                    k_distances),
+              0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+TEST(PCL, KdTreeDynamicReuse) {
+    // A sliding window of points: the removed points make room for the new
+    // ones, so the internal cloud stays bounded
+    const int window = 2000, step = 500;
+    PointCloud<MyPoint> points;
+    for (int i = 0; i < window; ++i)
+        points.push_back(
+            MyPoint(1024.0f * static_cast<float>(rand()) / RAND_MAX,
+                    1024.0f * static_cast<float>(rand()) / RAND_MAX,
+                    1024.0f * static_cast<float>(rand()) / RAND_MAX));
+    KdTreeDynamic<MyPoint> kdtree;
+    kdtree.setInputCloud(points.makeShared());
+
+    // The index of each live point, oldest first
+    std::deque<int> live;
+    for (int i = 0; i < window; ++i)
+        live.push_back(i);
+    vector<int> indices;
+    for (int iteration = 0; iteration < 100; ++iteration) {
+        vector<int> removed(live.begin(), live.begin() + step);
+        live.erase(live.begin(), live.begin() + step);
+        EXPECT_EQ(step, kdtree.removeIndices(removed));
+
+        PointCloud<MyPoint> chunk;
+        for (int i = 0; i < step; ++i)
+            chunk.push_back(
+                MyPoint(1024.0f * static_cast<float>(rand()) / RAND_MAX,
+                        1024.0f * static_cast<float>(rand()) / RAND_MAX,
+                        1024.0f * static_cast<float>(rand()) / RAND_MAX));
+        kdtree.addPoints(chunk, indices);
+        ASSERT_EQ(chunk.size(), indices.size());
+        for (int i = 0; i < step; ++i) {
+            // The new points are stored at the returned indices
+            const MyPoint &point = kdtree.getInputCloud()->points[indices[i]];
+            EXPECT_EQ(chunk.points[i].x, point.x);
+            EXPECT_EQ(chunk.points[i].y, point.y);
+            EXPECT_EQ(chunk.points[i].z, point.z);
+            live.push_back(indices[i]);
+        }
+
+        EXPECT_EQ(window, kdtree.size());
+        EXPECT_LE(kdtree.getInputCloud()->size(), size_t(2 * window));
+        EXPECT_LE(kdtree.getInputCloud()->points.capacity(),
+                  size_t(4 * window));
+    }
+
+    // Same neighbors as a static tree over the live points
+    boost::shared_ptr<vector<int>> remaining(
+        new vector<int>(live.begin(), live.end()));
+    std::sort(remaining->begin(), remaining->end());
+    EXPECT_TRUE(std::adjacent_find(remaining->begin(), remaining->end()) ==
+                remaining->end());
+    KdTreeStatic<MyPoint> ground_truth;
+    ground_truth.setInputCloud(kdtree.getInputCloud(), remaining);
+    vector<int> k_indices, gt_indices;
+    vector<float> k_distances, gt_distances;
+    for (size_t i = 0; i < remaining->size(); i += 37) {
+        const MyPoint &point = kdtree.getInputCloud()->points[(*remaining)[i]];
+        ground_truth.nearestKSearch(point, 20, gt_indices, gt_distances);
+        kdtree.nearestKSearch(point, 20, k_indices, k_distances);
+        expectSameNeighbors(k_indices, k_distances, gt_indices, gt_distances);
+
+        ground_truth.radiusSearch(point, 100.0, gt_indices, gt_distances);
+        kdtree.radiusSearch(point, 100.0, k_indices, k_distances);
+        expectSameNeighbors(k_indices, k_distances, gt_indices, gt_distances);
+    }
+}
+
 /* ---[ */
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
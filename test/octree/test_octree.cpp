@@ -36,6 +36,8 @@
 #include <gtest/gtest.h>
 
 #include <vector>
+#include <set>
+#include <map>
 
 #include <stdio.h>
 
@@ -625,6 +627,121 @@ TEST(PCL, Octree2Buf_Base_Double_Buffering_XOR_Test) {
     }
 }
 
+TEST(PCL, Octree2Buf_Base_Change_Serialization_Test) {
+
+    typedef Octree2BufBase<int, OctreeContainerDataTVector<int>> OctreeT;
+    typedef std::map<unsigned int, std::vector<int>> VoxelMap;
+
+    // create octree instances
+    OctreeT octreeA;
+    OctreeT octreeB;
+
+    octreeA.setTreeDepth(5);
+    octreeB.setTreeDepth(5);
+
+    std::vector<char> diffBinary;
+    std::vector<int> newData;
+    std::vector<int> changedData;
+    std::vector<OctreeKey> removedKeysA;
+    std::vector<OctreeKey> newKeysB;
+    std::vector<OctreeKey> removedKeysB;
+
+    std::vector<char> treeBinaryA;
+    std::vector<char> treeBinaryB;
+
+    VoxelMap prevVoxels;
+    VoxelMap voxels;
+
+    const std::size_t minSizeChange = 2;
+    const unsigned int test_runs = 15;
+    unsigned int i, j;
+
+    srand(static_cast<unsigned int>(time(NULL)));
+
+    for (j = 0; j < test_runs; j++) {
+        octreeA.switchBuffers();
+        octreeB.switchBuffers();
+
+        prevVoxels.swap(voxels);
+        voxels.clear();
+
+        // fill a 16^3 corner of the tree so that voxels overlap between
+        // frames and their point counts vary
+        for (i = 0; i < 2000; i++) {
+            unsigned int x = rand() % 16;
+            unsigned int y = rand() % 16;
+            unsigned int z = rand() % 16;
+            int data = static_cast<int>(j * 10000 + i);
+
+            octreeA.addData(x, y, z, data);
+            voxels[(x << 10) | (y << 5) | z].push_back(data);
+        }
+
+        octreeA.serializeChanges(diffBinary, newData, changedData,
+                                 removedKeysA, minSizeChange);
+
+        // brute force reference
+        std::multiset<int> expectedNewData;
+        std::multiset<int> expectedChangedData;
+        std::set<unsigned int> expectedNewKeys;
+        std::set<unsigned int> expectedRemovedKeys;
+
+        VoxelMap::const_iterator it;
+        for (it = voxels.begin(); it != voxels.end(); ++it) {
+            VoxelMap::const_iterator prevIt = prevVoxels.find(it->first);
+            if (prevIt == prevVoxels.end()) {
+                expectedNewKeys.insert(it->first);
+                expectedNewData.insert(it->second.begin(), it->second.end());
+            } else {
+                std::size_t size = it->second.size();
+                std::size_t prevSize = prevIt->second.size();
+                if (((size > prevSize) ? size - prevSize : prevSize - size) >=
+                    minSizeChange)
+                    expectedChangedData.insert(it->second.begin(),
+                                               it->second.end());
+            }
+        }
+        for (it = prevVoxels.begin(); it != prevVoxels.end(); ++it)
+            if (voxels.find(it->first) == voxels.end())
+                expectedRemovedKeys.insert(it->first);
+
+        ASSERT_EQ(expectedNewData,
+                  std::multiset<int>(newData.begin(), newData.end()));
+        ASSERT_EQ(expectedChangedData,
+                  std::multiset<int>(changedData.begin(), changedData.end()));
+
+        std::set<unsigned int> removedKeySet;
+        for (i = 0; i < removedKeysA.size(); i++)
+            removedKeySet.insert((removedKeysA[i].x << 10) |
+                                 (removedKeysA[i].y << 5) | removedKeysA[i].z);
+        ASSERT_EQ(removedKeysA.size(), expectedRemovedKeys.size());
+        ASSERT_EQ(expectedRemovedKeys, removedKeySet);
+
+        // rebuild the tree from the diff
+        octreeB.deserializeChanges(diffBinary, newKeysB, removedKeysB);
+
+        std::set<unsigned int> newKeySet;
+        for (i = 0; i < newKeysB.size(); i++)
+            newKeySet.insert((newKeysB[i].x << 10) | (newKeysB[i].y << 5) |
+                             newKeysB[i].z);
+        removedKeySet.clear();
+        for (i = 0; i < removedKeysB.size(); i++)
+            removedKeySet.insert((removedKeysB[i].x << 10) |
+                                 (removedKeysB[i].y << 5) | removedKeysB[i].z);
+
+        ASSERT_EQ(expectedNewKeys, newKeySet);
+        ASSERT_EQ(expectedRemovedKeys, removedKeySet);
+
+        // check if octree structure is consistent
+        ASSERT_EQ(octreeA.getLeafCount(), octreeB.getLeafCount());
+        ASSERT_EQ(voxels.size(), octreeB.getLeafCount());
+
+        octreeA.serializeTree(treeBinaryA, false);
+        octreeB.serializeTree(treeBinaryB, false);
+        ASSERT_EQ(treeBinaryA, treeBinaryB);
+    }
+}
+
 TEST(PCL, Octree_Pointcloud_Test) {
 
     size_t i;
@@ -839,6 +956,172 @@ TEST(PCL, Octree_Pointcloud_Density_Test) {
                           static_cast<unsigned int>(1));
 }
 
+TEST(PCL, Octree_Pointcloud_Bulk_Insertion_Test) {
+    typedef OctreePointCloudPointVector<PointXYZ>::IndicesPtr IndicesPtr;
+
+    // instantiate point cloud
+    PointCloud<PointXYZ>::Ptr cloudIn(new PointCloud<PointXYZ>());
+
+    size_t i;
+
+    srand(static_cast<unsigned int>(time(NULL)));
+
+    cloudIn->width = 20000;
+    cloudIn->height = 1;
+    cloudIn->points.resize(cloudIn->width * cloudIn->height);
+
+    // generate point cloud data, the bounding box growing in all directions
+    // while the points are inserted
+    for (i = 0; i < cloudIn->points.size(); i++) {
+        const double scale = 0.1 + 20.0 * static_cast<double>(i) /
+                                       static_cast<double>(cloudIn->size());
+        cloudIn->points[i] =
+            PointXYZ(static_cast<float>(scale * (rand() - 0.5 * RAND_MAX) /
+                                        RAND_MAX),
+                     static_cast<float>(scale * rand() / RAND_MAX - 0.3),
+                     static_cast<float>(scale * (0.3 * RAND_MAX - rand()) /
+                                        RAND_MAX));
+    }
+    // points sharing voxels and non finite points
+    for (i = 0; i < cloudIn->points.size(); i += 100)
+        cloudIn->points[i + 1] = cloudIn->points[i];
+    for (i = 50; i < cloudIn->points.size(); i += 1000)
+        cloudIn->points[i].y = std::numeric_limits<float>::quiet_NaN();
+
+    // octree filled point by point
+    OctreePointCloudPointVector<PointXYZ> octreeA(0.1);
+    octreeA.setInputCloud(cloudIn);
+    for (i = 0; i < cloudIn->points.size(); i++)
+        if (isFinite(cloudIn->points[i]))
+            octreeA.addPointFromCloud(static_cast<int>(i),
+                                      IndicesPtr());
+
+    // octree filled in bulk
+    OctreePointCloudPointVector<PointXYZ> octreeB(0.1);
+    octreeB.setNumberOfThreads(4);
+    octreeB.setInputCloud(cloudIn);
+    octreeB.addPointsFromInputCloud();
+
+    double minA[3], maxA[3], minB[3], maxB[3];
+    octreeA.getBoundingBox(minA[0], minA[1], minA[2], maxA[0], maxA[1],
+                           maxA[2]);
+    octreeB.getBoundingBox(minB[0], minB[1], minB[2], maxB[0], maxB[1],
+                           maxB[2]);
+    for (i = 0; i < 3; i++) {
+        EXPECT_EQ(minA[i], minB[i]);
+        EXPECT_EQ(maxA[i], maxB[i]);
+    }
+    EXPECT_EQ(octreeA.getTreeDepth(), octreeB.getTreeDepth());
+    EXPECT_EQ(octreeA.getLeafCount(), octreeB.getLeafCount());
+    EXPECT_EQ(octreeA.getBranchCount(), octreeB.getBranchCount());
+
+    // same structure, same point indices in the same order
+    std::vector<char> treeBinaryA, treeBinaryB;
+    std::vector<int> leafVectorA, leafVectorB;
+    octreeA.serializeTree(treeBinaryA, leafVectorA);
+    octreeB.serializeTree(treeBinaryB, leafVectorB);
+    EXPECT_EQ(treeBinaryA, treeBinaryB);
+    EXPECT_EQ(leafVectorA, leafVectorB);
+
+    // a subset of the points, in a predefined bounding box
+    IndicesPtr indices(new std::vector<int>());
+    for (i = 0; i < cloudIn->points.size(); i += 3)
+        indices->push_back(static_cast<int>(i));
+
+    OctreePointCloudPointVector<PointXYZ> octreeC(0.1);
+    octreeC.defineBoundingBox(-1.0, -1.0, -1.0, 1.0, 1.0, 1.0);
+    octreeC.setInputCloud(cloudIn);
+    for (i = 0; i < indices->size(); i++)
+        if (isFinite(cloudIn->points[(*indices)[i]]))
+            octreeC.addPointFromCloud((*indices)[i], IndicesPtr());
+
+    OctreePointCloudPointVector<PointXYZ> octreeD(0.1);
+    octreeD.setNumberOfThreads(4);
+    octreeD.defineBoundingBox(-1.0, -1.0, -1.0, 1.0, 1.0, 1.0);
+    octreeD.setInputCloud(cloudIn, indices);
+    octreeD.addPointsFromInputCloud();
+
+    octreeC.serializeTree(treeBinaryA, leafVectorA);
+    octreeD.serializeTree(treeBinaryB, leafVectorB);
+    EXPECT_EQ(treeBinaryA, treeBinaryB);
+    EXPECT_EQ(leafVectorA, leafVectorB);
+
+    // voxel centroids are accumulated in the same order
+    OctreePointCloudVoxelCentroid<PointXYZ> centroidOctreeA(0.1);
+    centroidOctreeA.setInputCloud(cloudIn);
+    for (i = 0; i < cloudIn->points.size(); i++)
+        if (isFinite(cloudIn->points[i]))
+            centroidOctreeA.addPointFromCloud(static_cast<int>(i),
+                                              IndicesPtr());
+
+    OctreePointCloudVoxelCentroid<PointXYZ> centroidOctreeB(0.1);
+    centroidOctreeB.setNumberOfThreads(4);
+    centroidOctreeB.setInputCloud(cloudIn);
+    centroidOctreeB.addPointsFromInputCloud();
+
+    pcl::PointCloud<PointXYZ>::VectorType centroidsA, centroidsB;
+    centroidOctreeA.getVoxelCentroids(centroidsA);
+    centroidOctreeB.getVoxelCentroids(centroidsB);
+    ASSERT_EQ(centroidsA.size(), centroidsB.size());
+    for (i = 0; i < centroidsA.size(); i++) {
+        EXPECT_EQ(centroidsA[i].x, centroidsB[i].x);
+        EXPECT_EQ(centroidsA[i].y, centroidsB[i].y);
+        EXPECT_EQ(centroidsA[i].z, centroidsB[i].z);
+    }
+
+    // voxel densities
+    OctreePointCloudDensity<PointXYZ> densityOctreeA(0.1);
+    densityOctreeA.setInputCloud(cloudIn);
+    for (i = 0; i < cloudIn->points.size(); i++)
+        if (isFinite(cloudIn->points[i]))
+            densityOctreeA.addPointFromCloud(static_cast<int>(i),
+                                             IndicesPtr());
+
+    OctreePointCloudDensity<PointXYZ> densityOctreeB(0.1);
+    densityOctreeB.setNumberOfThreads(4);
+    densityOctreeB.setInputCloud(cloudIn);
+    densityOctreeB.addPointsFromInputCloud();
+
+    densityOctreeA.serializeTree(treeBinaryA);
+    densityOctreeB.serializeTree(treeBinaryB);
+    EXPECT_EQ(treeBinaryA, treeBinaryB);
+    for (i = 0; i < cloudIn->points.size(); i += 7)
+        if (isFinite(cloudIn->points[i]))
+            EXPECT_EQ(
+                densityOctreeA.getVoxelDensityAtPoint(cloudIn->points[i]),
+                densityOctreeB.getVoxelDensityAtPoint(cloudIn->points[i]));
+
+    // double buffered octrees, filled in bulk after a buffer switch
+    OctreePointCloudChangeDetector<PointXYZ> changeOctreeA(0.1);
+    OctreePointCloudChangeDetector<PointXYZ> changeOctreeB(0.1);
+    changeOctreeB.setNumberOfThreads(4);
+    changeOctreeA.setInputCloud(cloudIn, indices);
+    changeOctreeB.setInputCloud(cloudIn, indices);
+    changeOctreeA.addPointsFromInputCloud();
+    changeOctreeB.addPointsFromInputCloud();
+    changeOctreeA.switchBuffers();
+    changeOctreeB.switchBuffers();
+
+    changeOctreeA.setInputCloud(cloudIn);
+    for (i = 0; i < cloudIn->points.size(); i++)
+        if (isFinite(cloudIn->points[i]))
+            changeOctreeA.addPointFromCloud(static_cast<int>(i),
+                                            IndicesPtr());
+    changeOctreeB.setInputCloud(cloudIn);
+    changeOctreeB.addPointsFromInputCloud();
+
+    std::vector<int> newPointIdxVectorA, newPointIdxVectorB;
+    changeOctreeA.getPointIndicesFromNewVoxels(newPointIdxVectorA);
+    changeOctreeB.getPointIndicesFromNewVoxels(newPointIdxVectorB);
+    EXPECT_FALSE(newPointIdxVectorA.empty());
+    EXPECT_EQ(newPointIdxVectorA, newPointIdxVectorB);
+
+    changeOctreeA.serializeTree(treeBinaryA, leafVectorA);
+    changeOctreeB.serializeTree(treeBinaryB, leafVectorB);
+    EXPECT_EQ(treeBinaryA, treeBinaryB);
+    EXPECT_EQ(leafVectorA, leafVectorB);
+}
+
 TEST(PCL, Octree_Pointcloud_Iterator_Test) {
     // instantiate point cloud and fill it with point data
 
@@ -959,6 +1242,121 @@ TEST(PCL, Octree_Pointcloud_Occupancy_Test) {
     }
 }
 
+TEST(PCL, Octree_Pointcloud_Leaf_Index_Test) {
+    // instantiate point cloud
+    PointCloud<PointXYZ>::Ptr cloudIn(new PointCloud<PointXYZ>());
+
+    size_t i, j;
+
+    srand(static_cast<unsigned int>(time(NULL)));
+
+    cloudIn->width = 5000;
+    cloudIn->height = 1;
+    cloudIn->points.resize(cloudIn->width * cloudIn->height);
+
+    // generate point cloud data
+    for (i = 0; i < cloudIn->points.size(); i++) {
+        cloudIn->points[i] =
+            PointXYZ(static_cast<float>(4.0 * rand() / RAND_MAX),
+                     static_cast<float>(4.0 * rand() / RAND_MAX),
+                     static_cast<float>(2.0 * rand() / RAND_MAX));
+    }
+
+    // the index is enabled before the octree grows point by point
+    OctreePointCloudSearch<PointXYZ> octreeA(0.25);
+    OctreePointCloudSearch<PointXYZ> octreeB(0.25);
+    octreeB.enableLeafIndex();
+    EXPECT_TRUE(octreeB.leafIndexEnabled());
+
+    octreeA.setInputCloud(cloudIn);
+    octreeA.addPointsFromInputCloud();
+    octreeB.setInputCloud(cloudIn);
+    for (i = 0; i < cloudIn->points.size(); i++)
+        octreeB.addPointFromCloud(
+            static_cast<int>(i),
+            OctreePointCloudSearch<PointXYZ>::IndicesPtr());
+
+    // remove some voxels
+    for (i = 0; i < cloudIn->points.size(); i += 10) {
+        octreeA.deleteVoxelAtPoint(cloudIn->points[i]);
+        octreeB.deleteVoxelAtPoint(cloudIn->points[i]);
+    }
+    EXPECT_EQ(octreeA.getLeafCount(), octreeB.getLeafCount());
+
+    // copies, depth first relayout and deserialization keep the index
+    OctreePointCloudSearch<PointXYZ> octreeC(octreeB);
+    OctreePointCloudSearch<PointXYZ> octreeD(octreeB);
+    octreeD.sortNodesDepthFirst();
+
+    std::vector<char> treeBinary;
+    std::vector<int> leafVector;
+    octreeB.serializeTree(treeBinary, leafVector);
+    OctreePointCloudSearch<PointXYZ> octreeE(octreeB);
+    octreeE.deserializeTree(treeBinary, leafVector);
+
+    double minX, minY, minZ, maxX, maxY, maxZ;
+    octreeA.getBoundingBox(minX, minY, minZ, maxX, maxY, maxZ);
+
+    std::vector<int> voxelA, voxelB;
+    for (i = 0; i < 1000; i++) {
+        // query points inside and outside of the bounding box
+        const PointXYZ queryPoint(
+            static_cast<float>(6.0 * rand() / RAND_MAX - 1.0),
+            static_cast<float>(6.0 * rand() / RAND_MAX - 1.0),
+            static_cast<float>(3.0 * rand() / RAND_MAX - 0.5));
+        const bool occupied = octreeA.isVoxelOccupiedAtPoint(queryPoint);
+        EXPECT_EQ(octreeB.isVoxelOccupiedAtPoint(queryPoint), occupied);
+        EXPECT_EQ(octreeC.isVoxelOccupiedAtPoint(queryPoint), occupied);
+        EXPECT_EQ(octreeD.isVoxelOccupiedAtPoint(queryPoint), occupied);
+        EXPECT_EQ(octreeE.isVoxelOccupiedAtPoint(queryPoint), occupied);
+
+        const PointXYZ &point = cloudIn->points[i];
+        voxelA.clear();
+        voxelB.clear();
+        EXPECT_EQ(octreeA.voxelSearch(point, voxelA),
+                  octreeB.voxelSearch(point, voxelB));
+        EXPECT_EQ(voxelA, voxelB);
+
+        // points within the 3x3x3 voxels around the point
+        std::vector<int> neighbors;
+        for (j = 0; j < cloudIn->points.size(); j++) {
+            if (!octreeA.isVoxelOccupiedAtPoint(cloudIn->points[j]))
+                continue;
+            const PointXYZ &candidate = cloudIn->points[j];
+            const double res = octreeA.getResolution();
+            if ((std::abs(floor((candidate.x - minX) / res) -
+                          floor((point.x - minX) / res)) <= 1.0) &&
+                (std::abs(floor((candidate.y - minY) / res) -
+                          floor((point.y - minY) / res)) <= 1.0) &&
+                (std::abs(floor((candidate.z - minZ) / res) -
+                          floor((point.z - minZ) / res)) <= 1.0))
+                neighbors.push_back(static_cast<int>(j));
+        }
+
+        octreeA.voxelNeighborSearch(point, 1, voxelA);
+        octreeB.voxelNeighborSearch(point, 1, voxelB);
+        std::sort(voxelA.begin(), voxelA.end());
+        std::sort(voxelB.begin(), voxelB.end());
+        EXPECT_EQ(voxelA, neighbors);
+        EXPECT_EQ(voxelB, neighbors);
+    }
+
+    // the index follows voxels set and removed one by one
+    OctreePointCloudOccupancy<PointXYZ> occupancyOctree(0.1);
+    occupancyOctree.enableLeafIndex();
+    occupancyOctree.defineBoundingBox(0.0, 0.0, 0.0, 4.0, 4.0, 4.0);
+    for (i = 0; i < cloudIn->points.size(); i++) {
+        occupancyOctree.setOccupiedVoxelAtPoint(cloudIn->points[i]);
+        ASSERT_TRUE(occupancyOctree.isVoxelOccupiedAtPoint(cloudIn->points[i]));
+    }
+    for (i = 0; i < cloudIn->points.size(); i++) {
+        occupancyOctree.deleteVoxelAtPoint(cloudIn->points[i]);
+        ASSERT_FALSE(
+            occupancyOctree.isVoxelOccupiedAtPoint(cloudIn->points[i]));
+    }
+    EXPECT_EQ(occupancyOctree.getLeafCount(), 0u);
+}
+
 TEST(PCL, Octree_Pointcloud_Change_Detector_Test) {
     // instantiate point cloud
 
@@ -1015,6 +1413,43 @@ TEST(PCL, Octree_Pointcloud_Change_Detector_Test) {
     for (i = 0; i < 1000; i++) {
         ASSERT_EQ((newPointIdxVector[i] >= 1000), true);
     }
+
+    // compare buffers in a single pass - same points, nothing changed
+    vector<int> changedPointIdxVector;
+    OctreePointCloudChangeDetector<PointXYZ>::AlignedPointTVector
+        removedVoxelCenters;
+    vector<char> diffBinary;
+
+    octree.switchBuffers();
+    octree.addPointsFromInputCloud();
+
+    octree.getPointIndicesFromChangedVoxels(newPointIdxVector,
+                                            changedPointIdxVector,
+                                            removedVoxelCenters, diffBinary);
+
+    ASSERT_EQ(newPointIdxVector.size(), static_cast<std::size_t>(0));
+    ASSERT_EQ(changedPointIdxVector.size(), static_cast<std::size_t>(0));
+    ASSERT_EQ(removedVoxelCenters.size(), static_cast<std::size_t>(0));
+
+    // keep only the additional points - the voxels of the first 1000 points
+    // are removed
+    std::size_t leafCount = octree.getLeafCount();
+    octree.switchBuffers();
+    for (i = 1000; i < 2000; i++)
+        octree.addPointFromCloud(static_cast<int>(i), IndicesPtr());
+
+    octree.getPointIndicesFromChangedVoxels(newPointIdxVector,
+                                            changedPointIdxVector,
+                                            removedVoxelCenters, diffBinary);
+
+    ASSERT_EQ(newPointIdxVector.size(), static_cast<std::size_t>(0));
+    ASSERT_EQ(changedPointIdxVector.size(), static_cast<std::size_t>(0));
+
+    ASSERT_EQ(removedVoxelCenters.size(), leafCount - octree.getLeafCount());
+    for (i = 0; i < removedVoxelCenters.size(); i++) {
+        ASSERT_EQ((removedVoxelCenters[i].x < 10.0f), true);
+        ASSERT_EQ(octree.isVoxelOccupiedAtPoint(removedVoxelCenters[i]), false);
+    }
 }
 
 TEST(PCL, Octree_Pointcloud_Voxel_Centroid_Test) {
@@ -1462,6 +1897,80 @@ TEST(PCL, Octree_Pointcloud_Neighbours_Within_Radius_Search) {
     }
 }
 
+TEST(PCL, Octree_Pointcloud_Node_Layout_Test) {
+    // instantiate point cloud
+    PointCloud<PointXYZ>::Ptr cloudIn(new PointCloud<PointXYZ>());
+
+    size_t i;
+
+    srand(static_cast<unsigned int>(time(NULL)));
+
+    cloudIn->width = 10000;
+    cloudIn->height = 1;
+    cloudIn->points.resize(cloudIn->width * cloudIn->height);
+
+    // generate point cloud data
+    for (i = 0; i < cloudIn->points.size(); i++) {
+        cloudIn->points[i] =
+            PointXYZ(static_cast<float>(10.0 * rand() / RAND_MAX),
+                     static_cast<float>(10.0 * rand() / RAND_MAX),
+                     static_cast<float>(5.0 * rand() / RAND_MAX));
+    }
+
+    OctreePointCloudSearch<PointXYZ> octree(0.05);
+
+    // build octree
+    octree.setInputCloud(cloudIn);
+    octree.addPointsFromInputCloud();
+
+    // every allocated node is in use
+    EXPECT_EQ(octree.getNumberOfAllocatedNodes(),
+              octree.getLeafCount() + octree.getBranchCount());
+
+    // removed voxels stay allocated for reuse
+    for (i = 0; i < cloudIn->points.size(); i += 10)
+        octree.deleteVoxelAtPoint(cloudIn->points[i]);
+    std::size_t leafCount = octree.getLeafCount();
+    std::size_t branchCount = octree.getBranchCount();
+    EXPECT_GT(octree.getNumberOfAllocatedNodes(), leafCount + branchCount);
+
+    vector<vector<int>> radiusSearchResults(100);
+    vector<float> cloudNWRRadius;
+    for (i = 0; i < radiusSearchResults.size(); i++)
+        octree.radiusSearch(cloudIn->points[i], 0.5, radiusSearchResults[i],
+                            cloudNWRRadius);
+
+    // the depth first layout releases the unused nodes and keeps the octree
+    // structure
+    octree.sortNodesDepthFirst();
+    EXPECT_EQ(octree.getLeafCount(), leafCount);
+    EXPECT_EQ(octree.getBranchCount(), branchCount);
+    EXPECT_EQ(octree.getNumberOfAllocatedNodes(), leafCount + branchCount);
+
+    OctreePointCloudSearch<PointXYZ> octreeCopy(octree);
+    EXPECT_EQ(octreeCopy.getNumberOfAllocatedNodes(), leafCount + branchCount);
+
+    vector<int> cloudNWRSearch;
+    for (i = 0; i < radiusSearchResults.size(); i++) {
+        octree.radiusSearch(cloudIn->points[i], 0.5, cloudNWRSearch,
+                            cloudNWRRadius);
+        EXPECT_EQ(cloudNWRSearch, radiusSearchResults[i]);
+
+        octreeCopy.radiusSearch(cloudIn->points[i], 0.5, cloudNWRSearch,
+                                cloudNWRRadius);
+        EXPECT_EQ(cloudNWRSearch, radiusSearchResults[i]);
+    }
+
+    // releasing all the nodes leaves an empty octree, ready to be rebuilt
+    octree.deleteTree(true);
+    EXPECT_EQ(octree.getLeafCount(), 0u);
+    EXPECT_EQ(octree.getNumberOfAllocatedNodes(), 1u);
+    octree.setInputCloud(cloudIn);
+    octree.addPointsFromInputCloud();
+    EXPECT_EQ(octree.getNumberOfAllocatedNodes(),
+              octree.getLeafCount() + octree.getBranchCount());
+}
+
 TEST(PCL, Octree_Pointcloud_Ray_Traversal) {
 
     const unsigned int test_runs = 100;
@@ -1543,6 +2052,160 @@ TEST(PCL, Octree_Pointcloud_Ray_Traversal) {
     }
 }
 
+TEST(PCL, Octree_Pointcloud_Frustum_Search) {
+    PointCloud<PointXYZ>::Ptr cloudIn(new PointCloud<PointXYZ>());
+    cloudIn->width = 5000;
+    cloudIn->height = 1;
+    cloudIn->points.resize(cloudIn->width * cloudIn->height);
+    srand(static_cast<unsigned int>(time(NULL)));
+    for (size_t i = 0; i < cloudIn->points.size(); i++)
+        cloudIn->points[i] =
+            PointXYZ(static_cast<float>(10.0 * rand() / RAND_MAX),
+                     static_cast<float>(10.0 * rand() / RAND_MAX),
+                     static_cast<float>(10.0 * rand() / RAND_MAX));
+
+    OctreePointCloudSearch<PointXYZ> octree(0.25);
+    octree.setInputCloud(cloudIn);
+    octree.addPointsFromInputCloud();
+    double minX, minY, minZ, maxX, maxY, maxZ;
+    octree.getBoundingBox(minX, minY, minZ, maxX, maxY, maxZ);
+
+    // The voxel of a point, or of a voxel center
+    struct {
+        double minX, minY, minZ;
+        std::vector<int> operator()(const PointXYZ &pt) const {
+            std::vector<int> voxel(3);
+            voxel[0] = static_cast<int>(floor((pt.x - minX) / 0.25));
+            voxel[1] = static_cast<int>(floor((pt.y - minY) / 0.25));
+            voxel[2] = static_cast<int>(floor((pt.z - minZ) / 0.25));
+            return (voxel);
+        }
+    } getVoxel = {minX, minY, minZ};
+
+    for (unsigned int test_id = 0; test_id < 30; test_id++) {
+        // Random pyramid with its apex around the cloud, looking inside
+        const Eigen::Vector3f apex(
+            static_cast<float>(-2.0 + 14.0 * rand() / RAND_MAX),
+            static_cast<float>(-2.0 + 14.0 * rand() / RAND_MAX), -3.0f);
+        OctreePointCloudSearch<PointXYZ>::PlaneVector planes;
+        for (int i = 0; i < 4; ++i) {
+            Eigen::Vector3f normal(
+                static_cast<float>(1.0 * rand() / RAND_MAX) - 0.5f,
+                static_cast<float>(1.0 * rand() / RAND_MAX) - 0.5f, 1.0f);
+            normal((i & 1) ? 1 : 0) = (i & 2) ? 1.0f : -1.0f;
+            planes.push_back(
+                Eigen::Vector4f(normal(0), normal(1), normal(2),
+                                -normal.dot(apex)));
+        }
+        planes.push_back(Eigen::Vector4f(0.0f, 0.0f, -1.0f,
+                                         static_cast<float>(
+                                             2.0 + 8.0 * rand() / RAND_MAX)));
+
+        std::vector<int> k_indices;
+        octree.frustumSearch(planes, k_indices);
+        std::vector<bool> found(cloudIn->points.size(), false);
+        for (size_t i = 0; i < k_indices.size(); ++i) {
+            ASSERT_FALSE(found[k_indices[i]]);
+            found[k_indices[i]] = true;
+        }
+
+        // Compare with the test of every point, and check that the voxels
+        // returned contain all the points found
+        OctreePointCloudSearch<PointXYZ>::AlignedPointTVector voxelCenters;
+        octree.frustumSearch(planes, voxelCenters);
+        std::set<std::vector<int>> voxels;
+        for (size_t i = 0; i < voxelCenters.size(); ++i)
+            voxels.insert(getVoxel(voxelCenters[i]));
+        EXPECT_EQ(voxels.size(), voxelCenters.size());
+
+        for (size_t i = 0; i < cloudIn->points.size(); i++) {
+            const PointXYZ &pt = cloudIn->points[i];
+            bool inside = true;
+            for (size_t j = 0; j < planes.size(); ++j)
+                inside = inside && planes[j](0) * pt.x + planes[j](1) * pt.y +
+                                           planes[j](2) * pt.z + planes[j](3) >
+                                       0.0f;
+            ASSERT_EQ(found[i], inside);
+            if (inside)
+                ASSERT_EQ(voxels.count(getVoxel(pt)), 1u);
+        }
+    }
+}
+
+TEST(PCL, Octree_Pointcloud_Ray_Batch) {
+    PointCloud<PointXYZ>::Ptr cloudIn(new PointCloud<PointXYZ>());
+    cloudIn->width = 20000;
+    cloudIn->height = 1;
+    cloudIn->points.resize(cloudIn->width * cloudIn->height);
+    srand(0);
+    for (size_t i = 0; i < cloudIn->points.size(); i++)
+        cloudIn->points[i] =
+            PointXYZ(static_cast<float>(10.0 * rand() / RAND_MAX),
+                     static_cast<float>(10.0 * rand() / RAND_MAX),
+                     static_cast<float>(10.0 * rand() / RAND_MAX));
+
+    OctreePointCloudSearch<PointXYZ> octree(0.2);
+    octree.setInputCloud(cloudIn);
+    octree.addPointsFromInputCloud();
+
+    // Rays from inside and outside of the octree, in all directions, and
+    // along the axes
+    std::vector<Eigen::Vector3f> origins, directions;
+    for (int i = 0; i < 1000; ++i) {
+        origins.push_back(Eigen::Vector3f(
+            static_cast<float>(-2.0 + 14.0 * rand() / RAND_MAX),
+            static_cast<float>(-2.0 + 14.0 * rand() / RAND_MAX),
+            static_cast<float>(-2.0 + 14.0 * rand() / RAND_MAX)));
+        Eigen::Vector3f direction(
+            static_cast<float>(-1.0 + 2.0 * rand() / RAND_MAX),
+            static_cast<float>(-1.0 + 2.0 * rand() / RAND_MAX),
+            static_cast<float>(-1.0 + 2.0 * rand() / RAND_MAX));
+        if (i % 10 == 0)
+            direction(i % 3) = 0.0f;
+        directions.push_back(direction);
+    }
+
+    for (int maxVoxelCount = 0; maxVoxelCount < 4; maxVoxelCount += 3) {
+        OctreePointCloudSearch<PointXYZ>::AlignedPointTVector voxelCenters;
+        std::vector<size_t> offsets;
+        Neighborhoods neighborhoods;
+        octree.getIntersectedVoxelCenters(origins, directions, voxelCenters,
+                                          offsets, maxVoxelCount, 4);
+        octree.getIntersectedVoxelIndices(origins, directions, neighborhoods,
+                                          maxVoxelCount, 4);
+        ASSERT_EQ(offsets.size(), origins.size() + 1);
+        ASSERT_EQ(neighborhoods.size(), origins.size());
+
+        // Same voxels and indices, in the same order, as the single rays
+        for (size_t i = 0; i < origins.size(); ++i) {
+            OctreePointCloudSearch<PointXYZ>::AlignedPointTVector rayCenters;
+            std::vector<int> rayIndices;
+            octree.getIntersectedVoxelCenters(origins[i], directions[i],
+                                              rayCenters, maxVoxelCount);
+            octree.getIntersectedVoxelIndices(origins[i], directions[i],
+                                              rayIndices, maxVoxelCount);
+
+            ASSERT_EQ(offsets[i + 1] - offsets[i], rayCenters.size());
+            for (size_t j = 0; j < rayCenters.size(); ++j) {
+                const PointXYZ &center = voxelCenters[offsets[i] + j];
+                EXPECT_EQ(center.x, rayCenters[j].x);
+                EXPECT_EQ(center.y, rayCenters[j].y);
+                EXPECT_EQ(center.z, rayCenters[j].z);
+            }
+
+            ASSERT_EQ(neighborhoods.getNumberOfNeighbors(i),
+                      static_cast<int>(rayIndices.size()));
+            for (size_t j = 0; j < rayIndices.size(); ++j) {
+                EXPECT_EQ(neighborhoods.getIndices(i)[j], rayIndices[j]);
+                const PointXYZ &pt = cloudIn->points[rayIndices[j]];
+                EXPECT_FLOAT_EQ(neighborhoods.getSqrDistances(i)[j],
+                                (pt.getVector3fMap() - origins[i])
+                                    .squaredNorm());
+            }
+        }
+    }
+}
+
 /* ---[ */
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,286 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Point Cloud Library (PCL) - www.pointclouds.org
+ *  Copyright (c) 2010-2011, Willow Garage, Inc.
+ *  Copyright (c) 2012-, Open Perception, Inc.
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $Id$
+ *
+ */
+
+#include <gtest/gtest.h>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <pcl/search/hnsw.h>
+#include <pcl/search/impl/hnsw.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/variate_generator.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <limits>
+
+using namespace pcl;
+
+typedef search::HNSW<FPFHSignature33> HNSWSearch;
+
+PointCloud<FPFHSignature33>::Ptr descriptors(new PointCloud<FPFHSignature33>);
+PointCloud<FPFHSignature33>::Ptr queries(new PointCloud<FPFHSignature33>);
+
+/** \brief Clustered random histograms, like the descriptors of a scene. */
+void generateDescriptors(PointCloud<FPFHSignature33> &cloud, size_t size,
+                         unsigned int seed) {
+    boost::mt19937 rng(seed);
+    boost::variate_generator<boost::mt19937 &,
+                             boost::normal_distribution<float>>
+        normal(rng, boost::normal_distribution<float>());
+    boost::mt19937 centers_rng(42);
+    boost::normal_distribution<float> centers_distribution;
+    std::vector<FPFHSignature33> centers(50);
+    for (size_t c = 0; c < centers.size(); ++c)
+        for (int d = 0; d < 33; ++d)
+            centers[c].histogram[d] = 30.0f * centers_distribution(centers_rng);
+
+    cloud.resize(size);
+    for (size_t i = 0; i < size; ++i)
+        for (int d = 0; d < 33; ++d)
+            cloud.points[i].histogram[d] =
+                centers[i % centers.size()].histogram[d] + 10.0f * normal();
+}
+
+/** \brief The exact k nearest neighbors of a query. */
+void bruteForceSearch(const PointCloud<FPFHSignature33> &cloud,
+                      const FPFHSignature33 &query, int k,
+                      std::vector<std::pair<float, int>> &neighbors) {
+    neighbors.clear();
+    for (int i = 0; i < static_cast<int>(cloud.size()); ++i) {
+        float distance = 0.0f;
+        for (int d = 0; d < 33; ++d) {
+            const float diff =
+                cloud.points[i].histogram[d] - query.histogram[d];
+            distance += diff * diff;
+        }
+        if (pcl_isfinite(distance))
+            neighbors.push_back(std::make_pair(distance, i));
+    }
+    std::partial_sort(neighbors.begin(), neighbors.begin() + k,
+                      neighbors.end());
+    neighbors.resize(k);
+}
+
+/** \brief The fraction of the exact k nearest neighbors found. */
+double computeRecall(const HNSWSearch &search, int k) {
+    std::vector<std::pair<float, int>> exact;
+    std::vector<int> k_indices;
+    std::vector<float> k_sqr_distances;
+    size_t found = 0;
+    for (size_t q = 0; q < queries->size(); ++q) {
+        bruteForceSearch(*search.getInputCloud(), queries->points[q], k,
+                         exact);
+        EXPECT_EQ(search.nearestKSearch(queries->points[q], k, k_indices,
+                                        k_sqr_distances),
+                  k);
+        for (int i = 0; i < k; ++i)
+            found += std::count(k_indices.begin(), k_indices.end(),
+                                exact[i].second);
+    }
+    return (static_cast<double>(found) / (queries->size() * k));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+TEST(PCL, HNSW_Recall) {
+    HNSWSearch search;
+    search.setInputCloud(descriptors);
+
+    // The recall grows with the beam width, up to almost exact results
+    search.setEf(10);
+    const double low_recall = computeRecall(search, 10);
+    search.setEf(200);
+    const double high_recall = computeRecall(search, 10);
+    EXPECT_LE(low_recall, high_recall);
+    EXPECT_GE(low_recall, 0.5);
+    EXPECT_GE(high_recall, 0.98);
+
+    // The results are sorted and their distances exact
+    std::vector<int> k_indices;
+    std::vector<float> k_sqr_distances;
+    search.nearestKSearch(queries->points[0], 20, k_indices, k_sqr_distances);
+    for (size_t i = 0; i < k_indices.size(); ++i) {
+        float distance = 0.0f;
+        for (int d = 0; d < 33; ++d) {
+            const float diff = descriptors->points[k_indices[i]].histogram[d] -
+                               queries->points[0].histogram[d];
+            distance += diff * diff;
+        }
+        EXPECT_NEAR(k_sqr_distances[i], distance, 1e-3f * distance);
+        if (i > 0)
+            EXPECT_LE(k_sqr_distances[i - 1], k_sqr_distances[i]);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+TEST(PCL, HNSW_RadiusSearch) {
+    HNSWSearch search;
+    search.setEf(100);
+    search.setInputCloud(descriptors);
+
+    std::vector<std::pair<float, int>> exact;
+    std::vector<int> k_indices;
+    std::vector<float> k_sqr_distances;
+    for (size_t q = 0; q < queries->size(); q += 10) {
+        bruteForceSearch(*descriptors, queries->points[q], 10, exact);
+        const double radius = std::sqrt(exact[4].first);
+        const int nr_neighbors = search.radiusSearch(
+            queries->points[q], radius, k_indices, k_sqr_distances);
+        EXPECT_LE(nr_neighbors, 5);
+        EXPECT_GE(nr_neighbors, 1);
+        for (int i = 0; i < nr_neighbors; ++i)
+            EXPECT_LE(k_sqr_distances[i], radius * radius);
+
+        EXPECT_EQ(search.radiusSearch(queries->points[q], radius, k_indices,
+                                      k_sqr_distances, 2),
+                  std::min(nr_neighbors, 2));
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+TEST(PCL, HNSW_IndicesAndInvalidPoints) {
+    PointCloud<FPFHSignature33>::Ptr cloud(
+        new PointCloud<FPFHSignature33>(*descriptors));
+    cloud->points[3].histogram[7] = std::numeric_limits<float>::quiet_NaN();
+    boost::shared_ptr<std::vector<int>> indices(new std::vector<int>);
+    for (int i = 0; i < static_cast<int>(cloud->size()); i += 2)
+        indices->push_back(i + 1);
+
+    HNSWSearch search;
+    search.setInputCloud(cloud, indices);
+
+    // Query the points of the subset: each one finds itself
+    std::vector<int> k_indices;
+    std::vector<float> k_sqr_distances;
+    for (size_t i = 0; i < indices->size(); ++i) {
+        const int index = (*indices)[i];
+        if (index == 3) {
+            EXPECT_EQ(search.nearestKSearch(cloud->points[index], 1, k_indices,
+                                            k_sqr_distances),
+                      0);
+            continue;
+        }
+        ASSERT_EQ(search.nearestKSearch(cloud->points[index], 4, k_indices,
+                                        k_sqr_distances),
+                  4);
+        EXPECT_EQ(k_indices[0], index);
+        EXPECT_EQ(k_sqr_distances[0], 0.0f);
+        for (size_t j = 0; j < k_indices.size(); ++j) {
+            EXPECT_EQ(k_indices[j] % 2, 1);
+            EXPECT_NE(k_indices[j], 3);
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+TEST(PCL, HNSW_Batch) {
+    HNSWSearch search;
+    search.setInputCloud(descriptors);
+
+    Neighborhoods neighborhoods;
+    std::vector<int> k_indices;
+    std::vector<float> k_sqr_distances;
+    search.nearestKSearch(*queries, std::vector<int>(), 8, neighborhoods, 4);
+    ASSERT_EQ(neighborhoods.size(), queries->size());
+    for (size_t q = 0; q < queries->size(); ++q) {
+        search.nearestKSearch(queries->points[q], 8, k_indices,
+                              k_sqr_distances);
+        ASSERT_EQ(neighborhoods.getNumberOfNeighbors(q), 8);
+        for (int i = 0; i < 8; ++i) {
+            EXPECT_EQ(neighborhoods.getIndices(q)[i], k_indices[i]);
+            EXPECT_EQ(neighborhoods.getSqrDistances(q)[i], k_sqr_distances[i]);
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+TEST(PCL, HNSW_SaveLoad) {
+    const std::string file_name = "test_hnsw_index.bin";
+    HNSWSearch search(true, 12, 100);
+    search.setInputCloud(descriptors);
+    ASSERT_TRUE(search.saveIndex(file_name));
+
+    // The loaded graph gives the same results as the saved one
+    HNSWSearch loaded;
+    ASSERT_TRUE(loaded.loadIndex(file_name, descriptors));
+    EXPECT_EQ(loaded.getInputCloud(), descriptors);
+    std::vector<int> k_indices, loaded_indices;
+    std::vector<float> k_sqr_distances, loaded_sqr_distances;
+    for (size_t q = 0; q < queries->size(); ++q) {
+        search.nearestKSearch(queries->points[q], 10, k_indices,
+                              k_sqr_distances);
+        loaded.nearestKSearch(queries->points[q], 10, loaded_indices,
+                              loaded_sqr_distances);
+        EXPECT_EQ(k_indices, loaded_indices);
+        EXPECT_EQ(k_sqr_distances, loaded_sqr_distances);
+    }
+
+    // Not the cloud the graph was built from
+    boost::shared_ptr<std::vector<int>> indices(new std::vector<int>);
+    for (int i = 0; i < static_cast<int>(descriptors->size()) - 1; ++i)
+        indices->push_back(i);
+    EXPECT_FALSE(loaded.loadIndex(file_name, descriptors, indices));
+    EXPECT_EQ(loaded.nearestKSearch(queries->points[0], 10, loaded_indices,
+                                    loaded_sqr_distances),
+              0);
+    EXPECT_FALSE(loaded.loadIndex("missing_hnsw_index.bin", descriptors));
+
+    // Truncated file
+    std::ifstream in(file_name.c_str(), std::ios::binary);
+    std::vector<char> content((std::istreambuf_iterator<char>(in)),
+                              std::istreambuf_iterator<char>());
+    in.close();
+    std::ofstream out(file_name.c_str(), std::ios::binary);
+    out.write(&content[0], content.size() / 2);
+    out.close();
+    EXPECT_FALSE(loaded.loadIndex(file_name, descriptors));
+    remove(file_name.c_str());
+}
+
+/* ---[ */
+int main(int argc, char **argv) {
+    generateDescriptors(*descriptors, 5000, 1);
+    generateDescriptors(*queries, 200, 2);
+
+    testing::InitGoogleTest(&argc, argv);
+    return (RUN_ALL_TESTS());
+}
+/* ]--- */
@@ -38,12 +38,14 @@
 #include <gtest/gtest.h>
 #include <pcl/search/brute_force.h>
 #include <pcl/search/kdtree.h>
+#include <pcl/search/kdtree_dynamic.h>
 #include <pcl/search/organized.h>
 #include <pcl/search/octree.h>
 #include <pcl/io/pcd_io.h>
 #include "boost.h"
 
 #include <pcl/common/time.h>
+#include <limits>
 
 using namespace pcl;
 using namespace std;
@@ -65,6 +67,9 @@ using namespace std;
 #define TEST_ORGANIZED_SPARSE_VIEW_KNN 1
 #define TEST_ORGANIZED_SPARSE_COMPLETE_RADIUS 1
 #define TEST_ORGANIZED_SPARSE_VIEW_RADIUS 1
+#define TEST_unorganized_sparse_cloud_BATCH 1
+#define TEST_ORGANIZED_SPARSE_BATCH 1
+#define TEST_ORGANIZED_SPARSE_FRAME 1
 
 #if EXCESSIVE_TESTING
 /** \brief number of points used for creating unordered point clouds */
@@ -115,6 +120,14 @@ pcl::search::BruteForce<pcl::PointXYZ> brute_force;
 /** \brief instance of KDTree search method to be tested*/
 pcl::search::KdTree<pcl::PointXYZ> KDTree;
 
+/** \brief instance of KDTree search method based on KdTreeStatic to be
+ * tested*/
+pcl::search::KdTree<pcl::PointXYZ, pcl::KdTreeStatic<pcl::PointXYZ>>
+    kdtree_static;
+
+/** \brief instance of KdTreeDynamic search method to be tested*/
+pcl::search::KdTreeDynamic<pcl::PointXYZ> kdtree_dynamic;
+
 /** \brief instance of Octree search method to be tested*/
 pcl::search::Octree<pcl::PointXYZ> octree_search(0.1);
 
@@ -455,6 +468,77 @@ void testRadiusSearch(typename PointCloud<PointT>::ConstPtr point_cloud,
     }
 }
 
+/** \brief checks that the batch searches of all the search methods, run on
+ * several threads, return exactly the results of the single query searches
+ * \param cloud the input point cloud \param search_methods vector of all
+ * search methods to be tested \param query_indices indices of query points
+ * in the point cloud
+ */
+template <typename PointT>
+void testBatchSearch(typename PointCloud<PointT>::ConstPtr point_cloud,
+                     vector<search::Search<PointT> *> search_methods,
+                     const vector<int> &query_indices) {
+    vector<int> indices;
+    vector<float> distances;
+    Neighborhoods neighborhoods;
+
+    for (size_t sIdx = 0; sIdx < search_methods.size(); ++sIdx) {
+        search::Search<PointT> &search = *search_methods[sIdx];
+        search.setInputCloud(point_cloud);
+        bool passed = true;
+
+        for (int knn = 1; knn <= 64; knn <<= 3) {
+            search.nearestKSearch(*point_cloud, query_indices, knn,
+                                  neighborhoods, 4);
+            passed = passed && neighborhoods.size() == query_indices.size();
+            for (size_t qIdx = 0; passed && qIdx < query_indices.size();
+                 ++qIdx) {
+                search.nearestKSearch(point_cloud->points[query_indices[qIdx]],
+                                      knn, indices, distances);
+                passed = neighborhoods.getNumberOfNeighbors(qIdx) ==
+                             int(indices.size()) &&
+                         std::equal(indices.begin(), indices.end(),
+                                    neighborhoods.getIndices(qIdx)) &&
+                         std::equal(distances.begin(), distances.end(),
+                                    neighborhoods.getSqrDistances(qIdx));
+            }
+        }
+
+        for (unsigned max_nn = 0; max_nn <= 8; max_nn += 8) {
+            search.radiusSearch(*point_cloud, query_indices, 0.04,
+                                neighborhoods, max_nn, 4);
+            passed = passed && neighborhoods.size() == query_indices.size();
+            for (size_t qIdx = 0; passed && qIdx < query_indices.size();
+                 ++qIdx) {
+                search.radiusSearch(point_cloud->points[query_indices[qIdx]],
+                                    0.04, indices, distances, max_nn);
+                passed = neighborhoods.getNumberOfNeighbors(qIdx) ==
+                             int(indices.size()) &&
+                         std::equal(indices.begin(), indices.end(),
+                                    neighborhoods.getIndices(qIdx)) &&
+                         std::equal(distances.begin(), distances.end(),
+                                    neighborhoods.getSqrDistances(qIdx));
+            }
+        }
+
+        // A bound far above the cloud size must neither reserve memory for it
+        // nor change the neighbors found
+        Neighborhoods all_neighborhoods;
+        search.radiusSearch(*point_cloud, query_indices, 0.04,
+                            all_neighborhoods, 0, 4);
+        search.radiusSearch(*point_cloud, query_indices, 0.04, neighborhoods,
+                            std::numeric_limits<unsigned int>::max(), 4);
+        passed = passed &&
+                 neighborhoods.offsets == all_neighborhoods.offsets &&
+                 neighborhoods.indices == all_neighborhoods.indices &&
+                 neighborhoods.sqr_distances == all_neighborhoods.sqr_distances;
+
+        cout << search.getName() << ": " << (passed ? "passed" : "failed")
+             << endl;
+        EXPECT_TRUE(passed);
+    }
+}
+
 #if TEST_unorganized_dense_cloud_COMPLETE_KNN
 // Test search on unorganized point clouds
 TEST(PCL, unorganized_dense_cloud_Complete_KNN) {
@@ -569,6 +653,112 @@ TEST(PCL, Organized_Sparse_View_Radius) {
 }
 #endif
 
+#if TEST_unorganized_sparse_cloud_BATCH
+// Test batch search on unorganized point clouds
+TEST(PCL, unorganized_sparse_cloud_Batch) {
+    testBatchSearch(unorganized_sparse_cloud, unorganized_search_methods,
+                    unorganized_sparse_cloud_query_indices);
+}
+#endif
+
+#if TEST_ORGANIZED_SPARSE_BATCH
+// Test batch search on organized point clouds
+TEST(PCL, Organized_Sparse_Batch) {
+    testBatchSearch(organized_sparse_cloud, organized_search_methods,
+                    organized_sparse_query_indices);
+}
+
+// The batch searches have to stay visible next to the single query searches
+// declared by the search classes
+template <typename SearchT>
+void testDerivedBatchSearch(SearchT &search) {
+    Neighborhoods neighborhoods;
+    search.setInputCloud(organized_sparse_cloud);
+    search.nearestKSearch(*organized_sparse_cloud,
+                          organized_sparse_query_indices, 8, neighborhoods);
+    EXPECT_EQ(neighborhoods.size(), organized_sparse_query_indices.size());
+    search.radiusSearch(*organized_sparse_cloud,
+                        organized_sparse_query_indices, 0.04, neighborhoods);
+    EXPECT_EQ(neighborhoods.size(), organized_sparse_query_indices.size());
+}
+
+TEST(PCL, Organized_Sparse_Derived_Batch) {
+    testDerivedBatchSearch(brute_force);
+    testDerivedBatchSearch(KDTree);
+    testDerivedBatchSearch(octree_search);
+    testDerivedBatchSearch(organized);
+}
+#endif
+
+#if TEST_ORGANIZED_SPARSE_FRAME
+// Test whole frame radius searches and the reuse of the projection matrix
+// between frames of OrganizedNeighbor
+TEST(PCL, Organized_Sparse_Frame) {
+    pcl::search::OrganizedNeighbor<PointXYZ> search;
+    search.setInputCloud(organized_sparse_cloud);
+    ASSERT_TRUE(search.isValid());
+    Eigen::Matrix3f camera_matrix, frame_camera_matrix;
+    search.computeCameraMatrix(camera_matrix);
+
+    // Another, noisy, scene seen by the same sensor: the projection matrix is
+    // kept
+    PointCloud<PointXYZ>::Ptr frame(
+        new PointCloud<PointXYZ>(*organized_sparse_cloud));
+    for (size_t pIdx = 0; pIdx < frame->size(); ++pIdx) {
+        frame->points[pIdx].getVector3fMap() *= 1.0f + 0.01f * (pIdx % 50);
+        frame->points[pIdx].x += 1e-4f * (float(pIdx % 3) - 1.0f);
+    }
+    search.setInputCloud(frame);
+    search.computeCameraMatrix(frame_camera_matrix);
+    EXPECT_TRUE(camera_matrix == frame_camera_matrix);
+
+    // Other focal lengths: it is estimated again
+    for (size_t pIdx = 0; pIdx < frame->size(); ++pIdx) {
+        frame->points[pIdx].x *= 0.5f;
+        frame->points[pIdx].y *= 0.5f;
+    }
+    search.setInputCloud(frame);
+    ASSERT_TRUE(search.isValid());
+    search.computeCameraMatrix(frame_camera_matrix);
+    EXPECT_NEAR(2.0f * camera_matrix(0, 0), frame_camera_matrix(0, 0),
+                1e-2f * camera_matrix(0, 0));
+    EXPECT_NEAR(2.0f * camera_matrix(1, 1), frame_camera_matrix(1, 1),
+                1e-2f * camera_matrix(1, 1));
+
+    // All the points of the frame at once, with the same results as the
+    // single queries
+    vector<int> indices;
+    vector<float> distances;
+    Neighborhoods neighborhoods;
+    search.setInputCloud(organized_sparse_cloud);
+    for (int sorted = 0; sorted < 2; ++sorted) {
+        search.setSortedResults(sorted != 0);
+        for (unsigned max_nn = 0; max_nn <= 8; max_nn += 8) {
+            search.radiusSearch(*organized_sparse_cloud, vector<int>(), 0.02,
+                                neighborhoods, max_nn, 4);
+            ASSERT_EQ(organized_sparse_cloud->size(), neighborhoods.size());
+            size_t nr_failed = 0;
+            for (size_t qIdx = 0; qIdx < organized_sparse_cloud->size();
+                 ++qIdx) {
+                indices.clear();
+                distances.clear();
+                if (isFinite(organized_sparse_cloud->points[qIdx]))
+                    search.radiusSearch(organized_sparse_cloud->points[qIdx],
+                                        0.02, indices, distances, max_nn);
+                if (neighborhoods.getNumberOfNeighbors(qIdx) !=
+                        int(indices.size()) ||
+                    !std::equal(indices.begin(), indices.end(),
+                                neighborhoods.getIndices(qIdx)) ||
+                    !std::equal(distances.begin(), distances.end(),
+                                neighborhoods.getSqrDistances(qIdx)))
+                    ++nr_failed;
+            }
+            EXPECT_EQ(0u, nr_failed);
+        }
+    }
+}
+#endif
+
 /** \brief create subset of point in cloud to use as query points
  * \param[out] query_indices resulting query indices - not guaranteed to have
  * size of query_count but guaranteed not to exceed that value \param cloud
@@ -670,15 +860,21 @@ int main(int argc, char **argv) {
 
     brute_force.setSortedResults(true);
     KDTree.setSortedResults(true);
+    kdtree_static.setSortedResults(true);
+    kdtree_dynamic.setSortedResults(true);
     octree_search.setSortedResults(true);
     organized.setSortedResults(true);
 
     unorganized_search_methods.push_back(&brute_force);
     unorganized_search_methods.push_back(&KDTree);
+    unorganized_search_methods.push_back(&kdtree_static);
+    unorganized_search_methods.push_back(&kdtree_dynamic);
     unorganized_search_methods.push_back(&octree_search);
 
     organized_search_methods.push_back(&brute_force);
     organized_search_methods.push_back(&KDTree);
+    organized_search_methods.push_back(&kdtree_static);
+    organized_search_methods.push_back(&kdtree_dynamic);
     organized_search_methods.push_back(&octree_search);
     organized_search_methods.push_back(&organized);
 